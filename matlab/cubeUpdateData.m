@@ -0,0 +1,49 @@
+classdef cubeUpdateData < event.EventData
+	% CUBEUPDATEDATA Data of radarDataCube's updateFinished event
+	%
+	% Every batch decays the whole cube and rewrites only its cells (with
+	% spread pattern around them). Yaw x pitch tiles holding rewritten cells
+	% since the previous event are marked in dirtyTiles with extent of range
+	% bins which may have changed in them, so listeners can limit their work
+	% to dirty regions. Zeroing or resampling of the cubes marks everything.
+
+	properties
+		lastYaw;        % Yaw of the last update (degrees)
+		lastPitch;      % Pitch of the last update (degrees)
+		dirtyTiles;     % logical [tilesYaw x tilesPitch], tile (i, j) covers yaw cells (i-1)*tileSize+1 : i*tileSize
+		dirtyRange;     % [first last] range bins (one based) which may have changed, empty if none
+		tileSize;       % Yaw and pitch cells per tile
+	end
+
+	methods
+		function obj = cubeUpdateData(lastYaw, lastPitch, dirtyTiles, dirtyRange, tileSize)
+			% CUBEUPDATEDATA Creates event data
+			%
+			% Inputs:
+			%   lastYaw ... Yaw of the last update (degrees)
+			%   lastPitch ... Pitch of the last update (degrees)
+			%   dirtyTiles ... logical [tilesYaw x tilesPitch] of rewritten tiles
+			%   dirtyRange ... [first last] range bins which may have changed
+			%   tileSize ... Yaw and pitch cells per tile
+
+			obj.lastYaw = lastYaw;
+			obj.lastPitch = lastPitch;
+			obj.dirtyTiles = dirtyTiles;
+			obj.dirtyRange = dirtyRange;
+			obj.tileSize = tileSize;
+		end
+
+		function dirty = isDirty(obj, yawIdx, pitchIdx)
+			% ISDIRTY Checks if cube cell was rewritten
+			%
+			% Inputs:
+			%   yawIdx ... Yaw index into cube (one based)
+			%   pitchIdx ... Pitch index into cube (one based)
+			%
+			% Output:
+			%   dirty ... true if tile of the cell is dirty
+
+			dirty = obj.dirtyTiles(floor((yawIdx - 1)/obj.tileSize) + 1, floor((pitchIdx - 1)/obj.tileSize) + 1);
+		end
+	end
+end
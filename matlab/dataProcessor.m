@@ -12,6 +12,15 @@ classdef dataProcessor < handle
 		isProcessing = false;      % Flag to prevent overlapping batch jobs
 		hRadarBuffer radarBuffer;  % Circular buffer for raw radar FFT data
 		hDataCube radarDataCube;   % 4D radar data cube manager
+		hPipeline = [];            % Native streaming pipeline (nativePipeline), empty if disabled
+		traceEnabled = false;      % Event tracing (radarPipeline trace commands) is on
+		shmEnabled = false;        % Cubes are exported to shared memory shmName
+		shmName = '/fmcwRadar';    % POSIX shared memory name of the export
+		streamEnabled = false;     % Detections are served on Unix socket streamPath
+		streamPath = '/tmp/fmcwDetections.sock'; % Socket of detection stream server
+		sectorIndexEnabled = false; % Sector queries are answered from index of the cube
+		changeDetectionEnabled = false; % Cube updates are compared with previous sweeps
+		pendingStart = [];         % struct(radarSamples, spreadPattern) of pipeline and export waiting for cube resampling
 
 		% Visualization components
 		hPanel = [];               % UI panel for displays
@@ -20,11 +29,13 @@ classdef dataProcessor < handle
 		hPlot = [];                % Basic plot used to display (Range-"RCS")
 		hAxes = [];                % Axes handle for current visualization
 		hScatter3D = [];           % 3D scatter plot handle (Target-3D)
+		hTracks = [];              % 3D scatter plot handle for confirmed tracks (Target-3D)
 		hLine = [];
 
 		% Display configuration
 		yawIndex = 1;              % Selected yaw index for Range-Doppler view
 		pitchIndex = 21;           % Selected pitch index (default: 21 -> 0°)
+		drawnCell = [];            % [yaw pitch] index shown by Range-Doppler view, empty if not drawn
 		hEditYaw;                  % textbox for yaw input
 		hEditPitch;                % textbox for pitch input
 		hLabelYaw;                 % label for yaw input
@@ -41,16 +52,73 @@ classdef dataProcessor < handle
 		processingParameters;       % Processing configuration parameters
 		calcSpeed = 0;             % Speed calculation flag (legacy)
 		currentVisualizationStyle; % Current display style identifier
+		trackerTime;               % Time base for tracker updates (output of tic)
+		tracks = [];               % Last tracker output [numTracks x 10]
+		appliedSetup = [];         % Preferences applied by last onNewConfigAvailable
+		configGeneration = 0;      % Incremented whenever processing is reconfigured
 
 
 	end
 
+	properties(Constant, Access = private)
+		% processing parameters used only when drawing cube updates
+		displayParameters = {'maxValue', 'dbscanEnable', 'dbscanEpsilon', 'dbscanMinDetections', 'trackingEnable'};
+		% chirps of Doppler batch are within this distance (deg) of the newest one
+		positionTolerance = 6;
+		% larger deviation of chirp interval from mean (fraction of mean) is
+		% handled by NUFFT
+		timingTolerance = 0.2;
+	end
+
 	methods(Static, Access=public)
 
+		function level = reconfigurationLevel(previous, setup)
+			% RECONFIGURATIONLEVEL Classifies change of preferences
+			%
+			% Inputs:
+			%   previous ... setup applied last time (see onNewConfigAvailable),
+			%                empty before first configuration
+			%   setup ... new setup
+			%
+			% Output:
+			%   level ... 'none', 'display' (visualization, display thresholds,
+			%             clustering, tracking), 'processing' (cubes are kept),
+			%             'resample' (range bins changed, cubes are resampled) or
+			%             'rebuild' (cube geometry changed, new cubes)
+
+			if isempty(previous)
+				level = 'rebuild';
+				return;
+			end
+			if isequal(previous, setup)
+				level = 'none';
+				return;
+			end
+
+			changed = @(a, b, fields) ~all(cellfun(@(f) isequal(a.(f), b.(f)), fields));
+			old = previous.processing;
+			new = setup.processing;
+			if changed(old, new, {'speedNFFT', 'calcSpeed', 'calcRaw', 'calcCFAR', 'clutterEnable', 'logCompress'}) || ...
+					changed(previous.roi, setup.roi, {'enabled', 'yawBinMin', 'yawBinMax', 'pitchBinMin', 'pitchBinMax'})
+				level = 'rebuild';
+			elseif changed(old, new, {'rangeNFFT', 'rangeBinWidth'}) || ...
+					changed(previous.roi, setup.roi, {'rangeBinMin', 'rangeBins'}) || ...
+					previous.radarSamples ~= setup.radarSamples
+				level = 'resample';
+			elseif changed(old, new, setdiff(fieldnames(new), dataProcessor.displayParameters)) || ...
+					~isequal(rmfield(previous, {'processing', 'visualization'}), rmfield(setup, {'processing', 'visualization'}))
+				level = 'processing';
+			else
+				level = 'display';
+			end
+		end
+
 		function D = polarEuclidDistance(X, Y)
 			% POLAREUCLIDDISTANCE calculate euclidean distance of two points specified
 			% by their polar coordinates
 			%
+			% Reference for the metric implemented natively by dbscanGrid
+			%
 			% Inputs:
 			%   X ... point X position [range, yaw, pitch]
 			%   Y ... point Y position [range, yaw, pitch]
@@ -82,8 +150,8 @@ classdef dataProcessor < handle
 			D=D./correctiveCoeff; % scale linearly with distance
 		end
 
-		function [yaw, pitch, cfar, rangeDoppler, speed] = ...
-				processBatch(batchRangeFFTs, batchTimes, posTimes, posYaw, posPitch, processingParameters)
+		function [yaw, pitch, cfar, rangeDoppler, speed, profile] = ...
+				processBatch(batchRangeFFTs, batchTimes, posTimes, posYaw, posPitch, processingParameters, dopplerSpectrum, clutterBackground)
 			% PROCESSBATCH Processes FFT batch into CFAR detections and Range-Doppler maps
 			%
 			% Inputs:
@@ -93,6 +161,11 @@ classdef dataProcessor < handle
 			%   posYaw ... Platform yaw angles [1 x N] (degrees)
 			%   posPitch ... Platform pitch angles [1 x N] (degrees)
 			%   processingParameters . Configuration struct (CFAR/FFT params)
+			%   dopplerSpectrum ... Doppler spectrum maintained by streaming engine
+			%                       (optional), if present no slow time FFT is run
+			%                       and only last chirp of the batch is needed
+			%   clutterBackground ... Copy of clutter background of the cell
+			%                         (optional), subtracted before detection
 			%
 			% Outputs:
 			%   yaw ... Final yaw angle (degrees)
@@ -100,16 +173,35 @@ classdef dataProcessor < handle
 			%   cfar ... CFAR detection vector [rangeBins x 1]
 			%   rangeDoppler ... Range-Doppler matrix [rangeBins x dopplerBins]
 			%   speed ... Platform motion speed (m/s)
+			%   profile ... Range profile before clutter subtraction [rangeBins x 1],
+			%               background is updated with it by mergeResults
 
 
+			if nargin < 7
+				dopplerSpectrum = [];
+			end
+			if nargin < 8
+				clutterBackground = [];
+			end
+
 			yaw = posYaw(end);
 			pitch = posPitch(end);
-			distance = (0:(processingParameters.rangeNFFT/2-1))*processingParameters.rangeBinWidth;
+			% range gate of region of interest
+			gate = processingParameters.rangeBinMin + (1:processingParameters.rangeBins);
+			distance = (gate-1)*processingParameters.rangeBinWidth;
 
 			lastFFT = abs(batchRangeFFTs(:,end))';
 
-			rangeProfile = lastFFT(1:processingParameters.rangeNFFT/2);
+			rangeProfile = lastFFT(gate);
 			rangeProfile = ((rangeProfile.^2).*distance.^4)';
+			profile = rangeProfile;
+
+			if processingParameters.clutterEnable == 1 && numel(clutterBackground) == numel(rangeProfile)
+				% subtract static background of this cell before detection, several
+				% workers run at once so they only get a copy and the map is updated
+				% by the single cube writer (radarDataCube.updateClutter)
+				rangeProfile = max(rangeProfile - double(clutterBackground), 0);
+			end
 
 			if processingParameters.calcCFAR == 1
 				cfarDetector = phased.CFARDetector('NumTrainingCells',processingParameters.cfarTraining, ...
@@ -117,7 +209,7 @@ classdef dataProcessor < handle
 				cfarDetector.ThresholdFactor = 'Auto';
 				cfarDetector.ProbabilityFalseAlarm = 1e-3;
 
-				cfar = cfarDetector(rangeProfile, 1:processingParameters.rangeNFFT/2);
+				cfar = cfarDetector(rangeProfile, 1:processingParameters.rangeBins);
 				delete(cfarDetector);
 			else
 				cfar = [];
@@ -149,7 +241,7 @@ classdef dataProcessor < handle
 			% four is totally arbitrary number, given radars capabilities speed
 			% processing is more of an demonstration of processing than anything
 			% practical
-			tolerace = 6;
+			tolerace = dataProcessor.positionTolerance;
 			idxPosition = length(posYaw);
 			for i=length(posYaw):-1:1
 				distanceYaw = abs((mod((posYaw(i)-posYaw(end)) + 180, 360) - 180));
@@ -170,8 +262,13 @@ classdef dataProcessor < handle
 			timeElapsed = posTimes(end) - posTimes(idxPosition);
 			speed = sqrt((sum(rawDiffYaw(idxPosition:end))^2 + sum(rawDiffPitch(idxPosition:end))^2)) / (timeElapsed + 1e-6); % speed falls to zero for some reason
 
-			distanceMap = repmat(distance', [1,processingParameters.speedNFFT]);
-
+			% magnitude, square, r^4 compensation, slicing and cast to single are
+			% done in a single pass by rangeDopplerPower
+			if ~isempty(dopplerSpectrum)
+				rangeDoppler = rangeDopplerPower(dopplerSpectrum, processingParameters.rangeCompensation, ...
+					false, processingParameters.logCompress);
+				return;
+			end
 
 			% Timing based analysis
 			timeDeltas = diff(batchTimes);
@@ -180,7 +277,7 @@ classdef dataProcessor < handle
 			% Check uniformity of sampling (20% threshold)
 			[~, idx] = max(abs(timeDeltas - meanInterval));
 			maxDeviation = timeDeltas(idx) / meanInterval;
-			useNUFFT = maxDeviation > 0.2;
+			useNUFFT = maxDeviation > dataProcessor.timingTolerance;
 
 
 			% Run FFT
@@ -191,23 +288,56 @@ classdef dataProcessor < handle
 				t0 = batchTimes(1);
 				timeRelative = batchTimes - t0;
 				timeTotal = max(timeRelative(end) - timeRelative(1), 0.001);
-				freqDoppler = (-processingParameters.speedNFFT/2 : processingParameters.speedNFFT/2-1) * (1 / timeTotal);
-				% Vectorized NUFFT along slow-time (dim=1), hopefully this is correct
-				tmp = nufft(spectrumns', timeRelative, freqDoppler,1 );
-				tmp = abs(tmp)';
-				%tmp = abs(fftshift(tmp,1))'; % NUFFT spectrum doesn't need shift to be
-				%correct
+				% Native Kaiser-Bessel gridding NUFFT, evaluates same frequencies as
+				% nufft(spectrumns', timeRelative, (-speedNFFT/2:speedNFFT/2-1)/timeTotal)
+				% but only over range bins we keep and in single precision
+				tmp = nufftDoppler(spectrumns(gate, :), timeRelative, timeTotal, processingParameters.speedNFFT);
+				% NUFFT spectrum doesn't need shift to be correct
+				rangeDoppler = rangeDopplerPower(tmp, processingParameters.rangeCompensation, ...
+					false, processingParameters.logCompress);
 			else
-				tmp = abs(fftshift(fft(spectrumns, processingParameters.speedNFFT, 2),2));
+				tmp = fft(spectrumns(gate, :), processingParameters.speedNFFT, 2);
+				rangeDoppler = rangeDopplerPower(tmp, processingParameters.rangeCompensation, ...
+					true, processingParameters.logCompress);
+			end
+		end
+	end
+
+	methods(Static, Access=private)
+		function valid = streamingWindowValid(windowTimes, posTimes, posYaw, posPitch)
+			% STREAMINGWINDOWVALID Checks if streaming Doppler spectrum can be used
+			%
+			% Sliding DFT always covers the last speedNFFT chirps, it's equal to
+			% batch FFT only if chirps are evenly spaced (otherwise NUFFT is
+			% needed) and platform stayed within positionTolerance meanwhile
+			% (otherwise batch is trimmed)
+			%
+			% Inputs:
+			%   windowTimes ... Timestamps of the last speedNFFT chirps
+			%   posTimes ... Platform timestamps
+			%   posYaw ... Platform yaw angles (degrees)
+			%   posPitch ... Platform pitch angles (degrees)
+			%
+			% Output:
+			%   valid ... true if streaming spectrum matches batch processing
+
+			timeDeltas = diff(windowTimes);
+			meanInterval = mean(timeDeltas);
+			if isempty(timeDeltas) || ~(meanInterval > 0) || ...
+					max(abs(timeDeltas - meanInterval)) / meanInterval > dataProcessor.timingTolerance
+				valid = false;
+				return;
 			end
 
-			tmp = tmp(1:processingParameters.rangeNFFT/2, 1:processingParameters.speedNFFT);
-			rangeDoppler = single((tmp.^2).*distanceMap);
+			inWindow = posTimes >= windowTimes(1);
+			distanceYaw = abs(mod(posYaw(inWindow) - posYaw(end) + 180, 360) - 180);
+			distancePitch = posPitch(inWindow) - posPitch(end);
+			valid = all(sqrt(distanceYaw.^2 + distancePitch.^2) <= dataProcessor.positionTolerance);
 		end
 	end
 
 	methods(Access=private)
-		function mergeResults(obj, yaw, pitch, cfar, rangeDoppler, speed)
+		function mergeResults(obj, generation, yaw, pitch, cfar, rangeDoppler, speed, profile)
 			% MERGERESULTS Adds processed data to radarDataCube and triggers batch processing
 			%
 			% by default output from processBatch is only buffered in radarDataCube, if
@@ -215,14 +345,23 @@ classdef dataProcessor < handle
 			% the buffer
 			%
 			% Inputs:
+			%   generation ... configGeneration the batch was started with, results
+			%                  of previous configuration are dropped
 			%   yaw ... Yaw angle (degrees)
 			%   pitch ... Pitch angle (degrees)
 			%   cfar ... CFAR detection vector
 			%   rangeDoppler ... Range-Doppler matrix
 			%   speed ... Platform speed (m/s)
+			%   profile ... Range profile before clutter subtraction
 
+			if generation ~= obj.configGeneration
+				return;
+			end
 
 			obj.hDataCube.addData(yaw, pitch, cfar, rangeDoppler, speed);
+			if obj.processingParameters.clutterEnable == 1
+				obj.hDataCube.updateClutter(yaw, pitch, profile, obj.processingParameters.clutterAlpha);
+			end
 
 			if obj.hDataCube.isBatchFull()
 				fprintf("dataProcessor | mergeResults | starting batch processing\n");
@@ -230,12 +369,33 @@ classdef dataProcessor < handle
 			end
 		end
 
-		function onCubeUpdateFinished(obj)
+		function onCubeUpdateFinished(obj, update)
 			% ONCUBEUPDATEFINISHED Updates visualizations after data cube refresh
 			%
 			% Range-Azimuth -
+			% Range-Doppler - redrawn only when tile of shown cell is dirty,
+			%                 decay alone scales the cell and axes follow it
 			%
 			% Function is called by radarDataCube's updateFinished event
+			%
+			% Input:
+			%   update ... cubeUpdateData with tiles rewritten by the update
+
+			if obj.traceEnabled
+				radarPipeline('trace', 'render', 'B');
+			end
+
+			% tracks are kept up to date regardless of shown view, published
+			% detection stream carries them
+			if obj.processingParameters.trackingEnable == 1 && obj.processingParameters.calcCFAR
+				obj.updateTracks(obj.updateDetections(update));
+			end
+
+			% export runs on its own thread, this only wakes it
+			if obj.shmEnabled
+				[lastUpdateYaw, lastUpdatePitch] = obj.hDataCube.getLastPosition();
+				radarPipeline('shmPublish', lastUpdateYaw, lastUpdatePitch);
+			end
 
 			if strcmp(obj.currentVisualizationStyle,'Range-Azimuth')
 				[lastUpdateYaw, lastUpdatePitch] = obj.hDataCube.getLastPosition();
@@ -243,7 +403,7 @@ classdef dataProcessor < handle
 				% Find the closest pitch bin to the last update's pitch
 				[~, computedPitchIndex] = min(abs(obj.hDataCube.pitchBins - lastUpdatePitch));
 				lineTheta = -deg2rad(lastUpdateYaw) + pi/2;
-				[lineX, lineY] = pol2cart(lineTheta,  obj.processingParameters.rangeNFFT/2);
+				[lineX, lineY] = pol2cart(lineTheta,  obj.processingParameters.rangeBinMin + obj.processingParameters.rangeBins);
 				set(obj.hLine, 'XData', [0, lineX], 'YData', [0, lineY]);
 				if computedPitchIndex == obj.pitchIndex
 					set(obj.hLine, 'Color', 'r'); % red
@@ -278,7 +438,7 @@ classdef dataProcessor < handle
 			elseif strcmp(obj.currentVisualizationStyle, 'Target-3D')
 				% Update platform direction line
 				[lastUpdateYaw, lastUpdatePitch] = obj.hDataCube.getLastPosition();
-				maxRange = (obj.processingParameters.rangeNFFT/2) * obj.processingParameters.rangeBinWidth;
+				maxRange = (obj.processingParameters.rangeBinMin + obj.processingParameters.rangeBins) * obj.processingParameters.rangeBinWidth;
 
 				Xline = maxRange * cosd(lastUpdatePitch) * cosd(-lastUpdateYaw + 90);
 				Yline = maxRange * cosd(lastUpdatePitch) * sind(-lastUpdateYaw + 90);
@@ -292,7 +452,7 @@ classdef dataProcessor < handle
 				% Update data itself
 				idx = find(obj.hDataCube.cfarCube >= obj.cfarDrawThreshold);
 				[rangeBin, yawBin, pitchBin] = ind2sub(size(obj.hDataCube.cfarCube), idx);
-				range = (rangeBin - 1) * obj.processingParameters.rangeBinWidth;
+				range = (rangeBin - 1 + obj.processingParameters.rangeBinMin) * obj.processingParameters.rangeBinWidth;
 				yaw = obj.hDataCube.yawBins(yawBin);
 				pitch = obj.hDataCube.pitchBins(pitchBin);
 
@@ -305,7 +465,9 @@ classdef dataProcessor < handle
 					normalizedRange = range;
 
 					points = [normalizedRange, yaw', pitch'];
-					labels = dbscan(points, obj.processingParameters.dbscanEpsilon, obj.processingParameters.dbscanMinDetections, 'Distance', @(X,Y) dataProcessor.polarEuclidDistance(X, Y));
+					% grid accelerated equivalent of
+					% dbscan(points, eps, minpts, 'Distance', @dataProcessor.polarEuclidDistance)
+					labels = dbscanGrid(points, obj.processingParameters.dbscanEpsilon, obj.processingParameters.dbscanMinDetections);
 
 					validLabels = labels(labels ~= -1); % remove garbage
 					validPoints = points(labels ~= -1, :);
@@ -332,7 +494,9 @@ classdef dataProcessor < handle
 					%set(obj.hScatter3D, 'XData', [0, 1], 'YData', [0, 1], 'ZData', [0,1], 'CData', [0,-Inf]);
 					set(obj.hScatter3D, 'XData', X, 'YData', Y, 'ZData', Z, 'CData', obj.hDataCube.cfarCube(idx));
 				end
-			elseif strcmp(obj.currentVisualizationStyle, 'Range-Doppler')
+			elseif strcmp(obj.currentVisualizationStyle, 'Range-Doppler') && ...
+					(update.isDirty(obj.yawIndex, obj.pitchIndex) || ~isequal(obj.drawnCell, [obj.yawIndex obj.pitchIndex]))
+				obj.drawnCell = [obj.yawIndex obj.pitchIndex];
 				if obj.processingParameters.calcSpeed == 1
 					fprintf("dataProcessor | updateFinished | Updating Range-Doppler Map\n");
 					data = squeeze(obj.hDataCube.rawCube(:, :, obj.yawIndex, obj.pitchIndex));
@@ -345,26 +509,262 @@ classdef dataProcessor < handle
 				end
 			end
 
+			if obj.streamEnabled
+				obj.publishDetections();
+			end
+
 			drawnow limitrate;
 
+			if obj.traceEnabled
+				radarPipeline('trace', 'render', 'E');
+			end
+
 			% java.lang.System.gc();
 		end
 
+		function publishDetections(obj)
+			% PUBLISHDETECTIONS Sends CFAR detections and last tracks to detection
+			% stream server, which filters them for every subscriber
+			%
+			% Detections are cells over cfarDrawThreshold, time is seconds since
+			% configuration (tracker time base)
+
+			detections = zeros(0, 4);
+			if obj.processingParameters.calcCFAR
+				idx = find(obj.hDataCube.cfarCube >= obj.cfarDrawThreshold);
+				[rangeBin, yawBin, pitchBin] = ind2sub(size(obj.hDataCube.cfarCube), idx);
+				detections = [ ...
+					(rangeBin - 1 + obj.processingParameters.rangeBinMin) * obj.processingParameters.rangeBinWidth, ...
+					reshape(obj.hDataCube.yawBins(yawBin), [], 1), ...
+					reshape(obj.hDataCube.pitchBins(pitchBin), [], 1), ...
+					double(obj.hDataCube.cfarCube(idx))];
+			end
+			radarPipeline('streamPublish', toc(obj.trackerTime), detections, obj.tracks);
+		end
+
+		function detections = updateDetections(obj, update)
+			% UPDATEDETECTIONS Extracts detections of the last update for tracker
+			%
+			% Only CFAR cells over cfarDrawThreshold in dirty tiles and range are
+			% taken, rest of the cube holds decayed detections of earlier
+			% batches which were already fed to tracker. With DBSCAN enabled
+			% every cluster is single detection (its centroid), noise is dropped.
+			%
+			% Input:
+			%   update ... cubeUpdateData with tiles rewritten by the update
+			%
+			% Output:
+			%   detections ... cartesian detections [n x 3] (m)
+
+			detections = zeros(0, 3);
+			if isempty(update.dirtyRange) || ~any(update.dirtyTiles(:))
+				return;
+			end
+
+			cube = obj.hDataCube.cfarCube;
+			cubeSize = [size(cube, 1), size(cube, 2), size(cube, 3)];
+			cells = repelem(update.dirtyTiles, update.tileSize, update.tileSize);
+			cells = find(cells(1:cubeSize(2), 1:cubeSize(3)));
+			rangeIdx = update.dirtyRange(1):min(update.dirtyRange(2), cubeSize(1));
+
+			% [range x (yaw x pitch)] view, only dirty columns are copied
+			cube = reshape(cube, cubeSize(1), []);
+			[rangeBin, cellIdx] = find(cube(rangeIdx, cells) >= obj.cfarDrawThreshold);
+			if isempty(rangeBin)
+				return;
+			end
+			[yawBin, pitchBin] = ind2sub(cubeSize(2:3), cells(cellIdx));
+
+			range = (rangeIdx(rangeBin)' - 1 + obj.processingParameters.rangeBinMin) * obj.processingParameters.rangeBinWidth;
+			yaw = reshape(obj.hDataCube.yawBins(yawBin), [], 1);
+			pitch = reshape(obj.hDataCube.pitchBins(pitchBin), [], 1);
+
+			X = range .* cosd(pitch) .* cosd(-yaw + 90);
+			Y = range .* cosd(pitch) .* sind(-yaw + 90);
+			Z = range .* sind(pitch);
+
+			if obj.processingParameters.dbscanEnable == 1
+				labels = dbscanGrid([range, yaw, pitch], obj.processingParameters.dbscanEpsilon, obj.processingParameters.dbscanMinDetections);
+				valid = labels ~= -1;
+				if ~any(valid)
+					return;
+				end
+				[~, ~, clusterIdx] = unique(labels(valid));
+				detections = [ ...
+					accumarray(clusterIdx, X(valid), [], @mean), ...
+					accumarray(clusterIdx, Y(valid), [], @mean), ...
+					accumarray(clusterIdx, Z(valid), [], @mean)];
+			else
+				detections = [X, Y, Z];
+			end
+		end
+
+		function updateTracks(obj, detections)
+			% UPDATETRACKS Feeds detections to tracker and draws confirmed tracks
+			%
+			% Tracks are drawn only in Target-3D view, they are updated always
+			%
+			% Input:
+			%   detections ... cartesian detections [n x 3] (m)
+
+			obj.tracks = targetTracker('update', toc(obj.trackerTime), detections);
+			if isgraphics(obj.hTracks)
+				confirmed = obj.tracks(obj.tracks(:, 10) == 1, :);
+				set(obj.hTracks, 'XData', confirmed(:, 2), 'YData', confirmed(:, 3), 'ZData', confirmed(:, 4));
+			end
+		end
+
 		function onPlatformTriggerYawHit(obj)
 			% ONPLATFORMTRIGGERYAWHIT Resets data cubes on platform position trigger
 			%
 			% Function is called by platformControl's positionTriggerHit event
-			if obj.decayType == 0
+			if obj.decayType == 0 && ~isempty(obj.hPipeline)
+				obj.hPipeline.zeroCubes();
+			elseif obj.decayType == 0
 				obj.hDataCube.zeroCubes();
 			end
 		end
 
+		function onPipelineUpdateFinished(obj)
+			% ONPIPELINEUPDATEFINISHED Forwards cube update of native pipeline
+			%
+			% Function is called by nativePipeline's updateFinished event
+
+			[lastYaw, lastPitch] = obj.hPipeline.getLastPosition();
+			[dirtyTiles, dirtyRange] = obj.hPipeline.getDirtyRegion();
+			obj.hDataCube.externalUpdateFinished(lastYaw, lastPitch, dirtyTiles, dirtyRange);
+		end
+
+		function onCubeResampleFinished(obj, cube)
+			% ONCUBERESAMPLEFINISHED Starts what waited for resampled cube files
+			%
+			% Function is called by radarDataCube's resampleFinished event
+			%
+			% Input:
+			%   cube ... radarDataCube which was resampled
+
+			if cube == obj.hDataCube && ~isempty(obj.pendingStart)
+				obj.startCubeMappers();
+			end
+		end
+
+		function startCubeMappers(obj)
+			% STARTCUBEMAPPERS Starts native pipeline and shared memory export
+			%
+			% Both map cube files, they are started once cubes have their
+			% final range bins (pendingStart of onNewConfigAvailable)
+
+			start = obj.pendingStart;
+			obj.pendingStart = [];
+
+			if obj.processingParameters.nativePipeline == 1
+				obj.startPipeline(start.radarSamples, start.spreadPattern(1), start.spreadPattern(2));
+			end
+
+			if obj.processingParameters.shmExport == 1
+				obj.openSharedMemoryExport();
+			end
+		end
+
+		function startPipeline(obj, radarSamples, spreadPatternYaw, spreadPatternPitch)
+			% STARTPIPELINE Starts native pipeline writing into current data cubes
+			%
+			% Inputs:
+			%   radarSamples ... Number of samples per chirp
+			%   spreadPatternYaw ... Yaw spreading pattern width
+			%   spreadPatternPitch ... Pitch spreading pattern width
+
+			config = obj.processingParameters;
+			config.samples = radarSamples;
+			config.batchSize = obj.hPreferences.getProcessingBatchSize();
+			config.decay = obj.decayType;
+			config.ringSize = obj.processingParameters.pipelineRingSize;
+			config.affinity = obj.processingParameters.pipelineAffinity;
+			config.shedding = obj.processingParameters.pipelineShedding;
+			config.metrics = obj.processingParameters.pipelineMetrics;
+			config.metricsDumpPeriod = obj.processingParameters.pipelineMetricsDumpPeriod;
+			[~, config.poseInterpolation] = obj.hPreferences.getPoseTimelineParameters();
+			if spreadPatternYaw ~= 0 && spreadPatternPitch ~= 0
+				config.spreadPattern = obj.hDataCube.getSpreadPattern();
+			end
+
+			obj.hPipeline = nativePipeline(config, obj.processingParameters.pipelinePollPeriod);
+			addlistener(obj.hPipeline, 'updateFinished', @(~,~) obj.onPipelineUpdateFinished());
+		end
+
+		function openSharedMemoryExport(obj)
+			% OPENSHAREDMEMORYEXPORT Publishes cubes, Range-Azimuth projections and
+			% CFAR detections to POSIX shared memory shmName
+			%
+			% External consumers attach read-only, layout is described in
+			% scripts/shmExport.h
+
+			config = struct();
+			config.rawCubeSize = obj.hDataCube.rawCubeSize;
+			config.calcRaw = obj.processingParameters.calcRaw;
+			config.calcCFAR = obj.processingParameters.calcCFAR;
+			config.rawCubePath = fullfile(pwd, 'rawCube.dat');
+			config.cfarCubePath = fullfile(pwd, 'cfarCube.dat');
+			config.rangeBinWidth = obj.processingParameters.rangeBinWidth;
+			config.rangeBinMin = obj.hDataCube.rangeBinMin;
+			config.yawBinMin = obj.hDataCube.yawBinMin;
+			config.pitchBinMin = obj.hDataCube.pitchBinMin;
+			config.detectionThreshold = obj.cfarDrawThreshold;
+			config.maxDetections = obj.processingParameters.shmMaxDetections;
+			config.slots = obj.processingParameters.shmSlots;
+
+			try
+				radarPipeline('shmOpen', obj.shmName, config);
+				obj.shmEnabled = true;
+			catch ME
+				fprintf("dataProcessor | openSharedMemoryExport | %s\n", ME.message);
+			end
+		end
+
+		function openChangeDetection(obj)
+			% OPENCHANGEDETECTION Starts sweep to sweep change detection
+			%
+			% Native pipeline compares range profile of every frame it writes,
+			% otherwise radarDataCube feeds processed batches. References are
+			% learned from scratch, changes are collected by pollChanges.
+
+			config = struct();
+			% cube may still wait for resampling to new range bins
+			config.rawCubeSize = [obj.processingParameters.rangeBins, 1, obj.hDataCube.rawCubeSize(3:4)];
+			config.rangeBinWidth = obj.processingParameters.rangeBinWidth;
+			config.rangeBinMin = obj.processingParameters.rangeBinMin;
+			config.yawBinMin = obj.hDataCube.yawBinMin;
+			config.pitchBinMin = obj.hDataCube.pitchBinMin;
+			config.alpha = obj.processingParameters.changeAlpha;
+			config.visitGap = obj.processingParameters.changeVisitGap;
+			config.training = obj.processingParameters.cfarTraining;
+			config.guard = obj.processingParameters.cfarGuard;
+			config.pfa = obj.processingParameters.changePfa;
+			config.minRatio = obj.processingParameters.changeMinRatio;
+			config.maxRecords = obj.processingParameters.changeMaxRecords;
+
+			try
+				radarPipeline('changeOpen', config);
+				obj.hDataCube.setChangeDetection(obj.processingParameters.nativePipeline ~= 1);
+				obj.changeDetectionEnabled = true;
+			catch ME
+				fprintf("dataProcessor | openChangeDetection | %s\n", ME.message);
+			end
+		end
+
 		function onNewConfigAvailable(obj)
-			% ONNEWCONFIGAVAILABLE Reinitializes system with new preferences
+			% ONNEWCONFIGAVAILABLE Applies new preferences
 			%
 			% Function is called by preference's newConfigEvent event
-			% Updates processing parameters, visualization mode, and data cubes
-
+			% Only what changed is reconfigured (see reconfigurationLevel): display
+			% settings are applied directly, other processing settings keep the
+			% cubes, change of range bins resamples them and only change of cube
+			% geometry allocates new (zeroed) cubes
+
+			processingParameters = obj.hPreferences.getProcessingParamters();
+			% cubes cover only region of interest, range gate is applied to range
+			% FFTs, positions outside of sector are not processed
+			roi = obj.hPreferences.getProcessingROI();
 			[spreadPatternEnabled, spreadPatternYaw, spreadPatternPitch] = obj.hPreferences.getProcessingSpreadPatternParamters();
 
 			if spreadPatternEnabled == 0
@@ -372,54 +772,205 @@ classdef dataProcessor < handle
 				spreadPatternPitch = 0;
 			end
 
-			obj.processingParameters = obj.hPreferences.getProcessingParamters();
-			visual=obj.hPreferences.getProcessingVisualization();
-			obj.decayType = obj.hPreferences.getDecayType();
+			[radarSamples, ~, ~, ~] = obj.hPreferences.getRadarBasebandParameters();
+			[~, poseInterpolation] = obj.hPreferences.getPoseTimelineParameters();
+			setup = struct( ...
+				'processing', processingParameters, ...
+				'roi', roi, ...
+				'visualization', obj.hPreferences.getProcessingVisualization(), ...
+				'spreadPattern', [spreadPatternYaw, spreadPatternPitch], ...
+				'decayType', obj.hPreferences.getDecayType(), ...
+				'batchSize', obj.hPreferences.getProcessingBatchSize(), ...
+				'radarSamples', radarSamples, ...
+				'poseInterpolation', poseInterpolation);
+			previous = obj.appliedSetup;
+			level = dataProcessor.reconfigurationLevel(previous, setup);
+			obj.appliedSetup = setup;
+			fprintf("dataProcessor | onNewConfigAvailable | %s\n", level);
+
+			if strcmp(level, 'none')
+				return;
+			end
 
+			if strcmp(level, 'display')
+				% read on every cube update, nothing else depends on them
+				for field = dataProcessor.displayParameters
+					obj.processingParameters.(field{1}) = processingParameters.(field{1});
+				end
+				if ~strcmp(setup.visualization, previous.visualization)
+					obj.initializeVisualization(setup.visualization);
+				end
+				return;
+			end
 
-			[radarSamples, ~, ~, ~] = obj.hPreferences.getRadarBasebandParameters();
-			obj.hRadarBuffer = radarBuffer(floor(obj.processingParameters.speedNFFT*1.5), obj.processingParameters.rangeNFFT, radarSamples);
+			% pipeline has cube files mapped, it has to be stopped before they are
+			% resampled or reallocated
+			if ~isempty(obj.hPipeline)
+				delete(obj.hPipeline);
+				obj.hPipeline = [];
+			end
+
+			% export and sector index map cube files as well
+			obj.pendingStart = [];
+			if obj.shmEnabled
+				radarPipeline('shmClose');
+				obj.shmEnabled = false;
+			end
+			if obj.sectorIndexEnabled
+				obj.hDataCube.closeSectorIndex();
+				obj.sectorIndexEnabled = false;
+			end
+			if obj.changeDetectionEnabled
+				obj.hDataCube.setChangeDetection(false);
+				radarPipeline('changeClose');
+				obj.changeDetectionEnabled = false;
+			end
+
+			% trace of previous configuration is kept in pipelineTrace.json
+			if obj.traceEnabled
+				obj.exportTrace(fullfile(pwd, 'pipelineTrace.json'));
+				radarPipeline('traceEnable', 0);
+			end
+
+			% results of batches started with previous configuration are dropped
+			obj.configGeneration = obj.configGeneration + 1;
+
+			obj.processingParameters = processingParameters;
+			obj.processingParameters.roiEnable = roi.enabled;
+			obj.processingParameters.rangeBinMin = roi.rangeBinMin;
+			obj.processingParameters.rangeBins = roi.rangeBins;
+			% r^4 range compensation table of range gate used by rangeDopplerPower
+			obj.processingParameters.rangeCompensation = single((((0:(roi.rangeBins-1)) + roi.rangeBinMin) ...
+				*obj.processingParameters.rangeBinWidth).^4)';
+			obj.decayType = setup.decayType;
+
+			if ~strcmp(level, 'processing')
+				% measurement noise of the tracker is given by range resolution
+				targetTracker('init', obj.processingParameters.rangeBinWidth);
+				obj.trackerTime = tic;
+				obj.tracks = [];
+			end
+
+			if obj.processingParameters.calcSpeed == 1 && obj.processingParameters.streamingDoppler == 1
+				streamingNFFT = obj.processingParameters.speedNFFT;
+			else
+				streamingNFFT = 0;
+			end
+			obj.hRadarBuffer = radarBuffer(floor(obj.processingParameters.speedNFFT*1.5), obj.processingParameters.rangeNFFT, radarSamples, streamingNFFT, ...
+				roi.rangeBinMin, roi.rangeBins);
 
 			if obj.processingParameters.calcSpeed == 0
 				obj.processingParameters.speedNFFT = 1;
 			end
 
-			obj.hDataCube = radarDataCube( ...
-				obj.processingParameters.rangeNFFT/2, ...
-				obj.processingParameters.speedNFFT, ...
-				obj.hPreferences.getProcessingBatchSize(), ...
-				spreadPatternYaw, ...
-				spreadPatternPitch, ...
-				obj.processingParameters.calcRaw , ...
-				obj.processingParameters.calcCFAR, ...
-				obj.decayType ...
-				);
+			if strcmp(level, 'rebuild')
+				obj.hDataCube = radarDataCube( ...
+					roi.rangeBins, ...
+					obj.processingParameters.speedNFFT, ...
+					setup.batchSize, ...
+					spreadPatternYaw, ...
+					spreadPatternPitch, ...
+					obj.processingParameters.calcRaw , ...
+					obj.processingParameters.calcCFAR, ...
+					obj.decayType, ...
+					obj.processingParameters.clutterEnable, ...
+					roi ...
+					);
+				addlistener(obj.hDataCube, 'updateFinished', @(~, update) obj.onCubeUpdateFinished(update));
+				addlistener(obj.hDataCube, 'resampleFinished', @(src, ~) obj.onCubeResampleFinished(src));
+			else
+				% accumulated scene is kept
+				obj.hDataCube.setSpreadPattern(spreadPatternYaw, spreadPatternPitch);
+				obj.hDataCube.setDecay(obj.decayType);
+				obj.hDataCube.setBatchSize(setup.batchSize);
+				if strcmp(level, 'resample')
+					obj.hDataCube.resampleRange(roi.rangeBins, roi.rangeBinMin, ...
+						processingParameters.rangeBinWidth/previous.processing.rangeBinWidth);
+				end
+			end
+
+			obj.traceEnabled = obj.processingParameters.pipelineTrace == 1;
+			if obj.traceEnabled
+				radarPipeline('traceClear');
+				radarPipeline('traceEnable', 1);
+			end
+			obj.hDataCube.setTraceEnabled(obj.traceEnabled);
+			% native pipeline publishes tiles of the same size
+			obj.hDataCube.setDirtyTileSize(obj.processingParameters.dirtyTileSize);
+
+			% cube geometry is needed by native pipeline
+			obj.processingParameters.yawBinMin = obj.hDataCube.yawBinMin;
+			obj.processingParameters.yawBinMax = obj.hDataCube.yawBinMax;
+			obj.processingParameters.pitchBinMin = obj.hDataCube.pitchBinMin;
+			obj.processingParameters.pitchBinMax = obj.hDataCube.pitchBinMax;
+
+			% opened before the pipeline starts, which then keeps it up to date
+			if obj.processingParameters.sectorIndex == 1 && ...
+					(obj.processingParameters.calcRaw == 1 || obj.processingParameters.calcCFAR == 1)
+				try
+					obj.hDataCube.openSectorIndex(obj.processingParameters.rangeBinWidth, ...
+						obj.processingParameters.sectorTileSize);
+					obj.sectorIndexEnabled = true;
+				catch ME
+					fprintf("dataProcessor | onNewConfigAvailable | %s\n", ME.message);
+				end
+			end
+
+			if obj.processingParameters.changeDetection == 1
+				obj.openChangeDetection();
+			end
 
+			% pipeline and export map cube files, resampling waiting for batch in
+			% flight replaces them first (onCubeResampleFinished)
+			obj.pendingStart = struct('radarSamples', radarSamples, ...
+				'spreadPattern', [spreadPatternYaw, spreadPatternPitch]);
+			if ~obj.hDataCube.isResamplePending()
+				obj.startCubeMappers();
+			end
 
+			% stream doesn't depend on cube geometry, server keeps its clients
+			% over reconfiguration
+			if obj.processingParameters.detectionStream == 1 && ~obj.streamEnabled
+				try
+					radarPipeline('streamOpen', obj.streamPath);
+					obj.streamEnabled = true;
+				catch ME
+					fprintf("dataProcessor | onNewConfigAvailable | %s\n", ME.message);
+				end
+			elseif obj.processingParameters.detectionStream == 0 && obj.streamEnabled
+				radarPipeline('streamClose');
+				obj.streamEnabled = false;
+			end
+
+			obj.initializeVisualization(setup.visualization);
+		end
+
+		function initializeVisualization(obj, visual)
+			% INITIALIZEVISUALIZATION Replaces current display with given one
+			%
+			% Input:
+			%   visual ... 'Range-Azimuth', 'Target-3D' or 'Range-Doppler'
 
 			if strcmp(visual, 'Range-Azimuth')
-				fprintf("dataProcessor | onNewConfigAvailable | visualizing as yaw-range map.\n")
+				fprintf("dataProcessor | initializeVisualization | visualizing as yaw-range map.\n")
 				obj.currentVisualizationStyle = 'Range-Azimuth';
 				obj.deinitializeDisplay();
 				obj.initializeARDisplay();
 			end
 
 			if strcmp(visual, 'Target-3D')
-				fprintf("dataProcessor | onNewConfigAvailable | visualizing CFAR in 3D.\n")
+				fprintf("dataProcessor | initializeVisualization | visualizing CFAR in 3D.\n")
 				obj.currentVisualizationStyle = 'Target-3D';
 				obj.deinitializeDisplay();
 				obj.initialize3DDisplay();
 			end
 
 			if strcmp(visual, 'Range-Doppler')
-				fprintf("dataProcessor | onNewConfigAvailable | visualizing Range-Doppler.\n")
+				fprintf("dataProcessor | initializeVisualization | visualizing Range-Doppler.\n")
 				obj.currentVisualizationStyle = 'Range-Doppler';
 				obj.deinitializeDisplay();
 				obj.initializeRDDisplay();
 			end
-
-
-			addlistener(obj.hDataCube, 'updateFinished', @(~,~) obj.onCubeUpdateFinished());
 		end
 
 		function onNewDataAvailable(obj)
@@ -428,6 +979,25 @@ classdef dataProcessor < handle
 			% Function is called by radars's newDataAvailable event
 			% Depending on current configuration if processing is active and platform
 			% position has changed processing will be launched in parallel process
+			% or pushed to native pipeline
+
+			if ~isempty(obj.hPipeline)
+				% range FFT and everything after it runs in native pipeline, chirp is
+				% dropped there (and counted) if pipeline can't keep up
+				if obj.processingActive && obj.hPlatform.usesPoseTimeline()
+					% pose is interpolated from native timeline by the pipeline itself
+					obj.hPipeline.pushChirp(obj.hRadar.bufferI(:, obj.readIdx), ...
+						obj.hRadar.bufferQ(:, obj.readIdx), obj.hRadar.bufferTime(obj.readIdx));
+				elseif obj.processingActive
+					time = obj.hRadar.bufferTime(obj.readIdx);
+					[yaw, pitch] = obj.hPlatform.getPositionAtTime(time);
+					obj.hPipeline.pushChirp(obj.hRadar.bufferI(:, obj.readIdx), ...
+						obj.hRadar.bufferQ(:, obj.readIdx), time, yaw, pitch);
+				end
+				obj.readIdx =  mod(obj.readIdx, obj.radarBufferSize) + 1;
+				return;
+			end
+
 			obj.hRadarBuffer.addChirp(obj.hRadar.bufferI(:, obj.readIdx), ...
 				obj.hRadar.bufferQ(:, obj.readIdx), ...
 				obj.hRadar.bufferTime(obj.readIdx));
@@ -445,6 +1015,15 @@ classdef dataProcessor < handle
 
 				[minTime, maxTime] = obj.hRadarBuffer.getTimeInterval();
 				[posTimes, yaw, pitch] = obj.hPlatform.getPositionsInInterval(minTime, maxTime);
+				% Doppler spectrum is already up to date, only last chirp is needed for
+				% range profile, no need to gather whole batch. Sliding window can't
+				% be trimmed to positionTolerance nor handle irregular chirps, batch
+				% FFT/NUFFT path is taken instead then
+				streaming = obj.processingParameters.calcSpeed == 1 && obj.processingParameters.streamingDoppler == 1 && ...
+					dataProcessor.streamingWindowValid(obj.hRadarBuffer.getLastTimes(obj.processingParameters.speedNFFT), ...
+					posTimes, yaw, pitch);
+				dopplerSpectrum = [];
+
 				if obj.processingParameters.requirePosChange == 1
 
 
@@ -455,24 +1034,54 @@ classdef dataProcessor < handle
 						% to process frames where position has not changed, this data is
 						% only useful for speed calculation
 						return;
-					else
+					elseif ~streaming
 						% we exclude last frame as that one will have different position that the
 						% previous one
 						[batchRangeFFTs, batchTimes] = obj.hRadarBuffer.getSlidingBatchOld();
 						[posTimes, yaw, pitch] = obj.hPlatform.getPositionsInInterval(min(batchTimes), max(batchTimes));
 					end
-				else
+				elseif ~streaming
 					[batchRangeFFTs, batchTimes] = obj.hRadarBuffer.getSlidingBatch();
 
 				end
 
+				if streaming
+					% requirePosChange gates the same way, but newest chirp (at the
+					% new position) is processed instead of batch before it, and
+					% spectrum covers last speedNFFT chirps including it
+					[batchRangeFFTs, batchTimes] = obj.hRadarBuffer.getLastChirp();
+					dopplerSpectrum = obj.hRadarBuffer.getDopplerSpectrum();
+				end
+
+				if obj.hPlatform.usesPoseTimeline() && ~streaming
+					% every chirp gets its own interpolated pose instead of last
+					% platform report for whole batch
+					[yaw, pitch] = obj.hPlatform.getPositionsAtTimes(batchTimes);
+					posTimes = batchTimes;
+				elseif obj.hPlatform.usesPoseTimeline()
+					% pose at the time of the processed chirp closes position history
+					[yaw(end+1), pitch(end+1)] = obj.hPlatform.getPositionsAtTimes(batchTimes);
+					posTimes(end+1) = batchTimes;
+				end
+
+				% outside of region of interest nothing is stored, previous position
+				% is kept
+				if obj.processingParameters.roiEnable
+					[~, ~, inside] = radarDataCube.cellIndex(yaw(end), pitch(end), ...
+						obj.hDataCube.yawBinMin, obj.hDataCube.yawBinMax, ...
+						obj.hDataCube.pitchBinMin, obj.hDataCube.pitchBinMax, true);
+					if ~inside
+						return;
+					end
+				end
+
 				% this needs to stay this way regardless if we take last frame or not;
 				obj.lastProcesingYaw = yaw(end);
 				obj.lastProcesingPitch = pitch(end);
 
 
 
-				% [ yaw, pitch, cfar, rangeDoppler, speed] = dataProcessor.processBatch( ...
+				% [ yaw, pitch, cfar, rangeDoppler, speed, profile] = dataProcessor.processBatch( ...
 				% 		batchRangeFFTs,  ...
 				% 		batchTimes, ...
 				% 		posTimes, ...
@@ -480,18 +1089,27 @@ classdef dataProcessor < handle
 				% 		pitch, ...
 				% 		obj.processingParameters);
 				%
-				% obj.mergeResults(yaw, pitch, cfar, rangeDoppler, speed);
+				% obj.mergeResults(obj.configGeneration, yaw, pitch, cfar, rangeDoppler, speed, profile);
+
+				% workers subtract copy of the background, map is updated in mergeResults
+				clutterBackground = [];
+				if obj.processingParameters.clutterEnable == 1
+					clutterBackground = obj.hDataCube.getClutterBackground(yaw(end), pitch(end));
+				end
 
 				%fprintf("dataProcessor | onNewDataAvailable | processing: yaw: %f, pitch %f\n", yaw(end), pitch(end));
 				future = parfeval(obj.parallelPool, ...
-					@dataProcessor.processBatch, 5, ...
+					@dataProcessor.processBatch, 6, ...
 					batchRangeFFTs, ...
 					batchTimes, ...
 					posTimes, ...
 					yaw, ...
 					pitch, ...
-					obj.processingParameters);
-				afterAll(future, @(varargin) obj.mergeResults(varargin{:}), 0);
+					obj.processingParameters, ...
+					dopplerSpectrum, ...
+					clutterBackground);
+				generation = obj.configGeneration;
+				afterAll(future, @(varargin) obj.mergeResults(generation, varargin{:}), 0);
 			else
 				fprintf("dataProcessor | onNewDataAvailable | pool empty\n");
 			end
@@ -538,6 +1156,10 @@ classdef dataProcessor < handle
 			if ~isempty(obj.hPlot)
 				delete(obj.hPlot)
 			end
+
+			if ~isempty(obj.hTracks)
+				delete(obj.hTracks)
+			end
 			obj.hAxes = [];
 			obj.hSurf = [];
 			obj.hEditPitch = [];
@@ -545,6 +1167,8 @@ classdef dataProcessor < handle
 			obj.hImage = [];
 			obj.hPlot = [];
 			obj.hLine = [];
+			obj.hTracks = [];
+			obj.drawnCell = [];
 			obj.hLabelPitch = [];
 			obj.hLabelYaw = [];
 		end
@@ -555,18 +1179,21 @@ classdef dataProcessor < handle
 			obj.hAxes = axes('Parent', obj.hPanel, ...
 				'Units', 'pixels');
 
-			yawBins = 360;
+			yawBins = length(obj.hDataCube.yawBins);
+			maxBin = obj.processingParameters.rangeBinMin + obj.processingParameters.rangeBins;
 
 			theta = -deg2rad(obj.hDataCube.yawBins)+pi/2; % minus to rotate counter clock wise, +pi/2 to center 0 deg
-			r = 1:(obj.processingParameters.rangeNFFT/2);
+			r = obj.processingParameters.rangeBinMin + (1:obj.processingParameters.rangeBins);
 			[THETA, R] = meshgrid(theta, r);
 			[X, Y] = pol2cart(THETA, R);
 
-			initialData = zeros((obj.processingParameters.rangeNFFT/2), yawBins);
+			initialData = zeros(obj.processingParameters.rangeBins, yawBins);
 
-			X = [X, X(:,1)]; % Add 360° = 0°
-			Y = [Y, Y(:,1)];
-			initialData(:, end) = initialData(:, 1);
+			if yawBins >= 360
+				X = [X, X(:,1)]; % Add 360° = 0°
+				Y = [Y, Y(:,1)];
+				initialData(:, end) = initialData(:, 1);
+			end
 
 			obj.hSurf = surf(obj.hAxes, X, Y, zeros(size(X)), initialData,...
 				'EdgeColor', 'none',...
@@ -601,7 +1228,7 @@ classdef dataProcessor < handle
 			hold(obj.hAxes, 'on');
 
 
-			circleRadii = linspace(0, obj.processingParameters.rangeNFFT/2, 6);
+			circleRadii = linspace(0, maxBin, 6);
 
 			markerColor = [0.9 0.9 0.9];
 			for r = circleRadii(2:end)
@@ -616,7 +1243,7 @@ classdef dataProcessor < handle
 			angles = [0, 45, 90, 135, 180, 225, 270, 315];
 			for angle = angles
 				th = -deg2rad(angle) + pi/2;  % Match coordinate system rotation
-				[x, y] = pol2cart(th, obj.processingParameters.rangeNFFT/2);
+				[x, y] = pol2cart(th, maxBin);
 				plot(obj.hAxes, [0, x], [0, y], '--', 'Color', markerColor, 'LineWidth', 1/ (mod(angle,2)+1));
 			end
 
@@ -629,7 +1256,7 @@ classdef dataProcessor < handle
 		function initialize3DDisplay(obj)
 			% INITIALIZE3DDISPLAY Creates 3D scatter plot for target visualization
 
-			maxRange = obj.processingParameters.rangeNFFT/2* obj.processingParameters.rangeBinWidth;
+			maxRange = (obj.processingParameters.rangeBinMin + obj.processingParameters.rangeBins)* obj.processingParameters.rangeBinWidth;
 
 			xlimits = [-maxRange, maxRange];
 			ylimits = [-maxRange, maxRange];
@@ -665,6 +1292,13 @@ classdef dataProcessor < handle
 				);
 			obj.hLine = plot3(obj.hAxes, [0, 0], [0, 0], [0, 0], ...
 				'Color', 'r', 'LineWidth', 2, 'Visible', 'on');
+			obj.hTracks = scatter3(obj.hAxes, [], [], [], ...
+				'Marker', 'o', ...
+				'SizeData', 150, ...
+				'MarkerEdgeColor', [0 0 0], ...
+				'LineWidth', 1.5, ...
+				'DisplayName', 'Tracks' ...
+				);
 
 			hold(obj.hAxes, 'off');
 
@@ -706,12 +1340,12 @@ classdef dataProcessor < handle
 			% initilaize axes, two text boxes, one for yaw, second for pitch
 			if(obj.processingParameters.calcSpeed)
 
-				maxRange = obj.processingParameters.rangeNFFT/2* obj.processingParameters.rangeBinWidth;
 				maxSpeed = obj.processingParameters.speedNFFT/2*obj.hPreferences.getSpeedBinWidth();
 				initialData = zeros(obj.processingParameters.speedNFFT, ...
-					obj.processingParameters.rangeNFFT/2);
+					obj.processingParameters.rangeBins);
 				speedBins = linspace(-maxSpeed, maxSpeed-obj.hPreferences.getSpeedBinWidth(), obj.processingParameters.speedNFFT)*1000;
-				rangeBins = linspace(0, maxRange, obj.processingParameters.rangeNFFT/2);
+				rangeBins = ((0:obj.processingParameters.rangeBins-1) + obj.processingParameters.rangeBinMin) ...
+					*obj.processingParameters.rangeBinWidth;
 
 				obj.hImage = imagesc(obj.hAxes, ...
 					rangeBins, ...
@@ -728,8 +1362,8 @@ classdef dataProcessor < handle
 				ylabel(obj.hAxes, 'Speed [mm/s]');
 				colormap(obj.hAxes, 'jet');
 			else
-				maxRange = obj.processingParameters.rangeNFFT/2* obj.processingParameters.rangeBinWidth;
-				rangeBins = linspace(0, maxRange, obj.processingParameters.rangeNFFT/2);
+				rangeBins = ((0:obj.processingParameters.rangeBins-1) + obj.processingParameters.rangeBinMin) ...
+					*obj.processingParameters.rangeBinWidth;
 				initialData = zeros(length(rangeBins));  % Row vector for initial YData
 
 				obj.hPlot = plot(obj.hAxes, rangeBins, initialData);
@@ -791,7 +1425,6 @@ classdef dataProcessor < handle
 
 			obj.parallelPool = gcp('nocreate'); % Start parallel pool
 
-			% TODO -> move some of these paramters to be updateable on the fly
 			fprintf("dataProcessor | dataProcessor |  starting gui\n");
 
 			obj.onNewConfigAvailable();
@@ -857,6 +1490,119 @@ classdef dataProcessor < handle
 		end
 
 
+		function tracks = getTracks(obj)
+			% GETTRACKS Returns tracks from last 3D update
+			%
+			% Output:
+			%   tracks ... [numTracks x 10] rows of id, x, y, z, vx, vy, vz, age,
+			%              hits, confirmed
+
+			tracks = obj.tracks;
+		end
+
+		function stats = getPipelineStats(obj)
+			% GETPIPELINESTATS Returns frame counters of native pipeline
+			%
+			% Output:
+			%   stats ... struct with processed and dropped frames per stage, empty
+			%             if native pipeline is disabled
+
+			if isempty(obj.hPipeline)
+				stats = [];
+				return;
+			end
+			stats = obj.hPipeline.getStats();
+		end
+
+		function count = exportTrace(obj, path)
+			% EXPORTTRACE Writes recorded trace events as Chrome Trace Event JSON
+			%
+			% Input:
+			%   path ... Output file, opens in chrome://tracing or Perfetto
+			%
+			% Output:
+			%   count ... Number of exported events
+
+			count = radarPipeline('traceExport', path);
+		end
+
+		function stats = getDetectionStreamStats(obj)
+			% GETDETECTIONSTREAMSTATS Returns counters of detection stream server
+			%
+			% Output:
+			%   stats ... struct(clients, published, frames, droppedFrames,
+			%             droppedUpdates), empty if server is disabled
+
+			if ~obj.streamEnabled
+				stats = [];
+				return;
+			end
+			stats = radarPipeline('streamStats');
+		end
+
+		function stats = getSharedMemoryStats(obj)
+			% GETSHAREDMEMORYSTATS Returns counters of shared memory export
+			%
+			% Output:
+			%   stats ... struct(requests, published, truncated), empty if export
+			%             is disabled
+
+			if ~obj.shmEnabled
+				stats = [];
+				return;
+			end
+			stats = radarPipeline('shmStats');
+		end
+
+		function result = querySectors(obj, sectors)
+			% QUERYSECTORS Total and maximum energy of cube sectors
+			%
+			% Input:
+			%   sectors ... [n x 6] yawMin, yawMax, pitchMin, pitchMax (deg),
+			%               rangeMin, rangeMax (m), see radarDataCube.querySectors
+			%
+			% Output:
+			%   result ... [n x 3] sum, maximum and cells of every sector, empty
+			%              if sector index is disabled
+
+			if ~obj.sectorIndexEnabled
+				result = [];
+				return;
+			end
+			result = obj.hDataCube.querySectors(sectors);
+		end
+
+		function changes = pollChanges(obj)
+			% POLLCHANGES Returns cells changed since the last sweep
+			%
+			% Output:
+			%   changes ... [n x 6] time, range (m), yaw, pitch (deg), value and
+			%               reference of range bins whose change against
+			%               reference of their cell exceeded adaptive threshold
+			%               since last poll, empty if change detection is disabled
+
+			if ~obj.changeDetectionEnabled
+				changes = [];
+				return;
+			end
+			changes = radarPipeline('changePoll');
+		end
+
+		function metrics = getPipelineMetrics(obj)
+			% GETPIPELINEMETRICS Returns stage latencies of native pipeline
+			%
+			% Output:
+			%   metrics ... struct with latency percentiles per stage and frame
+			%               counters (nativePipeline.getMetrics), empty if native
+			%               pipeline is disabled
+
+			if isempty(obj.hPipeline)
+				metrics = [];
+				return;
+			end
+			metrics = obj.hPipeline.getMetrics();
+		end
+
 		function status = toggleProcessing(obj)
 			% TOGGLEPROCESSING Enables/disables data processing
 			%
@@ -0,0 +1,207 @@
+classdef nativePipeline < handle
+	% NATIVEPIPELINE Handle for native streaming pipeline (radarPipeline mex)
+	%
+	% Chirps are pushed into native ingest ring, range FFT, Doppler, CFAR and
+	% cube update run in long lived native threads connected by lock-free rings
+	% and write directly into rawCube.dat/cfarCube.dat. Finished cube updates
+	% are polled by a timer which fires updateFinished.
+
+	properties(Access = private)
+		pollTimer;              % Timer polling pipeline for finished cube updates
+		lastGeneration = 0;     % Generation of last cube update notified
+		metricsFile = '';       % CSV file metrics are appended to, empty = no dump
+		metricsPeriod = 0;      % Period of metrics dump (s)
+		lastMetricsDump;        % tic of last metrics dump
+	end
+
+	properties(Access = public)
+		lastYaw = 0;            % Yaw of last cube update (degrees)
+		lastPitch = 0;          % Pitch of last cube update (degrees)
+		dirtyTiles = [];        % Tiles rewritten since previous notified update, logical [tilesYaw x tilesPitch]
+		dirtyRange = [];        % [first last] range bins which may have changed in dirtyTiles
+	end
+
+	events
+		updateFinished          % called when pipeline finished cube update
+	end
+
+	methods(Access = private)
+		function poll(obj)
+			% POLL Checks pipeline for finished cube updates
+			%
+			% Function is called by pollTimer
+
+			status = radarPipeline('poll');
+			if status.generation ~= obj.lastGeneration
+				obj.lastGeneration = status.generation;
+				obj.lastYaw = status.lastYaw;
+				obj.lastPitch = status.lastPitch;
+				% tiles are taken with generation, poll without new one has none
+				obj.dirtyTiles = status.dirtyTiles;
+				obj.dirtyRange = status.dirtyRange;
+				notify(obj, 'updateFinished');
+			end
+
+			if ~isempty(obj.metricsFile) && toc(obj.lastMetricsDump) >= obj.metricsPeriod
+				obj.lastMetricsDump = tic;
+				radarPipeline('metricsDump', obj.metricsFile);
+			end
+		end
+	end
+
+	methods(Access = public)
+		function obj = nativePipeline(config, pollPeriod)
+			% NATIVEPIPELINE Starts native pipeline
+			%
+			% Inputs:
+			%   config ... processing parameters (preferences.getProcessingParamters)
+			%              extended with samples, batchSize, decay, spreadPattern,
+			%              yawBinMin, yawBinMax, pitchBinMin, pitchBinMax,
+			%              rangeBinMin, rangeBins, roiEnable (chirps outside
+			%              of the cube are dropped before range FFT) and
+			%              optionally ringSize, affinity (first core or core per
+			%              stage, -1 = no pinning), shedding (load shedding
+			%              under backpressure), metrics (latency histograms),
+			%              metricsDumpPeriod (s, 0 = no dump), streams (number
+			%              of radars feeding the cube, default 1), mountYaw and
+			%              mountPitch (mounting offset of every radar added to
+			%              platform pose, degrees), dirtyTileSize (yaw and
+			%              pitch cells per tile of dirty bitmap, default 8) and
+			%              cube file paths
+			%   pollPeriod ... period of polling for finished cube updates (s)
+
+			if nargin < 2
+				pollPeriod = 0.05;
+			end
+
+			% cube files are opened by native code, relative paths would be resolved
+			% against process working directory
+			config.rawCubePath = fullfile(pwd, 'rawCube.dat');
+			config.cfarCubePath = fullfile(pwd, 'cfarCube.dat');
+			config.clutterCubePath = fullfile(pwd, 'clutterCube.dat');
+
+			radarPipeline('start', config);
+
+			if isfield(config, 'metrics') && config.metrics && ...
+					isfield(config, 'metricsDumpPeriod') && config.metricsDumpPeriod > 0
+				obj.metricsFile = fullfile(pwd, 'pipelineMetrics.csv');
+				obj.metricsPeriod = config.metricsDumpPeriod;
+				obj.lastMetricsDump = tic;
+			end
+
+			obj.pollTimer = timer;
+			obj.pollTimer.Period = pollPeriod;
+			obj.pollTimer.ExecutionMode = 'fixedSpacing';
+			obj.pollTimer.BusyMode = 'drop';
+			obj.pollTimer.TimerFcn = @(~,~) obj.poll();
+			start(obj.pollTimer);
+		end
+
+		function accepted = pushChirp(obj, I, Q, time, yaw, pitch)
+			% PUSHCHIRP Offers chirp to the pipeline, never blocks
+			%
+			% Inputs:
+			%   I ... In-phase samples
+			%   Q ... Quadrature samples
+			%   time ... Timestamp of the chirp
+			%   yaw ... Platform yaw at chirp time (degrees, optional)
+			%   pitch ... Platform pitch at chirp time (degrees, optional)
+			%             without pose it is interpolated from native pose timeline
+			%
+			% Output:
+			%   accepted ... false if chirp was dropped because ingest ring was full
+
+			if nargin < 6
+				accepted = radarPipeline('push', I, Q, time);
+			else
+				accepted = radarPipeline('push', I, Q, time, yaw, pitch);
+			end
+		end
+
+		function accepted = pushStreamChirp(obj, stream, I, Q, time, yaw, pitch)
+			% PUSHSTREAMCHIRP Offers chirp of one of several radars, never blocks
+			%
+			% Every radar stream has its own ingest ring, range FFT and Doppler
+			% thread, streams merge into the same cubes.
+			%
+			% Inputs:
+			%   stream ... Radar stream (1 - config.streams)
+			%   I, Q, time ... as in pushChirp
+			%   yaw, pitch ... Platform pose at chirp time (degrees, optional),
+			%                  mounting offset of the stream is added natively
+			%
+			% Output:
+			%   accepted ... false if chirp was dropped because ingest ring was full
+
+			if nargin < 7
+				accepted = radarPipeline('pushStream', stream, I, Q, time);
+			else
+				accepted = radarPipeline('pushStream', stream, I, Q, time, yaw, pitch);
+			end
+		end
+
+		function [yaw, pitch] = getLastPosition(obj)
+			% GETLASTPOSITION return position of the last cube update
+			%
+			% Outputs:
+			%   yaw ... yaw angle  (0-360°)
+			%   pitch ... Pitch angle (-90°-90°)
+
+			yaw = obj.lastYaw;
+			pitch = obj.lastPitch;
+		end
+
+		function [tiles, range] = getDirtyRegion(obj)
+			% GETDIRTYREGION return tiles rewritten by the last notified updates
+			%
+			% Outputs:
+			%   tiles ... logical [tilesYaw x tilesPitch] of dirtyTileSize cells
+			%   range ... [first last] range bins (one based), empty if none
+
+			tiles = obj.dirtyTiles;
+			range = obj.dirtyRange;
+		end
+
+		function stats = getStats(obj)
+			% GETSTATS Returns processed and dropped frame counters of all stages
+			%
+			% Output:
+			%   stats ... struct, dropped is total of all dropped frames,
+			%             shedLevel is 0 (none), 1 (same cell frames coalesced),
+			%             2 (Doppler skipped) or 3 (raw cube skipped)
+
+			stats = radarPipeline('stats');
+		end
+
+		function metrics = getMetrics(obj)
+			% GETMETRICS Returns latency histograms summary and frame counters
+			%
+			% Output:
+			%   metrics ... struct, field per stage (ingest, rangeFFT, doppler,
+			%               cfar, cubeUpdate, handoff) with count, min, mean,
+			%               p50, p90, p99, p999 and max latency (s), counters
+			%               framesIn, dropped and coalesced
+
+			metrics = radarPipeline('metrics');
+		end
+
+		function setMetricsEnabled(obj, enable)
+			% SETMETRICSENABLED Switches latency measurement of running pipeline
+			radarPipeline('metricsEnable', enable);
+		end
+
+		function zeroCubes(obj)
+			% ZEROCUBES Zeroes cubes before next cube update
+			radarPipeline('zero');
+		end
+
+		function delete(obj)
+			% DELETE Stops polling and pipeline threads
+			if ~isempty(obj.pollTimer) && isvalid(obj.pollTimer)
+				stop(obj.pollTimer);
+				delete(obj.pollTimer);
+			end
+			radarPipeline('stop');
+		end
+	end
+end
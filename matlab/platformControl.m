@@ -37,6 +37,12 @@ classdef platformControl < handle
 		positionYaw;                  % Array of yaw positions
 		positionPitch;                % Array of pitch positions
 		currentIdx double = 1;        % Circular buffer write index
+		poseTimeline = false;         % Positions are also kept in native timeline (radarPipeline)
+		poseInterpolation = 1;        % Interpolation of native timeline (0 nearest, 1 linear, 2 cubic)
+		nativeReader = false;         % Serial is read by native reader (radarPipeline) instead of serialport
+		nativeReaderOpen = false;     % Native reader is currently connected
+		messageTimer;                 % Timer draining replies and log lines of native reader
+		lastTriggerCount = 0;         % Yaw trigger hits of native reader already notified
 
 		angleOffsetYaw = 0;           % Yaw calibration offset (degrees)
 		angleOffsetPitch = 0;         % Pitch calibration offset (degrees)
@@ -263,8 +269,66 @@ classdef platformControl < handle
 
 			value = append(get(obj.hEditCommand, 'String'));
 			set(obj.hEditCommand, 'String', '');
-			flush(obj.hSerial);
-			writeline(obj.hSerial, value);
+			obj.flushSerial();
+			obj.sendCommand(value);
+		end
+
+		function sendCommand(obj, command)
+			% SENDCOMMAND writes command line to the platform
+			%
+			% Line is terminated by CR, goes through native reader if it is used
+			if obj.nativeReaderOpen
+				radarPipeline('platformWrite', char(command));
+			else
+				writeline(obj.hSerial, command);
+			end
+		end
+
+		function flushSerial(obj)
+			% FLUSHSERIAL clears serialport buffers, native reader consumes input
+			% continuously so there is nothing to clear
+			if ~obj.nativeReaderOpen
+				flush(obj.hSerial);
+			end
+		end
+
+		function connected = isConnected(obj)
+			% ISCONNECTED returns true if serial connection to the platform is open
+			connected = ~isempty(obj.hSerial) || obj.nativeReaderOpen;
+		end
+
+		function settings = nativeReaderSettings(obj)
+			% NATIVEREADERSETTINGS offsets and yaw trigger for native reader
+			settings = struct('offsetYaw', obj.angleOffsetYaw, ...
+				'offsetPitch', obj.angleOffsetPitch, ...
+				'triggerYaw', obj.angleTriggerYaw, ...
+				'triggerTolerance', obj.angleTriggerYawTorelance);
+		end
+
+		function pollNativeReader(obj)
+			% POLLNATIVEREADER drains replies and log lines of native reader
+			%
+			% Function is called by messageTimer, positions never pass through
+			% MATLAB, yaw trigger hits are counted natively
+			status = radarPipeline('platformPoll');
+			for i = 1:numel(status.messages)
+				obj.processMessage(string(status.messages{i}));
+			end
+			if status.triggers > obj.lastTriggerCount
+				obj.lastTriggerCount = status.triggers;
+				notify(obj, 'positionTriggerHit');
+			end
+		end
+
+		function closeNativeReader(obj)
+			% CLOSENATIVEREADER stops message timer and native reader thread
+			if ~isempty(obj.messageTimer) && isvalid(obj.messageTimer)
+				stop(obj.messageTimer);
+				delete(obj.messageTimer);
+			end
+			obj.messageTimer = [];
+			radarPipeline('platformClose');
+			obj.nativeReaderOpen = false;
 		end
 
 
@@ -278,10 +342,6 @@ classdef platformControl < handle
 				return;
 			end
 
-			if length(obj.log) > 200
-				obj.log(1) = [];
-			end
-
 			if strncmp(line,'!P',2)
 				tmp = char(line);
 				vals = strtrim(split(tmp(3:end), ','));
@@ -290,6 +350,11 @@ classdef platformControl < handle
 				obj.positionYaw(obj.currentIdx) = mod(str2double(vals{2})-obj.angleOffsetYaw,360);
 				obj.positionPitch(obj.currentIdx) = str2double(vals{3})-obj.angleOffsetPitch;
 
+				if obj.poseTimeline
+					radarPipeline('posePush', obj.positionTimes(obj.currentIdx), ...
+						obj.positionYaw(obj.currentIdx), obj.positionPitch(obj.currentIdx));
+				end
+
 				if obj.angleTriggerYaw ~= -1 && ...
 						(mod(obj.positionYaw(obj.currentIdx) - obj.angleTriggerYaw, 360) <= 2*obj.angleTriggerYawTorelance) && ...
 						toc(obj.angleTriggerYawTimestamp) > 1
@@ -299,7 +364,20 @@ classdef platformControl < handle
 
 				obj.currentIdx = mod(obj.currentIdx, obj.bufferSize) + 1;
 				return;
-			elseif strncmp(line,'!R',2)
+			end
+			obj.processMessage(line);
+		end
+
+		function processMessage(obj, line)
+			% PROCESSMESSAGE displays reply or log line coming from the platform
+			%
+			% replies are always shown, log only when platform debug is enabled
+
+			if length(obj.log) > 200
+				obj.log(1) = [];
+			end
+
+			if strncmp(line,'!R',2)
 				obj.log{end+1} = line;
 				set(obj.hTextOut, 'String', obj.log);
 				return;
@@ -371,10 +449,10 @@ classdef platformControl < handle
 		function startProgram(obj)
 			% STARTPROGRAM starts picked program on the platform
 
-			flush(obj.hSerial);
-			writeline(obj.hSerial, "M82"); % stop current move
-			writeline(obj.hSerial, "P1 "+obj.currentProgramName);
-			flush(obj.hSerial);
+			obj.flushSerial();
+			obj.sendCommand("M82"); % stop current move
+			obj.sendCommand("P1 "+obj.currentProgramName);
+			obj.flushSerial();
 		end
 
 		function uploadProgram(obj)
@@ -383,8 +461,8 @@ classdef platformControl < handle
 			% P90 and P92 commands are automatically added, user is not expected
 			% to enter them in program declarations
 
-			flush(obj.hSerial);
-			writeline(obj.hSerial, "P90 "+obj.currentProgramName);
+			obj.flushSerial();
+			obj.sendCommand("P90 "+obj.currentProgramName);
 			valueHeader = get(obj.hEditProgramHeader, 'String');
 			trimmedHeader = (strtrim(string(valueHeader)));
 			disp(trimmedHeader);
@@ -392,10 +470,10 @@ classdef platformControl < handle
 				if ~isstring(trimmedHeader(i))  || trimmedHeader(i) == ""
 					continue;
 				end
-				writeline(obj.hSerial, trimmedHeader(i));
+				obj.sendCommand(trimmedHeader(i));
 				pause(0.04); % incoming buffer on ESP32 is not infinite so we introduce a small delay
 			end
-			writeline(obj.hSerial, "P91");
+			obj.sendCommand("P91");
 			valueMain = get(obj.hEditProgramMain, 'String');
 			trimmedMain = (strtrim(string(valueMain)));
 			disp(trimmedMain);
@@ -403,12 +481,12 @@ classdef platformControl < handle
 				if ~isstring(trimmedMain(i)) || trimmedMain(i) == ""
 					continue;
 				end
-				writeline(obj.hSerial, trimmedMain(i));
+				obj.sendCommand(trimmedMain(i));
 				pause(0.04); % incoming buffer on ESP32 is not infinite so we introduce a small delay
 			end
 
-			writeline(obj.hSerial, "P92");
-			flush(obj.hSerial);
+			obj.sendCommand("P92");
+			obj.flushSerial();
 		end
 
 		function onNewConfigAvailable(obj)
@@ -417,6 +495,11 @@ classdef platformControl < handle
 			% Function is called by preference's newConfigEvent event
 			% Yaw trigger is configured, step count is sent to the platform
 			[obj.angleOffsetYaw, obj.angleOffsetPitch, obj.stepCountYaw , obj.stepCountPitch] = obj.hPreferences.getPlatformParamters();
+			[obj.poseTimeline, obj.poseInterpolation] = obj.hPreferences.getPoseTimelineParameters();
+			obj.nativeReader = obj.hPreferences.getPlatformNativeReader() == 1;
+			if obj.nativeReader || obj.nativeReaderOpen
+				obj.poseTimeline = true; % native reader only feeds native timeline
+			end
 
 			if obj.hPreferences.getDecayType() == 0
 				obj.angleTriggerYaw = mod(obj.hPreferences.getTriggerYaw()-obj.angleTriggerYawTorelance, 360);
@@ -424,10 +507,14 @@ classdef platformControl < handle
 				obj.angleTriggerYaw = -1;
 			end
 
-			if ~isempty(obj.hSerial)
+			if obj.nativeReaderOpen
+				radarPipeline('platformSettings', obj.nativeReaderSettings());
+			end
+
+			if obj.isConnected()
 				command = "M92 Y"+obj.stepCountYaw + " P"+obj.stepCountPitch;
-				flush(obj.hSerial);
-				writeline(obj.hSerial, command);
+				obj.flushSerial();
+				obj.sendCommand(command);
 			end
 		end
 
@@ -463,6 +550,9 @@ classdef platformControl < handle
 				configureCallback(obj.hSerial, "off");
 				delete(obj.hSerial)
 			end
+			if obj.nativeReaderOpen
+				obj.closeNativeReader();
+			end
 			if ~isempty(obj.mockDataTimer)
 				stop(obj.mockDataTimer);
 				delete(obj.mockDataTimer);
@@ -491,6 +581,11 @@ classdef platformControl < handle
 			% return;
 
 			% NORMAL
+			if obj.nativeReaderOpen
+				obj.closeNativeReader();
+				status = false;
+				return;
+			end
 			if ~isempty(obj.hSerial)
 				configureCallback(obj.hSerial, "off");
 				delete(obj.hSerial);
@@ -499,6 +594,29 @@ classdef platformControl < handle
 				return;
 			end
 			[port, baudrate] = obj.hPreferences.getConnectionPlatform();
+			if obj.nativeReader
+				try
+					fprintf("platFormControl | setupSerial | native reader port: %s, baud: %f\n", port, baudrate)
+					radarPipeline('platformOpen', char(port), baudrate, toc(obj.startTime), obj.nativeReaderSettings());
+					obj.nativeReaderOpen = true;
+					obj.lastTriggerCount = 0;
+
+					obj.sendCommand("M92 Y"+obj.stepCountYaw + " P"+obj.stepCountPitch); % send step count
+
+					obj.messageTimer = timer;
+					obj.messageTimer.Period = 0.2;
+					obj.messageTimer.ExecutionMode = 'fixedSpacing';
+					obj.messageTimer.BusyMode = 'drop';
+					obj.messageTimer.TimerFcn = @(~,~) obj.pollNativeReader();
+					start(obj.messageTimer);
+					status = true;
+				catch ME
+					fprintf("platFormControl | setupSerial | Failed to setup native reader: %s\n", ME.message)
+					obj.nativeReaderOpen = false;
+					status = false;
+				end
+				return;
+			end
 			try
 				fprintf("platFormControl | setupSerial | port: %s, baud: %f\n", port, baudrate)
 				obj.hSerial = serialport(port, baudrate, "Timeout", 5);
@@ -522,7 +640,7 @@ classdef platformControl < handle
 		function stopPlatform(obj)
 			% STOPPLATFORM Emergency stop command for platform
 			command = "M82"; % clears queues, issues stop requests, shuts down power
-			writeline(obj.hSerial, command);
+			obj.sendCommand(command);
 		end
 
 		function [yaw, pitch] = getLastPosition(obj)
@@ -531,6 +649,10 @@ classdef platformControl < handle
 			% Outputs:
 			%   yaw ... yaw angle  (0-360°)
 			%   pitch ... Pitch angle (-90°-90°)
+			if obj.poseTimeline
+				[yaw, pitch] = radarPipeline('poseAt', Inf, 0);
+				return;
+			end
 			idx = mod(obj.currentIdx-1, obj.bufferSize);
 			yaw = obj.positionYaw(idx);
 			pitch = obj.positionPitch(idx);
@@ -547,6 +669,17 @@ classdef platformControl < handle
 			%   timestamps ... Vector of timestamps
 			%   yaw        ... Corresponding yaw angles vector
 			%   pitch      ... Corresponding pitch angles vector
+
+			if obj.poseTimeline
+				% binary search in native timeline, at least one pose is returned
+				[timestamps, yaw, pitch] = radarPipeline('poseInterval', timeMin, timeMax);
+				if isempty(timestamps)
+					timestamps = timeMax;
+					[yaw, pitch] = radarPipeline('poseAt', timeMax, obj.poseInterpolation);
+				end
+				return;
+			end
+
 			[~, idxMin] = min(abs(obj.positionTimes - timeMin));
 			[~, idxMax] = min(abs(obj.positionTimes - timeMax));
 
@@ -572,6 +705,11 @@ classdef platformControl < handle
 			% Outputs:
 			%   yaw  ... Yaw angle (0-360°)
 			%   pitch ... Pitch angle (-90°-90°)
+			if obj.poseTimeline
+				[yaw, pitch] = radarPipeline('poseAt', time, obj.poseInterpolation);
+				return;
+			end
+
 			if isempty(obj.positionTimes)
 				error('No position data available.');
 			end
@@ -580,6 +718,35 @@ classdef platformControl < handle
 			pitch = obj.positionPitch(idx);
 		end
 
+		function [yaw, pitch] = getPositionsAtTimes(obj, times)
+			% GETPOSITIONSATTIMES Returns platform position for every timestamp
+			%
+			% With native timeline positions are interpolated (wrap safe in yaw) in
+			% single call, otherwise closest stored position is used
+			%
+			% Input:
+			%   times ... Vector of timestamps
+			%
+			% Outputs:
+			%   yaw  ... Yaw angles (0-360°), same shape as times
+			%   pitch ... Pitch angles (-90°-90°), same shape as times
+			if obj.poseTimeline
+				[yaw, pitch] = radarPipeline('poseAt', times, obj.poseInterpolation);
+				return;
+			end
+
+			yaw = zeros(size(times));
+			pitch = zeros(size(times));
+			for i = 1:numel(times)
+				[yaw(i), pitch(i)] = obj.getPositionAtTime(times(i));
+			end
+		end
+
+		function enabled = usesPoseTimeline(obj)
+			% USESPOSETIMELINE Returns true if positions are kept in native timeline
+			enabled = obj.poseTimeline;
+		end
+
 		function showGUI(obj)
 			% SHOWGUI displays generated GUI that is hidden
 			if isempty(obj.hFig) | ~isvalid(obj.hFig)
@@ -96,6 +96,11 @@ classdef preferences < handle
 			obj.configStruct.radar.adc=obj.availableADC(1);
 			obj.configStruct.radar.trigger=25;
 			obj.configStruct.radar.ramps = obj.availableRamps(1);
+			obj.configStruct.radar.nativeReader = 0;
+			obj.configStruct.radar.nativeTrigger = 0;
+			obj.configStruct.radar.triggerAngleStep = 0;
+			obj.configStruct.radar.capture = 0;
+			obj.configStruct.radar.captureSegmentRecords = 65536;
 
 			obj.configStruct.platform.port='none';
 			obj.configStruct.platform.baudrate=obj.availableBaudrates(1);
@@ -104,6 +109,9 @@ classdef preferences < handle
 			obj.configStruct.platform.debug=1;
 			obj.configStruct.platform.stepCountYaw = 200;
 			obj.configStruct.platform.stepCountPitch = 200;
+			obj.configStruct.platform.poseTimeline = 0;
+			obj.configStruct.platform.poseInterpolation = 1;
+			obj.configStruct.platform.nativeReader = 0;
 
 			obj.configStruct.processing.visualization=obj.availableVisualization(1);
 			obj.configStruct.processing.speedNFFT=8;
@@ -126,6 +134,39 @@ classdef preferences < handle
 			obj.configStruct.processing.dbscanEnable = 1;
 			obj.configStruct.processing.maxValue = 50000;
 			obj.configStruct.processing.dbscanEpsilon = 2;
+			obj.configStruct.processing.streamingDoppler = 0;
+			obj.configStruct.processing.logCompress = 0;
+			obj.configStruct.processing.trackingEnable = 0;
+			obj.configStruct.processing.clutterEnable = 0;
+			obj.configStruct.processing.clutterAlpha = 0.05;
+			obj.configStruct.processing.nativePipeline = 0;
+			obj.configStruct.processing.pipelineRingSize = 64;
+			obj.configStruct.processing.pipelineAffinity = -1;
+			obj.configStruct.processing.pipelinePollPeriod = 0.05;
+			obj.configStruct.processing.pipelineShedding = 1;
+			obj.configStruct.processing.pipelineMetrics = 0;
+			obj.configStruct.processing.pipelineMetricsDumpPeriod = 0;
+			obj.configStruct.processing.pipelineTrace = 0;
+			obj.configStruct.processing.shmExport = 0;
+			obj.configStruct.processing.shmMaxDetections = 4096;
+			obj.configStruct.processing.shmSlots = 3;
+			obj.configStruct.processing.detectionStream = 0;
+			obj.configStruct.processing.sectorIndex = 0;
+			obj.configStruct.processing.sectorTileSize = 8;
+			obj.configStruct.processing.changeDetection = 0;
+			obj.configStruct.processing.changeAlpha = 1;
+			obj.configStruct.processing.changeVisitGap = 1;
+			obj.configStruct.processing.changePfa = 1e-4;
+			obj.configStruct.processing.changeMinRatio = 4;
+			obj.configStruct.processing.changeMaxRecords = 4096;
+			obj.configStruct.processing.dirtyTileSize = 8;
+			obj.configStruct.processing.roiEnable = 0;
+			obj.configStruct.processing.roiYawMin = 0;
+			obj.configStruct.processing.roiYawMax = 359;
+			obj.configStruct.processing.roiPitchMin = -20;
+			obj.configStruct.processing.roiPitchMax = 60;
+			obj.configStruct.processing.roiRangeMin = 0;
+			obj.configStruct.processing.roiRangeMax = 0;
 
 			obj.configStruct.programs=[];
 
@@ -204,6 +245,32 @@ classdef preferences < handle
 			% processingParameters.dbscanRange	= obj.configStruct.processing.dbscanRange;
 			processingParameters.dbscanEpsilon = obj.configStruct.processing.dbscanEpsilon;
 			processingParameters.dbscanMinDetections =	obj.configStruct.processing.dbscanMinDetections;
+			processingParameters.streamingDoppler = obj.configStruct.processing.streamingDoppler;
+			processingParameters.logCompress = obj.configStruct.processing.logCompress; % range-Doppler maps stored in dB
+			processingParameters.trackingEnable = obj.configStruct.processing.trackingEnable;
+			processingParameters.clutterEnable = obj.configStruct.processing.clutterEnable;
+			processingParameters.clutterAlpha = obj.configStruct.processing.clutterAlpha; % clutter map EMA coefficient per visit
+			processingParameters.nativePipeline = obj.configStruct.processing.nativePipeline;
+			processingParameters.pipelineRingSize = obj.configStruct.processing.pipelineRingSize; % frames per ring between stages
+			processingParameters.pipelineAffinity = obj.configStruct.processing.pipelineAffinity; % first core for stage threads, -1 = no pinning
+			processingParameters.pipelinePollPeriod = obj.configStruct.processing.pipelinePollPeriod; % (s)
+			processingParameters.pipelineShedding = obj.configStruct.processing.pipelineShedding; % shed work under backpressure instead of dropping frames
+			processingParameters.pipelineMetrics = obj.configStruct.processing.pipelineMetrics; % stage latency histograms
+			processingParameters.pipelineMetricsDumpPeriod = obj.configStruct.processing.pipelineMetricsDumpPeriod; % (s), 0 = no pipelineMetrics.csv dump
+			processingParameters.pipelineTrace = obj.configStruct.processing.pipelineTrace; % event tracing, exported to pipelineTrace.json
+			processingParameters.shmExport = obj.configStruct.processing.shmExport; % publish cubes and detections to POSIX shared memory
+			processingParameters.shmMaxDetections = obj.configStruct.processing.shmMaxDetections; % capacity of exported detection list
+			processingParameters.shmSlots = obj.configStruct.processing.shmSlots; % copies of exported arrays, readers of the newest one have numSlots - 1 publications of time
+			processingParameters.detectionStream = obj.configStruct.processing.detectionStream; % serve detections and tracks on Unix socket
+			processingParameters.sectorIndex = obj.configStruct.processing.sectorIndex; % summed-area tables for sector queries (dataProcessor.querySectors)
+			processingParameters.sectorTileSize = obj.configStruct.processing.sectorTileSize; % yaw and pitch cells per tile of incremental index update
+			processingParameters.changeDetection = obj.configStruct.processing.changeDetection; % sweep to sweep change detection (dataProcessor.pollChanges)
+			processingParameters.changeAlpha = obj.configStruct.processing.changeAlpha; % reference update per visit, 1 = previous sweep, small = long EMA
+			processingParameters.changeVisitGap = obj.configStruct.processing.changeVisitGap; % (s) frames of a cell further apart belong to the next visit
+			processingParameters.changePfa = obj.configStruct.processing.changePfa; % false alarm probability of change threshold
+			processingParameters.changeMinRatio = obj.configStruct.processing.changeMinRatio; % change has to rise above or drop below references of the cell and its yaw neighbours by this factor
+			processingParameters.changeMaxRecords = obj.configStruct.processing.changeMaxRecords; % changes kept between polls
+			processingParameters.dirtyTileSize = obj.configStruct.processing.dirtyTileSize; % yaw and pitch cells per tile of dirty bitmap published with cube updates
 		end
 
 		function [port, baudrate] = getConnectionPlatform(obj)
@@ -236,6 +303,54 @@ classdef preferences < handle
 			debug = obj.configStruct.platform.debug;
 		end
 
+		function [enabled] = getRadarNativeReader(obj)
+			% GETRADARNATIVEREADER Checks if radar serial is read by native reader
+			%
+			% Native reader assembles frames in own thread and stamps them with
+			% monotonic clock at arrival of their last byte
+			%
+			% Output:
+			%   enabled ... 1 (enabled) or 0 (disabled)
+			enabled = obj.configStruct.radar.nativeReader;
+		end
+
+		function [nativeTrigger, angleStep] = getRadarTriggerMode(obj)
+			% GETRADARTRIGGERMODE Returns how radar trigger is generated
+			%
+			% Native trigger needs native radar reader, angle locked mode needs
+			% native pose timeline
+			%
+			% Output:
+			%   nativeTrigger ... 1 trigger from native timerfd thread, 0 MATLAB timer
+			%   angleStep ... yaw step between triggers (degrees), 0 = periodic
+			nativeTrigger = obj.configStruct.radar.nativeTrigger;
+			angleStep = obj.configStruct.radar.triggerAngleStep;
+		end
+
+		function [enabled, segmentRecords] = getRadarCapture(obj)
+			% GETRADARCAPTURE Returns raw I/Q capture settings
+			%
+			% Capture writes frames of native radar reader with receive time and
+			% interpolated pose to segment files for offline reprocessing
+			%
+			% Output:
+			%   enabled ... 1 (enabled) or 0 (disabled)
+			%   segmentRecords ... Chirps per preallocated segment file
+			enabled = obj.configStruct.radar.capture;
+			segmentRecords = obj.configStruct.radar.captureSegmentRecords;
+		end
+
+		function [enabled] = getPlatformNativeReader(obj)
+			% GETPLATFORMNATIVEREADER Checks if platform serial is read by native reader
+			%
+			% Native reader parses positions in own thread and feeds native pose
+			% timeline, MATLAB only receives replies and log lines
+			%
+			% Output:
+			%   enabled ... 1 (enabled) or 0 (disabled)
+			enabled = obj.configStruct.platform.nativeReader;
+		end
+
 
 		function header = getRadarFrontend(obj)
 			% GETRADARFRONTEND Returns the radar's frequency header
@@ -340,6 +455,16 @@ classdef preferences < handle
 			stepCountYaw = 	obj.configStruct.platform.stepCountYaw;
 		end
 
+		function [enabled, interpolation] = getPoseTimelineParameters(obj)
+			% GETPOSETIMELINEPARAMETERS Returns settings of native pose timeline
+			%
+			% Output:
+			%   enabled ... Platform positions are kept in native timeline
+			%   interpolation ... 0 nearest, 1 linear, 2 cubic
+			enabled = obj.configStruct.platform.poseTimeline;
+			interpolation = obj.configStruct.platform.poseInterpolation;
+		end
+
 
 
 		function time = getRampTime(obj)
@@ -369,6 +494,42 @@ classdef preferences < handle
 				/(2*abs(obj.configStruct.radar.bandwidth)*1e6*obj.configStruct.processing.rangeNFFT);
 		end
 
+		function roi = getProcessingROI(obj)
+			% GETPROCESSINGROI Returns region of interest covered by data cubes
+			%
+			% Sector and range gate given in degrees and meters are converted to
+			% cube bins, same as setRegionOfInterest of scripts/radarPipeline.h.
+			% roiYawMin may be negative for sector over 0 deg, roiRangeMax of 0
+			% means up to the last range bin. Without roiEnable whole default cube
+			% is returned.
+			%
+			% Output:
+			%   roi ... struct(enabled, yawBinMin, yawBinMax, pitchBinMin,
+			%           pitchBinMax, rangeBinMin, rangeBins), rangeBinMin is zero
+			%           based
+			p = obj.configStruct.processing;
+			lastBin = p.rangeNFFT/2 - 1;
+			roi = struct('enabled', false, 'yawBinMin', 0, 'yawBinMax', 359, ...
+				'pitchBinMin', -20, 'pitchBinMax', 60, 'rangeBinMin', 0, 'rangeBins', lastBin + 1);
+			if p.roiEnable == 0
+				return;
+			end
+
+			binWidth = obj.getRangeBinWidth();
+			roi.enabled = true;
+			roi.yawBinMin = round(p.roiYawMin);
+			roi.yawBinMax = min(round(p.roiYawMax), roi.yawBinMin + 359);
+			roi.pitchBinMin = round(p.roiPitchMin);
+			roi.pitchBinMax = round(p.roiPitchMax);
+			roi.rangeBinMin = min(max(floor(p.roiRangeMin/binWidth), 0), lastBin);
+			if p.roiRangeMax > 0
+				rangeBinMax = min(max(ceil(p.roiRangeMax/binWidth), 0), lastBin);
+			else
+				rangeBinMax = lastBin;
+			end
+			roi.rangeBins = max(rangeBinMax, roi.rangeBinMin) - roi.rangeBinMin + 1;
+		end
+
 
 		function binWidth = getSpeedBinWidth(obj)
 			% GETSPEEDBINWIDTH Computes the speed resolution bin width
@@ -17,6 +17,14 @@ classdef radar < handle
 		triggerTimerPeriod;
 		bufferSize = 100;          % Max buffer size
 		writeIdx = 1;              % Index for next write
+		nativeReader = false;      % Serial is read by native reader (radarPipeline) instead of serialport
+		nativeReaderOpen = false;  % Native reader is currently connected
+		pollTimer;                 % Timer draining frames received by native reader
+		nativeTrigger = false;     % Trigger is sent by native timerfd scheduler (needs native reader)
+		triggerAngleStep = 0;      % Angle locked trigger step in yaw (degrees, 0 = periodic)
+		nativeTriggerRunning = false; % Native trigger scheduler is running
+		captureDir = fullfile(pwd, 'captures'); % Directory of raw I/Q capture segments
+		captureOpen = false;       % Native reader frames are captured
 	end
 
 	properties(Access = public)
@@ -49,6 +57,134 @@ classdef radar < handle
 
 	methods (Access=private)
 
+		function sendCommand(obj, command)
+			% SENDCOMMAND writes command line to the radar
+			%
+			% Line is terminated by CR/LF, goes through native reader if it is used
+			if obj.nativeReaderOpen
+				radarPipeline('radarWrite', char(command));
+			else
+				writeline(obj.hSerial, command);
+			end
+		end
+
+		function flushSerial(obj)
+			% FLUSHSERIAL clears serialport buffers, native reader consumes input
+			% continuously so there is nothing to clear
+			if ~obj.nativeReaderOpen
+				flush(obj.hSerial);
+			end
+		end
+
+		function pollNativeReader(obj)
+			% POLLNATIVEREADER Moves frames received by native reader to buffers
+			% Triggers newDataAvailable event for every frame
+			%
+			% Function is called by pollTimer, frames are already parsed and
+			% stamped at arrival of their last byte
+			[I, Q, times] = radarPipeline('radarPoll');
+			for k = 1:numel(times)
+				obj.bufferI(:, obj.writeIdx) = I(:, k);
+				obj.bufferQ(:, obj.writeIdx) = Q(:, k);
+				obj.bufferTime(obj.writeIdx) = times(k);
+
+				obj.writeIdx = mod(obj.writeIdx, obj.bufferSize) + 1;
+				notify(obj, 'newDataAvailable');
+			end
+		end
+
+		function closeNativeReader(obj)
+			% CLOSENATIVEREADER stops poll timer and native reader thread
+			if ~isempty(obj.pollTimer) && isvalid(obj.pollTimer)
+				stop(obj.pollTimer);
+				delete(obj.pollTimer);
+			end
+			obj.pollTimer = [];
+			radarPipeline('radarClose');
+			obj.nativeReaderOpen = false;
+			obj.captureOpen = false;
+		end
+
+		function updateCapture(obj)
+			% UPDATECAPTURE Starts or stops raw I/Q capture of native reader frames
+			%
+			% Native reader closes capture when frame length changes, so it is
+			% reopened with the new samples
+
+			[enabled, segmentRecords] = obj.hPreferences.getRadarCapture();
+			if ~enabled || ~obj.nativeReaderOpen
+				if obj.captureOpen
+					radarPipeline('captureClose');
+					obj.captureOpen = false;
+				end
+				return
+			end
+			stats = radarPipeline('captureStats');
+			if stats.open
+				return
+			end
+			if ~isfolder(obj.captureDir)
+				mkdir(obj.captureDir);
+			end
+			[~, interpolation] = obj.hPreferences.getPoseTimelineParameters();
+			config = struct('samples', obj.samples, ...
+				'segmentRecords', segmentRecords, ...
+				'poseInterpolation', interpolation, ...
+				'bandwidth', obj.hPreferences.getRadarBandwidth(), ...
+				'frontend', str2double(string(obj.hPreferences.getRadarFrontend())), ...
+				'chirpPeriod', obj.hPreferences.getRadarTriggerPeriod()/1000);
+			try
+				prefix = radarPipeline('captureOpen', obj.captureDir, config);
+				obj.captureOpen = true;
+				fprintf("radar | updateCapture | capturing to %s_*.iq\n", prefix);
+			catch ME
+				fprintf("Radar | updateCapture | Failed to open capture: %s\n", ME.message)
+			end
+		end
+
+		function startTrigger(obj)
+			% STARTTRIGGER starts sending trigger command to the radar
+			%
+			% With native reader and native trigger enabled trigger is fired by
+			% native timerfd thread, either periodically or in angle locked mode
+			% whenever platform yaw crosses another triggerAngleStep, otherwise
+			% MATLAB timer is used
+			period = obj.hPreferences.getRadarTriggerPeriod()/1000;
+			if obj.nativeReaderOpen && obj.nativeTrigger
+				[~, interpolation] = obj.hPreferences.getPoseTimelineParameters();
+				config = struct('period', period, ...
+					'angleStep', obj.triggerAngleStep, ...
+					'pollPeriod', 0.001, ...
+					'minInterval', period, ...
+					'startDelay', 2, ...
+					'poseInterpolation', interpolation);
+				radarPipeline('triggerStart', config, toc(obj.startTime));
+				obj.nativeTriggerRunning = true;
+				return;
+			end
+
+			obj.triggerTimer = timer;
+			obj.triggerTimer.StartDelay = 2;
+			obj.triggerTimer.Period = period;
+			obj.triggerTimer.ExecutionMode = 'fixedSpacing';
+			obj.triggerTimer.UserData = 0;
+			obj.triggerTimer.TimerFcn = @(~,~) obj.sendCommand('!N');
+			start(obj.triggerTimer);
+		end
+
+		function stopTrigger(obj)
+			% STOPTRIGGER stops trigger timer or native trigger scheduler
+			if obj.nativeTriggerRunning
+				radarPipeline('triggerStop');
+				obj.nativeTriggerRunning = false;
+			end
+			if ~isempty(obj.triggerTimer) && isvalid(obj.triggerTimer)
+				stop(obj.triggerTimer);
+				delete(obj.triggerTimer);
+			end
+			obj.triggerTimer = [];
+		end
+
 		function processIncomingData(obj, src)
 			% PROCESSINCOMINGDATA Processes raw serial data into I/Q components and timestamps
 			% Triggers newDataAvailable event when a full chirp is received
@@ -201,11 +337,11 @@ classdef radar < handle
 			% Sends all configuration commands to the radar via serial
 			%
 			% Flushes buffers and ensures commands are executed in sequence
-			flush(obj.hSerial); writeline(obj.hSerial, obj.generateSystemConfig());
-			flush(obj.hSerial); writeline(obj.hSerial, obj.generateBasebandCommand());
-			flush(obj.hSerial); writeline(obj.hSerial, obj.generateFrontendCommand());
-			flush(obj.hSerial); writeline(obj.hSerial, obj.generatePLLCommand());
-			flush(obj.hSerial);
+			obj.flushSerial(); obj.sendCommand(obj.generateSystemConfig());
+			obj.flushSerial(); obj.sendCommand(obj.generateBasebandCommand());
+			obj.flushSerial(); obj.sendCommand(obj.generateFrontendCommand());
+			obj.flushSerial(); obj.sendCommand(obj.generatePLLCommand());
+			obj.flushSerial();
 		end
 
 	end
@@ -227,6 +363,8 @@ classdef radar < handle
 			obj.startTime = startTime;
 
 			[obj.samples, ~, ~, ~] = obj.hPreferences.getRadarBasebandParameters();
+			obj.nativeReader = obj.hPreferences.getRadarNativeReader() == 1;
+			[obj.nativeTrigger, obj.triggerAngleStep] = obj.hPreferences.getRadarTriggerMode();
 
 				obj.triggerTimerPeriod = obj.hPreferences.getRadarTriggerPeriod()/1000;
 			obj.bufferI=zeros(obj.samples, obj.bufferSize);
@@ -243,7 +381,11 @@ classdef radar < handle
 			if ~isempty(obj.hSerial)
 				configureCallback(obj.hSerial, "off");
 				delete(obj.hSerial)
-				stop(obj.triggerTimer);
+				obj.stopTrigger();
+			end
+			if obj.nativeReaderOpen
+				obj.stopTrigger();
+				obj.closeNativeReader();
 			end
 		end
 
@@ -253,17 +395,51 @@ classdef radar < handle
 			% Function is called by preference's newConfigEvent event
 			% Re configures radar via serial commands and trigger timer
 
+			oldSamples = obj.samples;
 			[obj.samples, ~, ~, ~] = obj.hPreferences.getRadarBasebandParameters();
+			obj.nativeReader = obj.hPreferences.getRadarNativeReader() == 1;
+			[obj.nativeTrigger, obj.triggerAngleStep] = obj.hPreferences.getRadarTriggerMode();
 			obj.bufferI=zeros(obj.samples, obj.bufferSize);
 			obj.bufferQ=zeros(obj.samples, obj.bufferSize);
 
-
-			if ~isempty(obj.hSerial)
-				stop(obj.triggerTimer);
-				obj.triggerTimer.Period = obj.hPreferences.getRadarTriggerPeriod()/1000;
-				start(obj.triggerTimer);
+			if ~isempty(obj.hSerial) || obj.nativeReaderOpen
+				obj.stopTrigger();
+				if obj.nativeReaderOpen && oldSamples ~= obj.samples
+					% frame length changed, reader is reopened to resize its frames
+					[port, baudrate] = obj.hPreferences.getConnectionRadar();
+					radarPipeline('radarOpen', char(port), baudrate, obj.samples, toc(obj.startTime));
+				end
+				obj.startTrigger();
 				obj.configureRadar();
 			end
+			obj.updateCapture();
+		end
+
+		function stats = getCaptureStats(obj)
+			% GETCAPTURESTATS Returns statistics of raw I/Q capture
+			%
+			% Output:
+			%   stats ... struct(open, offered, written, droppedQueue, droppedDisk,
+			%             withoutPose, segments, bytes, truncateFailed,
+			%             pending), empty if
+			%             capture isn't open
+			stats = [];
+			if obj.captureOpen
+				stats = radarPipeline('captureStats');
+			end
+		end
+
+		function stats = getTriggerStats(obj)
+			% GETTRIGGERSTATS Returns statistics of native trigger scheduler
+			%
+			% Output:
+			%   stats ... struct(triggers, failed, missed, skippedCells, jitterMean,
+			%             jitterStd, jitterMax), jitter in seconds, empty if MATLAB
+			%             timer is used
+			stats = [];
+			if obj.nativeTriggerRunning
+				stats = radarPipeline('triggerStats');
+			end
 		end
 
 		function status = setupSerial(obj)
@@ -272,16 +448,45 @@ classdef radar < handle
 			% Output:
 			%   status ... true if connection succeeded, false otherwise
 
+			if obj.nativeReaderOpen
+				obj.stopTrigger();
+				obj.closeNativeReader();
+				status = false;
+				return
+			end
 			if ~isempty(obj.hSerial)
 				configureCallback(obj.hSerial, "off");
 				delete(obj.hSerial)
-				delete(obj.triggerTimer);
+				obj.stopTrigger();
 				obj.hSerial = [];
-				obj.triggerTimer = [];
 				status = false;
 				return
 			end
 			[port, baudrate] = obj.hPreferences.getConnectionRadar();
+			if obj.nativeReader
+				try
+					fprintf("radar | setupSerial | native reader port: %s, baud: %f\n", port, baudrate)
+					radarPipeline('radarOpen', char(port), baudrate, obj.samples, toc(obj.startTime));
+					obj.nativeReaderOpen = true;
+					obj.updateCapture();
+					obj.configureRadar();
+
+					obj.pollTimer = timer;
+					obj.pollTimer.Period = 0.01;
+					obj.pollTimer.ExecutionMode = 'fixedSpacing';
+					obj.pollTimer.BusyMode = 'drop';
+					obj.pollTimer.TimerFcn = @(~,~) obj.pollNativeReader();
+					start(obj.pollTimer);
+
+					obj.startTrigger();
+					status = true;
+				catch ME
+					fprintf("Radar | setupSerial | Failed to setup native reader: %s\n", ME.message)
+					obj.closeNativeReader();
+					status = false;
+				end
+				return
+			end
 			try
 				fprintf("radar | setupSerial | port: %s, baud: %f\n", port, baudrate)
 				obj.hSerial = serialport(port, baudrate, "Timeout", 5);
@@ -292,13 +497,7 @@ classdef radar < handle
 				configureCallback(obj.hSerial, "terminator", @(src, ~) obj.processIncomingData(src))
 				status = true;
 
-				obj.triggerTimer = timer;
-				obj.triggerTimer.StartDelay = 2;
-				obj.triggerTimer.Period = obj.hPreferences.getRadarTriggerPeriod()/1000;
-				obj.triggerTimer.ExecutionMode = 'fixedSpacing';
-				obj.triggerTimer.UserData = 0;
-				obj.triggerTimer.TimerFcn = @(~,~) writeline(obj.hSerial, '!N');
-				start(obj.triggerTimer);
+				obj.startTrigger();
 			catch ME
 				fprintf("Radar | setupSerial | Failed to setup serial")
 				obj.hSerial = [];
@@ -11,15 +11,23 @@ classdef radarBuffer < handle
 		currentIdx = 1        % Index for circular buffer (index, of next item)
 		rangeNFFT;            % Number of FFT points
 		wn;                   % weighting window, currently hamming
+		streamingDoppler = false; % Doppler spectrum is updated per chirp by slidingDoppler
 	end
 
 	methods
-		function obj = radarBuffer(bufferSize, rangeNFFT, samples)
+		function obj = radarBuffer(bufferSize, rangeNFFT, samples, speedNFFT, rangeBinMin, rangeBins)
 			% RADARBUFFER Initializes the radarBuffer with specified buffer size and FFT parameters
 			%
 			% Inputs:
 			%   bufferSize ... Size of the circular buffer
 			%   rangeNFFT ... Number of FFT points for range processing
+			%   samples ... Number of samples per chirp
+			%   speedNFFT ... Number of Doppler bins of streaming Doppler engine
+			%                 (optional, 0 = disabled)
+			%   rangeBinMin ... First range bin (zero based) of streaming Doppler
+			%                   engine (optional, 0 by default)
+			%   rangeBins ... Number of range bins of streaming Doppler engine
+			%                 (optional, rangeNFFT/2 by default)
 			%
 			% Output:
 			%   obj ... Initialized radarBuffer instance
@@ -29,6 +37,19 @@ classdef radarBuffer < handle
 			obj.wn=hann(samples);
 			obj.FFTData = complex(zeros(rangeNFFT,bufferSize));
 			obj.timestamps = zeros(bufferSize, 1);
+
+			if nargin < 6
+				rangeBinMin = 0;
+				rangeBins = rangeNFFT/2;
+			end
+
+			if nargin > 3 && speedNFFT > 0
+				% window spans speedNFFT chirps, state is recomputed every 1024
+				% chirps to get rid of accumulated rounding errors, only range gate
+				% of region of interest is kept
+				slidingDoppler('init', rangeBins, speedNFFT, speedNFFT, 1024, rangeBinMin);
+				obj.streamingDoppler = true;
+			end
 		end
 
 		function addChirp(obj, I, Q, timestamp)
@@ -41,9 +62,62 @@ classdef radarBuffer < handle
 
 			obj.FFTData(:, obj.currentIdx) = fft((I + 1j*Q).*obj.wn, obj.rangeNFFT);
 			obj.timestamps(obj.currentIdx) = timestamp;
+			if obj.streamingDoppler
+				slidingDoppler('push', obj.FFTData(:, obj.currentIdx));
+			end
 			obj.currentIdx = mod(obj.currentIdx, obj.bufferSize) + 1;
 		end
 
+		function [lastFFT, lastTime] = getLastChirp(obj)
+			% GETLASTCHIRP Retrieves FFT and timestamp of the last added chirp
+			%
+			% Unlike getSlidingBatchOld the newest chirp is included, it is
+			% the one taken at the new position when requirePosChange gates
+			% processing.
+			%
+			% Outputs:
+			%   lastFFT ... FFT data vector [rangeNFFT x 1]
+			%   lastTime ... Timestamp of the chirp
+
+			idx = mod(obj.currentIdx-2, obj.bufferSize) + 1;
+			lastFFT = obj.FFTData(:, idx);
+			lastTime = obj.timestamps(idx);
+		end
+
+		function spectrum = getDopplerSpectrum(obj)
+			% GETDOPPLERSPECTRUM Returns Doppler spectrum over last speedNFFT chirps
+			%
+			% Spectrum is maintained incrementally with every added chirp, only
+			% available if buffer was created with speedNFFT. Window is fixed
+			% to the last speedNFFT chirps including the newest one, it is not
+			% sized by bufferSize and does not exclude chirps taken while
+			% platform moved to the current position, dataProcessor uses batch
+			% processing when that matters.
+			%
+			% Outputs:
+			%   spectrum ... complex single [rangeBins x speedNFFT], fftshifted
+
+			if ~obj.streamingDoppler
+				spectrum = [];
+				return;
+			end
+			spectrum = slidingDoppler('spectrum');
+		end
+
+		function times = getLastTimes(obj, n)
+			% GETLASTTIMES Retrieves timestamps of the last n added chirps
+			%
+			% Input:
+			%   n ... Number of chirps, at most bufferSize
+			%
+			% Output:
+			%   times ... Timestamps vector [n x 1], oldest first
+
+			n = min(n, obj.bufferSize);
+			idxs = mod((obj.currentIdx-1-n : obj.currentIdx-2), obj.bufferSize) + 1;
+			times = obj.timestamps(idxs);
+		end
+
 		function [batchFFTs, batchTimes] = getSlidingBatch(obj)
 			% GETSLIDINGBATCH Retrieves the latest contiguous batch of FFT data and timestamps
 			%
@@ -19,12 +19,25 @@ classdef radarDataCube < handle
 		requestToZero = false;  % Flag to zero cubes after processing
 		isProcessing = false;   % Batch processing status flag
 		overflow = false;       % Buffer overflow flag
+		shedCounts = struct('coalesced', 0, 'dropped', 0); % entries shed while buffer was full
+		traceEnabled = false;   % Record processBatch spans (radarPipeline trace)
+		batchCounter = 0;       % ID of processBatch trace span
 		keepRaw;                % Flag to retain raw data
 		keepCFAR;               % Flag to retain CFAR data
+		keepClutter;            % Flag to maintain clutter map
 		parallelPool;           % Thread pool
 		lastYaw                 % last updated yaw angle
 		lastPitch               % last updated pitch angle
 		relativeTimestamp;           % relative timestamp to measure against
+		roiGating = false;      % yaw bins are sector of region of interest, data outside is dropped
+		pendingResample = [];   % [oldBins, newBins, scale, offset] of resampleRange waiting for batch to finish
+		sectorIndex = [];       % struct(rangeBinWidth, tileSize) of open sector index, empty if closed
+		changeDetection = false; % Range profiles of batches go to change detector (radarPipeline change commands)
+		batchCells = struct('yawIdx', [], 'pitchIdx', [], 'decay', 1, 'pattern', [1 1], ...
+			'timestamp', [], 'profiles', [], 'tiles', [], 'range', []); % batch being processed, for sector index, change detector and dirty tiles
+		dirtyTileSize = 8;      % Yaw and pitch cells per tile of dirty bitmap
+		dirtyEvent = struct('tiles', [], 'range', []); % tiles dirty since last updateFinished
+		dirtyConsumers = struct('name', {}, 'tiles', {}, 'range', {}); % tiles dirty until consumer acknowledges them
 	end
 
 	properties(Access=public)
@@ -34,6 +47,7 @@ classdef radarDataCube < handle
 		pitchBinMin=-20;       % Minimum pitch angle (degrees)
 		pitchBinMax=60;        % Maximum pitch angle (degrees)
 		pitchBins;             % Pitch angle bins with 1 deg resolution
+		rangeBinMin=0;         % First range bin of the cube (zero based, region of interest)
 
 		rawCube = [];          % 4D raw data matrix [Yaw x Pitch x (Fast Time x Slow Time)]
 		rawCubeMap = [];       % Memory map for rawCube data
@@ -43,14 +57,100 @@ classdef radarDataCube < handle
 		cfarCubeMap = [];      % Memory map for cfarCube data
 		cfarCubeSize = [];     % Dimensions of cfarCube [Range x Yaw x Pitch]
 
+		clutterCube = [];      % 3D clutter map, background estimate per cell [Range x Yaw x Pitch]
+		clutterCubeMap = [];   % Memory map for clutterCube data
+		clutterCubeSize = [];  % Dimensions of clutterCube [Range x Yaw x Pitch]
+
 	end
 
 	events
-		updateFinished          % called after processBatch function finishes
+		updateFinished          % called after processBatch function finishes, data is cubeUpdateData with dirty tiles
+		resampleFinished        % called when cube files were resampled to new range bins
 	end
 
 	methods(Static)
 
+		function [yawIdx, pitchIdx, inside] = cellIndex(yaw, pitch, yawBinMin, yawBinMax, pitchBinMin, pitchBinMax, gated)
+			% CELLINDEX Returns cube cell of given position
+			%
+			% Positions are rounded to the nearest bin and clipped to the cube.
+			% With gating yaw bins are a sector which may wrap over 0 deg
+			% (yawBinMin negative) and position outside of it is reported.
+			%
+			% Inputs:
+			%   yaw ... Yaw angle (degrees)
+			%   pitch ... Pitch angle (degrees)
+			%   yawBinMin, yawBinMax ... Yaw bins of the cube (degrees)
+			%   pitchBinMin, pitchBinMax ... Pitch bins of the cube (degrees)
+			%   gated ... Region of interest gating is enabled
+			%
+			% Outputs:
+			%   yawIdx ... Yaw index into cube (one based)
+			%   pitchIdx ... Pitch index into cube (one based)
+			%   inside ... false if position is outside of the cube (gated only)
+
+			yawOffset = round(yaw) - yawBinMin;
+			pitchOffset = round(pitch) - pitchBinMin;
+			if gated
+				yawOffset = mod(yawOffset, 360);
+			end
+			inside = ~gated || (yawOffset <= yawBinMax - yawBinMin && ...
+				pitchOffset >= 0 && pitchOffset <= pitchBinMax - pitchBinMin);
+			yawIdx = min(max(yawOffset, 0), yawBinMax - yawBinMin) + 1;
+			pitchIdx = min(max(pitchOffset, 0), pitchBinMax - pitchBinMin) + 1;
+		end
+
+		function tiles = dirtyTiles(yawIdx, pitchIdx, pattern, numYawBins, numPitchBins, tileSize)
+			% DIRTYTILES Returns tiles of cells rewritten by cube update
+			%
+			% Same tiles as native pipeline marks (dirtyTiles.h): spread pattern
+			% around every cell, yaw wraps for full circle, otherwise clipped as
+			% by processBatch.
+			%
+			% Inputs:
+			%   yawIdx ... Yaw indices of the batch (one based)
+			%   pitchIdx ... Pitch indices of the batch (one based)
+			%   pattern ... Size of spread pattern [yaw pitch], [1 1] = no spreading
+			%   numYawBins, numPitchBins ... Cube cells
+			%   tileSize ... Yaw and pitch cells per tile
+			%
+			% Output:
+			%   tiles ... logical [ceil(numYawBins/tileSize) x ceil(numPitchBins/tileSize)]
+
+			tiles = false(ceil(numYawBins/tileSize), ceil(numPitchBins/tileSize));
+			half = floor(pattern/2);
+			for k = 1:numel(yawIdx)
+				yaw = yawIdx(k) - half(1) + (0:pattern(1)-1);
+				pitch = pitchIdx(k) - half(2) + (0:pattern(2)-1);
+				if numYawBins >= 360
+					yaw = mod(yaw - 1, numYawBins) + 1;
+				else
+					yaw = yaw(yaw >= 1 & yaw <= numYawBins);
+				end
+				pitch = pitch(pitch >= 1 & pitch <= numPitchBins);
+				tiles(floor((yaw - 1)/tileSize) + 1, floor((pitch - 1)/tileSize) + 1) = true;
+			end
+		end
+
+		function region = mergeDirty(region, tiles, range)
+			% MERGEDIRTY Adds dirty tiles and range extent to accumulated region
+			%
+			% Inputs:
+			%   region ... struct(tiles, range) accumulated so far
+			%   tiles ... logical [tilesYaw x tilesPitch] to add
+			%   range ... [first last] range bins to add, empty if none
+			%
+			% Output:
+			%   region ... struct(tiles, range) covering both
+
+			region.tiles = region.tiles | tiles;
+			if isempty(region.range)
+				region.range = range;
+			elseif ~isempty(range)
+				region.range = [min(region.range(1), range(1)), max(region.range(2), range(2))];
+			end
+		end
+
 		function mask = createSectorMask(diffYaw, diffPitch, patternSize, speed)
 			% CREATESECTORMASK Generates a mask that will keep data in area we are
 			% moving from and use just new in the area we are moving to
@@ -203,6 +303,7 @@ classdef radarDataCube < handle
 				halfYaw = floor(size(spreadPattern, 1)/2);
 				halfPitch = floor(size(spreadPattern, 2)/2);
 				numYawBins = length(yawBins);
+				wrapYaw = numYawBins >= 360; % sector of region of interest is clipped as pitch
 
 				% Get raw min/max indices
 				% --- 1.1 Expand Yar range for each update ---
@@ -216,7 +317,12 @@ classdef radarDataCube < handle
 				%  that array
 				%  find breaks in this array (wrap fro 360 to 1) -> fill in elements
 				expandedYaws = arrayfun(@(y) [(y-halfYaw):(y+halfYaw)], [buffer.yawIdx], 'UniformOutput', false);
-				allYaws = unique(mod(cat(2, expandedYaws{:}) - 1, numYawBins) + 1);
+				allYaws = cat(2, expandedYaws{:});
+				if wrapYaw
+					allYaws = unique(mod(allYaws - 1, numYawBins) + 1);
+				else
+					allYaws = unique(allYaws(allYaws >= 1 & allYaws <= numYawBins));
+				end
 				% Split into contiguous segments if wrap-around exists
 				wrapIdx = find(diff(allYaws) < 0);
 				if ~isempty(wrapIdx)
@@ -252,7 +358,13 @@ classdef radarDataCube < handle
 					pitch = buffer.pitchIdx(i);
 
 					% --- 3.1 Reindex from rawCube into subrawCube ---
-					validYaw = mod((yaw - halfYaw : yaw + halfYaw) - 1, length(yawBins)) + 1;
+					if wrapYaw
+						validYaw = mod((yaw - halfYaw : yaw + halfYaw) - 1, length(yawBins)) + 1;
+						startYawPat = 1;
+					else
+						validYaw = max(1, yaw - halfYaw):min(numYawBins, yaw + halfYaw);
+						startYawPat = (halfYaw+1)-(yaw-validYaw(1));
+					end
 					localYaw = arrayfun(@(x) yawMap(x), validYaw);
 
 					validPitch = max(1, pitch - halfPitch):min(length(pitchBins), pitch + halfPitch);
@@ -262,7 +374,8 @@ classdef radarDataCube < handle
 					% --- 3.2 Adjust pattern ---
 					startPitchPat = max(1,(halfPitch+1)-(pitch-validPitch(1)));
 					endPitchPat = min(size(spreadPattern, 2), startPitchPat + length(validPitch) - 1);
-					adjPattern = spreadPattern(:, startPitchPat:endPitchPat)*prod(buffer.decay(i:end));
+					yawPat = startYawPat:(startYawPat + length(validYaw) - 1);
+					adjPattern = spreadPattern(yawPat, startPitchPat:endPitchPat)*prod(buffer.decay(i:end));
 
 					% --- 3.3 Spread contribution into 4D with pattern ---
 					rangerDoppler = buffer.rangeDoppler(:, :, i);
@@ -325,19 +438,112 @@ classdef radarDataCube < handle
 		function afterBatchProcessing(obj, lastYawIdx, lastPitchIdx)
 			% AFTERBATCHPROCESSING Post-batch processing callback
 			%
-			% In case zero was called while thread was processing cubes will be zeroed
-			% form here
+			% In case zero or resampling was requested while thread was processing
+			% cubes will be zeroed/resampled form here
 
 			obj.lastYaw = obj.yawBins(lastYawIdx);
 			obj.lastPitch = obj.pitchBins(lastPitchIdx);
 			obj.isProcessing = false;
+			if obj.traceEnabled
+				radarPipeline('trace', 'processBatch', 'e', obj.batchCounter);
+			end
+			% index follows the batch before cubes are resampled or zeroed
+			if ~isempty(obj.sectorIndex)
+				radarPipeline('sectorUpdate', obj.batchCells.decay, obj.batchCells.yawIdx, ...
+					obj.batchCells.pitchIdx, obj.batchCells.pattern(1), obj.batchCells.pattern(2));
+			end
+			if ~isempty(obj.batchCells.profiles)
+				radarPipeline('changeUpdate', obj.batchCells.timestamp, obj.batchCells.yawIdx, ...
+					obj.batchCells.pitchIdx, obj.batchCells.profiles);
+				obj.batchCells.profiles = [];
+			end
+			obj.markDirty(obj.batchCells.tiles, obj.batchCells.range);
+			if ~isempty(obj.pendingResample)
+				obj.applyResample();
+			end
 			if obj.requestToZero
 				obj.requestToZero = false;
 				obj.zeroCubes();
 			end
 
 			% fprintf("radarDataCube | updateFinished\n");
-			notify(obj, 'updateFinished');
+			obj.notifyUpdateFinished();
+		end
+
+		function markDirty(obj, tiles, range)
+			% MARKDIRTY Adds rewritten tiles to the next event and all consumers
+			%
+			% Inputs:
+			%   tiles ... logical [tilesYaw x tilesPitch]
+			%   range ... [first last] range bins which may have changed, empty if none
+
+			if isempty(tiles)
+				return;
+			end
+			obj.dirtyEvent = radarDataCube.mergeDirty(obj.dirtyEvent, tiles, range);
+			for k = 1:numel(obj.dirtyConsumers)
+				obj.dirtyConsumers(k) = radarDataCube.mergeDirty(obj.dirtyConsumers(k), tiles, range);
+			end
+		end
+
+		function markAllDirty(obj)
+			% MARKALLDIRTY Marks the whole cube, zeroed or resampled
+
+			tiles = true(size(obj.cleanTiles()));
+			range = [1 obj.rawCubeSize(1)];
+			obj.dirtyEvent.tiles = tiles;
+			obj.dirtyEvent.range = range;
+			for k = 1:numel(obj.dirtyConsumers)
+				% range of old range bins has no meaning after resampling
+				obj.dirtyConsumers(k).tiles = tiles;
+				obj.dirtyConsumers(k).range = range;
+			end
+		end
+
+		function tiles = cleanTiles(obj)
+			% CLEANTILES Returns bitmap with no dirty tile
+			tiles = false(ceil(numel(obj.yawBins)/obj.dirtyTileSize), ceil(numel(obj.pitchBins)/obj.dirtyTileSize));
+		end
+
+		function notifyUpdateFinished(obj)
+			% NOTIFYUPDATEFINISHED Fires updateFinished with tiles dirty since the previous one
+
+			data = cubeUpdateData(obj.lastYaw, obj.lastPitch, obj.dirtyEvent.tiles, ...
+				obj.dirtyEvent.range, obj.dirtyTileSize);
+			obj.dirtyEvent.tiles = obj.cleanTiles();
+			obj.dirtyEvent.range = [];
+			notify(obj, 'updateFinished', data);
+		end
+
+		function range = batchDirtyRange(obj, buffer)
+			% BATCHDIRTYRANGE Returns range bins the batch may change
+			%
+			% Replaced cells change where old or new content is nonzero,
+			% spread contributions are added to cells where they are nonzero.
+			% Cubes are not written while no batch is processed.
+			%
+			% Input:
+			%   buffer ... Batch data structure about to be processed
+			%
+			% Output:
+			%   range ... [first last] range bins (one based), empty if none
+
+			rows = false(obj.rawCubeSize(1), 1);
+			if obj.keepRaw
+				rows = rows | any(any(buffer.rangeDoppler ~= 0, 2), 3);
+				if isempty(obj.spreadPattern)
+					for k = 1:numel(buffer.yawIdx)
+						rows = rows | any(obj.rawCube(:, :, buffer.yawIdx(k), buffer.pitchIdx(k)) ~= 0, 2);
+					end
+				end
+			end
+			if obj.keepCFAR
+				rows = rows | any(buffer.cfar ~= 0, 2);
+				for k = 1:numel(buffer.yawIdx)
+					rows = rows | obj.cfarCube(:, buffer.yawIdx(k), buffer.pitchIdx(k)) ~= 0;
+				end
+			end
+			range = [find(rows, 1, 'first'), find(rows, 1, 'last')];
 		end
 
 		function generateSpreadPattern(obj, spreadPatternYaw, spreadPatternPitch)
@@ -359,12 +565,162 @@ classdef radarDataCube < handle
 			%imagesc(dimensionsYaw, dimensionsPitch, pattern);
 		end
 
+		function allocateBuffers(obj, numRangeBins)
+			% ALLOCATEBUFFERS (Re)allocates both batch buffers
+			%
+			% Entries waiting in active buffer are dropped
+			%
+			% Input:
+			%   numRangeBins ... Number of range bins (optional, cube's by default)
+
+			if nargin < 2 && ~isempty(obj.pendingResample)
+				numRangeBins = obj.pendingResample(2);
+			elseif nargin < 2
+				numRangeBins = obj.rawCubeSize(1);
+			end
+
+			empty = struct('timestamp', [], 'yawIdx', [], 'pitchIdx', [], 'rangeDoppler', [], 'cfar', [], 'decay', []);
+			if obj.keepRaw
+				empty.rangeDoppler = zeros([numRangeBins, obj.rawCubeSize(2), obj.batchSize], 'single');
+			end
+			if obj.keepCFAR
+				empty.cfar = zeros([numRangeBins, obj.batchSize], 'single');
+			end
+			obj.bufferA = empty;
+			obj.bufferB = empty;
+			obj.bufferActiveWriteIdx = 1;
+			obj.overflow = false;
+		end
+
+		function mapCubes(obj)
+			% MAPCUBES Maps cube files with current cube sizes
+
+			if obj.keepRaw
+				obj.rawCubeMap = memmapfile('rawCube.dat', ...
+					'Format', {'single', obj.rawCubeSize, 'rawCube'}, ...
+					'Writable', true, ...
+					'Repeat', 1);
+				obj.rawCube = obj.rawCubeMap.Data.rawCube;
+			end
+
+			if obj.keepCFAR
+				obj.cfarCubeMap = memmapfile('cfarCube.dat', ...
+					'Format', {'single', obj.cfarCubeSize, 'cfarCube'}, ...
+					'Writable', true, ...
+					'Repeat', 1);
+				obj.cfarCube = obj.cfarCubeMap.Data.cfarCube;
+			end
+
+			if obj.keepClutter
+				obj.clutterCubeMap = memmapfile('clutterCube.dat', ...
+					'Format', {'single', obj.clutterCubeSize, 'clutterCube'}, ...
+					'Writable', true, ...
+					'Repeat', 1);
+				obj.clutterCube = obj.clutterCubeMap.Data.clutterCube;
+			end
+		end
+
+		function applyResample(obj)
+			% APPLYRESAMPLE Resamples cube files as requested by resampleRange
+			%
+			% Raw and clutter cubes are interpolated, CFAR cube keeps maximum of
+			% covered bins so that detections are not lost. If resampling fails
+			% (e.g. native pipeline or shared memory export still maps the
+			% cubes) old cubes are mapped again and the request stays pending.
+
+			request = obj.pendingResample;
+			[oldBins, newBins, scale, offset] = deal(request(1), request(2), request(3), request(4));
+
+			% old files are replaced, mappings must not outlive them
+			obj.rawCube = [];
+			obj.rawCubeMap = [];
+			obj.cfarCube = [];
+			obj.cfarCubeMap = [];
+			obj.clutterCube = [];
+			obj.clutterCubeMap = [];
+
+			try
+				if obj.keepRaw
+					radarPipeline('cubeResample', fullfile(pwd, 'rawCube.dat'), oldBins, ...
+						prod(obj.rawCubeSize(2:4)), newBins, scale, offset, false);
+				end
+				if obj.keepCFAR
+					radarPipeline('cubeResample', fullfile(pwd, 'cfarCube.dat'), oldBins, ...
+						prod(obj.cfarCubeSize(2:3)), newBins, scale, offset, true);
+				end
+				if obj.keepClutter
+					radarPipeline('cubeResample', fullfile(pwd, 'clutterCube.dat'), oldBins, ...
+						prod(obj.clutterCubeSize(2:3)), newBins, scale, offset, false);
+				end
+			catch ME
+				obj.mapCubes();
+				rethrow(ME);
+			end
+
+			obj.pendingResample = [];
+			obj.rawCubeSize(1) = newBins;
+			obj.cfarCubeSize(1) = newBins;
+			obj.clutterCubeSize(1) = newBins;
+			obj.mapCubes();
+			obj.markAllDirty();
+			if ~isempty(obj.sectorIndex)
+				obj.attachSectorIndex();
+			end
+			notify(obj, 'resampleFinished');
+		end
+
+		function attachSectorIndex(obj)
+			% ATTACHSECTORINDEX Opens sector index on current cube files
+			%
+			% Index follows raw cube summed over Doppler, CFAR cube without raw
+			% cube. Cube being written by a batch is read by the first update.
+
+			config = struct();
+			config.rawCubeSize = obj.rawCubeSize;
+			config.raw = obj.keepRaw;
+			if obj.keepRaw
+				config.cubePath = fullfile(pwd, 'rawCube.dat');
+			else
+				config.cubePath = fullfile(pwd, 'cfarCube.dat');
+			end
+			config.rangeBinWidth = obj.sectorIndex.rangeBinWidth;
+			config.rangeBinMin = obj.rangeBinMin;
+			config.yawBinMin = obj.yawBinMin;
+			config.pitchBinMin = obj.pitchBinMin;
+			config.tileSize = obj.sectorIndex.tileSize;
+			config.deferRebuild = obj.isProcessing;
+			radarPipeline('sectorOpen', config);
+		end
+
+		function shiftActiveBuffer(obj)
+			% SHIFTACTIVEBUFFER Drops the oldest entry of full active buffer
+			%
+			% Entries move one position towards the start, the last one is free.
+			% Decay of the dropped entry is carried to its successor so cube
+			% decays the same as if it was processed.
+
+			if obj.batchSize < 2
+				return;
+			end
+			obj.bufferA.decay(2) = obj.bufferA.decay(2) * obj.bufferA.decay(1);
+			obj.bufferA.timestamp(1:end-1) = obj.bufferA.timestamp(2:end);
+			obj.bufferA.decay(1:end-1) = obj.bufferA.decay(2:end);
+			obj.bufferA.yawIdx(1:end-1) = obj.bufferA.yawIdx(2:end);
+			obj.bufferA.pitchIdx(1:end-1) = obj.bufferA.pitchIdx(2:end);
+			if obj.keepRaw
+				obj.bufferA.rangeDoppler(:, :, 1:end-1) = obj.bufferA.rangeDoppler(:, :, 2:end);
+			end
+			if obj.keepCFAR
+				obj.bufferA.cfar(:, 1:end-1) = obj.bufferA.cfar(:, 2:end);
+			end
+		end
+
 	end
 
 	methods(Access=public)
 
 
-		function obj = radarDataCube(numRangeBins, numDopplerBins, batchSize,  spreadPatternYaw, spreadPatternPitch, keepRaw, keepCFAR, decay)
+		function obj = radarDataCube(numRangeBins, numDopplerBins, batchSize,  spreadPatternYaw, spreadPatternPitch, keepRaw, keepCFAR, decay, keepClutter, roi)
 			% RADARDATACUBE Initializes radar data cube and associated buffers
 			%
 			% Inputs:
@@ -376,6 +732,22 @@ classdef radarDataCube < handle
 			%   keepRaw ... Flag to retain raw data
 			%   keepCFAR ... Flag to retain CFAR data
 			%   decay ... Enable/disable data decay
+			%   keepClutter ... Flag to maintain clutter map (optional)
+			%   roi ... Region of interest of preferences.getProcessingROI
+			%           (optional), numRangeBins has to match its range gate
+
+			if nargin < 9
+				keepClutter = false;
+			end
+
+			if nargin > 9 && roi.enabled
+				obj.roiGating = true;
+				obj.yawBinMin = roi.yawBinMin;
+				obj.yawBinMax = roi.yawBinMax;
+				obj.pitchBinMin = roi.pitchBinMin;
+				obj.pitchBinMax = roi.pitchBinMax;
+				obj.rangeBinMin = roi.rangeBinMin;
+			end
 
 			obj.yawBins = obj.yawBinMin:obj.yawBinMax;     % 1° resolution
 			obj.pitchBins = obj.pitchBinMin:obj.pitchBinMax;          % 1° resolution
@@ -383,13 +755,10 @@ classdef radarDataCube < handle
 			obj.bufferActive = obj.bufferA;
 			obj.parallelPool = gcp('nocreate');
 			obj.relativeTimestamp = tic;
-			if(spreadPatternYaw == 0 || spreadPatternPitch == 0)
-				obj.spreadPattern = [];
-			else
-				obj.generateSpreadPattern(spreadPatternYaw, spreadPatternPitch);
-			end
+			obj.setSpreadPattern(spreadPatternYaw, spreadPatternPitch);
 			obj.keepRaw = keepRaw;
 			obj.keepCFAR = keepCFAR;
+			obj.keepClutter = keepClutter;
 			obj.decay = decay;
 			obj.rawCubeSize = [ ...
 				numRangeBins, ...
@@ -397,47 +766,116 @@ classdef radarDataCube < handle
 				length(obj.yawBins), ...
 				length(obj.pitchBins), ...
 				];
-			%% Initialize radar cube for raw data
+			obj.cfarCubeSize = obj.rawCubeSize([1 3 4]);
+			% background estimate is updated by updateClutter with results of
+			% dataProcessor.processBatch and is not affected by decay or zeroing
+			% of the cubes
+			obj.clutterCubeSize = obj.rawCubeSize([1 3 4]);
 
 			if obj.keepRaw
 				radarDataCube.allocateRadarCubeFile(obj.rawCubeSize, 'rawCube.dat');
 				fprintf("radarDataCube | radarDataCube | Initializing rawCube with yaw %f, pitch %f, range %d, doppler %f\n", length(obj.yawBins), length(obj.pitchBins), numRangeBins, numDopplerBins)
+			end
+			if obj.keepCFAR
+				radarDataCube.allocateRadarCubeFile(obj.cfarCubeSize, 'cfarCube.dat');
+			end
+			if obj.keepClutter
+				radarDataCube.allocateRadarCubeFile(obj.clutterCubeSize, 'clutterCube.dat');
+			end
 
-				obj.bufferA.rangeDoppler = zeros([numRangeBins, numDopplerBins, obj.batchSize], 'single');
-				obj.bufferB.rangeDoppler = zeros([numRangeBins, numDopplerBins, obj.batchSize], 'single');
+			obj.allocateBuffers();
+			obj.mapCubes();
+			obj.dirtyEvent.tiles = obj.cleanTiles();
 
-				% Create memory map
-				obj.rawCubeMap = memmapfile('rawCube.dat', ...
-					'Format', {'single', obj.rawCubeSize, 'rawCube'}, ...
-					'Writable', true, ...
-					'Repeat', 1);
-				zeroCube(obj.rawCubeMap.Data.rawCube);
-				obj.rawCube = obj.rawCubeMap.Data.rawCube;
+			obj.zeroCubes();
+			if obj.keepClutter
+				zeroCube(obj.clutterCube);
 			end
+		end
 
-			%% Initialize radar cube for cfar
+		function setSpreadPattern(obj, spreadPatternYaw, spreadPatternPitch)
+			% SETSPREADPATTERN Replaces pattern used to spread range-Doppler maps
+			%
+			% Takes effect with next batch, cubes are kept
+			%
+			% Inputs:
+			%   spreadPatternYaw ... Yaw spreading pattern width, 0 = no spreading
+			%   spreadPatternPitch ... Pitch spreading pattern width, 0 = no spreading
 
-			if obj.keepCFAR
-				obj.bufferA.cfar = zeros([numRangeBins, obj.batchSize], 'single');
-				obj.bufferB.cfar = zeros([numRangeBins, obj.batchSize], 'single');
-				obj.cfarCubeSize = obj.rawCubeSize([1 3 4]);
-				radarDataCube.allocateRadarCubeFile(obj.cfarCubeSize, 'cfarCube.dat');
+			if(spreadPatternYaw == 0 || spreadPatternPitch == 0)
+				obj.spreadPattern = [];
+			else
+				obj.generateSpreadPattern(spreadPatternYaw, spreadPatternPitch);
+			end
+		end
 
-				% Create memory map
-				obj.cfarCubeMap = memmapfile('cfarCube.dat', ...
-					'Format', {'single', obj.rawCubeSize([1 3 4]), 'cfarCube'}, ...
-					'Writable', true, ...
-					'Repeat', 1);
+		function setDecay(obj, decay)
+			% SETDECAY Enables or disables decay of the cubes from next batch
+			%
+			% Input:
+			%   decay ... Enable/disable data decay
+
+			obj.decay = decay;
+		end
 
+		function setBatchSize(obj, batchSize)
+			% SETBATCHSIZE Changes number of samples per batch
+			%
+			% Buffers are reallocated, entries waiting in active buffer are
+			% dropped, batch being processed is not affected
+			%
+			% Input:
+			%   batchSize ... Samples per processing batch
 
-				zeroCube(obj.cfarCubeMap.Data.cfarCube);
-				obj.cfarCube = obj.cfarCubeMap.Data.cfarCube;
+			if batchSize == obj.batchSize
+				return;
+			end
+			obj.batchSize = batchSize;
+			obj.allocateBuffers();
+		end
+
+		function resampleRange(obj, numRangeBins, rangeBinMin, rangeScale)
+			% RESAMPLERANGE Carries accumulated scene over to new range bins
+			%
+			% Used when range bin width (rangeNFFT, radar samples or bandwidth)
+			% or range gate changes. Cube files are resampled in parallel by
+			% radarPipeline('cubeResample') and mapped again, which is much
+			% cheaper than allocating and zeroing new cubes. If a batch is being
+			% processed resampling waits for it to finish. Entries waiting in
+			% active buffer belong to old range bins and are dropped.
+			%
+			% Native pipeline and shared memory export have to be closed as they
+			% map cube files.
+			%
+			% Inputs:
+			%   numRangeBins ... New number of range bins
+			%   rangeBinMin ... New first range bin (zero based)
+			%   rangeScale ... New range bin width divided by the old one
+
+			% new bin r is at old bin r*rangeScale + offset
+			offset = rangeBinMin*rangeScale - obj.rangeBinMin;
+			if isempty(obj.pendingResample)
+				obj.pendingResample = [obj.rawCubeSize(1), numRangeBins, rangeScale, offset];
+			else
+				% resampling of resampling which didn't happen yet
+				pending = obj.pendingResample;
+				obj.pendingResample = [pending(1), numRangeBins, pending(3)*rangeScale, pending(3)*offset + pending(4)];
+			end
+			obj.rangeBinMin = rangeBinMin;
+			obj.allocateBuffers(numRangeBins);
+			% profiles of batch being processed belong to old range bins
+			obj.batchCells.profiles = [];
+
+			if ~obj.isProcessing
+				obj.applyResample();
 			end
 		end
 
 		function addData(obj, yaw, pitch, cfar, rangeDoppler, speed)
 			% ADDDATA Adds radar detection to the active buffer
 			%
+			% Detection outside of region of interest is dropped
+			%
 			% Inputs:
 			%   yaw ... Yaw angle of detection (degrees)
 			%   pitch ... Pitch angle of detection (degrees)
@@ -450,11 +888,29 @@ classdef radarDataCube < handle
 			end
 
 			% disp(sum(cfar))
-			[~, yawIdx] = min(abs(obj.yawBins - yaw));
-			[~, pitchIdx] = min(abs(obj.pitchBins - pitch));
+			[yawIdx, pitchIdx, inside] = radarDataCube.cellIndex(yaw, pitch, ...
+				obj.yawBinMin, obj.yawBinMax, obj.pitchBinMin, obj.pitchBinMax, obj.roiGating);
+			if ~inside
+				return;
+			end
 			decayCoef = exp(-speed/500);
 			% fprintf("radarDataCube | addData | adding to max %d: yaw %f, pitch %f, decay %f\n", max(rangeDoppler(:)), yaw, pitch, decayCoef);
 
+			if obj.overflow
+				% buffer is full and previous batch is still processing, keep it
+				% ordered: same cell replaces the newest entry (its decay carried
+				% over), otherwise the oldest entry is dropped
+				last = obj.batchSize;
+				if obj.bufferA.yawIdx(last) == yawIdx && obj.bufferA.pitchIdx(last) == pitchIdx
+					decayCoef = decayCoef * obj.bufferA.decay(last);
+					obj.shedCounts.coalesced = obj.shedCounts.coalesced + 1;
+				else
+					obj.shiftActiveBuffer();
+					obj.shedCounts.dropped = obj.shedCounts.dropped + 1;
+				end
+				obj.bufferActiveWriteIdx = last;
+			end
+
 			obj.bufferA.timestamp(obj.bufferActiveWriteIdx) = toc(obj.relativeTimestamp);
 			obj.bufferA.decay(obj.bufferActiveWriteIdx) = decayCoef;
 			obj.bufferA.yawIdx(obj.bufferActiveWriteIdx) = yawIdx;
@@ -471,11 +927,91 @@ classdef radarDataCube < handle
 			obj.bufferActiveWriteIdx = obj.bufferActiveWriteIdx + 1;
 			if obj.bufferActiveWriteIdx > obj.batchSize
 				obj.overflow = true;
-				obj.bufferActiveWriteIdx = 1; % this means buffer will not be ordered
 			end
 
 		end
 
+		function background = getClutterBackground(obj, yaw, pitch)
+			% GETCLUTTERBACKGROUND Returns copy of clutter background of a cell
+			%
+			% Workers of dataProcessor.processBatch subtract the copy, only
+			% updateClutter writes the clutter map
+			%
+			% Inputs:
+			%   yaw ... Yaw angle (degrees)
+			%   pitch ... Pitch angle (degrees)
+			%
+			% Output:
+			%   background ... single [rangeBins x 1], empty without clutter map
+
+			background = [];
+			if ~obj.keepClutter || isempty(obj.clutterCube)
+				return;
+			end
+			[yawIdx, pitchIdx] = radarDataCube.cellIndex(yaw, pitch, ...
+				obj.yawBinMin, obj.yawBinMax, obj.pitchBinMin, obj.pitchBinMax, obj.roiGating);
+			background = obj.clutterCube(:, yawIdx, pitchIdx);
+		end
+
+		function updateClutter(obj, yaw, pitch, profile, alpha)
+			% UPDATECLUTTER Moves clutter background of a cell towards profile
+			%
+			% Called on MATLAB thread with results of processBatch, so every
+			% chirp updates the map once and in order of merging
+			%
+			% Inputs:
+			%   yaw ... Yaw angle (degrees)
+			%   pitch ... Pitch angle (degrees)
+			%   profile ... Range profile before subtraction [rangeBins x 1]
+			%   alpha ... EMA coefficient
+
+			if ~obj.keepClutter || isempty(obj.clutterCube) || numel(profile) ~= size(obj.clutterCube, 1)
+				% profile of previous range gate while resampling is pending
+				return;
+			end
+			[yawIdx, pitchIdx, inside] = radarDataCube.cellIndex(yaw, pitch, ...
+				obj.yawBinMin, obj.yawBinMax, obj.pitchBinMin, obj.pitchBinMax, obj.roiGating);
+			if ~inside
+				return;
+			end
+			% residual is not needed, worker already subtracted
+			clutterMap(obj.clutterCube, single(profile), yawIdx, pitchIdx, alpha);
+		end
+
+		function setTraceEnabled(obj, enable)
+			% SETTRACEENABLED Switches recording of processBatch trace spans
+			%
+			% Input:
+			%   enable ... true to record spans from dispatch to afterBatchProcessing
+
+			obj.traceEnabled = enable;
+		end
+
+		function setChangeDetection(obj, enable)
+			% SETCHANGEDETECTION Switches feeding of change detector
+			%
+			% Range profiles (range-Doppler maps summed over Doppler) of every
+			% processed batch are compared with references of their cells by
+			% radarPipeline('changeUpdate'), detector has to be opened by
+			% radarPipeline('changeOpen'). Needs raw data (keepRaw).
+			%
+			% Input:
+			%   enable ... true to feed change detector after every batch
+
+			obj.changeDetection = enable;
+		end
+
+		function counts = getShedCounts(obj)
+			% GETSHEDCOUNTS Returns number of entries shed while buffer was full
+			%
+			% Output:
+			%   counts ... struct(coalesced, dropped), coalesced entries were
+			%              merged with newer entry of the same cell, dropped
+			%              were the oldest entries pushed out
+
+			counts = obj.shedCounts;
+		end
+
 		function [yaw, pitch] = getLastPosition(obj)
 			% GETLASTPOSITION return position of the last update
 			%
@@ -510,12 +1046,37 @@ classdef radarDataCube < handle
 
 			obj.isProcessing = true;
 			obj.overflow = false;
+			obj.batchCounter = obj.batchCounter + 1;
+			if obj.traceEnabled
+				radarPipeline('trace', 'processBatch', 'b', obj.batchCounter);
+			end
 
 			processingBuffer = obj.bufferA;
 			obj.bufferA = obj.bufferB; % Reset active buffer
 			obj.bufferB = processingBuffer; % Assign to processing buffer
 			obj.bufferActiveWriteIdx = 1;
 
+			% buffers may be reallocated before the batch finishes
+			obj.batchCells.yawIdx = processingBuffer.yawIdx;
+			obj.batchCells.pitchIdx = processingBuffer.pitchIdx;
+			obj.batchCells.decay = 1;
+			if obj.decay
+				obj.batchCells.decay = prod(processingBuffer.decay);
+			end
+			obj.batchCells.pattern = [1 1];
+			if obj.keepRaw && ~isempty(obj.spreadPattern)
+				obj.batchCells.pattern = size(obj.spreadPattern);
+			end
+			obj.batchCells.timestamp = processingBuffer.timestamp;
+			obj.batchCells.profiles = [];
+			if obj.changeDetection && obj.keepRaw
+				% power range profile of every entry, range-Doppler map summed over Doppler
+				obj.batchCells.profiles = reshape(sum(processingBuffer.rangeDoppler, 2), obj.rawCubeSize(1), []);
+			end
+			obj.batchCells.tiles = radarDataCube.dirtyTiles(processingBuffer.yawIdx, processingBuffer.pitchIdx, ...
+				obj.batchCells.pattern, numel(obj.yawBins), numel(obj.pitchBins), obj.dirtyTileSize);
+			obj.batchCells.range = obj.batchDirtyRange(processingBuffer);
+
 
 			if obj.parallelPool.NumWorkers > obj.parallelPool.Busy
 
@@ -556,6 +1117,52 @@ classdef radarDataCube < handle
 
 		end
 
+		function pending = isResamplePending(obj)
+			% ISRESAMPLEPENDING Checks if resampleRange waits for batch to finish
+			%
+			% Cube files and rawCubeSize still have old range bins, whatever
+			% maps the files (native pipeline, shared memory export) has to wait
+			% for resampleFinished.
+			%
+			% Output:
+			%   pending ... true if cube files are going to be replaced
+
+			pending = ~isempty(obj.pendingResample);
+		end
+
+		function pattern = getSpreadPattern(obj)
+			% GETSPREADPATTERN Returns pattern used to spread range-Doppler maps
+			%
+			% Output:
+			%   pattern ... single [(2*spreadPatternYaw+1) x (2*spreadPatternPitch+1)],
+			%               empty if spreading is disabled
+
+			pattern = obj.spreadPattern;
+		end
+
+		function externalUpdateFinished(obj, lastYaw, lastPitch, dirtyTiles, dirtyRange)
+			% EXTERNALUPDATEFINISHED Announces cube update done outside of this object
+			%
+			% Used by native pipeline which writes into mapped cube files directly
+			%
+			% Inputs:
+			%   lastYaw ... Yaw of the last update (degrees)
+			%   lastPitch ... Pitch of the last update (degrees)
+			%   dirtyTiles ... logical [tilesYaw x tilesPitch] of tiles rewritten by
+			%                  the update (optional), whole cube if missing or of
+			%                  other tile size
+			%   dirtyRange ... [first last] range bins which may have changed
+
+			obj.lastYaw = lastYaw;
+			obj.lastPitch = lastPitch;
+			if nargin < 5 || ~isequal(size(dirtyTiles), size(obj.cleanTiles()))
+				obj.markAllDirty();
+			else
+				obj.markDirty(dirtyTiles, dirtyRange);
+			end
+			obj.notifyUpdateFinished();
+		end
+
 		function zeroCubes(obj)
 			% ZEROCUBES Resets rawCube and cfarCube to zero
 			%
@@ -572,6 +1179,123 @@ classdef radarDataCube < handle
 			if obj.keepRaw
 				zeroCube(obj.rawCube)
 			end
+			if ~isempty(obj.sectorIndex)
+				radarPipeline('sectorReset');
+			end
+			obj.markAllDirty();
+		end
+
+		function setDirtyTileSize(obj, tileSize)
+			% SETDIRTYTILESIZE Changes yaw and pitch cells per tile of dirty bitmap
+			%
+			% Has to match dirtyTileSize of native pipeline, registered
+			% consumers get the whole cube dirty in new tiles
+			%
+			% Input:
+			%   tileSize ... Yaw and pitch cells per tile
+
+			if tileSize == obj.dirtyTileSize
+				return;
+			end
+			obj.dirtyTileSize = tileSize;
+			obj.batchCells.tiles = obj.cleanTiles();
+			obj.markAllDirty();
+		end
+
+		function registerDirtyConsumer(obj, name)
+			% REGISTERDIRTYCONSUMER Starts accumulating dirty tiles for consumer
+			%
+			% Consumer that doesn't handle every updateFinished event collects
+			% tiles rewritten since its last acknowledgeDirty. It hasn't seen
+			% the cube yet, so everything starts dirty.
+			%
+			% Input:
+			%   name ... Consumer name (e.g. 'renderer', 'dbscan', 'recorder')
+
+			if any(strcmp({obj.dirtyConsumers.name}, name))
+				return;
+			end
+			obj.dirtyConsumers(end+1) = struct('name', name, ...
+				'tiles', true(size(obj.cleanTiles())), 'range', [1 obj.rawCubeSize(1)]);
+		end
+
+		function unregisterDirtyConsumer(obj, name)
+			% UNREGISTERDIRTYCONSUMER Stops accumulating dirty tiles for consumer
+			%
+			% Input:
+			%   name ... Consumer name
+
+			obj.dirtyConsumers(strcmp({obj.dirtyConsumers.name}, name)) = [];
+		end
+
+		function [tiles, range] = acknowledgeDirty(obj, name)
+			% ACKNOWLEDGEDIRTY Returns tiles dirty since consumer's last call and clears them
+			%
+			% Input:
+			%   name ... Consumer name of registerDirtyConsumer
+			%
+			% Outputs:
+			%   tiles ... logical [tilesYaw x tilesPitch], tile (i, j) covers yaw
+			%             cells (i-1)*tileSize+1 : i*tileSize and pitch cells alike
+			%   range ... [first last] range bins (one based) which may have
+			%             changed, empty if none
+
+			k = find(strcmp({obj.dirtyConsumers.name}, name), 1);
+			if isempty(k)
+				error('radarDataCube:dirtyConsumer', 'Dirty tile consumer %s is not registered.', name);
+			end
+			tiles = obj.dirtyConsumers(k).tiles;
+			range = obj.dirtyConsumers(k).range;
+			obj.dirtyConsumers(k).tiles = obj.cleanTiles();
+			obj.dirtyConsumers(k).range = [];
+		end
+
+		function openSectorIndex(obj, rangeBinWidth, tileSize)
+			% OPENSECTORINDEX Starts answering sector queries (querySectors)
+			%
+			% Summed-area tables and maximum pyramid over the raw cube (CFAR
+			% cube if raw is not kept) are kept by radarPipeline and updated
+			% with every batch, by native pipeline when it writes the cubes.
+			% Waits for pending resampling of the cubes.
+			%
+			% Inputs:
+			%   rangeBinWidth ... Range bin width (m)
+			%   tileSize ... Yaw and pitch cells per tile of incremental update
+
+			obj.sectorIndex = struct('rangeBinWidth', rangeBinWidth, 'tileSize', tileSize);
+			if isempty(obj.pendingResample)
+				obj.attachSectorIndex();
+			end
+		end
+
+		function closeSectorIndex(obj)
+			% CLOSESECTORINDEX Releases sector index
+
+			if ~isempty(obj.sectorIndex)
+				radarPipeline('sectorClose');
+				obj.sectorIndex = [];
+			end
+		end
+
+		function result = querySectors(obj, sectors)
+			% QUERYSECTORS Total and maximum energy of cube sectors
+			%
+			% Answered from sector index in constant time per sector (maximum in
+			% logarithmic), the cube is not sliced.
+			%
+			% Input:
+			%   sectors ... [n x 6] yawMin, yawMax, pitchMin, pitchMax (deg),
+			%               rangeMin, rangeMax (m), yaw arc may cross 0 deg
+			%               (350..10), rangeMax 0 = up to the last range bin
+			%
+			% Output:
+			%   result ... [n x 3] sum, maximum (NaN for empty sector) and number
+			%              of cells of every sector
+
+			if isempty(obj.sectorIndex)
+				error('radarDataCube:sectorIndex', 'Sector index is not open.');
+			end
+			result = radarPipeline('sectorQuery', double(sectors));
 		end
 
 	end
@@ -0,0 +1,126 @@
+#ifndef BACKPRESSURE_H
+#define BACKPRESSURE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Load shedding policy of the native pipeline
+//
+// Pressure of the stages behind range FFT (Doppler, CFAR, cube) is judged
+// from fill of their input rings and from their utilization, fraction of wall
+// time the stage spent processing (not idling) since the last evaluation.
+// Stage over busyHigh is about to fall behind and its ring will fill. Under
+// pressure the pipeline degrades one level at a time in fixed order:
+//
+//   SHED_COALESCE      frames of the same angle cell are merged in cube batch
+//   SHED_SKIP_DOPPLER  range-Doppler map isn't computed, frame updates CFAR only
+//   SHED_SKIP_RAW      raw cube isn't written nor decayed, CFAR is kept
+//
+// Level is evaluated every holdoff chirps by range stage (one thread at a time
+// when every radar stream has its own range stage), it rises when any ring is
+// over highWater or any stage over busyHigh and drops when all rings are under
+// lowWater and all stages under busyLow. Stages only read the level and add
+// their busy time.
+
+enum ShedLevel {
+	SHED_NONE = 0,
+	SHED_COALESCE = 1,
+	SHED_SKIP_DOPPLER = 2,
+	SHED_SKIP_RAW = 3
+};
+
+inline double steadySeconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class BackpressureScheduler {
+	public:
+		static constexpr int numStages = 3;
+		static constexpr double busyHigh = 0.9;
+		static constexpr double busyLow = 0.6;
+
+		std::atomic<uint64_t> raises{0};
+		std::atomic<uint64_t> drops{0};
+
+		void init(bool enabled, double highWater, double lowWater, size_t holdoff)
+		{
+			active = enabled;
+			high = highWater;
+			low = lowWater;
+			hold = holdoff > 0 ? holdoff : 1;
+			sinceEval = 0;
+			lastEval = steadySeconds();
+			shedLevel.store(SHED_NONE, std::memory_order_relaxed);
+			for (int s = 0; s < numStages; s++) {
+				busyNs[s].store(0, std::memory_order_relaxed);
+				lastBusyNs[s] = 0;
+				busy[s].store(0, std::memory_order_relaxed);
+			}
+			raises.store(0, std::memory_order_relaxed);
+			drops.store(0, std::memory_order_relaxed);
+		}
+
+		int level() const
+		{
+			return shedLevel.load(std::memory_order_relaxed);
+		}
+
+		// utilization of stage over the last evaluation window (0-1)
+		double utilization(int stage) const
+		{
+			return busy[stage].load(std::memory_order_relaxed);
+		}
+
+		// stage side, time spent processing since its last call
+		void addBusy(int stage, double seconds)
+		{
+			busyNs[stage].fetch_add((uint64_t)(seconds * 1e9), std::memory_order_relaxed);
+		}
+
+		// occupancy ... fill of input ring of every stage (0-1)
+		void update(const double* occupancy)
+		{
+			if (!active || ++sinceEval < hold)
+				return;
+			sinceEval = 0;
+			double now = steadySeconds();
+			double window = now - lastEval;
+			lastEval = now;
+
+			double fill = 0, load = 0;
+			for (int s = 0; s < numStages; s++) {
+				uint64_t total = busyNs[s].load(std::memory_order_relaxed);
+				double u = window > 0 ? (double)(total - lastBusyNs[s]) * 1e-9 / window : 0.0;
+				lastBusyNs[s] = total;
+				busy[s].store(u, std::memory_order_relaxed);
+				fill = occupancy[s] > fill ? occupancy[s] : fill;
+				load = u > load ? u : load;
+			}
+
+			int current = level();
+			if ((fill > high || load > busyHigh) && current < SHED_SKIP_RAW) {
+				shedLevel.store(current + 1, std::memory_order_relaxed);
+				raises.fetch_add(1, std::memory_order_relaxed);
+			} else if (fill < low && load < busyLow && current > SHED_NONE) {
+				shedLevel.store(current - 1, std::memory_order_relaxed);
+				drops.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		bool active = false;
+		double high = 0.5;
+		double low = 0.125;
+		size_t hold = 32;
+		size_t sinceEval = 0;
+		double lastEval = 0;
+		std::atomic<int> shedLevel{SHED_NONE};
+		std::atomic<uint64_t> busyNs[numStages] = {};
+		uint64_t lastBusyNs[numStages] = {};
+		std::atomic<double> busy[numStages] = {};
+};
+
+#endif /* !BACKPRESSURE_H */
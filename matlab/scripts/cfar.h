@@ -0,0 +1,78 @@
+#ifndef CFAR_H
+#define CFAR_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Cell averaging CFAR over one range profile
+//
+// Native counterpart of phased.CFARDetector with ThresholdFactor 'Auto':
+// training and guard are total cell counts split evenly to both sides of the
+// cell under test, threshold factor for probability of false alarm pfa is
+//   alpha = N * (pfa^(-1/N) - 1)
+// At the profile edges only cells present on one side are averaged. Output is
+// 1 for detection, 0 otherwise. Noise estimate uses running sums so the whole
+// profile is O(n) regardless of window size.
+
+class CACFAR {
+	public:
+		size_t training = 10;
+		size_t guard = 2;
+		double pfa = 1e-3;
+
+		void init(size_t numTraining, size_t numGuard, double probabilityFalseAlarm)
+		{
+			training = numTraining;
+			guard = numGuard;
+			pfa = probabilityFalseAlarm;
+		}
+
+		template <typename T>
+		void run(const T* x, float* out, size_t n) const
+		{
+			const long halfTrain = (long)(training / 2);
+			const long halfGuard = (long)(guard / 2);
+			const long len = (long)n;
+			double alpha = thresholdFactor(2 * halfTrain);
+
+			// cumulative sum, prefix[i] = sum(x[0..i-1])
+			prefix.resize(n + 1);
+			prefix[0] = 0.0;
+			for (size_t i = 0; i < n; i++)
+				prefix[i + 1] = prefix[i] + (double)x[i];
+
+			for (long i = 0; i < len; i++) {
+				long leadStart = i - halfGuard - halfTrain;
+				long leadEnd = i - halfGuard;           // exclusive
+				long lagStart = i + halfGuard + 1;
+				long lagEnd = i + halfGuard + halfTrain + 1; // exclusive
+
+				leadStart = leadStart < 0 ? 0 : leadStart;
+				leadEnd = leadEnd < 0 ? 0 : leadEnd;
+				lagStart = lagStart > len ? len : lagStart;
+				lagEnd = lagEnd > len ? len : lagEnd;
+
+				long cells = (leadEnd - leadStart) + (lagEnd - lagStart);
+				if (cells <= 0) {
+					out[i] = 0.0f;
+					continue;
+				}
+				double noise = (prefix[leadEnd] - prefix[leadStart]) + (prefix[lagEnd] - prefix[lagStart]);
+				double a = cells == 2 * halfTrain ? alpha : thresholdFactor(cells);
+				out[i] = (double)x[i] > a * noise / cells ? 1.0f : 0.0f;
+			}
+		}
+
+	private:
+		mutable std::vector<double> prefix;
+
+		double thresholdFactor(long cells) const
+		{
+			if (cells <= 0)
+				return 0.0;
+			return cells * (std::pow(pfa, -1.0 / cells) - 1.0);
+		}
+};
+
+#endif /* !CFAR_H */
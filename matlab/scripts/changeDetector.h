@@ -0,0 +1,299 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include "cfar.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Sweep to sweep change detection
+//
+// Cube accumulates with decay, so it doesn't say what changed since the last
+// revolution. Detector keeps reference range profile of every yaw/pitch cell
+// and compares each incoming profile with it in the cube update pass:
+//
+//   change = |log((x + noise) / (reference + noise))|
+//
+// noise is median of the cell's reference profile. Log ratio makes change
+// relative, strong static return fluctuating by a percent doesn't stand out
+// of its quiet neighbours as absolute difference would, while target
+// appearing or leaving gives large ratio either way. Change profile goes
+// through CA-CFAR along range (cfar.h) with its own pfa, bins over the
+// adaptive threshold are emitted as sparse ChangeRecords which consumers poll
+// instead of scanning the cube.
+//
+// Frames of one cell closer than visitGap belong to one visit (platform passing
+// the cell), their mean is folded into the reference only when the next visit
+// starts, so profile is never compared with the visit it belongs to:
+//
+//   reference = (1 - alpha) * reference + alpha * visit
+//
+// alpha = 1 compares with the previous sweep, small alpha with long EMA. First
+// visit of a cell only seeds its reference.
+//
+// Static return at the beam edge moves between adjacent yaw cells from sweep
+// to sweep as poses are sampled at other angles and its peak moves between
+// adjacent range bins. Bin over CFAR threshold is reported only when it rises
+// above references of its cell and seeded yaw neighbours or drops below them
+// by more than minRatio, with range bins r - 1 .. r + 1 tolerated, so such
+// return is not a change.
+//
+// process is called by the thread writing the cube (cube stage of
+// RadarPipeline or MATLAB after processBatch), poll by consumer, records are
+// guarded by mutex. When maxRecords are waiting newer records are dropped and
+// counted.
+
+struct ChangeDetectorConfig {
+	size_t rangeBins = 0;
+	size_t yawBins = 0;
+	size_t pitchBins = 0;
+	double rangeBinWidth = 1.0;    // (m)
+	size_t rangeBinMin = 0;        // range FFT bin of first range bin (range gate)
+	int yawBinMin = 0;             // angle of first yaw and pitch bin (deg)
+	int pitchBinMin = -20;
+	float alpha = 1.0f;            // reference update per visit, 1 = previous sweep
+	double visitGap = 1.0;         // (s) frames of a cell further apart start new visit
+	size_t training = 10;          // CA-CFAR over change profile
+	size_t guard = 2;
+	double pfa = 1e-4;
+	float minRatio = 4.0f;         // change has to leave neighbour references by this factor
+	size_t maxRecords = 4096;      // records waiting for poll
+};
+
+struct ChangeRecord {
+	double time;                   // frame time
+	float range;                   // (m)
+	float yaw;                     // (deg)
+	float pitch;
+	float value;                   // incoming profile
+	float reference;               // reference it was compared with
+};
+
+// incoming profile of one cell
+struct ChangeFrame {
+	size_t yaw;
+	size_t pitch;
+	double time;
+	const float* profile;          // [rangeBins]
+};
+
+struct ChangeDetectorStats {
+	std::atomic<uint64_t> frames{0};    // profiles compared
+	std::atomic<uint64_t> seeded{0};    // frames of first visits (no reference yet)
+	std::atomic<uint64_t> visits{0};    // visits folded into references
+	std::atomic<uint64_t> changes{0};   // records emitted
+	std::atomic<uint64_t> dropped{0};   // records dropped, poll too slow
+
+	void reset()
+	{
+		for (std::atomic<uint64_t>* c : {&frames, &seeded, &visits, &changes, &dropped})
+			c->store(0, std::memory_order_relaxed);
+	}
+};
+
+class ChangeDetector {
+	public:
+		ChangeDetectorStats stats;
+
+		void open(const ChangeDetectorConfig& cfg)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (cfg.rangeBins == 0 || cfg.yawBins == 0 || cfg.pitchBins == 0 ||
+					!(cfg.alpha > 0.0f && cfg.alpha <= 1.0f) || !(cfg.rangeBinWidth > 0) || !(cfg.minRatio >= 1.0f))
+				throw std::runtime_error("Invalid change detector configuration.");
+			config = cfg;
+			const size_t cells = cfg.yawBins * cfg.pitchBins;
+			reference.assign(cfg.rangeBins * cells, 0.0f);
+			visit.assign(cfg.rangeBins * cells, 0.0f);
+			state.assign(cells, CellState());
+			detector.init(cfg.training, cfg.guard, cfg.pfa);
+			change.assign(cfg.rangeBins, 0.0f);
+			flags.assign(cfg.rangeBins, 0.0f);
+			logMinRatio = std::log(cfg.minRatio);
+			records.clear();
+			records.reserve(std::min<size_t>(cfg.maxRecords, 65536));
+			stats.reset();
+			opened = true;
+		}
+
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			opened = false;
+			reference = std::vector<float>();
+			visit = std::vector<float>();
+			state = std::vector<CellState>();
+			records = std::vector<ChangeRecord>();
+		}
+
+		bool isOpen() const
+		{
+			return opened;
+		}
+
+		const ChangeDetectorConfig& getConfig() const
+		{
+			return config;
+		}
+
+		void process(const ChangeFrame* frames, size_t n)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!opened)
+				return;
+			const size_t R = config.rangeBins;
+			for (size_t k = 0; k < n; k++) {
+				const ChangeFrame& f = frames[k];
+				if (f.yaw >= config.yawBins || f.pitch >= config.pitchBins)
+					continue;
+				const size_t cell = f.yaw + f.pitch * config.yawBins;
+				CellState& s = state[cell];
+				float* ref = reference.data() + cell * R;
+				float* mean = visit.data() + cell * R;
+				stats.frames.fetch_add(1, std::memory_order_relaxed);
+
+				if (s.frames > 0 && f.time - s.lastTime > config.visitGap) {
+					foldVisit(s, ref, mean);
+					stats.visits.fetch_add(1, std::memory_order_relaxed);
+				}
+				s.lastTime = f.time;
+
+				if (s.hasReference) {
+					for (size_t r = 0; r < R; r++)
+						change[r] = std::fabs(std::log((f.profile[r] + s.noise) / (ref[r] + s.noise)));
+					detector.run(change.data(), flags.data(), R);
+					gatherNeighbours(f.yaw, f.pitch, ref);
+					for (size_t r = 0; r < R; r++)
+						if (flags[r] != 0.0f && outsideNeighbours(f.profile, r, s.noise) > logMinRatio)
+							emit(f, r, ref[r]);
+				} else {
+					stats.seeded.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				// running mean of the visit
+				s.frames++;
+				const float w = 1.0f / (float)s.frames;
+				for (size_t r = 0; r < R; r++)
+					mean[r] += (f.profile[r] - mean[r]) * w;
+			}
+		}
+
+		// records since last poll, oldest first
+		void poll(std::vector<ChangeRecord>& out)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			out.swap(records);
+			records.clear();
+		}
+
+		// references are learned again
+		void reset()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::fill(reference.begin(), reference.end(), 0.0f);
+			std::fill(visit.begin(), visit.end(), 0.0f);
+			std::fill(state.begin(), state.end(), CellState());
+		}
+
+	private:
+		struct CellState {
+			double lastTime = 0.0;
+			uint32_t frames = 0;       // frames of current visit
+			bool hasReference = false;
+			float noise = 0.0f;        // median of reference
+		};
+
+		ChangeDetectorConfig config;
+		std::mutex mutex;
+		bool opened = false;
+		std::vector<float> reference;  // [range x yaw x pitch]
+		std::vector<float> visit;      // mean of current visit [range x yaw x pitch]
+		std::vector<CellState> state;
+		std::vector<ChangeRecord> records;
+		CACFAR detector;
+		std::vector<float> change;
+		std::vector<float> flags;
+		float logMinRatio = 0.0f;
+		const float* neighbours[3];    // references of the cell and its seeded yaw neighbours
+		size_t neighbourCount = 0;
+
+		void gatherNeighbours(size_t yaw, size_t pitch, const float* ref)
+		{
+			const size_t Y = config.yawBins;
+			neighbourCount = 0;
+			neighbours[neighbourCount++] = ref;
+			for (long d : {-1L, 1L}) {
+				long y = (long)yaw + d;
+				if (Y >= 360)
+					y = (y + (long)Y) % (long)Y;
+				else if (y < 0 || y >= (long)Y)
+					continue;
+				const size_t cell = (size_t)y + pitch * Y;
+				if (state[cell].hasReference && cell != yaw + pitch * Y)
+					neighbours[neighbourCount++] = reference.data() + cell * config.rangeBins;
+			}
+		}
+
+		// log distance of x[r] from neighbour references, 0 inside. Rise is
+		// measured from max of references over range bins r - 1 .. r + 1, drop
+		// from max of x over them, peak moved by a bin is neither.
+		float outsideNeighbours(const float* x, size_t r, float noise) const
+		{
+			const size_t r0 = r > 0 ? r - 1 : 0;
+			const size_t r1 = std::min(r + 1, config.rangeBins - 1);
+			float lo = neighbours[0][r], hi = 0.0f, xmax = 0.0f;
+			for (size_t k = 0; k < neighbourCount; k++) {
+				lo = std::min(lo, neighbours[k][r]);
+				for (size_t i = r0; i <= r1; i++)
+					hi = std::max(hi, neighbours[k][i]);
+			}
+			for (size_t i = r0; i <= r1; i++)
+				xmax = std::max(xmax, x[i]);
+			if (x[r] > hi)
+				return std::log((x[r] + noise) / (hi + noise));
+			if (xmax < lo)
+				return std::log((lo + noise) / (xmax + noise));
+			return 0.0f;
+		}
+
+		void foldVisit(CellState& s, float* ref, float* mean)
+		{
+			const size_t R = config.rangeBins;
+			const float alpha = s.hasReference ? config.alpha : 1.0f;
+			for (size_t r = 0; r < R; r++) {
+				ref[r] += (mean[r] - ref[r]) * alpha;
+				mean[r] = 0.0f;
+			}
+			// median as noise floor, ratio of empty bins stays finite
+			change.assign(ref, ref + R);
+			std::nth_element(change.begin(), change.begin() + R / 2, change.end());
+			s.noise = std::max(change[R / 2], std::numeric_limits<float>::min());
+			s.hasReference = true;
+			s.frames = 0;
+		}
+
+		void emit(const ChangeFrame& f, size_t r, float ref)
+		{
+			if (records.size() >= config.maxRecords) {
+				stats.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			ChangeRecord c;
+			c.time = f.time;
+			c.range = (float)((double)(r + config.rangeBinMin) * config.rangeBinWidth);
+			c.yaw = (float)(config.yawBinMin + (long)f.yaw);
+			c.pitch = (float)(config.pitchBinMin + (long)f.pitch);
+			c.value = f.profile[r];
+			c.reference = ref;
+			records.push_back(c);
+			stats.changes.fetch_add(1, std::memory_order_relaxed);
+		}
+};
+
+#endif /* !CHANGE_DETECTOR_H */
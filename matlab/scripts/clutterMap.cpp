@@ -0,0 +1,53 @@
+#include "mex.h"
+#include "clutterMap.h"
+
+// residual = clutterMap(clutterCube, profile, yawIdx, pitchIdx, alpha)
+//
+// clutterCube ... single background estimate [range x yaw x pitch], updated
+//                 in place (memmapfile data, same as updateCube does with cube)
+// profile ... range profile [range x 1] (single or double)
+// yawIdx, pitchIdx ... 1-based cell indexes
+// alpha ... EMA coefficient
+//
+// residual has same class as profile and contains only returns stronger than
+// the background, background of the cell is updated in the same pass.
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	// Validate inputs
+	if (nrhs != 5) {
+		mexErrMsgTxt("Five inputs required: clutterCube, profile, yawIdx, pitchIdx, alpha");
+	}
+	if (!mxIsSingle(prhs[0])) {
+		mexErrMsgTxt("clutterCube must be single precision.");
+	}
+	if (!mxIsSingle(prhs[1]) && !mxIsDouble(prhs[1])) {
+		mexErrMsgTxt("profile must be single or double precision.");
+	}
+
+	const mwSize* dims = mxGetDimensions(prhs[0]);
+	mwSize numDims = mxGetNumberOfDimensions(prhs[0]);
+	mwSize rangeDim = dims[0];
+	mwSize yawDim = numDims > 1 ? dims[1] : 1;
+	mwSize pitchDim = numDims > 2 ? dims[2] : 1;
+
+	mwSize n = mxGetNumberOfElements(prhs[1]);
+	mwSize yawIdx = (mwSize)mxGetScalar(prhs[2]);
+	mwSize pitchIdx = (mwSize)mxGetScalar(prhs[3]);
+	float alpha = (float)mxGetScalar(prhs[4]);
+
+	if (n != rangeDim) {
+		mexErrMsgTxt("profile length must match first dimension of clutterCube.");
+	}
+	if (yawIdx < 1 || yawIdx > yawDim || pitchIdx < 1 || pitchIdx > pitchDim) {
+		mexErrMsgTxt("yawIdx or pitchIdx out of clutterCube range.");
+	}
+
+	float* background = (float*)mxGetData(prhs[0]) + rangeDim * ((yawIdx - 1) + (pitchIdx - 1) * yawDim);
+	plhs[0] = mxCreateNumericMatrix(n, 1, mxGetClassID(prhs[1]), mxREAL);
+
+	if (mxIsSingle(prhs[1])) {
+		clutterSubtract(background, (const float*)mxGetData(prhs[1]), (float*)mxGetData(plhs[0]), n, alpha);
+	} else {
+		clutterSubtract(background, mxGetPr(prhs[1]), mxGetPr(plhs[0]), n, alpha);
+	}
+}
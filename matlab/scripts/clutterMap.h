@@ -0,0 +1,28 @@
+#ifndef CLUTTER_MAP_H
+#define CLUTTER_MAP_H
+
+#include <cstddef>
+
+// Clutter map background subtraction (MTI style)
+//
+// background holds slowly updated estimate of static returns for one cell
+// (range profile of single yaw/pitch position). In one pass the incoming
+// profile is compared against the estimate from previous visits and the
+// estimate is moved towards the new profile:
+//   residual = max(x - background, 0)
+//   background = (1 - alpha) * background + alpha * x
+
+template <typename T>
+inline void clutterSubtract(float* background, const T* x, T* residual, size_t n, float alpha)
+{
+	const float keep = 1.0f - alpha;
+	for (size_t i = 0; i < n; i++) {
+		float v = (float)x[i];
+		float b = background[i];
+		float d = v - b;
+		residual[i] = (T)(d > 0.0f ? d : 0.0f);
+		background[i] = keep * b + alpha * v;
+	}
+}
+
+#endif /* !CLUTTER_MAP_H */
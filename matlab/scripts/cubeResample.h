@@ -0,0 +1,155 @@
+#ifndef CUBE_RESAMPLE_H
+#define CUBE_RESAMPLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Resampling of cube files along range
+//
+// Used when range bin width (rangeNFFT, samples, bandwidth) or range gate
+// changes, accumulated scene is carried over instead of reallocating and
+// zeroing the cubes. Cubes are column major with range as the fastest
+// dimension, every range column (Doppler bin of raw cell, cell of CFAR or
+// clutter cube) is resampled independently and columns are split between
+// threads.
+//
+// New bin r takes old bin position x = r * scale + offset, scale is ratio of
+// new and old bin width and offset = newBinMin * scale - oldBinMin accounts
+// for range gates. Range FFT with other number of points samples the same
+// spectrum, power maps are therefore linearly interpolated. Peak mode (CFAR
+// cube) keeps maximum of old bins covered by new bin, or nearest old bin when
+// new bins are narrower, so that detections survive. Range outside of old
+// bins is zero.
+
+struct RangeResampleMap {
+	std::vector<long> first;   // first old bin of new bin, -1 = no data
+	std::vector<long> last;    // last old bin (peak mode), first or first + 1 (linear)
+	std::vector<float> weight; // weight of last bin (linear mode)
+	bool peak = false;
+};
+
+inline RangeResampleMap rangeResampleMap(size_t oldBins, size_t newBins, double scale, double offset, bool peak)
+{
+	RangeResampleMap map;
+	map.peak = peak;
+	map.first.assign(newBins, -1);
+	map.last.assign(newBins, -1);
+	map.weight.assign(newBins, 0.0f);
+	const long top = (long)oldBins - 1;
+	for (size_t r = 0; r < newBins; r++) {
+		double x = (double)r * scale + offset;
+		if (peak) {
+			long lo = std::max((long)std::ceil(x - scale / 2), 0L);
+			long hi = std::min((long)std::floor(x + scale / 2), top);
+			if (lo > hi) {
+				lo = hi = std::lround(x);
+				if (lo < 0 || lo > top)
+					continue;
+			}
+			map.first[r] = lo;
+			map.last[r] = hi;
+		} else {
+			if (x < 0 || x > (double)top)
+				continue;
+			long i = std::min((long)x, top);
+			map.first[r] = i;
+			map.last[r] = std::min(i + 1, top);
+			map.weight[r] = i < top ? (float)(x - (double)i) : 0.0f;
+		}
+	}
+	return map;
+}
+
+inline void resampleRangeColumns(const float* src, size_t oldBins, float* dst, size_t newBins, size_t columns,
+		const RangeResampleMap& map, unsigned threads = 0)
+{
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	threads = (unsigned)std::min<size_t>(threads, std::max<size_t>(columns, 1));
+
+	auto work = [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			const float* in = src + c * oldBins;
+			float* out = dst + c * newBins;
+			for (size_t r = 0; r < newBins; r++) {
+				long first = map.first[r];
+				if (first < 0) {
+					out[r] = 0.0f;
+				} else if (map.peak) {
+					out[r] = *std::max_element(in + first, in + map.last[r] + 1);
+				} else {
+					float w = map.weight[r];
+					out[r] = in[first] * (1.0f - w) + in[map.last[r]] * w;
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	size_t chunk = (columns + threads - 1) / threads;
+	for (unsigned t = 1; t < threads; t++) {
+		size_t begin = std::min(columns, t * chunk);
+		pool.emplace_back(work, begin, std::min(columns, begin + chunk));
+	}
+	work(0, std::min(columns, chunk));
+	for (std::thread& t : pool)
+		t.join();
+}
+
+// Resamples cube file of columns x oldBins floats to columns x newBins. New
+// cube is written next to it and renamed over it, existing mappings of the
+// old file stay valid (and stale) until they are unmapped.
+inline void resampleCubeFile(const std::string& path, size_t oldBins, size_t columns, size_t newBins,
+		double scale, double offset, bool peak, unsigned threads = 0)
+{
+	if (oldBins == 0 || newBins == 0 || columns == 0 || !(scale > 0))
+		throw std::runtime_error("Invalid resampling of " + path);
+	const size_t oldBytes = oldBins * columns * sizeof(float);
+	const size_t newBytes = newBins * columns * sizeof(float);
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open cube file " + path);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < oldBytes) {
+		::close(fd);
+		throw std::runtime_error("Cube file " + path + " is smaller than cube");
+	}
+	void* in = mmap(nullptr, oldBytes, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (in == MAP_FAILED)
+		throw std::runtime_error("Failed to map cube file " + path);
+
+	const std::string tmp = path + ".resample";
+	fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	void* out = MAP_FAILED;
+	if (fd >= 0 && ftruncate(fd, (off_t)newBytes) == 0)
+		out = mmap(nullptr, newBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (fd >= 0)
+		::close(fd);
+	if (out == MAP_FAILED) {
+		munmap(in, oldBytes);
+		::unlink(tmp.c_str());
+		throw std::runtime_error("Failed to create " + tmp);
+	}
+
+	resampleRangeColumns((const float*)in, oldBins, (float*)out, newBins, columns,
+			rangeResampleMap(oldBins, newBins, scale, offset, peak), threads);
+	munmap(in, oldBytes);
+	munmap(out, newBytes);
+	if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+		::unlink(tmp.c_str());
+		throw std::runtime_error("Failed to replace " + path);
+	}
+}
+
+#endif /* !CUBE_RESAMPLE_H */
@@ -0,0 +1,49 @@
+#include "mex.h"
+#include "dbscanGrid.h"
+
+// [labels, corepts] = dbscanGrid(points, epsilon, minpts)
+//
+// Drop in replacement for
+//   dbscan(points, epsilon, minpts, 'Distance', @dataProcessor.polarEuclidDistance)
+// points ... [n x 3] double, columns range, yaw (deg), pitch (deg)
+// labels ... [n x 1] cluster indexes, -1 for noise
+// corepts ... [n x 1] logical, true for core points
+
+static DBSCANGrid dbscan;
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	// Validate inputs
+	if (nrhs != 3) {
+		mexErrMsgTxt("Three inputs required: points, epsilon, minpts");
+	}
+	if (!mxIsDouble(prhs[0]) || (mxGetN(prhs[0]) != 3 && mxGetNumberOfElements(prhs[0]) != 0)) {
+		mexErrMsgTxt("points must be double [n x 3] matrix (range, yaw, pitch).");
+	}
+
+	mwSize n = mxGetM(prhs[0]);
+	if (mxGetNumberOfElements(prhs[0]) == 0) {
+		n = 0;
+	}
+	double epsilon = mxGetScalar(prhs[1]);
+	double minPts = mxGetScalar(prhs[2]);
+	if (epsilon < 0 || minPts < 0) {
+		mexErrMsgTxt("epsilon and minpts must be non negative.");
+	}
+
+	const double* points = mxGetPr(prhs[0]);
+	dbscan.run(points, points + n, points + 2 * n, n, epsilon, (size_t)minPts);
+
+	plhs[0] = mxCreateDoubleMatrix(n, 1, mxREAL);
+	double* labels = mxGetPr(plhs[0]);
+	for (mwSize i = 0; i < n; i++) {
+		labels[i] = dbscan.labels[i];
+	}
+
+	if (nlhs > 1) {
+		plhs[1] = mxCreateNumericMatrix(n, 1, mxLOGICAL_CLASS, mxREAL);
+		mxLogical* core = (mxLogical*)mxGetData(plhs[1]);
+		for (mwSize i = 0; i < n; i++) {
+			core[i] = dbscan.core[i] != 0;
+		}
+	}
+}
@@ -0,0 +1,192 @@
+#ifndef DBSCAN_GRID_H
+#define DBSCAN_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// Grid accelerated DBSCAN over detections given in polar coordinates
+//
+// Distance is the one used by dataProcessor.polarEuclidDistance, euclidean
+// distance scaled down linearly with range:
+//   D(a, b) = |a - b| / ((range_a + range_b) / 30)
+// Points are converted to cartesian coordinates once and binned into a
+// spatial hash. Since range_b <= range_a + |a - b|, all neighbours of a lie
+// within rho_a = 2*epsilon*range_a / (30 - epsilon) so only cells within
+// ceil(rho_a / cellSize) are visited; cell size is rho at mean range, which
+// makes it adjacent cells for typical points. Cell size is never below
+// rho at max range / maxSpan, so detections close to zero range pulling the
+// mean down don't make far points visit (2 * span + 1)^3 cells.
+//
+// Labels follow MATLAB dbscan: clusters are numbered from 1 in order of
+// discovery, -1 marks noise, point counts as its own neighbour.
+
+class DBSCANGrid {
+	public:
+		static constexpr double rangeScale = 30.0;
+		static constexpr double maxSpan = 4.0; // cells visited along each axis from the point's cell
+
+		std::vector<int> labels;
+		std::vector<uint8_t> core;
+
+		void run(const double* range, const double* yaw, const double* pitch, size_t n, double epsilon, size_t minPts)
+		{
+			numPoints = n;
+			eps = epsilon;
+			labels.assign(n, 0);
+			core.assign(n, 0);
+			x.resize(n);
+			y.resize(n);
+			z.resize(n);
+			r.assign(range, range + n);
+
+			double meanRange = 0, maxRange = 0;
+			for (size_t i = 0; i < n; i++) {
+				double p = pitch[i] * M_PI / 180.0;
+				double a = yaw[i] * M_PI / 180.0;
+				x[i] = range[i] * std::cos(p) * std::cos(a);
+				y[i] = range[i] * std::cos(p) * std::sin(a);
+				z[i] = range[i] * std::sin(p);
+				meanRange += range[i];
+				maxRange = std::max(maxRange, range[i]);
+			}
+			meanRange = n ? meanRange / n : 0;
+
+			bruteForce = eps >= rangeScale;
+			if (!bruteForce) {
+				cellSize = std::max({searchRadius(meanRange), searchRadius(maxRange) / maxSpan, 1e-6});
+				buildGrid();
+			}
+
+			int cluster = 0;
+			std::vector<size_t> neighbours;
+			std::vector<size_t> seeds;
+			for (size_t i = 0; i < n; i++) {
+				if (labels[i] != 0) {
+					continue;
+				}
+				query(i, neighbours);
+				if (neighbours.size() < minPts) {
+					labels[i] = -1;
+					continue;
+				}
+				cluster++;
+				labels[i] = cluster;
+				core[i] = 1;
+				seeds = neighbours;
+				for (size_t s = 0; s < seeds.size(); s++) {
+					size_t q = seeds[s];
+					if (labels[q] == -1) {
+						labels[q] = cluster; // border point
+					}
+					if (labels[q] != 0) {
+						continue;
+					}
+					labels[q] = cluster;
+					query(q, neighbours);
+					if (neighbours.size() >= minPts) {
+						core[q] = 1;
+						seeds.insert(seeds.end(), neighbours.begin(), neighbours.end());
+					}
+				}
+			}
+		}
+
+	private:
+		size_t numPoints = 0;
+		double eps = 0;
+		double cellSize = 1;
+		bool bruteForce = false;
+		std::vector<double> x, y, z, r;
+		std::vector<size_t> order;                                   // point indexes sorted by cell
+		std::unordered_map<uint64_t, std::pair<size_t, size_t>> cells; // cell -> [start, end) in order
+
+		double searchRadius(double range) const
+		{
+			return 2.0 * eps * range / (rangeScale - eps);
+		}
+
+		int64_t cellCoord(double v) const
+		{
+			return (int64_t)std::floor(v / cellSize);
+		}
+
+		static uint64_t cellKey(int64_t cx, int64_t cy, int64_t cz)
+		{
+			const int64_t offset = 1 << 20;
+			return ((uint64_t)(cx + offset) & 0x1FFFFF) << 42
+				| ((uint64_t)(cy + offset) & 0x1FFFFF) << 21
+				| ((uint64_t)(cz + offset) & 0x1FFFFF);
+		}
+
+		void buildGrid()
+		{
+			std::vector<uint64_t> keys(numPoints);
+			for (size_t i = 0; i < numPoints; i++) {
+				keys[i] = cellKey(cellCoord(x[i]), cellCoord(y[i]), cellCoord(z[i]));
+			}
+			order.resize(numPoints);
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+				return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+			});
+			cells.clear();
+			cells.reserve(numPoints);
+			size_t start = 0;
+			for (size_t i = 1; i <= numPoints; i++) {
+				if (i == numPoints || keys[order[i]] != keys[order[start]]) {
+					cells[keys[order[start]]] = {start, i};
+					start = i;
+				}
+			}
+		}
+
+		bool isNeighbour(size_t a, size_t b) const
+		{
+			if (a == b) {
+				return true;
+			}
+			double dx = x[a] - x[b];
+			double dy = y[a] - y[b];
+			double dz = z[a] - z[b];
+			double scale = (r[a] + r[b]) / rangeScale;
+			// same comparison as D <= epsilon, zero scale gives NaN in MATLAB
+			return scale > 0 && std::sqrt(dx * dx + dy * dy + dz * dz) / scale <= eps;
+		}
+
+		void query(size_t a, std::vector<size_t>& out) const
+		{
+			out.clear();
+			if (bruteForce) {
+				for (size_t b = 0; b < numPoints; b++) {
+					if (isNeighbour(a, b)) {
+						out.push_back(b);
+					}
+				}
+				return;
+			}
+			int64_t span = (int64_t)std::ceil(searchRadius(r[a]) / cellSize);
+			int64_t cx = cellCoord(x[a]), cy = cellCoord(y[a]), cz = cellCoord(z[a]);
+			for (int64_t ix = cx - span; ix <= cx + span; ix++) {
+				for (int64_t iy = cy - span; iy <= cy + span; iy++) {
+					for (int64_t iz = cz - span; iz <= cz + span; iz++) {
+						auto it = cells.find(cellKey(ix, iy, iz));
+						if (it == cells.end()) {
+							continue;
+						}
+						for (size_t k = it->second.first; k < it->second.second; k++) {
+							if (isNeighbour(a, order[k])) {
+								out.push_back(order[k]);
+							}
+						}
+					}
+				}
+			}
+		}
+};
+
+#endif /* !DBSCAN_GRID_H */
@@ -0,0 +1,560 @@
+#ifndef DETECTION_STREAM_H
+#define DETECTION_STREAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Local stream of CFAR detections and tracks over Unix domain socket
+//
+// Clients connect to SOCK_STREAM socket and send StreamSubscribe (may be
+// resent any time), until then they get everything without rate limit. Every
+// published update is filtered by sector of each client and sent as one frame:
+//
+//   StreamFrameHeader, numDetections x StreamDetection, numTracks x StreamTrack
+//
+// All fields are little endian, structures are packed without padding. Client
+// with rate limit gets at most maxRate frames per second, detections of
+// updates in between are batched into the next frame (up to maxBatch, excess
+// is counted in dropped), tracks are state so only the newest ones are sent.
+// Server never blocks, client whose socket buffer and backlog are full loses
+// frames, which are counted in dropped of its next frame.
+//
+// publish copies update to small queue and wakes server thread through
+// eventfd, filtering and writes happen on the server thread only.
+
+#pragma pack(push, 1)
+struct StreamSubscribe {
+	char magic[4];       // "SUB1"
+	float yawMin;        // sector (deg), yawMin > yawMax wraps over 0
+	float yawMax;
+	float pitchMin;
+	float pitchMax;
+	float rangeMin;      // (m)
+	float rangeMax;
+	float maxRate;       // frames per second, 0 = every update
+	uint32_t flags;      // STREAM_DETECTIONS | STREAM_TRACKS
+};
+
+struct StreamFrameHeader {
+	char magic[4];       // "DET1"
+	uint32_t bytes;      // whole frame including header
+	uint64_t sequence;   // update number of newest batched update
+	double time;         // MATLAB time base (s)
+	uint32_t numDetections;
+	uint32_t numTracks;
+	uint32_t dropped;    // detections and frames lost since previous frame
+	uint32_t batched;    // updates merged into this frame
+};
+
+struct StreamDetection {
+	float range;         // (m)
+	float yaw;           // (deg)
+	float pitch;         // (deg)
+	float value;         // CFAR cube value
+};
+
+struct StreamTrack {
+	uint32_t id;
+	uint32_t hits;
+	float pos[3];        // cartesian (m), x = east, y = north
+	float vel[3];        // (m/s)
+	float age;           // (s)
+	uint32_t confirmed;
+};
+#pragma pack(pop)
+
+enum StreamFlags {
+	STREAM_DETECTIONS = 1,
+	STREAM_TRACKS = 2
+};
+
+struct DetectionStreamStats {
+	std::atomic<uint64_t> published{0};
+	std::atomic<uint64_t> frames{0};         // sent to all clients
+	std::atomic<uint64_t> droppedFrames{0};  // client backlog full
+	std::atomic<uint64_t> droppedUpdates{0}; // publish queue full
+	std::atomic<uint32_t> clients{0};
+};
+
+class DetectionStream {
+	public:
+		static constexpr size_t maxQueue = 16;        // updates waiting for server thread
+		static constexpr size_t maxBatch = 16384;     // detections batched per client
+		static constexpr size_t maxBacklog = 1 << 20; // bytes buffered per client
+
+		DetectionStreamStats stats;
+
+		~DetectionStream() { close(); }
+
+		bool isOpen() const
+		{
+			return running.load(std::memory_order_acquire);
+		}
+
+		void open(const std::string& socketPath)
+		{
+			close();
+			sockaddr_un addr{};
+			if (socketPath.size() >= sizeof(addr.sun_path))
+				throw std::runtime_error("Socket path " + socketPath + " is too long");
+			addr.sun_family = AF_UNIX;
+			std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+			// stale socket of crashed session
+			unlink(socketPath.c_str());
+			listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if (listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 8) != 0) {
+				std::string error = std::strerror(errno);
+				closeFds();
+				throw std::runtime_error("Failed to listen on " + socketPath + ": " + error);
+			}
+			wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (wakeFd < 0) {
+				closeFds();
+				unlink(socketPath.c_str());
+				throw std::runtime_error("Failed to create eventfd");
+			}
+			path = socketPath;
+			stats.published.store(0, std::memory_order_relaxed);
+			stats.frames.store(0, std::memory_order_relaxed);
+			stats.droppedFrames.store(0, std::memory_order_relaxed);
+			stats.droppedUpdates.store(0, std::memory_order_relaxed);
+			stats.clients.store(0, std::memory_order_relaxed);
+			sequence = 0;
+			running.store(true, std::memory_order_release);
+			worker = std::thread(&DetectionStream::run, this);
+		}
+
+		void close()
+		{
+			running.store(false, std::memory_order_release);
+			if (wakeFd >= 0) {
+				uint64_t one = 1;
+				ssize_t r = write(wakeFd, &one, sizeof(one));
+				(void)r;
+			}
+			if (worker.joinable())
+				worker.join();
+			clients.clear();
+			closeFds();
+			if (!path.empty())
+				unlink(path.c_str());
+			path.clear();
+			queue.clear();
+		}
+
+		// detections ... [n x 4] column major range, yaw, pitch, value
+		// tracks ... [m x 10] column major id, x, y, z, vx, vy, vz, age, hits,
+		//            confirmed (targetTracker output)
+		void publish(double time, const double* detections, size_t n, const double* tracks, size_t m)
+		{
+			if (!isOpen())
+				return;
+			std::unique_ptr<Update> u(new Update());
+			u->time = time;
+			u->detections.resize(n);
+			for (size_t k = 0; k < n; k++) {
+				u->detections[k].range = (float)detections[k];
+				u->detections[k].yaw = (float)detections[n + k];
+				u->detections[k].pitch = (float)detections[2 * n + k];
+				u->detections[k].value = (float)detections[3 * n + k];
+			}
+			u->tracks.resize(m);
+			for (size_t k = 0; k < m; k++) {
+				StreamTrack& t = u->tracks[k];
+				t.id = (uint32_t)tracks[k];
+				for (int a = 0; a < 3; a++) {
+					t.pos[a] = (float)tracks[(1 + a) * m + k];
+					t.vel[a] = (float)tracks[(4 + a) * m + k];
+				}
+				t.age = (float)tracks[7 * m + k];
+				t.hits = (uint32_t)tracks[8 * m + k];
+				t.confirmed = (uint32_t)tracks[9 * m + k];
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (queue.size() == maxQueue) {
+					queue.pop_front();
+					stats.droppedUpdates.fetch_add(1, std::memory_order_relaxed);
+				}
+				u->sequence = ++sequence;
+				queue.push_back(std::move(u));
+			}
+			stats.published.fetch_add(1, std::memory_order_relaxed);
+			uint64_t one = 1;
+			ssize_t r = write(wakeFd, &one, sizeof(one));
+			(void)r;
+		}
+
+	private:
+		struct Update {
+			uint64_t sequence = 0;
+			double time = 0;
+			std::vector<StreamDetection> detections;
+			std::vector<StreamTrack> tracks;
+		};
+
+		struct Client {
+			int fd = -1;
+			bool closed = false;
+			StreamSubscribe filter;
+			double interval = 0;         // 1/maxRate
+			double lastSent = -1e300;    // steady clock
+			// pending batch
+			bool pending = false;
+			uint64_t sequence = 0;
+			double time = 0;
+			uint32_t batched = 0;
+			uint32_t dropped = 0;
+			std::vector<StreamDetection> detections;
+			std::vector<StreamTrack> tracks;
+			// bytes not yet accepted by socket
+			std::vector<uint8_t> backlog;
+			size_t backlogOffset = 0;
+			// partially received subscription
+			uint8_t request[sizeof(StreamSubscribe)];
+			size_t requestBytes = 0;
+
+			explicit Client(int socket) : fd(socket)
+			{
+				std::memcpy(filter.magic, "SUB1", 4);
+				filter.yawMin = 0;
+				filter.yawMax = 360;
+				filter.pitchMin = -90;
+				filter.pitchMax = 90;
+				filter.rangeMin = 0;
+				filter.rangeMax = INFINITY;
+				filter.maxRate = 0;
+				filter.flags = STREAM_DETECTIONS | STREAM_TRACKS;
+			}
+
+			~Client()
+			{
+				if (fd >= 0)
+					::close(fd);
+			}
+		};
+
+		std::string path;
+		int listenFd = -1;
+		int wakeFd = -1;
+		std::atomic<bool> running{false};
+		std::thread worker;
+		std::mutex mutex;
+		std::deque<std::unique_ptr<Update>> queue;
+		uint64_t sequence = 0;
+		std::vector<std::unique_ptr<Client>> clients; // server thread only
+
+		void closeFds()
+		{
+			if (listenFd >= 0)
+				::close(listenFd);
+			if (wakeFd >= 0)
+				::close(wakeFd);
+			listenFd = wakeFd = -1;
+		}
+
+		static double now()
+		{
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+		}
+
+		static bool inSector(const StreamSubscribe& f, float range, float yaw, float pitch)
+		{
+			if (range < f.rangeMin || range > f.rangeMax || pitch < f.pitchMin || pitch > f.pitchMax)
+				return false;
+			float y = std::fmod(yaw, 360.0f);
+			y = y < 0 ? y + 360.0f : y;
+			if (f.yawMax - f.yawMin >= 360.0f)
+				return true;
+			float lo = std::fmod(f.yawMin, 360.0f), hi = std::fmod(f.yawMax, 360.0f);
+			lo = lo < 0 ? lo + 360.0f : lo;
+			hi = hi < 0 ? hi + 360.0f : hi;
+			return lo <= hi ? (y >= lo && y <= hi) : (y >= lo || y <= hi);
+		}
+
+		// track position to the polar convention of detections (yaw clockwise from y)
+		static bool trackInSector(const StreamSubscribe& f, const StreamTrack& t)
+		{
+			float range = std::sqrt(t.pos[0] * t.pos[0] + t.pos[1] * t.pos[1] + t.pos[2] * t.pos[2]);
+			float yaw = 90.0f - std::atan2(t.pos[1], t.pos[0]) * (float)(180.0 / M_PI);
+			float pitch = range > 0 ? std::asin(t.pos[2] / range) * (float)(180.0 / M_PI) : 0.0f;
+			return inSector(f, range, yaw, pitch);
+		}
+
+		void run()
+		{
+			std::vector<pollfd> fds;
+			while (running.load(std::memory_order_acquire)) {
+				fds.clear();
+				fds.push_back({listenFd, POLLIN, 0});
+				fds.push_back({wakeFd, POLLIN, 0});
+				for (const std::unique_ptr<Client>& c : clients)
+					fds.push_back({c->fd, (short)(POLLIN | (c->backlog.size() > c->backlogOffset ? POLLOUT : 0)), 0});
+				if (poll(fds.data(), fds.size(), flushTimeout()) < 0 && errno != EINTR)
+					break;
+				if (fds[1].revents & POLLIN) {
+					uint64_t count;
+					ssize_t r = read(wakeFd, &count, sizeof(count));
+					(void)r;
+				}
+				if (fds[0].revents & POLLIN)
+					accept();
+				for (size_t k = 0; k < clients.size(); k++) {
+					short ev = fds[2 + k].revents;
+					if ((ev & (POLLIN | POLLHUP | POLLERR)) && !receive(*clients[k]))
+						clients[k]->closed = true;
+					else if (ev & POLLOUT)
+						flushBacklog(*clients[k]);
+				}
+				removeClosed();
+				dispatch();
+				double t = now();
+				for (std::unique_ptr<Client>& c : clients) {
+					if (c->pending && t - c->lastSent >= c->interval)
+						send(*c, t);
+				}
+			}
+		}
+
+		// poll waits until the next rate limited batch is due
+		int flushTimeout() const
+		{
+			double t = now(), due = 1.0;
+			for (const std::unique_ptr<Client>& c : clients) {
+				if (c->pending)
+					due = std::min(due, c->lastSent + c->interval - t);
+			}
+			return (int)std::max(0.0, std::ceil(due * 1e3));
+		}
+
+		void accept()
+		{
+			while (true) {
+				int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (fd < 0)
+					return;
+				clients.emplace_back(new Client(fd));
+				stats.clients.store((uint32_t)clients.size(), std::memory_order_relaxed);
+			}
+		}
+
+		// false when client disconnected or sent garbage
+		bool receive(Client& c)
+		{
+			while (true) {
+				ssize_t r = read(c.fd, c.request + c.requestBytes, sizeof(c.request) - c.requestBytes);
+				if (r == 0)
+					return false;
+				if (r < 0)
+					return errno == EAGAIN || errno == EINTR;
+				c.requestBytes += (size_t)r;
+				if (c.requestBytes < sizeof(c.request))
+					continue;
+				c.requestBytes = 0;
+				StreamSubscribe s;
+				std::memcpy(&s, c.request, sizeof(s));
+				if (std::memcmp(s.magic, "SUB1", 4) != 0)
+					return false;
+				c.filter = s;
+				c.interval = s.maxRate > 0 ? 1.0 / s.maxRate : 0.0;
+			}
+		}
+
+		void removeClosed()
+		{
+			size_t before = clients.size();
+			clients.erase(std::remove_if(clients.begin(), clients.end(),
+					[](const std::unique_ptr<Client>& c) { return c->closed; }), clients.end());
+			if (clients.size() != before)
+				stats.clients.store((uint32_t)clients.size(), std::memory_order_relaxed);
+		}
+
+		// filters queued updates into batches of every client
+		void dispatch()
+		{
+			std::deque<std::unique_ptr<Update>> updates;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				updates.swap(queue);
+			}
+			for (const std::unique_ptr<Update>& u : updates) {
+				for (std::unique_ptr<Client>& c : clients) {
+					const StreamSubscribe& f = c->filter;
+					if (f.flags & STREAM_DETECTIONS) {
+						for (const StreamDetection& d : u->detections) {
+							if (!inSector(f, d.range, d.yaw, d.pitch))
+								continue;
+							if (c->detections.size() < maxBatch)
+								c->detections.push_back(d);
+							else
+								c->dropped++;
+						}
+					}
+					if (f.flags & STREAM_TRACKS) {
+						c->tracks.clear();
+						for (const StreamTrack& t : u->tracks) {
+							if (trackInSector(f, t))
+								c->tracks.push_back(t);
+						}
+					}
+					c->pending = true;
+					c->sequence = u->sequence;
+					c->time = u->time;
+					c->batched++;
+				}
+			}
+		}
+
+		void send(Client& c, double t)
+		{
+			StreamFrameHeader h;
+			std::memcpy(h.magic, "DET1", 4);
+			h.numDetections = (uint32_t)c.detections.size();
+			h.numTracks = (uint32_t)c.tracks.size();
+			h.bytes = (uint32_t)(sizeof(h) + h.numDetections * sizeof(StreamDetection) + h.numTracks * sizeof(StreamTrack));
+			h.sequence = c.sequence;
+			h.time = c.time;
+			h.dropped = c.dropped;
+			h.batched = c.batched;
+
+			size_t queued = c.backlog.size() - c.backlogOffset;
+			if (queued + h.bytes > maxBacklog) {
+				// reader is too slow, frame is lost and reported in the next one
+				c.dropped += 1 + h.numDetections;
+				stats.droppedFrames.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				const uint8_t* header = (const uint8_t*)&h;
+				c.backlog.insert(c.backlog.end(), header, header + sizeof(h));
+				const uint8_t* d = (const uint8_t*)c.detections.data();
+				c.backlog.insert(c.backlog.end(), d, d + h.numDetections * sizeof(StreamDetection));
+				const uint8_t* tr = (const uint8_t*)c.tracks.data();
+				c.backlog.insert(c.backlog.end(), tr, tr + h.numTracks * sizeof(StreamTrack));
+				c.dropped = 0;
+				stats.frames.fetch_add(1, std::memory_order_relaxed);
+				flushBacklog(c);
+			}
+			c.detections.clear();
+			c.pending = false;
+			c.batched = 0;
+			c.lastSent = t;
+		}
+
+		void flushBacklog(Client& c)
+		{
+			while (c.backlogOffset < c.backlog.size()) {
+				ssize_t w = ::send(c.fd, c.backlog.data() + c.backlogOffset, c.backlog.size() - c.backlogOffset,
+						MSG_NOSIGNAL | MSG_DONTWAIT);
+				if (w <= 0)
+					break;
+				c.backlogOffset += (size_t)w;
+			}
+			if (c.backlogOffset == c.backlog.size()) {
+				c.backlog.clear();
+				c.backlogOffset = 0;
+			} else if (c.backlogOffset >= maxBacklog / 2) {
+				// sent bytes are dropped, otherwise slow reader which never drains
+				// the backlog completely would grow it past maxBacklog
+				c.backlog.erase(c.backlog.begin(), c.backlog.begin() + (std::ptrdiff_t)c.backlogOffset);
+				c.backlogOffset = 0;
+			}
+		}
+};
+
+// Consumer side, blocking reads of frames
+class DetectionStreamClient {
+	public:
+		~DetectionStreamClient() { disconnect(); }
+
+		bool connect(const std::string& socketPath)
+		{
+			disconnect();
+			sockaddr_un addr{};
+			if (socketPath.size() >= sizeof(addr.sun_path))
+				return false;
+			addr.sun_family = AF_UNIX;
+			std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+			fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+				disconnect();
+				return false;
+			}
+			return true;
+		}
+
+		void disconnect()
+		{
+			if (fd >= 0)
+				::close(fd);
+			fd = -1;
+		}
+
+		bool subscribe(const StreamSubscribe& s)
+		{
+			StreamSubscribe m = s;
+			std::memcpy(m.magic, "SUB1", 4);
+			return writeAll((const uint8_t*)&m, sizeof(m));
+		}
+
+		// waits for next frame, false on disconnect
+		bool next(StreamFrameHeader& header, std::vector<StreamDetection>& detections, std::vector<StreamTrack>& tracks)
+		{
+			if (!readAll((uint8_t*)&header, sizeof(header)) || std::memcmp(header.magic, "DET1", 4) != 0)
+				return false;
+			detections.resize(header.numDetections);
+			tracks.resize(header.numTracks);
+			return readAll((uint8_t*)detections.data(), detections.size() * sizeof(StreamDetection)) &&
+				readAll((uint8_t*)tracks.data(), tracks.size() * sizeof(StreamTrack));
+		}
+
+	private:
+		int fd = -1;
+
+		bool readAll(uint8_t* p, size_t n)
+		{
+			while (n > 0) {
+				ssize_t r = read(fd, p, n);
+				if (r < 0 && errno == EINTR)
+					continue;
+				if (r <= 0)
+					return false;
+				p += r;
+				n -= (size_t)r;
+			}
+			return true;
+		}
+
+		bool writeAll(const uint8_t* p, size_t n)
+		{
+			while (n > 0) {
+				ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+				if (w < 0 && errno == EINTR)
+					continue;
+				if (w <= 0)
+					return false;
+				p += w;
+				n -= (size_t)w;
+			}
+			return true;
+		}
+};
+
+#endif /* !DETECTION_STREAM_H */
@@ -0,0 +1,166 @@
+#ifndef DIRTY_TILES_H
+#define DIRTY_TILES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dirty tiles of the cube
+//
+// Cube update rewrites only cells of the batch (with spread pattern around
+// them), rest of the cube is just scaled by decay. DirtyTiles is bitmap of
+// yaw x pitch tiles of tileSize x tileSize cells holding rewritten cells, tile
+// (i, j) is bit i + j * tilesYaw, together with extent of range bins which
+// may have changed in them. Consumers (sector index, renderer, DBSCAN,
+// recorder) redo only dirty tiles instead of the whole cube. Decay of the
+// whole cube is not tracked.
+//
+// Not synchronized, owner guards it.
+
+class DirtyTiles {
+	public:
+		void init(size_t yawBins, size_t pitchBins, size_t tileSize, size_t rangeBins)
+		{
+			Y = yawBins;
+			P = pitchBins;
+			T = std::max<size_t>(tileSize, 1);
+			R = rangeBins;
+			tilesYaw = (Y + T - 1) / T;
+			tilesPitch = (P + T - 1) / T;
+			words.assign((tilesYaw * tilesPitch + 63) / 64, 0);
+			clear();
+		}
+
+		size_t getTilesYaw() const { return tilesYaw; }
+		size_t getTilesPitch() const { return tilesPitch; }
+		size_t getTileSize() const { return T; }
+
+		bool empty() const
+		{
+			return !dirty;
+		}
+
+		// cell with patternYaw x patternPitch spread around it, yaw wraps for
+		// full circle, otherwise clipped as by the cube update
+		void markCell(size_t yaw, size_t pitch, size_t patternYaw = 1, size_t patternPitch = 1)
+		{
+			patternYaw = std::max<size_t>(patternYaw, 1);
+			patternPitch = std::max<size_t>(patternPitch, 1);
+			long p0 = std::max((long)pitch - (long)patternPitch / 2, 0L);
+			long p1 = std::min((long)pitch - (long)patternPitch / 2 + (long)patternPitch, (long)P) - 1;
+			long y0 = (long)yaw - (long)patternYaw / 2;
+			long y1 = y0 + (long)patternYaw - 1;
+			if (p0 > p1)
+				return;
+			if (Y >= 360 && (y0 < 0 || y1 >= (long)Y)) {
+				// wrapped pattern may touch both ends
+				for (long y = y0; y <= y1; y++)
+					markTiles((size_t)(((y % (long)Y) + (long)Y) % (long)Y) / T, (size_t)p0 / T, (size_t)p1 / T);
+				return;
+			}
+			y0 = std::max(y0, 0L);
+			y1 = std::min(y1, (long)Y - 1);
+			for (long i = y0 / (long)T; y0 <= y1 && i <= y1 / (long)T; i++)
+				markTiles((size_t)i, (size_t)p0 / T, (size_t)p1 / T);
+		}
+
+		void markRange(size_t first, size_t last)
+		{
+			rangeFirst = std::min(rangeFirst, first);
+			rangeLast = std::max(rangeLast, std::min(last, R - 1));
+		}
+
+		// range bins with nonzero value of [rangeBins x columns] data
+		void markNonzeroRange(const float* x, size_t columns)
+		{
+			size_t first = 0, last = R;
+			for (; first < R && !nonzeroRow(x, first, columns); first++) {}
+			if (first == R)
+				return;
+			while (--last > first && !nonzeroRow(x, last, columns)) {}
+			markRange(first, last);
+		}
+
+		void markAll()
+		{
+			for (size_t t = 0; t < tilesYaw * tilesPitch; t++)
+				words[t / 64] |= 1ull << (t % 64);
+			dirty = tilesYaw * tilesPitch > 0;
+			if (R > 0)
+				markRange(0, R - 1);
+		}
+
+		// other has the same geometry
+		void merge(const DirtyTiles& other)
+		{
+			if (other.empty())
+				return;
+			for (size_t w = 0; w < words.size() && w < other.words.size(); w++)
+				words[w] |= other.words[w];
+			dirty = true;
+			if (other.hasRange())
+				markRange(other.rangeFirst, other.rangeLast);
+		}
+
+		void clear()
+		{
+			std::fill(words.begin(), words.end(), 0);
+			dirty = false;
+			rangeFirst = SIZE_MAX;
+			rangeLast = 0;
+		}
+
+		bool test(size_t i, size_t j) const
+		{
+			size_t t = i + j * tilesYaw;
+			return (words[t / 64] >> (t % 64)) & 1;
+		}
+
+		// f(i, j) for every dirty tile in bit order
+		template <typename F>
+		void forEach(F f) const
+		{
+			for (size_t w = 0; w < words.size(); w++)
+				for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+					size_t t = w * 64 + (size_t)__builtin_ctzll(bits);
+					f(t % tilesYaw, t / tilesYaw);
+				}
+		}
+
+		// range bins of dirty tiles which may have changed, none if !hasRange()
+		bool hasRange() const
+		{
+			return rangeFirst <= rangeLast;
+		}
+
+		size_t getRangeFirst() const { return rangeFirst; }
+		size_t getRangeLast() const { return rangeLast; }
+
+	private:
+		size_t Y = 0, P = 0, T = 1, R = 0;
+		size_t tilesYaw = 0, tilesPitch = 0;
+		std::vector<uint64_t> words;     // [tilesYaw x tilesPitch] bits
+		bool dirty = false;
+		size_t rangeFirst = SIZE_MAX;
+		size_t rangeLast = 0;
+
+		void markTiles(size_t i, size_t j0, size_t j1)
+		{
+			for (size_t j = j0; j <= j1; j++) {
+				size_t t = i + j * tilesYaw;
+				words[t / 64] |= 1ull << (t % 64);
+			}
+			dirty = true;
+		}
+
+		bool nonzeroRow(const float* x, size_t r, size_t columns) const
+		{
+			for (size_t c = 0; c < columns; c++)
+				if (x[r + c * R] != 0.0f)
+					return true;
+			return false;
+		}
+};
+
+#endif /* !DIRTY_TILES_H */
@@ -0,0 +1,125 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Radix-2 FFT over split complex data laid out as [n x batch] with the batch
+// dimension contiguous (element (k, b) lives at k*batch + b). Every butterfly
+// is therefore applied to whole rows, which vectorises across e.g. all range
+// bins of a slow time transform. With batch == 1 it is a plain FFT.
+
+struct FFTPlan {
+	size_t n = 0;
+	std::vector<float> cosT;         // cos(2*pi*k/n), k < n/2
+	std::vector<float> sinT;         // sin(2*pi*k/n), k < n/2
+	std::vector<uint32_t> bitrev;    // bit reversed index permutation
+
+	FFTPlan() = default;
+	explicit FFTPlan(size_t size) { init(size); }
+
+	void init(size_t size)
+	{
+		n = size;
+		cosT.resize(n / 2);
+		sinT.resize(n / 2);
+		for (size_t k = 0; k < n / 2; k++) {
+			cosT[k] = (float)std::cos(2.0 * M_PI * k / n);
+			sinT[k] = (float)std::sin(2.0 * M_PI * k / n);
+		}
+		bitrev.resize(n);
+		uint32_t bits = 0;
+		while ((size_t(1) << bits) < n)
+			bits++;
+		for (size_t i = 0; i < n; i++) {
+			uint32_t r = 0;
+			for (uint32_t b = 0; b < bits; b++)
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			bitrev[i] = r;
+		}
+	}
+};
+
+inline bool isPowerOfTwo(size_t n)
+{
+	return n != 0 && (n & (n - 1)) == 0;
+}
+
+// swap rows a and b of a [n x batch] array
+inline void fftSwapRows(float* data, size_t a, size_t b, size_t batch)
+{
+	float* ra = data + a * batch;
+	float* rb = data + b * batch;
+	for (size_t i = 0; i < batch; i++) {
+		float t = ra[i];
+		ra[i] = rb[i];
+		rb[i] = t;
+	}
+}
+
+// one butterfly between rows a and b with twiddle (wr, wi)
+inline void fftButterfly(float* re, float* im, size_t a, size_t b, size_t batch, float wr, float wi)
+{
+	float* ar = re + a * batch;
+	float* ai = im + a * batch;
+	float* br = re + b * batch;
+	float* bi = im + b * batch;
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256 vwr = _mm256_set1_ps(wr);
+	__m256 vwi = _mm256_set1_ps(wi);
+	for (; i + 7 < batch; i += 8) {
+		__m256 xr = _mm256_loadu_ps(br + i);
+		__m256 xi = _mm256_loadu_ps(bi + i);
+		__m256 tr = _mm256_sub_ps(_mm256_mul_ps(vwr, xr), _mm256_mul_ps(vwi, xi));
+		__m256 ti = _mm256_add_ps(_mm256_mul_ps(vwr, xi), _mm256_mul_ps(vwi, xr));
+		__m256 ur = _mm256_loadu_ps(ar + i);
+		__m256 ui = _mm256_loadu_ps(ai + i);
+		_mm256_storeu_ps(ar + i, _mm256_add_ps(ur, tr));
+		_mm256_storeu_ps(ai + i, _mm256_add_ps(ui, ti));
+		_mm256_storeu_ps(br + i, _mm256_sub_ps(ur, tr));
+		_mm256_storeu_ps(bi + i, _mm256_sub_ps(ui, ti));
+	}
+#endif
+	for (; i < batch; i++) {
+		float tr = wr * br[i] - wi * bi[i];
+		float ti = wr * bi[i] + wi * br[i];
+		float ur = ar[i];
+		float ui = ai[i];
+		ar[i] = ur + tr;
+		ai[i] = ui + ti;
+		br[i] = ur - tr;
+		bi[i] = ui - ti;
+	}
+}
+
+// In-place transform, forward uses exp(-2*pi*i*k*m/n). Inverse is not scaled.
+inline void fftBatched(const FFTPlan& plan, float* re, float* im, size_t batch, bool inverse = false)
+{
+	const size_t n = plan.n;
+	for (size_t i = 0; i < n; i++) {
+		size_t j = plan.bitrev[i];
+		if (j > i) {
+			fftSwapRows(re, i, j, batch);
+			fftSwapRows(im, i, j, batch);
+		}
+	}
+	const float sign = inverse ? 1.0f : -1.0f;
+	for (size_t len = 2; len <= n; len <<= 1) {
+		size_t half = len / 2;
+		size_t step = n / len;
+		for (size_t start = 0; start < n; start += len) {
+			for (size_t k = 0; k < half; k++) {
+				fftButterfly(re, im, start + k, start + k + half, batch,
+						plan.cosT[k * step], sign * plan.sinT[k * step]);
+			}
+		}
+	}
+}
+
+#endif /* !FFT_H */
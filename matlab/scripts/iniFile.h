@@ -0,0 +1,49 @@
+#ifndef INI_FILE_H
+#define INI_FILE_H
+
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+// Minimal reader of fmcw.conf style INI files for standalone tools
+//
+// [section] headers, key=value lines, ';' and '#' comments. Values are kept
+// as strings, MATLAB side (ini2struct) does the same.
+
+typedef std::map<std::string, std::map<std::string, std::string>> IniFile;
+
+inline IniFile readIni(const std::string& path)
+{
+	IniFile ini;
+	std::ifstream in(path);
+	if (!in)
+		throw std::runtime_error("Failed to open " + path);
+	std::string line, section;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty() || line[0] == ';' || line[0] == '#')
+			continue;
+		if (line[0] == '[') {
+			section = line.substr(1, line.find(']') - 1);
+			continue;
+		}
+		size_t eq = line.find('=');
+		if (eq != std::string::npos)
+			ini[section][line.substr(0, eq)] = line.substr(eq + 1);
+	}
+	return ini;
+}
+
+inline double iniNumber(const IniFile& ini, const std::string& section, const std::string& key, double fallback)
+{
+	auto s = ini.find(section);
+	if (s == ini.end())
+		return fallback;
+	auto k = s->second.find(key);
+	return k == s->second.end() ? fallback : std::atof(k->second.c_str());
+}
+
+#endif /* !INI_FILE_H */
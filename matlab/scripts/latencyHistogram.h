@@ -0,0 +1,147 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+// HDR style latency histogram
+//
+// Values (ns) are counted in log-linear buckets: every power of two range is
+// split to 2^subBits equal sub buckets, so relative error of recorded value is
+// below 2^-subBits (3 %) over the whole range 1 ns - maxMagnitude (~18 min),
+// larger values fall into the last bucket. Recording is a few integer
+// operations and relaxed atomic stores, histogram has single writer (stage
+// thread) and any number of readers, which see slightly torn snapshot at worst.
+// Stage run by several threads (one per radar stream) records with
+// recordShared, which uses atomic read-modify-write instead.
+
+class LatencyHistogram {
+	public:
+		static constexpr int subBits = 5;
+		static constexpr uint64_t subCount = 1u << subBits;
+		static constexpr int maxMagnitude = 40;
+		static constexpr size_t numBuckets = (size_t)(maxMagnitude - subBits + 2) * subCount;
+
+		LatencyHistogram() { reset(); }
+
+		void reset()
+		{
+			for (std::atomic<uint64_t>& c : counts)
+				c.store(0, std::memory_order_relaxed);
+			total.store(0, std::memory_order_relaxed);
+			sumNs.store(0, std::memory_order_relaxed);
+			minNs.store(UINT64_MAX, std::memory_order_relaxed);
+			maxNs.store(0, std::memory_order_relaxed);
+		}
+
+		// single writer
+		void record(uint64_t ns)
+		{
+			std::atomic<uint64_t>& c = counts[bucket(ns)];
+			c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			sumNs.store(sumNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+			if (ns < minNs.load(std::memory_order_relaxed))
+				minNs.store(ns, std::memory_order_relaxed);
+			if (ns > maxNs.load(std::memory_order_relaxed))
+				maxNs.store(ns, std::memory_order_relaxed);
+			total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		// any number of writers
+		void recordShared(uint64_t ns)
+		{
+			counts[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+			sumNs.fetch_add(ns, std::memory_order_relaxed);
+			uint64_t m = minNs.load(std::memory_order_relaxed);
+			while (ns < m && !minNs.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {
+			}
+			m = maxNs.load(std::memory_order_relaxed);
+			while (ns > m && !maxNs.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {
+			}
+			total.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void recordSeconds(double seconds, bool shared = false)
+		{
+			uint64_t ns = seconds > 0 ? (uint64_t)(seconds * 1e9) : 0;
+			if (shared)
+				recordShared(ns);
+			else
+				record(ns);
+		}
+
+		uint64_t count() const { return total.load(std::memory_order_relaxed); }
+		uint64_t max() const { return maxNs.load(std::memory_order_relaxed); }
+
+		uint64_t min() const
+		{
+			uint64_t m = minNs.load(std::memory_order_relaxed);
+			return m == UINT64_MAX ? 0 : m;
+		}
+
+		double mean() const
+		{
+			uint64_t n = count();
+			return n ? (double)sumNs.load(std::memory_order_relaxed) / (double)n : 0.0;
+		}
+
+		// value (ns) below which fraction q of recorded values lies, middle of
+		// the bucket, clamped to observed min and max
+		double percentile(double q) const
+		{
+			uint64_t n = 0;
+			for (const std::atomic<uint64_t>& c : counts)
+				n += c.load(std::memory_order_relaxed);
+			if (n == 0)
+				return 0.0;
+			uint64_t rank = (uint64_t)std::ceil(std::min(std::max(q, 0.0), 1.0) * (double)n);
+			rank = std::max<uint64_t>(rank, 1);
+			uint64_t seen = 0;
+			for (size_t b = 0; b < numBuckets; b++) {
+				seen += counts[b].load(std::memory_order_relaxed);
+				if (seen >= rank) {
+					double mid = 0.5 * (double)(lowerBound(b) + upperBound(b));
+					return std::min(std::max(mid, (double)min()), (double)max());
+				}
+			}
+			return (double)max();
+		}
+
+		static size_t bucket(uint64_t ns)
+		{
+			if (ns < subCount)
+				return (size_t)ns;
+			int magnitude = 63 - __builtin_clzll(ns);
+			if (magnitude > maxMagnitude)
+				return numBuckets - 1;
+			uint64_t sub = (ns >> (magnitude - subBits)) - subCount;
+			return (size_t)(magnitude - subBits + 1) * subCount + (size_t)sub;
+		}
+
+		static uint64_t lowerBound(size_t b)
+		{
+			if (b < subCount)
+				return b;
+			int magnitude = (int)(b / subCount) + subBits - 1;
+			return (subCount + b % subCount) << (magnitude - subBits);
+		}
+
+		static uint64_t upperBound(size_t b)
+		{
+			if (b < subCount)
+				return b;
+			int magnitude = (int)(b / subCount) + subBits - 1;
+			return ((subCount + b % subCount + 1) << (magnitude - subBits)) - 1;
+		}
+
+	private:
+		std::atomic<uint64_t> counts[numBuckets];
+		std::atomic<uint64_t> total;
+		std::atomic<uint64_t> sumNs;
+		std::atomic<uint64_t> minNs;
+		std::atomic<uint64_t> maxNs;
+};
+
+#endif /* !LATENCY_HISTOGRAM_H */
@@ -0,0 +1,80 @@
+#ifndef MEX_UTILS_H
+#define MEX_UTILS_H
+
+#include "mex.h"
+#include <string>
+#include <vector>
+
+// Small helpers shared by mex gateways
+
+// copy n elements from offset of real or complex single/double array into split float buffers
+inline void toSplitFloat(const mxArray* a, float* re, float* im, mwSize n, mwSize offset = 0)
+{
+	if (mxIsSingle(a)) {
+		const float* pr = (const float*)mxGetData(a) + offset;
+		const float* pi = (const float*)mxGetImagData(a);
+		if (pi)
+			pi += offset;
+		for (mwSize i = 0; i < n; i++) {
+			re[i] = pr[i];
+			im[i] = pi ? pi[i] : 0.0f;
+		}
+	} else {
+		const double* pr = mxGetPr(a) + offset;
+		const double* pi = mxGetPi(a);
+		if (pi)
+			pi += offset;
+		for (mwSize i = 0; i < n; i++) {
+			re[i] = (float)pr[i];
+			im[i] = pi ? (float)pi[i] : 0.0f;
+		}
+	}
+}
+
+// first argument of command style gateways, e.g. myMex('init', ...)
+inline std::string getCommand(int nrhs, const mxArray* prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) {
+		mexErrMsgTxt("First input must be a command string.");
+	}
+	char* tmp = mxArrayToString(prhs[0]);
+	std::string command(tmp);
+	mxFree(tmp);
+	return command;
+}
+
+// scalar field of configuration struct, def when field is missing or empty
+inline double getScalarField(const mxArray* s, const char* name, double def)
+{
+	mxArray* f = mxGetField(s, 0, name);
+	if (f == nullptr || mxIsEmpty(f)) {
+		return def;
+	}
+	return mxGetScalar(f);
+}
+
+// string field of configuration struct, def when field is missing
+inline std::string getStringField(const mxArray* s, const char* name, const std::string& def)
+{
+	mxArray* f = mxGetField(s, 0, name);
+	if (f == nullptr || !mxIsChar(f)) {
+		return def;
+	}
+	char* tmp = mxArrayToString(f);
+	std::string value(tmp);
+	mxFree(tmp);
+	return value;
+}
+
+// numeric vector field of configuration struct, empty when field is missing
+inline std::vector<double> getVectorField(const mxArray* s, const char* name)
+{
+	mxArray* f = mxGetField(s, 0, name);
+	if (f == nullptr || !mxIsDouble(f)) {
+		return std::vector<double>();
+	}
+	const double* p = mxGetPr(f);
+	return std::vector<double>(p, p + mxGetNumberOfElements(f));
+}
+
+#endif /* !MEX_UTILS_H */
@@ -0,0 +1,193 @@
+#ifndef NUFFT_H
+#define NUFFT_H
+
+#include "fft.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Non uniform FFT via Kaiser-Bessel gridding (oversampling 2, kernel width 6,
+// which is accurate to roughly single precision).
+//
+// Type 1: y(k) = sum_j x(j) * exp(-1i*k*tau(j)),  k = -N/2 .. N/2-1
+// Type 2: x(j) = sum_k y(k) * exp(+1i*k*tau(j))
+//
+// tau are sample positions in [0, 2*pi]. Data are split complex, laid out
+// [samples x batch] and [N x batch] with the batch dimension (range bins)
+// contiguous, so spreading and the grid FFT run over whole rows at once.
+// Kernel table and deconvolution factors are computed once in init().
+
+inline double besselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	double q = x * x / 4.0;
+	for (int k = 1; k < 64; k++) {
+		term *= q / ((double)k * k);
+		sum += term;
+		if (term < sum * 1e-17)
+			break;
+	}
+	return sum;
+}
+
+// y += a*x over n elements
+inline void nufftAxpy(float* y, const float* x, float a, size_t n)
+{
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256 va = _mm256_set1_ps(a);
+	for (; i + 7 < n; i += 8) {
+		__m256 vy = _mm256_loadu_ps(y + i);
+		vy = _mm256_add_ps(vy, _mm256_mul_ps(va, _mm256_loadu_ps(x + i)));
+		_mm256_storeu_ps(y + i, vy);
+	}
+#endif
+	for (; i < n; i++)
+		y[i] += a * x[i];
+}
+
+class NUFFT {
+	public:
+		static constexpr int kernelWidth = 6;          // kernel support in grid cells
+		static constexpr int oversampling = 2;         // grid size / number of modes
+		static constexpr int tableResolution = 1024;   // kernel table samples per grid cell
+
+		size_t modes = 0;  // N
+		size_t grid = 0;   // oversampled grid size
+		size_t batch = 0;  // number of independent transforms (range bins)
+
+		void init(size_t numModes, size_t numBatch)
+		{
+			modes = numModes;
+			batch = numBatch;
+			grid = oversampling * modes;
+			plan.init(grid);
+			gridRe.assign(grid * batch, 0.0f);
+			gridIm.assign(grid * batch, 0.0f);
+
+			const double w = kernelWidth;
+			const double s = oversampling;
+			beta = M_PI * std::sqrt((w / s) * (w / s) * (s - 0.5) * (s - 0.5) - 0.8);
+			size_t tableSize = (size_t)(tableResolution * w / 2) + 2;
+			kernel.resize(tableSize);
+			double norm = besselI0(beta);
+			for (size_t i = 0; i < tableSize; i++) {
+				double x = (double)i / tableResolution;
+				double r = 2.0 * x / w;
+				kernel[i] = r < 1.0 ? (float)(besselI0(beta * std::sqrt(1.0 - r * r)) / norm) : 0.0f;
+			}
+
+			// continuous Fourier transform of the kernel, trapezoid rule over the table
+			deconv.resize(modes);
+			size_t halfSamples = (size_t)(tableResolution * w / 2);
+			for (size_t c = 0; c < modes; c++) {
+				double k = (double)c - (double)(modes / 2);
+				double acc = 0.5 * kernel[0];
+				for (size_t i = 1; i <= halfSamples; i++) {
+					double x = (double)i / tableResolution;
+					acc += kernel[i] * std::cos(2.0 * M_PI * k * x / grid);
+				}
+				acc -= 0.5 * kernel[halfSamples] * std::cos(2.0 * M_PI * k * w / 2 / grid);
+				deconv[c] = (float)(1.0 / (2.0 * acc / tableResolution));
+			}
+		}
+
+		bool matches(size_t numModes, size_t numBatch) const
+		{
+			return modes == numModes && batch == numBatch;
+		}
+
+		void type1(const float* xRe, const float* xIm, const double* tau, size_t samples, float* yRe, float* yIm)
+		{
+			std::memset(gridRe.data(), 0, gridRe.size() * sizeof(float));
+			std::memset(gridIm.data(), 0, gridIm.size() * sizeof(float));
+
+			for (size_t j = 0; j < samples; j++) {
+				double u = tau[j] * grid / (2.0 * M_PI);
+				long first = (long)std::ceil(u - kernelWidth / 2.0);
+				long last = (long)std::floor(u + kernelWidth / 2.0);
+				for (long m = first; m <= last; m++) {
+					float w = kernelAt(m - u);
+					size_t idx = wrap(m);
+					nufftAxpy(&gridRe[idx * batch], xRe + j * batch, w, batch);
+					nufftAxpy(&gridIm[idx * batch], xIm + j * batch, w, batch);
+				}
+			}
+
+			fftBatched(plan, gridRe.data(), gridIm.data(), batch, false);
+
+			for (size_t c = 0; c < modes; c++) {
+				size_t idx = wrap((long)c - (long)(modes / 2));
+				float d = deconv[c];
+				const float* gr = &gridRe[idx * batch];
+				const float* gi = &gridIm[idx * batch];
+				float* outRe = yRe + c * batch;
+				float* outIm = yIm + c * batch;
+				for (size_t b = 0; b < batch; b++) {
+					outRe[b] = gr[b] * d;
+					outIm[b] = gi[b] * d;
+				}
+			}
+		}
+
+		void type2(const float* yRe, const float* yIm, const double* tau, size_t samples, float* xRe, float* xIm)
+		{
+			std::memset(gridRe.data(), 0, gridRe.size() * sizeof(float));
+			std::memset(gridIm.data(), 0, gridIm.size() * sizeof(float));
+
+			for (size_t c = 0; c < modes; c++) {
+				size_t idx = wrap((long)c - (long)(modes / 2));
+				float d = deconv[c];
+				for (size_t b = 0; b < batch; b++) {
+					gridRe[idx * batch + b] = yRe[c * batch + b] * d;
+					gridIm[idx * batch + b] = yIm[c * batch + b] * d;
+				}
+			}
+
+			fftBatched(plan, gridRe.data(), gridIm.data(), batch, true);
+
+			for (size_t j = 0; j < samples; j++) {
+				float* outRe = xRe + j * batch;
+				float* outIm = xIm + j * batch;
+				std::memset(outRe, 0, batch * sizeof(float));
+				std::memset(outIm, 0, batch * sizeof(float));
+				double u = tau[j] * grid / (2.0 * M_PI);
+				long first = (long)std::ceil(u - kernelWidth / 2.0);
+				long last = (long)std::floor(u + kernelWidth / 2.0);
+				for (long m = first; m <= last; m++) {
+					float w = kernelAt(m - u);
+					size_t idx = wrap(m);
+					nufftAxpy(outRe, &gridRe[idx * batch], w, batch);
+					nufftAxpy(outIm, &gridIm[idx * batch], w, batch);
+				}
+			}
+		}
+
+	private:
+		FFTPlan plan;
+		double beta = 0;
+		std::vector<float> kernel;   // kernel(|x|) sampled with tableResolution
+		std::vector<float> deconv;   // 1/kernel_hat(k) for k = -N/2 .. N/2-1
+		std::vector<float> gridRe;
+		std::vector<float> gridIm;
+
+		float kernelAt(double x) const
+		{
+			double p = std::fabs(x) * tableResolution;
+			size_t i = (size_t)p;
+			if (i + 1 >= kernel.size())
+				return 0.0f;
+			float f = (float)(p - i);
+			return kernel[i] + f * (kernel[i + 1] - kernel[i]);
+		}
+
+		size_t wrap(long m) const
+		{
+			long g = (long)grid;
+			return (size_t)(((m % g) + g) % g);
+		}
+};
+
+#endif /* !NUFFT_H */
@@ -0,0 +1,82 @@
+#include "mex.h"
+#include "mexUtils.h"
+#include "nufft.h"
+#include <vector>
+
+// nufftDoppler(data, timeRelative, timeTotal, N, type)
+//
+// type 1 (default): data is [rangeBins x chirps] slow time samples taken at
+//   timeRelative, output is [rangeBins x N] spectrum at frequencies
+//   (-N/2:N/2-1)/timeTotal, same as nufft(data.', timeRelative, f, 1).'
+// type 2: data is [rangeBins x N] spectrum, output is [rangeBins x chirps]
+//   evaluated at timeRelative (adjoint of type 1)
+//
+// Output is complex single. Plan is kept between calls and rebuilt only when
+// N or number of range bins changes.
+
+static NUFFT plan;
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	// Validate inputs
+	if (nrhs < 4) {
+		mexErrMsgTxt("Four inputs required: data, timeRelative, timeTotal, N");
+	}
+	if (!mxIsSingle(prhs[0]) && !mxIsDouble(prhs[0])) {
+		mexErrMsgTxt("data must be single or double precision.");
+	}
+	if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1])) {
+		mexErrMsgTxt("timeRelative must be real double precision.");
+	}
+	if (mxGetNumberOfElements(prhs[2]) != 1 || mxGetNumberOfElements(prhs[3]) != 1) {
+		mexErrMsgTxt("timeTotal and N must be scalars.");
+	}
+
+	int type = nrhs > 4 ? (int)mxGetScalar(prhs[4]) : 1;
+	if (type != 1 && type != 2) {
+		mexErrMsgTxt("type must be 1 or 2.");
+	}
+
+	mwSize rangeBins = mxGetM(prhs[0]);
+	mwSize columns = mxGetN(prhs[0]);
+	mwSize numTimes = mxGetNumberOfElements(prhs[1]);
+	double timeTotal = mxGetScalar(prhs[2]);
+	mwSize N = (mwSize)mxGetScalar(prhs[3]);
+
+	if (!isPowerOfTwo(N)) {
+		mexErrMsgTxt("N must be a power of two.");
+	}
+	if (timeTotal <= 0) {
+		mexErrMsgTxt("timeTotal must be positive.");
+	}
+	if (type == 1 && columns != numTimes) {
+		mexErrMsgTxt("Number of data columns must match number of timestamps.");
+	}
+	if (type == 2 && columns != N) {
+		mexErrMsgTxt("Number of data columns must match N.");
+	}
+
+	if (!plan.matches(N, rangeBins)) {
+		plan.init(N, rangeBins);
+	}
+
+	const double* timeRelative = mxGetPr(prhs[1]);
+	std::vector<double> tau(numTimes);
+	for (mwSize j = 0; j < numTimes; j++) {
+		tau[j] = 2.0 * M_PI * timeRelative[j] / timeTotal;
+	}
+
+	std::vector<float> inRe(rangeBins * columns);
+	std::vector<float> inIm(rangeBins * columns);
+	toSplitFloat(prhs[0], inRe.data(), inIm.data(), rangeBins * columns);
+
+	mwSize outColumns = type == 1 ? N : numTimes;
+	plhs[0] = mxCreateNumericMatrix(rangeBins, outColumns, mxSINGLE_CLASS, mxCOMPLEX);
+	float* outRe = (float*)mxGetData(plhs[0]);
+	float* outIm = (float*)mxGetImagData(plhs[0]);
+
+	if (type == 1) {
+		plan.type1(inRe.data(), inIm.data(), tau.data(), numTimes, outRe, outIm);
+	} else {
+		plan.type2(inRe.data(), inIm.data(), tau.data(), numTimes, outRe, outIm);
+	}
+}
@@ -0,0 +1,316 @@
+#ifndef PLATFORM_READER_H
+#define PLATFORM_READER_H
+
+#include "poseTimeline.h"
+#include "serialPort.h"
+#include "spscRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Native reader of platform telemetry
+//
+// Thread pulls bytes from serial fd in bulk and splits them into CR/LF
+// terminated lines. Position reports "!P t, yaw, pitch" are parsed in place
+// by scanNumber, offsets are applied and pose is pushed to PoseTimeline.
+// One read usually carries several reports, so pose time is taken from
+// platform clock (t, ms) mapped to MATLAB time base by offset tracking the
+// smallest observed transport delay (newest report of each read), offset may
+// grow by clockDrift per second to follow drift between the two clocks. Yaw
+// trigger (used to zero cubes) is evaluated here as well. Every other line
+// ("!R" replies, ESP-IDF log) goes to message queue which MATLAB drains at
+// its leisure, full queue drops messages and never delays position ingest.
+
+// Parses decimal number (sign, digits, fraction, exponent) starting at p,
+// leading spaces are skipped. Returns pointer after the number, nullptr if
+// there is none.
+inline const char* scanNumber(const char* p, const char* end, double& value)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	double mantissa = 0.0;
+	int digits = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		mantissa = mantissa * 10.0 + (*p - '0');
+		p++;
+		digits++;
+	}
+	int scale = 0;
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			mantissa = mantissa * 10.0 + (*p - '0');
+			scale--;
+			p++;
+			digits++;
+		}
+	}
+	if (digits == 0)
+		return nullptr;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool expNegative = false;
+		if (q < end && (*q == '-' || *q == '+')) {
+			expNegative = *q == '-';
+			q++;
+		}
+		int exponent = 0;
+		int expDigits = 0;
+		while (q < end && *q >= '0' && *q <= '9') {
+			exponent = exponent * 10 + (*q - '0');
+			q++;
+			expDigits++;
+		}
+		if (expDigits > 0) {
+			scale += expNegative ? -exponent : exponent;
+			p = q;
+		}
+	}
+	if (scale != 0)
+		mantissa *= std::pow(10.0, scale);
+	value = negative ? -mantissa : mantissa;
+	return p;
+}
+
+// "!P t, yaw, pitch", line without terminator
+inline bool parsePoseLine(const char* p, const char* end, double& t, double& yaw, double& pitch)
+{
+	if (end - p < 2 || p[0] != '!' || p[1] != 'P')
+		return false;
+	p += 2;
+	double* fields[3] = {&t, &yaw, &pitch};
+	for (int k = 0; k < 3; k++) {
+		p = scanNumber(p, end, *fields[k]);
+		if (!p)
+			return false;
+		while (p < end && *p == ' ')
+			p++;
+		if (k < 2) {
+			if (p >= end || *p != ',')
+				return false;
+			p++;
+		}
+	}
+	return true;
+}
+
+struct MessageSlot {
+	size_t length = 0;
+	char text[240];
+};
+
+struct PlatformStats {
+	std::atomic<uint64_t> bytes{0};
+	std::atomic<uint64_t> lines{0};
+	std::atomic<uint64_t> poses{0};
+	std::atomic<uint64_t> parseErrors{0};      // malformed "!P" or overlong lines
+	std::atomic<uint64_t> droppedMessages{0};  // message queue full
+	std::atomic<uint64_t> triggers{0};         // yaw trigger hits
+};
+
+class PlatformReader {
+	public:
+		static constexpr double clockDrift = 1e-4;
+		static constexpr size_t maxPending = 1024; // reports per read
+
+		PlatformStats stats;
+
+		~PlatformReader() { stop(); }
+
+		bool isRunning() const
+		{
+			return running.load(std::memory_order_acquire);
+		}
+
+		// timeNow is current time in MATLAB time base (toc(startTime))
+		void start(const std::string& port, int baudrate, PoseTimeline* timeline, double timeNow)
+		{
+			stop();
+			fd = openSerial(port, baudrate, 0, 1);
+			poses = timeline;
+			timeBase = timeNow - monotonicSeconds();
+			messages.init(256);
+			for (std::atomic<uint64_t>* c : {&stats.bytes, &stats.lines, &stats.poses,
+					&stats.parseErrors, &stats.droppedMessages, &stats.triggers})
+				c->store(0, std::memory_order_relaxed);
+			lastTrigger = -1e9;
+			clockOffset = 0;
+			lastPlatformTime = -1;
+			running.store(true, std::memory_order_release);
+			thread = std::thread(&PlatformReader::readLoop, this);
+		}
+
+		void stop()
+		{
+			running.store(false, std::memory_order_release);
+			if (thread.joinable())
+				thread.join();
+			if (fd >= 0)
+				::close(fd);
+			fd = -1;
+		}
+
+		// trigger fires when mod(yaw - triggerYaw, 360) <= 2*tolerance, at most
+		// once per second, triggerYaw < 0 disables it
+		void setSettings(double yawOffset, double pitchOffset, double yawTrigger, double tolerance)
+		{
+			offsetYaw.store(yawOffset, std::memory_order_relaxed);
+			offsetPitch.store(pitchOffset, std::memory_order_relaxed);
+			triggerYaw.store(yawTrigger, std::memory_order_relaxed);
+			triggerTolerance.store(tolerance, std::memory_order_relaxed);
+		}
+
+		// command line, CR terminator is appended
+		bool writeLine(const std::string& line)
+		{
+			if (fd < 0)
+				return false;
+			std::string out = line + "\r";
+			return writeAll(fd, out.data(), out.size());
+		}
+
+		// consumer side of message queue, single consumer
+		void popMessages(std::vector<std::string>& out)
+		{
+			out.clear();
+			while (MessageSlot* m = messages.peek()) {
+				out.emplace_back(m->text, m->length);
+				messages.release();
+			}
+		}
+
+	private:
+		int fd = -1;
+		std::thread thread;
+		std::atomic<bool> running{false};
+		PoseTimeline* poses = nullptr;
+		double timeBase = 0;
+		double lastTrigger = 0;
+		double clockOffset = 0;       // MATLAB time - platform time (s)
+		double lastPlatformTime = -1; // s, negative before first report
+		SPSCRing<MessageSlot> messages;
+		std::vector<double> pendingTime;  // platform time (s) of reports of current read
+		std::vector<double> pendingYaw;
+		std::vector<double> pendingPitch;
+		size_t pending = 0;
+		std::atomic<double> offsetYaw{0};
+		std::atomic<double> offsetPitch{0};
+		std::atomic<double> triggerYaw{-1};
+		std::atomic<double> triggerTolerance{2};
+
+		void readLoop()
+		{
+			std::vector<char> buffer(1 << 14);
+			size_t fill = 0;
+			pendingTime.resize(maxPending);
+			pendingYaw.resize(maxPending);
+			pendingPitch.resize(maxPending);
+			pending = 0;
+			while (running.load(std::memory_order_acquire)) {
+				ssize_t n = ::read(fd, buffer.data() + fill, buffer.size() - fill);
+				if (n <= 0)
+					continue; // VTIME expired or interrupted
+				double now = monotonicSeconds() + timeBase;
+				stats.bytes.fetch_add((uint64_t)n, std::memory_order_relaxed);
+				fill += (size_t)n;
+
+				size_t start = 0;
+				for (size_t i = 0; i < fill; i++) {
+					if (buffer[i] != '\r' && buffer[i] != '\n')
+						continue;
+					if (i > start)
+						processLine(buffer.data() + start, buffer.data() + i, now);
+					start = i + 1;
+				}
+				flushPoses(now);
+				if (start == 0 && fill == buffer.size()) {
+					// no terminator in whole buffer, garbage
+					stats.parseErrors.fetch_add(1, std::memory_order_relaxed);
+					fill = 0;
+				} else if (start > 0) {
+					std::memmove(buffer.data(), buffer.data() + start, fill - start);
+					fill -= start;
+				}
+			}
+		}
+
+		void processLine(const char* p, const char* end, double now)
+		{
+			stats.lines.fetch_add(1, std::memory_order_relaxed);
+			double t, yaw, pitch;
+			if (end - p >= 2 && p[0] == '!' && p[1] == 'P') {
+				if (!parsePoseLine(p, end, t, yaw, pitch)) {
+					stats.parseErrors.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				if (pending == maxPending)
+					flushPoses(now);
+				pendingTime[pending] = t * 1e-3;
+				pendingYaw[pending] = PoseTimeline::wrapYaw(yaw - offsetYaw.load(std::memory_order_relaxed));
+				pendingPitch[pending] = pitch - offsetPitch.load(std::memory_order_relaxed);
+				pending++;
+				return;
+			}
+
+			MessageSlot* m = messages.claim();
+			if (!m) {
+				stats.droppedMessages.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			m->length = std::min((size_t)(end - p), sizeof(m->text));
+			std::memcpy(m->text, p, m->length);
+			messages.publish();
+		}
+
+		// maps reports of one read to MATLAB time base and pushes them, arrival
+		// is never earlier than newest report
+		void flushPoses(double arrival)
+		{
+			if (pending == 0)
+				return;
+			double newest = pendingTime[pending - 1];
+			double delay = arrival - newest;
+			if (lastPlatformTime < 0 || pendingTime[0] < lastPlatformTime) {
+				clockOffset = delay; // first report or platform restarted
+			} else {
+				clockOffset += clockDrift * (newest - lastPlatformTime);
+				if (delay < clockOffset)
+					clockOffset = delay;
+			}
+			lastPlatformTime = newest;
+
+			for (size_t k = 0; k < pending; k++) {
+				double time = pendingTime[k] + clockOffset;
+				if (poses)
+					poses->push(time, pendingYaw[k], pendingPitch[k]);
+				checkTrigger(pendingYaw[k], time);
+			}
+			stats.poses.fetch_add(pending, std::memory_order_relaxed);
+			pending = 0;
+		}
+
+		void checkTrigger(double yaw, double now)
+		{
+			double trigger = triggerYaw.load(std::memory_order_relaxed);
+			if (trigger < 0)
+				return;
+			double tolerance = triggerTolerance.load(std::memory_order_relaxed);
+			if (PoseTimeline::wrapYaw(yaw - trigger) <= 2 * tolerance && now - lastTrigger > 1.0) {
+				lastTrigger = now;
+				stats.triggers.fetch_add(1, std::memory_order_release);
+			}
+		}
+};
+
+#endif /* !PLATFORM_READER_H */
@@ -0,0 +1,242 @@
+#ifndef POSE_TIMELINE_H
+#define POSE_TIMELINE_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Time indexed platform pose history
+//
+// Ring of (time, yaw, pitch) samples with strictly increasing timestamps, so
+// any time is located by binary search in O(log n). Yaw is stored unwrapped
+// (consecutive samples never differ by more than 180 deg), interpolation is
+// done on the unwrapped value and wrapped back to [0, 360), so crossing 0 deg
+// during rotation doesn't produce a sweep through the whole circle.
+//
+// Interpolation modes: nearest sample, linear, cubic (Catmull-Rom over four
+// neighbouring samples). Times outside of the history are clamped to the
+// first/last pose, nothing is extrapolated.
+//
+// One writer may push while other threads query. Writer publishes sample
+// count with release, readers only search samples that are at least
+// readerGuard slots away from being overwritten.
+
+enum PoseInterpolation {
+	POSE_NEAREST = 0,
+	POSE_LINEAR = 1,
+	POSE_CUBIC = 2
+};
+
+class PoseTimeline {
+	public:
+		static constexpr size_t readerGuard = 16;
+
+		void init(size_t capacity)
+		{
+			size_t n = 1;
+			while (n < capacity + readerGuard)
+				n <<= 1;
+			mask = n - 1;
+			times.assign(n, 0.0);
+			yaws.assign(n, 0.0);
+			pitches.assign(n, 0.0);
+			written.store(0, std::memory_order_release);
+		}
+
+		size_t capacity() const
+		{
+			return times.empty() ? 0 : times.size() - readerGuard;
+		}
+
+		size_t size() const
+		{
+			uint64_t first, end;
+			window(first, end);
+			return (size_t)(end - first);
+		}
+
+		// writer side, samples with time not newer than the last one are ignored
+		bool push(double time, double yaw, double pitch)
+		{
+			uint64_t n = written.load(std::memory_order_relaxed);
+			if (times.empty())
+				return false;
+			if (n > 0) {
+				size_t last = (size_t)((n - 1) & mask);
+				if (time <= times[last])
+					return false;
+				double delta = std::fmod(yaw - std::fmod(yaws[last], 360.0) + 540.0, 360.0) - 180.0;
+				yaw = yaws[last] + delta;
+			}
+			size_t slot = (size_t)(n & mask);
+			times[slot] = time;
+			yaws[slot] = yaw;
+			pitches[slot] = pitch;
+			written.store(n + 1, std::memory_order_release);
+			return true;
+		}
+
+		void clear()
+		{
+			written.store(0, std::memory_order_release);
+		}
+
+		// time of the newest sample, false if history is empty
+		bool newest(double& time) const
+		{
+			uint64_t end = written.load(std::memory_order_acquire);
+			if (end == 0)
+				return false;
+			time = timeAt(end - 1);
+			return true;
+		}
+
+		// pose at time t, false if history is empty
+		bool at(double t, double& yaw, double& pitch, int mode = POSE_LINEAR) const
+		{
+			uint64_t first, end;
+			window(first, end);
+			if (first == end)
+				return false;
+			uint64_t hint = first;
+			evaluate(t, first, end, hint, mode, yaw, pitch);
+			return true;
+		}
+
+		// pose at every time of times[n], sorted times are resolved by walking from
+		// previous position instead of full search
+		bool atMany(const double* t, size_t n, double* yaw, double* pitch, int mode = POSE_LINEAR) const
+		{
+			uint64_t first, end;
+			window(first, end);
+			if (first == end)
+				return false;
+			uint64_t hint = first;
+			for (size_t k = 0; k < n; k++)
+				evaluate(t[k], first, end, hint, mode, yaw[k], pitch[k]);
+			return true;
+		}
+
+		// samples with timeMin <= time <= timeMax in chronological order
+		size_t interval(double timeMin, double timeMax, std::vector<double>& outTimes,
+				std::vector<double>& outYaw, std::vector<double>& outPitch) const
+		{
+			outTimes.clear();
+			outYaw.clear();
+			outPitch.clear();
+			uint64_t first, end;
+			window(first, end);
+			if (first == end)
+				return 0;
+			uint64_t lo = lowerBound(timeMin, first, end);
+			for (uint64_t i = lo; i < end && timeAt(i) <= timeMax; i++) {
+				outTimes.push_back(timeAt(i));
+				outYaw.push_back(wrapYaw(yaws[i & mask]));
+				outPitch.push_back(pitches[i & mask]);
+			}
+			return outTimes.size();
+		}
+
+		static double wrapYaw(double yaw)
+		{
+			double w = std::fmod(yaw, 360.0);
+			return w < 0 ? w + 360.0 : w;
+		}
+
+	private:
+		std::vector<double> times;
+		std::vector<double> yaws;    // unwrapped
+		std::vector<double> pitches;
+		size_t mask = 0;
+		std::atomic<uint64_t> written{0};
+
+		void window(uint64_t& first, uint64_t& end) const
+		{
+			end = written.load(std::memory_order_acquire);
+			uint64_t usable = times.empty() ? 0 : times.size() - readerGuard;
+			first = end > usable ? end - usable : 0;
+		}
+
+		double timeAt(uint64_t i) const
+		{
+			return times[(size_t)(i & mask)];
+		}
+
+		// first index in [first, end) with time >= t
+		uint64_t lowerBound(double t, uint64_t first, uint64_t end) const
+		{
+			while (first < end) {
+				uint64_t mid = first + (end - first) / 2;
+				if (timeAt(mid) < t)
+					first = mid + 1;
+				else
+					end = mid;
+			}
+			return first;
+		}
+
+		// index i of sample with times[i] <= t < times[i+1], hint is moved along
+		uint64_t locate(double t, uint64_t first, uint64_t end, uint64_t& hint) const
+		{
+			if (hint < first || hint >= end || timeAt(hint) > t) {
+				hint = lowerBound(t, first, end);
+				hint = hint > first ? hint - 1 : first;
+			}
+			// short walk for sorted queries, fall back to search for long jumps
+			for (int step = 0; step < 8 && hint + 1 < end && timeAt(hint + 1) <= t; step++)
+				hint++;
+			if (hint + 1 < end && timeAt(hint + 1) <= t) {
+				hint = lowerBound(t, hint, end);
+				if (hint == end || timeAt(hint) > t)
+					hint--;
+			}
+			return hint;
+		}
+
+		void evaluate(double t, uint64_t first, uint64_t end, uint64_t& hint, int mode,
+				double& yaw, double& pitch) const
+		{
+			if (t <= timeAt(first)) {
+				yaw = wrapYaw(yaws[first & mask]);
+				pitch = pitches[first & mask];
+				return;
+			}
+			if (t >= timeAt(end - 1)) {
+				yaw = wrapYaw(yaws[(end - 1) & mask]);
+				pitch = pitches[(end - 1) & mask];
+				return;
+			}
+
+			uint64_t i = locate(t, first, end, hint);
+			size_t a = (size_t)(i & mask);
+			size_t b = (size_t)((i + 1) & mask);
+			double u = (t - times[a]) / (times[b] - times[a]);
+
+			if (mode == POSE_NEAREST) {
+				size_t s = u < 0.5 ? a : b;
+				yaw = wrapYaw(yaws[s]);
+				pitch = pitches[s];
+			} else if (mode == POSE_CUBIC) {
+				// Catmull-Rom, missing neighbours at the ends are repeated
+				size_t p0 = (size_t)((i > first ? i - 1 : i) & mask);
+				size_t p3 = (size_t)((i + 2 < end ? i + 2 : i + 1) & mask);
+				yaw = wrapYaw(catmullRom(yaws[p0], yaws[a], yaws[b], yaws[p3], u));
+				pitch = catmullRom(pitches[p0], pitches[a], pitches[b], pitches[p3], u);
+			} else {
+				yaw = wrapYaw(yaws[a] + u * (yaws[b] - yaws[a]));
+				pitch = pitches[a] + u * (pitches[b] - pitches[a]);
+			}
+		}
+
+		static double catmullRom(double p0, double p1, double p2, double p3, double u)
+		{
+			double u2 = u * u;
+			double u3 = u2 * u;
+			return 0.5 * (2.0 * p1 + (p2 - p0) * u + (2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * u2
+					+ (3.0 * p1 - p0 - 3.0 * p2 + p3) * u3);
+		}
+};
+
+#endif /* !POSE_TIMELINE_H */
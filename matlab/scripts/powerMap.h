@@ -0,0 +1,47 @@
+#ifndef POWER_MAP_H
+#define POWER_MAP_H
+
+#include <cmath>
+#include <cstddef>
+
+// Fused magnitude, range compensation and power kernel
+//
+// Turns complex Doppler output [inRows x cols] (split complex, column major)
+// into single precision power map [rows x cols]:
+//   out(r, c) = |x(r, src(c))|^2 * rangeCompensation(r)
+// where rows <= inRows (range bins above rows are dropped), src(c) optionally
+// applies fftshift and logCompress replaces value v by 10*log10(1 + v).
+// No intermediate arrays are created.
+
+template <typename T>
+inline void rangeDopplerPower(const T* re, const T* im, size_t inRows, size_t rows, size_t cols,
+		const float* rangeCompensation, bool shift, bool logCompress, float* out)
+{
+	for (size_t c = 0; c < cols; c++) {
+		size_t src = shift ? (c + cols / 2) % cols : c;
+		const T* colRe = re + src * inRows;
+		const T* colIm = im ? im + src * inRows : nullptr;
+		float* dst = out + c * rows;
+
+		if (colIm) {
+			for (size_t r = 0; r < rows; r++) {
+				float xr = (float)colRe[r];
+				float xi = (float)colIm[r];
+				dst[r] = (xr * xr + xi * xi) * rangeCompensation[r];
+			}
+		} else {
+			for (size_t r = 0; r < rows; r++) {
+				float xr = (float)colRe[r];
+				dst[r] = xr * xr * rangeCompensation[r];
+			}
+		}
+
+		if (logCompress) {
+			for (size_t r = 0; r < rows; r++) {
+				dst[r] = 10.0f * std::log10(1.0f + dst[r]);
+			}
+		}
+	}
+}
+
+#endif /* !POWER_MAP_H */
@@ -0,0 +1,1340 @@
+#include "mex.h"
+#include "changeDetector.h"
+#include "cubeResample.h"
+#include "detectionStream.h"
+#include "mexUtils.h"
+#include "platformReader.h"
+#include "radarPipeline.h"
+#include "radarReader.h"
+#include "rawCapture.h"
+#include "sectorQuery.h"
+#include "shmExport.h"
+#include "triggerScheduler.h"
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+// Native streaming pipeline, see radarPipeline.h
+//
+// radarPipeline('start', config)
+//   config ... struct with processing parameters (fields of
+//              preferences.getProcessingParamters) and cube geometry, see
+//              nativePipeline.m for the full list
+// radarPipeline('stop')
+// accepted = radarPipeline('push', I, Q, time[, yaw, pitch])
+//   I, Q ... samples of one chirp, accepted is false if ingest ring was full
+//   without yaw and pitch pose is interpolated from pose timeline
+// accepted = radarPipeline('pushStream', stream, I, Q, time[, yaw, pitch])
+//   chirp of radar stream 1..config.streams, yaw and pitch are platform pose,
+//   mounting offset (config.mountYaw, config.mountPitch) of stream is added
+// status = radarPipeline('poll')
+//   status ... struct(generation, lastYaw, lastPitch, dirtyTiles, dirtyRange),
+//              generation counts finished cube updates, dirtyTiles is logical
+//              [tilesYaw x tilesPitch] of config.dirtyTileSize cells rewritten
+//              since last poll, dirtyRange [first last] range bins (one based)
+//              which may have changed in them, empty if none
+// stats = radarPipeline('stats')
+//   stats ... struct with processed and dropped frame counters of all stages,
+//             frames shed under backpressure (coalesced, skippedDoppler,
+//             skippedRaw), chirps outside ROI (outsideRoi), current shedLevel
+//             (0-3) and utilization of Doppler, CFAR and cube stage, counters
+//             are totals over all radar streams
+// radarPipeline('zero')
+//   zero cubes before next cube update
+// metrics = radarPipeline('metrics')
+//   metrics ... struct with latency of every stage (ingest, rangeFFT, doppler,
+//               cfar, cubeUpdate, handoff), each struct(count, min, mean, p50,
+//               p90, p99, p999, max) in seconds, and counters framesIn,
+//               dropped, coalesced
+// radarPipeline('metricsEnable', enable)
+// radarPipeline('metricsReset')
+// radarPipeline('metricsDump', path)
+//   appends one CSV row per stage and counter to path, latencies in us
+// running = radarPipeline('running')
+//
+// Pose timeline (poseTimeline.h), available without running pipeline:
+// radarPipeline('poseInit', capacity)
+// radarPipeline('posePush', times, yaw, pitch)
+//   out of order samples are ignored
+// [yaw, pitch] = radarPipeline('poseAt', times[, mode])
+//   mode ... 0 nearest, 1 linear (default), 2 cubic
+//   zeros are returned while timeline is empty (platform at home position)
+// [times, yaw, pitch] = radarPipeline('poseInterval', timeMin, timeMax)
+//
+// Platform reader (platformReader.h), feeds pose timeline from serial port:
+// radarPipeline('platformOpen', port, baudrate, timeNow, settings)
+//   timeNow ... current time in MATLAB time base (toc(startTime))
+//   settings ... struct(offsetYaw, offsetPitch, triggerYaw, triggerTolerance)
+// radarPipeline('platformSettings', settings)
+// radarPipeline('platformWrite', line)
+//   line is terminated by CR
+// status = radarPipeline('platformPoll')
+//   status ... struct(messages, triggers, poses, parseErrors, droppedMessages),
+//              messages is cell of lines other than "!P" received since last
+//              poll, triggers counts yaw trigger hits since open
+// radarPipeline('platformClose')
+// open = radarPipeline('platformRunning')
+//
+// Radar reader (radarReader.h), raw ADC frames from serial port:
+// radarPipeline('radarOpen', port, baudrate, samples, timeNow)
+// radarPipeline('radarWrite', line)
+//   line is terminated by CR/LF
+// [I, Q, times] = radarPipeline('radarPoll')
+//   I, Q ... [samples x n] frames received since last poll
+//   times ... [1 x n] arrival of last byte of each frame in MATLAB time base
+// stats = radarPipeline('radarStats')
+// radarPipeline('radarClose')
+//   closes raw capture as well
+//
+// Raw I/Q capture (rawCapture.h), frames of radar reader to segment files:
+// prefix = radarPipeline('captureOpen', dir, config)
+//   config ... struct(samples, segmentRecords, maxSegments, queueSize,
+//              poseWait, poseInterpolation, bandwidth, frontend,
+//              chirpPeriod), samples default to those of radar reader
+//   prefix ... segment n is written to <prefix>_<n>.iq
+// stats = radarPipeline('captureStats')
+//   stats ... struct(open, offered, written, droppedQueue, droppedDisk,
+//              withoutPose, segments, bytes, truncateFailed, pending)
+// radarPipeline('captureClose')
+//   radarOpen with different samples closes capture too
+//
+// Trigger scheduler (triggerScheduler.h), writes "!N" through radar reader:
+// radarPipeline('triggerStart', config, timeNow)
+//   config ... struct(period, angleStep, pollPeriod, minInterval, startDelay,
+//              poseInterpolation), angleStep > 0 selects angle locked mode
+// stats = radarPipeline('triggerStats')
+//   stats ... struct(triggers, failed, missed, skippedCells, jitterMean,
+//              jitterStd, jitterMax), jitter is in seconds
+// radarPipeline('triggerStop')
+//
+// Event tracing (traceRecorder.h), available without running pipeline:
+// radarPipeline('traceEnable', enable[, capacity])
+//   capacity ... records per thread ring (default 65536)
+// radarPipeline('trace', name, phase[, id])
+//   event of MATLAB thread, phase is 'B' (begin), 'E' (end), 'i' (instant) or
+//   'b', 'e' for async span (begin and end matched by id)
+// count = radarPipeline('traceExport', path)
+//   writes Chrome Trace Event JSON, count is number of events
+// radarPipeline('traceClear')
+//
+// Shared memory export (shmExport.h), available without running pipeline:
+// radarPipeline('shmOpen', name, config)
+//   name ... POSIX shared memory name, e.g. '/fmcwRadar'
+//   config ... struct(rawCubeSize, calcRaw, calcCFAR, rawCubePath,
+//              cfarCubePath, rangeBinWidth, rangeBinMin, yawBinMin,
+//              pitchBinMin, detectionThreshold, maxDetections, slots)
+// radarPipeline('shmPublish', lastYaw, lastPitch)
+//   wakes export thread, returns immediately
+// stats = radarPipeline('shmStats')
+//   stats ... struct(requests, published, truncated)
+// radarPipeline('shmClose')
+//
+// Detection stream server (detectionStream.h), available without running
+// pipeline:
+// radarPipeline('streamOpen', socketPath)
+// radarPipeline('streamPublish', time, detections, tracks)
+//   detections ... [n x 4] range (m), yaw, pitch (deg), CFAR value
+//   tracks ... [m x 10] targetTracker output, may be empty
+// stats = radarPipeline('streamStats')
+//   stats ... struct(clients, published, frames, droppedFrames, droppedUpdates)
+// radarPipeline('streamClose')
+//
+// Cube resampling (cubeResample.h), keeps accumulated scene when range bins
+// change, pipeline and shared memory export must not map cube files:
+// radarPipeline('cubeResample', path, oldBins, columns, newBins, scale, offset, peak)
+//   range columns of cube file are resampled in parallel, new bin r takes
+//   old bin position r*scale + offset, peak selects maximum of covered bins
+//   (CFAR) instead of linear interpolation
+//
+// Sector queries (sectorQuery.h), available without running pipeline, index
+// is updated by the pipeline while it writes the indexed cube:
+// radarPipeline('sectorOpen', config)
+//   config ... struct(rawCubeSize, raw, cubePath, rangeBinWidth, rangeBinMin,
+//              yawBinMin, pitchBinMin, tileSize, deferRebuild), raw selects
+//              raw cube summed over Doppler (default), otherwise CFAR cube of
+//              cubePath, deferRebuild leaves reading the cube to the first
+//              update (cube being written by MATLAB batch)
+// radarPipeline('sectorUpdate', decay, yawIdx, pitchIdx[, patternYaw, patternPitch])
+//   batch written to the cube by MATLAB, whole cube scaled by decay and cells
+//   yawIdx, pitchIdx (1-based) rewritten with spread pattern around them
+// result = radarPipeline('sectorQuery', sectors)
+//   sectors ... [n x 6] yawMin, yawMax, pitchMin, pitchMax (deg), rangeMin,
+//               rangeMax (m), yaw arc may cross 0 deg, rangeMax 0 = up to the
+//               last bin
+//   result ... [n x 3] sum, maximum (NaN for empty sector) and cells
+// radarPipeline('sectorReset')
+//   cube was zeroed
+// stats = radarPipeline('sectorStats')
+//   stats ... struct(updates, tiles, rebuilds, queries)
+// radarPipeline('sectorClose')
+//
+// Change detection (changeDetector.h), available without running pipeline,
+// running pipeline with the same cube geometry feeds it:
+// radarPipeline('changeOpen', config)
+//   config ... struct(rawCubeSize, rangeBinWidth, rangeBinMin, yawBinMin,
+//              pitchBinMin, alpha, visitGap, training, guard, pfa, maxRecords)
+// radarPipeline('changeUpdate', times, yawIdx, pitchIdx, profiles)
+//   frames written to the cube by MATLAB, profiles [range x n] power range
+//   profiles of cells yawIdx, pitchIdx (1-based)
+// changes = radarPipeline('changePoll')
+//   changes ... [n x 6] time, range (m), yaw, pitch (deg), value and reference
+//               of range bins changed since last poll
+// radarPipeline('changeReset')
+//   references are learned again
+// stats = radarPipeline('changeStats')
+//   stats ... struct(frames, seeded, visits, changes, dropped)
+// radarPipeline('changeClose')
+//
+// Threads outlive the call, mex is locked while pipeline or platform reader
+// runs and threads are stopped when mex is cleared or MATLAB exits.
+
+static SectorIndex sectorIndex; // before pipeline, which updates it until it stops
+static ChangeDetector changeDetector;
+static RadarPipeline pipeline;
+static PoseTimeline poses;
+static PlatformReader platform;
+static RadarReader radarReader;
+static TriggerScheduler trigger;
+static RawCapture capture;
+static ShmExport shm;
+static DetectionStream detectionStream;
+static std::vector<float> chirpI;
+static std::vector<float> chirpQ;
+static std::vector<float> scratch; // imaginary part of real I/Q inputs
+static std::vector<std::string> platformMessages;
+static bool locked = false;
+
+static void stopAll()
+{
+	trigger.stop();
+	radarReader.setCapture(nullptr);
+	capture.close();
+	shm.close();
+	detectionStream.close();
+	radarReader.stop();
+	platform.stop();
+	pipeline.stop();
+	pipeline.setSectorIndex(nullptr);
+	pipeline.setChangeDetector(nullptr);
+	sectorIndex.close();
+	changeDetector.close();
+}
+
+// keeps mex locked while any native thread runs
+static void updateLock()
+{
+	bool running = pipeline.isRunning() || platform.isRunning() || radarReader.isRunning() ||
+		trigger.isRunning() || capture.isOpen() || shm.isOpen() || detectionStream.isOpen();
+	if (running && !locked) {
+		mexAtExit(stopAll);
+		mexLock();
+		locked = true;
+	} else if (!running && locked) {
+		mexUnlock();
+		locked = false;
+	}
+}
+
+static void ensurePoseTimeline()
+{
+	if (poses.capacity() == 0) {
+		poses.init(4096);
+	}
+}
+
+static PipelineConfig parseConfig(const mxArray* s)
+{
+	if (!mxIsStruct(s)) {
+		mexErrMsgTxt("config must be a struct.");
+	}
+	PipelineConfig cfg;
+	cfg.samples = (size_t)getScalarField(s, "samples", (double)cfg.samples);
+	cfg.rangeNFFT = (size_t)getScalarField(s, "rangeNFFT", (double)cfg.rangeNFFT);
+	cfg.speedNFFT = (size_t)getScalarField(s, "speedNFFT", (double)cfg.speedNFFT);
+	cfg.rangeBinWidth = getScalarField(s, "rangeBinWidth", cfg.rangeBinWidth);
+	cfg.calcSpeed = getScalarField(s, "calcSpeed", cfg.calcSpeed) != 0;
+	cfg.calcRaw = getScalarField(s, "calcRaw", cfg.calcRaw) != 0;
+	cfg.calcCFAR = getScalarField(s, "calcCFAR", cfg.calcCFAR) != 0;
+	cfg.requirePosChange = getScalarField(s, "requirePosChange", cfg.requirePosChange) != 0;
+	cfg.logCompress = getScalarField(s, "logCompress", cfg.logCompress) != 0;
+	cfg.decay = getScalarField(s, "decay", cfg.decay) != 0;
+	cfg.clutterEnable = getScalarField(s, "clutterEnable", cfg.clutterEnable) != 0;
+	cfg.clutterAlpha = (float)getScalarField(s, "clutterAlpha", cfg.clutterAlpha);
+	cfg.cfarTraining = (size_t)getScalarField(s, "cfarTraining", (double)cfg.cfarTraining);
+	cfg.cfarGuard = (size_t)getScalarField(s, "cfarGuard", (double)cfg.cfarGuard);
+	cfg.cfarPfa = getScalarField(s, "cfarPfa", cfg.cfarPfa);
+	cfg.batchSize = (size_t)getScalarField(s, "batchSize", (double)cfg.batchSize);
+	cfg.ringSize = (size_t)getScalarField(s, "ringSize", (double)cfg.ringSize);
+	cfg.shedding = getScalarField(s, "shedding", cfg.shedding) != 0;
+	cfg.shedHighWater = getScalarField(s, "shedHighWater", cfg.shedHighWater);
+	cfg.shedLowWater = getScalarField(s, "shedLowWater", cfg.shedLowWater);
+	cfg.yawBinMin = (int)getScalarField(s, "yawBinMin", cfg.yawBinMin);
+	cfg.yawBinMax = (int)getScalarField(s, "yawBinMax", cfg.yawBinMax);
+	cfg.pitchBinMin = (int)getScalarField(s, "pitchBinMin", cfg.pitchBinMin);
+	cfg.pitchBinMax = (int)getScalarField(s, "pitchBinMax", cfg.pitchBinMax);
+	cfg.rangeBinMin = (size_t)getScalarField(s, "rangeBinMin", (double)cfg.rangeBinMin);
+	cfg.rangeBinCount = (size_t)getScalarField(s, "rangeBins", (double)cfg.rangeBinCount);
+	cfg.roiGating = getScalarField(s, "roiEnable", cfg.roiGating) != 0;
+	cfg.dirtyTileSize = (size_t)getScalarField(s, "dirtyTileSize", (double)cfg.dirtyTileSize);
+	cfg.rawCubePath = getStringField(s, "rawCubePath", "rawCube.dat");
+	cfg.cfarCubePath = getStringField(s, "cfarCubePath", "cfarCube.dat");
+	cfg.clutterCubePath = getStringField(s, "clutterCubePath", "clutterCube.dat");
+	cfg.poseInterpolation = (int)getScalarField(s, "poseInterpolation", cfg.poseInterpolation);
+	cfg.metrics = getScalarField(s, "metrics", cfg.metrics) != 0;
+	cfg.streams = (size_t)getScalarField(s, "streams", (double)cfg.streams);
+	cfg.mountYaw = getVectorField(s, "mountYaw");
+	cfg.mountPitch = getVectorField(s, "mountPitch");
+
+	mxArray* pattern = mxGetField(s, 0, "spreadPattern");
+	if (pattern != nullptr && !mxIsEmpty(pattern)) {
+		if (!mxIsSingle(pattern)) {
+			mexErrMsgTxt("spreadPattern must be single precision.");
+		}
+		cfg.patternYaw = mxGetM(pattern);
+		cfg.patternPitch = mxGetN(pattern);
+		const float* p = (const float*)mxGetData(pattern);
+		cfg.spreadPattern.assign(p, p + cfg.patternYaw * cfg.patternPitch);
+	}
+
+	mxArray* affinity = mxGetField(s, 0, "affinity");
+	if (affinity != nullptr && !mxIsEmpty(affinity)) {
+		mwSize n = mxGetNumberOfElements(affinity);
+		for (mwSize k = 0; k < 4; k++) {
+			// single value is first core, stages take consecutive ones
+			double v = n == 1 ? (mxGetScalar(affinity) < 0 ? -1 : mxGetScalar(affinity) + k) :
+				(k < n ? mxGetPr(affinity)[k] : -1);
+			cfg.affinity[k] = (int)v;
+		}
+	}
+	return cfg;
+}
+
+static mxArray* createStats()
+{
+	const char* fields[] = {"pushed", "droppedIngest", "rangeProcessed", "droppedRange",
+		"dopplerProcessed", "skippedStatic", "droppedDoppler", "cfarProcessed", "droppedCfar",
+		"cubeFrames", "coalesced", "skippedDoppler", "skippedRaw", "outsideRoi", "shedRaises", "shedDrops",
+		"dropped", "ringOccupancy", "shedLevel", "utilization"};
+	const int numFields = sizeof(fields) / sizeof(fields[0]);
+	mxArray* out = mxCreateStructMatrix(1, 1, numFields, fields);
+	const PipelineStats& s = pipeline.stats;
+	uint64_t values[] = {s.pushed, s.droppedIngest, s.rangeProcessed, s.droppedRange,
+		s.dopplerProcessed, s.skippedStatic, s.droppedDoppler, s.cfarProcessed, s.droppedCfar,
+		s.cubeFrames, s.coalesced, s.skippedDoppler, s.skippedRaw, s.outsideRoi, pipeline.shedding.raises,
+		pipeline.shedding.drops};
+	const int numCounters = sizeof(values) / sizeof(values[0]);
+	for (int k = 0; k < numCounters; k++) {
+		mxSetField(out, 0, fields[k], mxCreateDoubleScalar((double)values[k]));
+	}
+	uint64_t dropped = s.droppedIngest + s.droppedRange + s.droppedDoppler + s.droppedCfar;
+	mxSetField(out, 0, "dropped", mxCreateDoubleScalar((double)dropped));
+
+	mxArray* occupancy = mxCreateDoubleMatrix(1, 4, mxREAL);
+	for (int k = 0; k < 4; k++) {
+		mxGetPr(occupancy)[k] = (double)pipeline.ringOccupancy(k);
+	}
+	mxSetField(out, 0, "ringOccupancy", occupancy);
+
+	mxSetField(out, 0, "shedLevel", mxCreateDoubleScalar((double)pipeline.shedding.level()));
+	mxArray* utilization = mxCreateDoubleMatrix(1, BackpressureScheduler::numStages, mxREAL);
+	for (int k = 0; k < BackpressureScheduler::numStages; k++) {
+		mxGetPr(utilization)[k] = pipeline.shedding.utilization(k);
+	}
+	mxSetField(out, 0, "utilization", utilization);
+	return out;
+}
+
+static mxArray* createMetrics()
+{
+	const char* stageFields[] = {"count", "min", "mean", "p50", "p90", "p99", "p999", "max"};
+	const int numStageFields = sizeof(stageFields) / sizeof(stageFields[0]);
+	std::vector<const char*> fields(pipelineLatencyNames, pipelineLatencyNames + LATENCY_COUNT);
+	fields.insert(fields.end(), {"framesIn", "dropped", "coalesced", "enabled"});
+	mxArray* out = mxCreateStructMatrix(1, 1, (int)fields.size(), fields.data());
+
+	for (int k = 0; k < LATENCY_COUNT; k++) {
+		const LatencyHistogram& h = pipeline.metrics.latency[k];
+		double values[] = {(double)h.count(), h.min() * 1e-9, h.mean() * 1e-9, h.percentile(0.5) * 1e-9,
+			h.percentile(0.9) * 1e-9, h.percentile(0.99) * 1e-9, h.percentile(0.999) * 1e-9, h.max() * 1e-9};
+		mxArray* stage = mxCreateStructMatrix(1, 1, numStageFields, stageFields);
+		for (int f = 0; f < numStageFields; f++) {
+			mxSetField(stage, 0, stageFields[f], mxCreateDoubleScalar(values[f]));
+		}
+		mxSetField(out, 0, pipelineLatencyNames[k], stage);
+	}
+	const PipelineStats& s = pipeline.stats;
+	uint64_t dropped = s.droppedIngest + s.droppedRange + s.droppedDoppler + s.droppedCfar;
+	mxSetField(out, 0, "framesIn", mxCreateDoubleScalar((double)s.pushed));
+	mxSetField(out, 0, "dropped", mxCreateDoubleScalar((double)dropped));
+	mxSetField(out, 0, "coalesced", mxCreateDoubleScalar((double)s.coalesced));
+	mxSetField(out, 0, "enabled", mxCreateLogicalScalar(pipeline.metrics.on()));
+	return out;
+}
+
+// rows "time,name,count,min,mean,p50,p90,p99,p999,max", time is unix time,
+// counters have count only
+static bool dumpMetrics(const std::string& path)
+{
+	FILE* fp = std::fopen(path.c_str(), "a");
+	if (!fp) {
+		return false;
+	}
+	if (std::ftell(fp) == 0) {
+		std::fprintf(fp, "time,name,count,min_us,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n");
+	}
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	double now = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+	for (int k = 0; k < LATENCY_COUNT; k++) {
+		const LatencyHistogram& h = pipeline.metrics.latency[k];
+		std::fprintf(fp, "%.3f,%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", now, pipelineLatencyNames[k],
+				(unsigned long long)h.count(), h.min() * 1e-3, h.mean() * 1e-3, h.percentile(0.5) * 1e-3,
+				h.percentile(0.9) * 1e-3, h.percentile(0.99) * 1e-3, h.percentile(0.999) * 1e-3, h.max() * 1e-3);
+	}
+	const PipelineStats& s = pipeline.stats;
+	uint64_t dropped = s.droppedIngest + s.droppedRange + s.droppedDoppler + s.droppedCfar;
+	uint64_t counters[] = {s.pushed, dropped, s.coalesced};
+	const char* names[] = {"framesIn", "dropped", "coalesced"};
+	for (int k = 0; k < 3; k++) {
+		std::fprintf(fp, "%.3f,%s,%llu,,,,,,,\n", now, names[k], (unsigned long long)counters[k]);
+	}
+	return std::fclose(fp) == 0;
+}
+
+static mxArray* createColumn(const std::vector<double>& values)
+{
+	mxArray* out = mxCreateDoubleMatrix(values.size(), 1, mxREAL);
+	std::copy(values.begin(), values.end(), mxGetPr(out));
+	return out;
+}
+
+// pose timeline commands, returns false if command is not one of them
+static bool poseCommand(const std::string& command, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 4, "pose") != 0) {
+		return false;
+	}
+	if (command == "poseInit") {
+		size_t capacity = nrhs > 1 ? (size_t)mxGetScalar(prhs[1]) : 4096;
+		if (pipeline.isRunning() || platform.isRunning()) {
+			mexErrMsgTxt("pose timeline can't be reinitialized while pipeline or platform reader runs.");
+		}
+		poses.init(capacity);
+		return true;
+	}
+	ensurePoseTimeline();
+
+	if (command == "posePush") {
+		if (platform.isRunning()) {
+			mexErrMsgTxt("pose timeline is fed by platform reader.");
+		}
+		if (nrhs < 4) {
+			mexErrMsgTxt("posePush requires: times, yaw, pitch");
+		}
+		mwSize n = mxGetNumberOfElements(prhs[1]);
+		if (!mxIsDouble(prhs[1]) || !mxIsDouble(prhs[2]) || !mxIsDouble(prhs[3]) ||
+				mxGetNumberOfElements(prhs[2]) != n || mxGetNumberOfElements(prhs[3]) != n) {
+			mexErrMsgTxt("times, yaw and pitch must be double vectors of same length.");
+		}
+		const double* t = mxGetPr(prhs[1]);
+		const double* yaw = mxGetPr(prhs[2]);
+		const double* pitch = mxGetPr(prhs[3]);
+		for (mwSize k = 0; k < n; k++) {
+			poses.push(t[k], yaw[k], pitch[k]);
+		}
+	} else if (command == "poseAt") {
+		if (nrhs < 2 || !mxIsDouble(prhs[1])) {
+			mexErrMsgTxt("poseAt requires double vector of times.");
+		}
+		int mode = nrhs > 2 ? (int)mxGetScalar(prhs[2]) : POSE_LINEAR;
+		mwSize n = mxGetNumberOfElements(prhs[1]);
+		plhs[0] = mxCreateDoubleMatrix(mxGetM(prhs[1]), mxGetN(prhs[1]), mxREAL);
+		mxArray* pitch = mxCreateDoubleMatrix(mxGetM(prhs[1]), mxGetN(prhs[1]), mxREAL);
+		poses.atMany(mxGetPr(prhs[1]), n, mxGetPr(plhs[0]), mxGetPr(pitch), mode);
+		if (nlhs > 1) {
+			plhs[1] = pitch;
+		}
+	} else if (command == "poseInterval") {
+		if (nrhs < 3) {
+			mexErrMsgTxt("poseInterval requires: timeMin, timeMax");
+		}
+		std::vector<double> t, yaw, pitch;
+		poses.interval(mxGetScalar(prhs[1]), mxGetScalar(prhs[2]), t, yaw, pitch);
+		plhs[0] = createColumn(t);
+		if (nlhs > 1) {
+			plhs[1] = createColumn(yaw);
+		}
+		if (nlhs > 2) {
+			plhs[2] = createColumn(pitch);
+		}
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static void applyPlatformSettings(const mxArray* s)
+{
+	if (!mxIsStruct(s)) {
+		mexErrMsgTxt("settings must be a struct.");
+	}
+	platform.setSettings(getScalarField(s, "offsetYaw", 0), getScalarField(s, "offsetPitch", 0),
+			getScalarField(s, "triggerYaw", -1), getScalarField(s, "triggerTolerance", 2));
+}
+
+static mxArray* createPlatformStatus()
+{
+	const char* fields[] = {"messages", "triggers", "poses", "parseErrors", "droppedMessages"};
+	mxArray* out = mxCreateStructMatrix(1, 1, 5, fields);
+	platform.popMessages(platformMessages);
+	mxArray* messages = mxCreateCellMatrix(platformMessages.size(), 1);
+	for (size_t k = 0; k < platformMessages.size(); k++) {
+		mxSetCell(messages, k, mxCreateString(platformMessages[k].c_str()));
+	}
+	mxSetField(out, 0, "messages", messages);
+	const PlatformStats& s = platform.stats;
+	mxSetField(out, 0, "triggers", mxCreateDoubleScalar((double)s.triggers.load()));
+	mxSetField(out, 0, "poses", mxCreateDoubleScalar((double)s.poses.load()));
+	mxSetField(out, 0, "parseErrors", mxCreateDoubleScalar((double)s.parseErrors.load()));
+	mxSetField(out, 0, "droppedMessages", mxCreateDoubleScalar((double)s.droppedMessages.load()));
+	return out;
+}
+
+// platform reader commands, returns false if command is not one of them
+static bool platformCommand(const std::string& command, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 8, "platform") != 0) {
+		return false;
+	}
+	if (command == "platformOpen") {
+		if (nrhs < 5 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("platformOpen requires: port, baudrate, timeNow, settings");
+		}
+		char* port = mxArrayToString(prhs[1]);
+		std::string path(port);
+		mxFree(port);
+		ensurePoseTimeline();
+		platform.stop();
+		applyPlatformSettings(prhs[4]);
+		try {
+			platform.start(path, (int)mxGetScalar(prhs[2]), &poses, mxGetScalar(prhs[3]));
+		} catch (const std::exception& e) {
+			platform.stop();
+			updateLock();
+			mexErrMsgIdAndTxt("radarPipeline:platformOpen", "%s", e.what());
+		}
+		updateLock();
+	} else if (command == "platformClose") {
+		platform.stop();
+		updateLock();
+	} else if (command == "platformRunning") {
+		plhs[0] = mxCreateLogicalScalar(platform.isRunning());
+	} else if (command == "platformSettings") {
+		if (nrhs < 2) {
+			mexErrMsgTxt("platformSettings requires settings struct.");
+		}
+		applyPlatformSettings(prhs[1]);
+	} else if (command == "platformWrite") {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("platformWrite requires line.");
+		}
+		char* line = mxArrayToString(prhs[1]);
+		bool written = platform.writeLine(line);
+		mxFree(line);
+		if (!written) {
+			mexErrMsgIdAndTxt("radarPipeline:platformWrite", "Failed to write to platform.");
+		}
+	} else if (command == "platformPoll") {
+		plhs[0] = createPlatformStatus();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static void pollRadarFrames(int nlhs, mxArray *plhs[])
+{
+	size_t samples = radarReader.samples();
+	size_t n = radarReader.isRunning() ? radarReader.pending() : 0;
+	mxArray* outI = mxCreateDoubleMatrix(samples, n, mxREAL);
+	mxArray* outQ = mxCreateDoubleMatrix(samples, n, mxREAL);
+	mxArray* outTime = mxCreateDoubleMatrix(1, n, mxREAL);
+	double* pi = mxGetPr(outI);
+	double* pq = mxGetPr(outQ);
+	for (size_t k = 0; k < n; k++) {
+		const RadarFrame* f = radarReader.peek();
+		std::copy(f->i.begin(), f->i.end(), pi + k * samples);
+		std::copy(f->q.begin(), f->q.end(), pq + k * samples);
+		mxGetPr(outTime)[k] = f->time;
+		radarReader.release();
+	}
+	plhs[0] = outI;
+	if (nlhs > 1) {
+		plhs[1] = outQ;
+	}
+	if (nlhs > 2) {
+		plhs[2] = outTime;
+	}
+}
+
+static mxArray* createRadarStats()
+{
+	const char* fields[] = {"bytes", "frames", "droppedFrames", "skippedBytes", "pending"};
+	mxArray* out = mxCreateStructMatrix(1, 1, 5, fields);
+	const RadarReaderStats& s = radarReader.stats;
+	mxSetField(out, 0, "bytes", mxCreateDoubleScalar((double)s.bytes.load()));
+	mxSetField(out, 0, "frames", mxCreateDoubleScalar((double)s.frames.load()));
+	mxSetField(out, 0, "droppedFrames", mxCreateDoubleScalar((double)s.droppedFrames.load()));
+	mxSetField(out, 0, "skippedBytes", mxCreateDoubleScalar((double)s.skippedBytes.load()));
+	mxSetField(out, 0, "pending", mxCreateDoubleScalar((double)radarReader.pending()));
+	return out;
+}
+
+// radar reader commands, returns false if command is not one of them
+static bool radarCommand(const std::string& command, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 5, "radar") != 0) {
+		return false;
+	}
+	if (command == "radarOpen") {
+		if (nrhs < 5 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("radarOpen requires: port, baudrate, samples, timeNow");
+		}
+		char* port = mxArrayToString(prhs[1]);
+		std::string path(port);
+		mxFree(port);
+		trigger.stop(); // writes through reader's fd
+		radarReader.stop();
+		if (capture.isOpen() && capture.samples() != (size_t)mxGetScalar(prhs[3])) {
+			radarReader.setCapture(nullptr);
+			capture.close();
+		}
+		try {
+			radarReader.start(path, (int)mxGetScalar(prhs[2]), (size_t)mxGetScalar(prhs[3]), mxGetScalar(prhs[4]));
+		} catch (const std::exception& e) {
+			radarReader.stop();
+			updateLock();
+			mexErrMsgIdAndTxt("radarPipeline:radarOpen", "%s", e.what());
+		}
+		updateLock();
+	} else if (command == "radarClose") {
+		trigger.stop();
+		radarReader.stop();
+		radarReader.setCapture(nullptr);
+		capture.close();
+		updateLock();
+	} else if (command == "radarWrite") {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("radarWrite requires line.");
+		}
+		char* line = mxArrayToString(prhs[1]);
+		bool written = radarReader.writeLine(line);
+		mxFree(line);
+		if (!written) {
+			mexErrMsgIdAndTxt("radarPipeline:radarWrite", "Failed to write to radar.");
+		}
+	} else if (command == "radarPoll") {
+		pollRadarFrames(nlhs, plhs);
+	} else if (command == "radarStats") {
+		plhs[0] = createRadarStats();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static mxArray* createTriggerStats()
+{
+	const char* fields[] = {"triggers", "failed", "missed", "skippedCells",
+		"jitterMean", "jitterStd", "jitterMax"};
+	mxArray* out = mxCreateStructMatrix(1, 1, 7, fields);
+	const TriggerStats& s = trigger.stats;
+	mxSetField(out, 0, "triggers", mxCreateDoubleScalar((double)s.triggers.load()));
+	mxSetField(out, 0, "failed", mxCreateDoubleScalar((double)s.failed.load()));
+	mxSetField(out, 0, "missed", mxCreateDoubleScalar((double)s.missed.load()));
+	mxSetField(out, 0, "skippedCells", mxCreateDoubleScalar((double)s.skippedCells.load()));
+	double n = (double)s.wakeups.load();
+	double mean = n > 0 ? (double)s.jitterSumNs.load() * 1e-9 / n : 0;
+	double meanSq = n > 0 ? (double)s.jitterSumSqUs.load() * 1e-12 / n : 0;
+	mxSetField(out, 0, "jitterMean", mxCreateDoubleScalar(mean));
+	mxSetField(out, 0, "jitterStd", mxCreateDoubleScalar(std::sqrt(std::max(0.0, meanSq - mean * mean))));
+	mxSetField(out, 0, "jitterMax", mxCreateDoubleScalar((double)s.jitterMaxNs.load() * 1e-9));
+	return out;
+}
+
+// trigger scheduler commands, returns false if command is not one of them
+static bool triggerCommand(const std::string& command, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 7, "trigger") != 0) {
+		return false;
+	}
+	if (command == "triggerStart") {
+		if (nrhs < 3 || !mxIsStruct(prhs[1])) {
+			mexErrMsgTxt("triggerStart requires: config, timeNow");
+		}
+		if (!radarReader.isRunning()) {
+			mexErrMsgTxt("triggerStart requires open radar reader.");
+		}
+		TriggerConfig cfg;
+		cfg.period = getScalarField(prhs[1], "period", cfg.period);
+		cfg.angleStep = getScalarField(prhs[1], "angleStep", cfg.angleStep);
+		cfg.pollPeriod = getScalarField(prhs[1], "pollPeriod", cfg.pollPeriod);
+		cfg.minInterval = getScalarField(prhs[1], "minInterval", cfg.period);
+		cfg.startDelay = getScalarField(prhs[1], "startDelay", cfg.startDelay);
+		cfg.poseMode = (int)getScalarField(prhs[1], "poseInterpolation", cfg.poseMode);
+		ensurePoseTimeline();
+		try {
+			trigger.start(cfg, [] { return radarReader.writeLine("!N"); }, &poses, mxGetScalar(prhs[2]));
+		} catch (const std::exception& e) {
+			trigger.stop();
+			updateLock();
+			mexErrMsgIdAndTxt("radarPipeline:triggerStart", "%s", e.what());
+		}
+		updateLock();
+	} else if (command == "triggerStop") {
+		trigger.stop();
+		updateLock();
+	} else if (command == "triggerStats") {
+		plhs[0] = createTriggerStats();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+// trace commands, returns false if command is not one of them
+static bool traceCommand(const std::string& command, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 5, "trace") != 0) {
+		return false;
+	}
+	TraceRecorder& recorder = TraceRecorder::instance();
+	if (command == "traceEnable") {
+		if (nrhs < 2) {
+			mexErrMsgTxt("traceEnable requires: enable");
+		}
+		size_t capacity = nrhs > 2 ? (size_t)mxGetScalar(prhs[2]) : (size_t)1 << 16;
+		recorder.threadName("matlab");
+		recorder.enable(mxGetScalar(prhs[1]) != 0, capacity);
+	} else if (command == "trace") {
+		if (nrhs < 3 || !mxIsChar(prhs[1]) || !mxIsChar(prhs[2])) {
+			mexErrMsgTxt("trace requires: name, phase[, id]");
+		}
+		if (!recorder.on()) {
+			return true;
+		}
+		char* name = mxArrayToString(prhs[1]);
+		char* phase = mxArrayToString(prhs[2]);
+		char ph = phase[0];
+		uint16_t event = recorder.name(name);
+		mxFree(name);
+		mxFree(phase);
+		if (ph != 'B' && ph != 'E' && ph != 'i' && ph != 'b' && ph != 'e') {
+			mexErrMsgTxt("trace phase must be one of B, E, i, b, e.");
+		}
+		recorder.record(event, nrhs > 3 ? (uint64_t)mxGetScalar(prhs[3]) : 0, ph);
+	} else if (command == "traceExport") {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("traceExport requires path.");
+		}
+		char* tmp = mxArrayToString(prhs[1]);
+		std::string path(tmp);
+		mxFree(tmp);
+		long count = recorder.exportJson(path);
+		if (count < 0) {
+			mexErrMsgIdAndTxt("radarPipeline:traceExport", "Failed to write %s", path.c_str());
+		}
+		if (nlhs > 0) {
+			plhs[0] = mxCreateDoubleScalar((double)count);
+		}
+	} else if (command == "traceClear") {
+		recorder.clear();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static mxArray* createCaptureStats()
+{
+	const char* fields[] = {"offered", "written", "droppedQueue", "droppedDisk", "withoutPose",
+		"segments", "bytes", "truncateFailed", "pending", "open"};
+	const int numFields = sizeof(fields) / sizeof(fields[0]);
+	mxArray* out = mxCreateStructMatrix(1, 1, numFields, fields);
+	const CaptureStats& s = capture.stats;
+	uint64_t values[] = {s.offered, s.written, s.droppedQueue, s.droppedDisk, s.withoutPose,
+		s.segments, s.bytes, s.truncateFailed, capture.pending()};
+	for (int k = 0; k < numFields - 1; k++) {
+		mxSetField(out, 0, fields[k], mxCreateDoubleScalar((double)values[k]));
+	}
+	mxSetField(out, 0, "open", mxCreateLogicalScalar(capture.isOpen()));
+	return out;
+}
+
+// raw capture commands, returns false if command is not one of them
+static bool captureCommand(const std::string& command, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 7, "capture") != 0) {
+		return false;
+	}
+	if (command == "captureOpen") {
+		if (nrhs < 2 || !mxIsChar(prhs[1]) || (nrhs > 2 && !mxIsStruct(prhs[2]))) {
+			mexErrMsgTxt("captureOpen requires: dir[, config]");
+		}
+		CaptureConfig cfg;
+		char* dir = mxArrayToString(prhs[1]);
+		cfg.dir = dir;
+		mxFree(dir);
+		cfg.samples = radarReader.isRunning() ? radarReader.samples() : cfg.samples;
+		if (nrhs > 2) {
+			const mxArray* s = prhs[2];
+			cfg.samples = (size_t)getScalarField(s, "samples", (double)cfg.samples);
+			cfg.segmentRecords = (size_t)getScalarField(s, "segmentRecords", (double)cfg.segmentRecords);
+			cfg.maxSegments = (size_t)getScalarField(s, "maxSegments", (double)cfg.maxSegments);
+			cfg.queueSize = (size_t)getScalarField(s, "queueSize", (double)cfg.queueSize);
+			cfg.poseWait = getScalarField(s, "poseWait", cfg.poseWait);
+			cfg.poseInterpolation = (int)getScalarField(s, "poseInterpolation", cfg.poseInterpolation);
+			cfg.bandwidth = getScalarField(s, "bandwidth", cfg.bandwidth);
+			cfg.frontend = getScalarField(s, "frontend", cfg.frontend);
+			cfg.chirpPeriod = getScalarField(s, "chirpPeriod", cfg.chirpPeriod);
+		}
+		radarReader.setCapture(nullptr);
+		ensurePoseTimeline();
+		capture.setPoseTimeline(&poses);
+		try {
+			capture.open(cfg);
+		} catch (const std::exception& e) {
+			capture.close();
+			updateLock();
+			mexErrMsgIdAndTxt("radarPipeline:captureOpen", "%s", e.what());
+		}
+		radarReader.setCapture(&capture);
+		updateLock();
+		plhs[0] = mxCreateString(capture.pathPrefix().c_str());
+	} else if (command == "captureStats") {
+		plhs[0] = createCaptureStats();
+	} else if (command == "captureClose") {
+		radarReader.setCapture(nullptr);
+		capture.close();
+		updateLock();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static bool shmCommand(const std::string& command, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 3, "shm") != 0) {
+		return false;
+	}
+	if (command == "shmOpen") {
+		if (nrhs < 3 || !mxIsChar(prhs[1]) || !mxIsStruct(prhs[2])) {
+			mexErrMsgTxt("shmOpen requires: name, config");
+		}
+		const mxArray* s = prhs[2];
+		ShmExportConfig cfg;
+		char* name = mxArrayToString(prhs[1]);
+		cfg.name = name;
+		mxFree(name);
+		mxArray* size = mxGetField(s, 0, "rawCubeSize");
+		if (size == nullptr || mxGetNumberOfElements(size) < 4 || !mxIsDouble(size)) {
+			mexErrMsgTxt("shmOpen config requires rawCubeSize [range x doppler x yaw x pitch].");
+		}
+		const double* dims = mxGetPr(size);
+		cfg.rangeBins = (size_t)dims[0];
+		cfg.dopplerBins = (size_t)dims[1];
+		cfg.yawBins = (size_t)dims[2];
+		cfg.pitchBins = (size_t)dims[3];
+		cfg.raw = getScalarField(s, "calcRaw", cfg.raw) != 0;
+		cfg.cfar = getScalarField(s, "calcCFAR", cfg.cfar) != 0;
+		cfg.rawCubePath = getStringField(s, "rawCubePath", "rawCube.dat");
+		cfg.cfarCubePath = getStringField(s, "cfarCubePath", "cfarCube.dat");
+		cfg.rangeBinWidth = getScalarField(s, "rangeBinWidth", cfg.rangeBinWidth);
+		cfg.yawBinMin = (int)getScalarField(s, "yawBinMin", cfg.yawBinMin);
+		cfg.pitchBinMin = (int)getScalarField(s, "pitchBinMin", cfg.pitchBinMin);
+		cfg.rangeBinMin = (size_t)getScalarField(s, "rangeBinMin", (double)cfg.rangeBinMin);
+		cfg.detectionThreshold = (float)getScalarField(s, "detectionThreshold", cfg.detectionThreshold);
+		cfg.maxDetections = (size_t)getScalarField(s, "maxDetections", (double)cfg.maxDetections);
+		cfg.slots = (size_t)getScalarField(s, "slots", (double)cfg.slots);
+		try {
+			shm.open(cfg);
+		} catch (const std::exception& e) {
+			shm.close();
+			updateLock();
+			mexErrMsgIdAndTxt("radarPipeline:shmOpen", "%s", e.what());
+		}
+		updateLock();
+	} else if (command == "shmPublish") {
+		if (nrhs < 3) {
+			mexErrMsgTxt("shmPublish requires: lastYaw, lastPitch");
+		}
+		shm.publish(mxGetScalar(prhs[1]), mxGetScalar(prhs[2]));
+	} else if (command == "shmStats") {
+		const char* fields[] = {"requests", "published", "truncated"};
+		plhs[0] = mxCreateStructMatrix(1, 1, 3, fields);
+		mxSetField(plhs[0], 0, "requests", mxCreateDoubleScalar((double)shm.stats.requests));
+		mxSetField(plhs[0], 0, "published", mxCreateDoubleScalar((double)shm.stats.published));
+		mxSetField(plhs[0], 0, "truncated", mxCreateDoubleScalar((double)shm.stats.truncated));
+	} else if (command == "shmClose") {
+		shm.close();
+		updateLock();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static bool cubeCommand(const std::string& command, int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 4, "cube") != 0) {
+		return false;
+	}
+	if (command == "cubeResample") {
+		if (nrhs < 8 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("cubeResample requires: path, oldBins, columns, newBins, scale, offset, peak");
+		}
+		if (pipeline.isRunning() || shm.isOpen()) {
+			mexErrMsgIdAndTxt("radarPipeline:cubeResample", "Stop pipeline and shared memory export before resampling cubes.");
+		}
+		char* tmp = mxArrayToString(prhs[1]);
+		std::string path(tmp);
+		mxFree(tmp);
+		try {
+			resampleCubeFile(path, (size_t)mxGetScalar(prhs[2]), (size_t)mxGetScalar(prhs[3]),
+					(size_t)mxGetScalar(prhs[4]), mxGetScalar(prhs[5]), mxGetScalar(prhs[6]), mxGetScalar(prhs[7]) != 0);
+		} catch (const std::exception& e) {
+			mexErrMsgIdAndTxt("radarPipeline:cubeResample", "%s", e.what());
+		}
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+// running pipeline writes the cube of the sector index
+static bool pipelineWrites(const SectorIndexConfig& cfg)
+{
+	if (!pipeline.isRunning()) {
+		return false;
+	}
+	const PipelineConfig& p = pipeline.getConfig();
+	if (cfg.rangeBins != p.rangeBins() || cfg.yawBins != p.yawBins() || cfg.pitchBins != p.pitchBins()) {
+		return false;
+	}
+	return cfg.raw ? p.calcRaw && cfg.dopplerBins == p.dopplerBins() && cfg.cubePath == p.rawCubePath :
+		p.calcCFAR && cfg.cubePath == p.cfarCubePath;
+}
+
+// sector index and change detector follow running pipeline of their geometry
+static void attachFollowers()
+{
+	bool attach = sectorIndex.isOpen() && pipelineWrites(sectorIndex.getConfig());
+	pipeline.setSectorIndex(attach ? &sectorIndex : nullptr);
+	const ChangeDetectorConfig& c = changeDetector.getConfig();
+	const PipelineConfig& p = pipeline.getConfig();
+	attach = changeDetector.isOpen() && pipeline.isRunning() && c.rangeBins == p.rangeBins() &&
+		c.yawBins == p.yawBins() && c.pitchBins == p.pitchBins();
+	pipeline.setChangeDetector(attach ? &changeDetector : nullptr);
+}
+
+static bool sectorCommand(const std::string& command, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 6, "sector") != 0) {
+		return false;
+	}
+	if (command == "sectorOpen") {
+		if (nrhs < 2 || !mxIsStruct(prhs[1])) {
+			mexErrMsgTxt("sectorOpen requires config struct.");
+		}
+		const mxArray* s = prhs[1];
+		SectorIndexConfig cfg;
+		mxArray* size = mxGetField(s, 0, "rawCubeSize");
+		if (size == nullptr || mxGetNumberOfElements(size) < 4 || !mxIsDouble(size)) {
+			mexErrMsgTxt("sectorOpen config requires rawCubeSize [range x doppler x yaw x pitch].");
+		}
+		const double* dims = mxGetPr(size);
+		cfg.rangeBins = (size_t)dims[0];
+		cfg.dopplerBins = (size_t)dims[1];
+		cfg.yawBins = (size_t)dims[2];
+		cfg.pitchBins = (size_t)dims[3];
+		cfg.raw = getScalarField(s, "raw", cfg.raw) != 0;
+		cfg.cubePath = getStringField(s, "cubePath", cfg.raw ? "rawCube.dat" : "cfarCube.dat");
+		cfg.rangeBinWidth = getScalarField(s, "rangeBinWidth", cfg.rangeBinWidth);
+		cfg.rangeBinMin = (size_t)getScalarField(s, "rangeBinMin", (double)cfg.rangeBinMin);
+		cfg.yawBinMin = (int)getScalarField(s, "yawBinMin", cfg.yawBinMin);
+		cfg.pitchBinMin = (int)getScalarField(s, "pitchBinMin", cfg.pitchBinMin);
+		cfg.tileSize = (size_t)getScalarField(s, "tileSize", (double)cfg.tileSize);
+		pipeline.setSectorIndex(nullptr);
+		try {
+			// cube being written by the pipeline is read by its first update
+			sectorIndex.open(cfg, pipelineWrites(cfg) || getScalarField(s, "deferRebuild", 0) != 0);
+		} catch (const std::exception& e) {
+			sectorIndex.close();
+			mexErrMsgIdAndTxt("radarPipeline:sectorOpen", "%s", e.what());
+		}
+		attachFollowers();
+	} else if (command == "sectorUpdate") {
+		if (nrhs < 4) {
+			mexErrMsgTxt("sectorUpdate requires: decay, yawIdx, pitchIdx[, patternYaw, patternPitch]");
+		}
+		size_t n = mxGetNumberOfElements(prhs[2]);
+		if (n != mxGetNumberOfElements(prhs[3]) || (n > 0 && (!mxIsDouble(prhs[2]) || !mxIsDouble(prhs[3])))) {
+			mexErrMsgTxt("yawIdx and pitchIdx must be double vectors of same length.");
+		}
+		const SectorIndexConfig& cfg = sectorIndex.getConfig();
+		const double* yaw = n ? mxGetPr(prhs[2]) : nullptr;
+		const double* pitch = n ? mxGetPr(prhs[3]) : nullptr;
+		std::vector<SectorCell> cells;
+		for (size_t k = 0; k < n; k++) {
+			if (yaw[k] >= 1 && yaw[k] <= (double)cfg.yawBins && pitch[k] >= 1 && pitch[k] <= (double)cfg.pitchBins) {
+				cells.push_back({(size_t)yaw[k] - 1, (size_t)pitch[k] - 1});
+			}
+		}
+		size_t patternYaw = nrhs > 5 ? (size_t)mxGetScalar(prhs[4]) : 1;
+		size_t patternPitch = nrhs > 5 ? (size_t)mxGetScalar(prhs[5]) : 1;
+		sectorIndex.update((float)mxGetScalar(prhs[1]), cells, patternYaw, patternPitch);
+	} else if (command == "sectorQuery") {
+		if (nrhs < 2 || !mxIsDouble(prhs[1]) || (!mxIsEmpty(prhs[1]) && mxGetN(prhs[1]) < 6)) {
+			mexErrMsgTxt("sectorQuery requires sectors [n x 6].");
+		}
+		if (!sectorIndex.isOpen()) {
+			mexErrMsgIdAndTxt("radarPipeline:sectorQuery", "Sector index is not open.");
+		}
+		size_t n = mxIsEmpty(prhs[1]) ? 0 : mxGetM(prhs[1]);
+		const double* in = n ? mxGetPr(prhs[1]) : nullptr;
+		std::vector<SectorQuery> queries(n);
+		for (size_t k = 0; k < n; k++) {
+			queries[k] = {in[k], in[k + n], in[k + 2 * n], in[k + 3 * n], in[k + 4 * n], in[k + 5 * n]};
+		}
+		std::vector<SectorResult> results(n);
+		sectorIndex.query(queries.data(), results.data(), n);
+		plhs[0] = mxCreateDoubleMatrix(n, 3, mxREAL);
+		double* out = mxGetPr(plhs[0]);
+		for (size_t k = 0; k < n; k++) {
+			out[k] = results[k].sum;
+			out[k + n] = results[k].max;
+			out[k + 2 * n] = results[k].cells;
+		}
+	} else if (command == "sectorReset") {
+		sectorIndex.reset();
+	} else if (command == "sectorStats") {
+		const char* fields[] = {"updates", "tiles", "rebuilds", "queries"};
+		plhs[0] = mxCreateStructMatrix(1, 1, 4, fields);
+		const SectorIndexStats& s = sectorIndex.stats;
+		double values[] = {(double)s.updates, (double)s.tiles, (double)s.rebuilds, (double)s.queries};
+		for (int k = 0; k < 4; k++) {
+			mxSetField(plhs[0], 0, fields[k], mxCreateDoubleScalar(values[k]));
+		}
+	} else if (command == "sectorClose") {
+		pipeline.setSectorIndex(nullptr);
+		sectorIndex.close();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static bool changeCommand(const std::string& command, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 6, "change") != 0) {
+		return false;
+	}
+	if (command == "changeOpen") {
+		if (nrhs < 2 || !mxIsStruct(prhs[1])) {
+			mexErrMsgTxt("changeOpen requires config struct.");
+		}
+		const mxArray* s = prhs[1];
+		ChangeDetectorConfig cfg;
+		mxArray* size = mxGetField(s, 0, "rawCubeSize");
+		if (size == nullptr || mxGetNumberOfElements(size) < 4 || !mxIsDouble(size)) {
+			mexErrMsgTxt("changeOpen config requires rawCubeSize [range x doppler x yaw x pitch].");
+		}
+		const double* dims = mxGetPr(size);
+		cfg.rangeBins = (size_t)dims[0];
+		cfg.yawBins = (size_t)dims[2];
+		cfg.pitchBins = (size_t)dims[3];
+		cfg.rangeBinWidth = getScalarField(s, "rangeBinWidth", cfg.rangeBinWidth);
+		cfg.rangeBinMin = (size_t)getScalarField(s, "rangeBinMin", (double)cfg.rangeBinMin);
+		cfg.yawBinMin = (int)getScalarField(s, "yawBinMin", cfg.yawBinMin);
+		cfg.pitchBinMin = (int)getScalarField(s, "pitchBinMin", cfg.pitchBinMin);
+		cfg.alpha = (float)getScalarField(s, "alpha", cfg.alpha);
+		cfg.visitGap = getScalarField(s, "visitGap", cfg.visitGap);
+		cfg.training = (size_t)getScalarField(s, "training", (double)cfg.training);
+		cfg.guard = (size_t)getScalarField(s, "guard", (double)cfg.guard);
+		cfg.pfa = getScalarField(s, "pfa", cfg.pfa);
+		cfg.minRatio = (float)getScalarField(s, "minRatio", cfg.minRatio);
+		cfg.maxRecords = (size_t)getScalarField(s, "maxRecords", (double)cfg.maxRecords);
+		pipeline.setChangeDetector(nullptr);
+		try {
+			changeDetector.open(cfg);
+		} catch (const std::exception& e) {
+			changeDetector.close();
+			mexErrMsgIdAndTxt("radarPipeline:changeOpen", "%s", e.what());
+		}
+		attachFollowers();
+	} else if (command == "changeUpdate") {
+		if (nrhs < 5) {
+			mexErrMsgTxt("changeUpdate requires: times, yawIdx, pitchIdx, profiles");
+		}
+		const ChangeDetectorConfig& cfg = changeDetector.getConfig();
+		size_t n = mxGetNumberOfElements(prhs[1]);
+		if (n != mxGetNumberOfElements(prhs[2]) || n != mxGetNumberOfElements(prhs[3]) ||
+				(n > 0 && (!mxIsDouble(prhs[1]) || !mxIsDouble(prhs[2]) || !mxIsDouble(prhs[3]) ||
+				mxGetM(prhs[4]) != cfg.rangeBins || mxGetN(prhs[4]) != n))) {
+			mexErrMsgTxt("times, yawIdx and pitchIdx must be double vectors of n frames and profiles [range x n].");
+		}
+		if (n == 0 || !changeDetector.isOpen()) {
+			return true;
+		}
+		std::vector<float> profiles(cfg.rangeBins * n);
+		std::vector<float> scratchIm(cfg.rangeBins * n);
+		toSplitFloat(prhs[4], profiles.data(), scratchIm.data(), profiles.size());
+		const double* times = mxGetPr(prhs[1]);
+		const double* yaw = mxGetPr(prhs[2]);
+		const double* pitch = mxGetPr(prhs[3]);
+		std::vector<ChangeFrame> frames;
+		for (size_t k = 0; k < n; k++) {
+			if (yaw[k] >= 1 && pitch[k] >= 1) {
+				frames.push_back({(size_t)yaw[k] - 1, (size_t)pitch[k] - 1, times[k], profiles.data() + k * cfg.rangeBins});
+			}
+		}
+		changeDetector.process(frames.data(), frames.size());
+	} else if (command == "changePoll") {
+		std::vector<ChangeRecord> records;
+		changeDetector.poll(records);
+		size_t n = records.size();
+		plhs[0] = mxCreateDoubleMatrix(n, 6, mxREAL);
+		double* out = mxGetPr(plhs[0]);
+		for (size_t k = 0; k < n; k++) {
+			const ChangeRecord& c = records[k];
+			double row[6] = {c.time, c.range, c.yaw, c.pitch, c.value, c.reference};
+			for (size_t j = 0; j < 6; j++) {
+				out[k + j * n] = row[j];
+			}
+		}
+	} else if (command == "changeReset") {
+		changeDetector.reset();
+	} else if (command == "changeStats") {
+		const char* fields[] = {"frames", "seeded", "visits", "changes", "dropped"};
+		plhs[0] = mxCreateStructMatrix(1, 1, 5, fields);
+		const ChangeDetectorStats& s = changeDetector.stats;
+		double values[] = {(double)s.frames, (double)s.seeded, (double)s.visits, (double)s.changes, (double)s.dropped};
+		for (int k = 0; k < 5; k++) {
+			mxSetField(plhs[0], 0, fields[k], mxCreateDoubleScalar(values[k]));
+		}
+	} else if (command == "changeClose") {
+		pipeline.setChangeDetector(nullptr);
+		changeDetector.close();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+static bool streamCommand(const std::string& command, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (command.compare(0, 6, "stream") != 0) {
+		return false;
+	}
+	if (command == "streamOpen") {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("streamOpen requires socket path.");
+		}
+		char* tmp = mxArrayToString(prhs[1]);
+		std::string path(tmp);
+		mxFree(tmp);
+		try {
+			detectionStream.open(path);
+		} catch (const std::exception& e) {
+			updateLock();
+			mexErrMsgIdAndTxt("radarPipeline:streamOpen", "%s", e.what());
+		}
+		updateLock();
+	} else if (command == "streamPublish") {
+		if (nrhs < 4) {
+			mexErrMsgTxt("streamPublish requires: time, detections, tracks");
+		}
+		const mxArray* detections = prhs[2];
+		const mxArray* tracks = prhs[3];
+		size_t n = mxIsEmpty(detections) ? 0 : mxGetM(detections);
+		size_t m = mxIsEmpty(tracks) ? 0 : mxGetM(tracks);
+		if ((n > 0 && (!mxIsDouble(detections) || mxGetN(detections) < 4)) ||
+				(m > 0 && (!mxIsDouble(tracks) || mxGetN(tracks) < 10))) {
+			mexErrMsgTxt("detections must be double [n x 4] and tracks double [m x 10].");
+		}
+		detectionStream.publish(mxGetScalar(prhs[1]), n ? mxGetPr(detections) : nullptr, n,
+				m ? mxGetPr(tracks) : nullptr, m);
+	} else if (command == "streamStats") {
+		const char* fields[] = {"clients", "published", "frames", "droppedFrames", "droppedUpdates"};
+		plhs[0] = mxCreateStructMatrix(1, 1, 5, fields);
+		const DetectionStreamStats& s = detectionStream.stats;
+		double values[] = {(double)s.clients, (double)s.published, (double)s.frames,
+			(double)s.droppedFrames, (double)s.droppedUpdates};
+		for (int k = 0; k < 5; k++) {
+			mxSetField(plhs[0], 0, fields[k], mxCreateDoubleScalar(values[k]));
+		}
+	} else if (command == "streamClose") {
+		detectionStream.close();
+		updateLock();
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+	return true;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	std::string command = getCommand(nrhs, prhs);
+
+	if (poseCommand(command, nlhs, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (platformCommand(command, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (radarCommand(command, nlhs, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (triggerCommand(command, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (traceCommand(command, nlhs, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (captureCommand(command, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (shmCommand(command, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (streamCommand(command, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (cubeCommand(command, nrhs, prhs)) {
+		return;
+	}
+	if (sectorCommand(command, plhs, nrhs, prhs)) {
+		return;
+	}
+	if (changeCommand(command, plhs, nrhs, prhs)) {
+		return;
+	}
+
+	if (command == "start") {
+		if (nrhs < 2) {
+			mexErrMsgTxt("start requires config struct.");
+		}
+		PipelineConfig cfg = parseConfig(prhs[1]);
+		pipeline.stop();
+		ensurePoseTimeline();
+		pipeline.setPoseTimeline(&poses);
+		try {
+			pipeline.start(cfg);
+		} catch (const std::exception& e) {
+			pipeline.stop();
+			updateLock();
+			mexErrMsgIdAndTxt("radarPipeline:start", "%s", e.what());
+		}
+		attachFollowers();
+		chirpI.resize(cfg.samples);
+		chirpQ.resize(cfg.samples);
+		scratch.resize(cfg.samples);
+		updateLock();
+		return;
+	}
+
+	if (command == "stop") {
+		pipeline.setSectorIndex(nullptr);
+		pipeline.setChangeDetector(nullptr);
+		pipeline.stop();
+		updateLock();
+		return;
+	}
+
+	if (command == "running") {
+		plhs[0] = mxCreateLogicalScalar(pipeline.isRunning());
+		return;
+	}
+
+	if (!pipeline.isRunning()) {
+		mexErrMsgTxt("radarPipeline is not running, call start first.");
+	}
+
+	if (command == "push" || command == "pushStream") {
+		// pushStream has stream index before the chirp
+		int a = command == "push" ? 1 : 2;
+		if (nrhs != a + 3 && nrhs < a + 5) {
+			mexErrMsgTxt(a == 1 ? "push requires: I, Q, time[, yaw, pitch]" :
+					"pushStream requires: stream, I, Q, time[, yaw, pitch]");
+		}
+		size_t stream = 0;
+		if (a == 2) {
+			double v = mxGetScalar(prhs[1]);
+			if (v < 1 || v > (double)pipeline.streamCount()) {
+				mexErrMsgTxt("stream must be between 1 and number of streams.");
+			}
+			stream = (size_t)v - 1;
+		}
+		mwSize n = mxGetNumberOfElements(prhs[a]);
+		if (n != mxGetNumberOfElements(prhs[a + 1])) {
+			mexErrMsgTxt("I and Q must have same length.");
+		}
+		n = n < chirpI.size() ? n : chirpI.size();
+		toSplitFloat(prhs[a], chirpI.data(), scratch.data(), n);
+		toSplitFloat(prhs[a + 1], chirpQ.data(), scratch.data(), n);
+		bool accepted = nrhs == a + 3 ?
+			pipeline.pushChirp(stream, chirpI.data(), chirpQ.data(), n, mxGetScalar(prhs[a + 2])) :
+			pipeline.pushChirp(stream, chirpI.data(), chirpQ.data(), n,
+					mxGetScalar(prhs[a + 2]), mxGetScalar(prhs[a + 3]), mxGetScalar(prhs[a + 4]));
+		if (nlhs > 0) {
+			plhs[0] = mxCreateLogicalScalar(accepted);
+		}
+	} else if (command == "poll") {
+		double yaw, pitch;
+		pipeline.getGeneration(yaw, pitch);
+		// tiles belong to generation taken with them
+		DirtyTiles dirty;
+		uint64_t generation = pipeline.takeDirty(dirty);
+		pipeline.notePolled(generation);
+		const char* fields[] = {"generation", "lastYaw", "lastPitch", "dirtyTiles", "dirtyRange"};
+		plhs[0] = mxCreateStructMatrix(1, 1, 5, fields);
+		mxSetField(plhs[0], 0, "generation", mxCreateDoubleScalar((double)generation));
+		mxSetField(plhs[0], 0, "lastYaw", mxCreateDoubleScalar(yaw));
+		mxSetField(plhs[0], 0, "lastPitch", mxCreateDoubleScalar(pitch));
+		mxArray* tiles = mxCreateNumericMatrix(dirty.getTilesYaw(), dirty.getTilesPitch(), mxLOGICAL_CLASS, mxREAL);
+		mxLogical* t = (mxLogical*)mxGetData(tiles);
+		dirty.forEach([&](size_t i, size_t j) { t[i + j * dirty.getTilesYaw()] = true; });
+		mxSetField(plhs[0], 0, "dirtyTiles", tiles);
+		mxArray* range = mxCreateDoubleMatrix(dirty.hasRange() ? 1 : 0, dirty.hasRange() ? 2 : 0, mxREAL);
+		if (dirty.hasRange()) {
+			mxGetPr(range)[0] = (double)dirty.getRangeFirst() + 1;
+			mxGetPr(range)[1] = (double)dirty.getRangeLast() + 1;
+		}
+		mxSetField(plhs[0], 0, "dirtyRange", range);
+	} else if (command == "stats") {
+		plhs[0] = createStats();
+	} else if (command == "zero") {
+		pipeline.requestZero();
+	} else if (command == "metrics") {
+		plhs[0] = createMetrics();
+	} else if (command == "metricsEnable") {
+		if (nrhs < 2) {
+			mexErrMsgTxt("metricsEnable requires: enable");
+		}
+		pipeline.metrics.enabled.store(mxGetScalar(prhs[1]) != 0, std::memory_order_relaxed);
+	} else if (command == "metricsReset") {
+		pipeline.metrics.reset();
+	} else if (command == "metricsDump") {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) {
+			mexErrMsgTxt("metricsDump requires path.");
+		}
+		char* tmp = mxArrayToString(prhs[1]);
+		std::string path(tmp);
+		mxFree(tmp);
+		if (!dumpMetrics(path)) {
+			mexErrMsgIdAndTxt("radarPipeline:metricsDump", "Failed to write %s", path.c_str());
+		}
+	} else {
+		mexErrMsgIdAndTxt("radarPipeline:command", "Unknown command %s", command.c_str());
+	}
+}
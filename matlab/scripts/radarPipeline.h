@@ -0,0 +1,1107 @@
+#ifndef RADAR_PIPELINE_H
+#define RADAR_PIPELINE_H
+
+#include "backpressure.h"
+#include "cfar.h"
+#include "changeDetector.h"
+#include "clutterMap.h"
+#include "dirtyTiles.h"
+#include "fft.h"
+#include "latencyHistogram.h"
+#include "poseTimeline.h"
+#include "powerMap.h"
+#include "sectorQuery.h"
+#include "slidingDFT.h"
+#include "spscRing.h"
+#include "traceRecorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Native streaming pipeline
+//
+//   ingest -> range FFT -> Doppler -> CFAR -> cube update
+//
+// Every stage is a long lived thread connected to the next one by bounded
+// SPSC ring (spscRing.h). Stage never waits on its successor, if the ring is
+// full the frame is dropped and counted in PipelineStats. Cubes are the same
+// rawCube.dat, cfarCube.dat (and clutterCube.dat) files radarDataCube maps
+// with memmapfile, here they are mapped MAP_SHARED so MATLAB sees every update
+// without copying. Cube update follows radarDataCube.processBatch, frames are
+// gathered to batches of batchSize, cube is decayed once per batch and every
+// finished batch increments generation which MATLAB polls. Tiles of yaw x pitch
+// cells rewritten since the last poll (dirtyTiles.h) are taken together with
+// the generation, so poller learns which part of the cube changed.
+//
+// When stages fall behind, work is shed in steps before rings overflow and
+// frames get dropped at random (backpressure.h). Every shed frame is counted.
+//
+// Optional metrics keep latency histogram of every stage (latencyHistogram.h),
+// disabled metrics cost one relaxed load per frame. Stages record trace events
+// with chirp ID (traceRecorder.h), chirps read by native radar reader keep ID
+// the reader gave them.
+//
+// Several radar streams (sensors mounted on the same platform) can feed one
+// cube. Every stream has its own ingest ring, range FFT and Doppler thread and
+// a fixed mounting offset added to platform pose, so N sensors cover N times
+// the angle per revolution. Streams merge at the CFAR stage, which serves their
+// rings round robin, clutter map and cubes keep single writer and need no
+// locking.
+//
+// Cube covers region of interest: yaw and pitch bins (yaw sector may wrap over
+// 0 deg) and range gate of rangeBinCount bins from rangeBinMin. With roiGating
+// chirps outside the sector are dropped before range FFT, only gated bins go
+// through Doppler, CFAR and cube, so memory and work scale with the ROI.
+//
+// Header has no MATLAB dependency, radarPipeline.cpp is the mex gateway.
+
+struct PipelineConfig {
+	size_t samples = 128;          // samples per chirp
+	size_t rangeNFFT = 128;        // range FFT size, up to rangeNFFT/2 bins are kept
+	size_t speedNFFT = 8;          // Doppler bins (window of sliding DFT)
+	double rangeBinWidth = 1.0;    // (m)
+
+	bool calcSpeed = true;         // Doppler processing, otherwise range profile is stored
+	bool calcRaw = true;           // maintain rawCube
+	bool calcCFAR = true;          // maintain cfarCube
+	bool requirePosChange = true;  // process only frames where platform moved
+	bool logCompress = false;      // range-Doppler maps stored in dB
+	bool decay = true;             // exponential decay of cubes
+	bool clutterEnable = false;    // clutter map subtraction before CFAR
+	float clutterAlpha = 0.05f;
+
+	size_t cfarTraining = 10;
+	size_t cfarGuard = 2;
+	double cfarPfa = 1e-3;
+
+	size_t batchSize = 6;          // frames per cube update
+	size_t ringSize = 64;          // capacity of every ring
+
+	bool shedding = true;          // load shedding under backpressure
+	double shedHighWater = 0.5;    // ring fill raising shed level
+	double shedLowWater = 0.125;   // ring fill allowing to lower it
+
+	int yawBinMin = 0;             // yaw bins may start below 0 for sector over 0 deg
+	int yawBinMax = 359;
+	int pitchBinMin = -20;
+	int pitchBinMax = 60;
+	size_t rangeBinMin = 0;        // range gate, first kept bin of range FFT
+	size_t rangeBinCount = 0;      // kept bins, 0 = up to rangeNFFT/2
+	bool roiGating = false;        // chirps outside yaw/pitch bins are dropped before range FFT,
+	                               // otherwise they are clamped to edge bins
+
+	std::vector<float> spreadPattern; // [patternYaw x patternPitch], empty = single cell update
+	size_t patternYaw = 0;
+	size_t patternPitch = 0;
+	size_t dirtyTileSize = 8;      // yaw and pitch cells per tile of dirty bitmap taken by poll
+
+	std::string rawCubePath;
+	std::string cfarCubePath;
+	std::string clutterCubePath;
+
+	size_t streams = 1;            // radar streams, each with own ingest, range FFT and Doppler thread
+	std::vector<double> mountYaw;  // offset of every stream added to platform pose (deg), missing = 0
+	std::vector<double> mountPitch;
+
+	int affinity[4] = {-1, -1, -1, -1}; // cores for range, Doppler, CFAR and cube stage
+	                                    // further streams take cores following the cube stage
+	int poseInterpolation = POSE_LINEAR; // chirps pushed without pose are looked up in pose timeline
+	bool metrics = false;          // latency histograms, can be switched while running
+
+	size_t rangeBins() const
+	{
+		size_t left = rangeBinMin < rangeNFFT / 2 ? rangeNFFT / 2 - rangeBinMin : 0;
+		return rangeBinCount ? std::min(rangeBinCount, left) : left;
+	}
+	size_t dopplerBins() const { return calcSpeed ? speedNFFT : 1; }
+	size_t yawBins() const { return (size_t)(yawBinMax - yawBinMin + 1); }
+	size_t pitchBins() const { return (size_t)(pitchBinMax - pitchBinMin + 1); }
+};
+
+// ROI of [processing] roiYawMin..roiRangeMax settings: sector (deg), yawMin
+// may be negative for sector over 0 deg, and range gate (m), rangeMax 0 = up
+// to the last bin. Needs rangeNFFT and rangeBinWidth, same as
+// preferences.getProcessingROI.
+inline void setRegionOfInterest(PipelineConfig& cfg, double yawMin, double yawMax, double pitchMin, double pitchMax,
+		double rangeMin, double rangeMax)
+{
+	cfg.roiGating = true;
+	cfg.yawBinMin = (int)std::lround(yawMin);
+	cfg.yawBinMax = std::min((int)std::lround(yawMax), cfg.yawBinMin + 359);
+	cfg.pitchBinMin = (int)std::lround(pitchMin);
+	cfg.pitchBinMax = (int)std::lround(pitchMax);
+	const size_t last = std::max<size_t>(cfg.rangeNFFT / 2, 1) - 1;
+	cfg.rangeBinMin = std::min((size_t)std::max(std::floor(rangeMin / cfg.rangeBinWidth), 0.0), last);
+	size_t rangeBinMax = rangeMax > 0 ?
+		std::min((size_t)std::max(std::ceil(rangeMax / cfg.rangeBinWidth), 0.0), last) : last;
+	cfg.rangeBinCount = std::max(rangeBinMax, cfg.rangeBinMin) - cfg.rangeBinMin + 1;
+}
+
+struct PipelineStats {
+	std::atomic<uint64_t> pushed{0};          // chirps offered to ingest
+	std::atomic<uint64_t> droppedIngest{0};   // ingest ring full
+	std::atomic<uint64_t> rangeProcessed{0};
+	std::atomic<uint64_t> droppedRange{0};    // Doppler ring full
+	std::atomic<uint64_t> dopplerProcessed{0};
+	std::atomic<uint64_t> skippedStatic{0};   // platform didn't move (requirePosChange)
+	std::atomic<uint64_t> droppedDoppler{0};  // CFAR ring full
+	std::atomic<uint64_t> cfarProcessed{0};
+	std::atomic<uint64_t> droppedCfar{0};     // cube ring full
+	std::atomic<uint64_t> cubeFrames{0};      // frames written to cubes
+	std::atomic<uint64_t> coalesced{0};       // frames merged with newer frame of the same cell
+	std::atomic<uint64_t> skippedDoppler{0};  // frames without range-Doppler map
+	std::atomic<uint64_t> skippedRaw{0};      // frames not written to raw cube
+	std::atomic<uint64_t> outsideRoi{0};      // chirps outside yaw/pitch bins (roiGating)
+
+	void reset()
+	{
+		for (std::atomic<uint64_t>* c : {&pushed, &droppedIngest, &rangeProcessed, &droppedRange,
+				&dopplerProcessed, &skippedStatic, &droppedDoppler, &cfarProcessed, &droppedCfar, &cubeFrames,
+				&coalesced, &skippedDoppler, &skippedRaw, &outsideRoi})
+			c->store(0, std::memory_order_relaxed);
+	}
+};
+
+enum PipelineLatency {
+	LATENCY_INGEST = 0, // wait in ingest ring
+	LATENCY_RANGE,      // range FFT
+	LATENCY_DOPPLER,    // sliding DFT and range-Doppler map
+	LATENCY_CFAR,       // clutter map and CFAR
+	LATENCY_CUBE,       // cube update of one batch
+	LATENCY_HANDOFF,    // finished cube update until MATLAB polled it
+	LATENCY_COUNT
+};
+
+static const char* const pipelineLatencyNames[LATENCY_COUNT] = {
+	"ingest", "rangeFFT", "doppler", "cfar", "cubeUpdate", "handoff"};
+
+struct PipelineMetrics {
+	std::atomic<bool> enabled{false};
+	LatencyHistogram latency[LATENCY_COUNT];
+
+	bool on() const
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	void reset()
+	{
+		for (LatencyHistogram& h : latency)
+			h.reset();
+	}
+};
+
+// y *= factor over n elements
+inline void pipelineScale(float* y, float factor, size_t n)
+{
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256 f = _mm256_set1_ps(factor);
+	for (; i + 7 < n; i += 8)
+		_mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), f));
+#endif
+	for (; i < n; i++)
+		y[i] *= factor;
+}
+
+// y += a*x over n elements
+inline void pipelineAxpy(float* y, const float* x, float a, size_t n)
+{
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256 va = _mm256_set1_ps(a);
+	for (; i + 7 < n; i += 8)
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(va, _mm256_loadu_ps(x + i))));
+#endif
+	for (; i < n; i++)
+		y[i] += a * x[i];
+}
+
+// Shared file mapping of cube file allocated by radarDataCube
+class MappedCube {
+	public:
+		float* data = nullptr;
+		size_t elements = 0;
+
+		MappedCube() = default;
+		MappedCube(const MappedCube&) = delete;
+		MappedCube& operator=(const MappedCube&) = delete;
+		~MappedCube() { close(); }
+
+		void open(const std::string& path, size_t numElements)
+		{
+			close();
+			int fd = ::open(path.c_str(), O_RDWR);
+			if (fd < 0)
+				throw std::runtime_error("Failed to open cube file " + path);
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size < numElements * sizeof(float)) {
+				::close(fd);
+				throw std::runtime_error("Cube file " + path + " is smaller than cube");
+			}
+			void* p = mmap(nullptr, numElements * sizeof(float), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (p == MAP_FAILED)
+				throw std::runtime_error("Failed to map cube file " + path);
+			data = (float*)p;
+			elements = numElements;
+		}
+
+		void close()
+		{
+			if (data)
+				munmap(data, elements * sizeof(float));
+			data = nullptr;
+			elements = 0;
+		}
+};
+
+struct ChirpSlot {
+	uint64_t id = 0;
+	double time = 0;       // (s)
+	double yaw = 0;        // (deg)
+	double pitch = 0;      // (deg)
+	bool hasPose = false;  // false = pose is looked up from timeline by range stage
+	double pushTime = 0;   // steady clock at push, 0 when metrics are off
+	size_t samples = 0;
+	std::vector<float> i;
+	std::vector<float> q;
+};
+
+struct RangeSlot {
+	uint64_t id = 0;
+	double time = 0;
+	double yaw = 0;
+	double pitch = 0;
+	bool restart = false;  // chirps outside ROI preceded this one, sliding DFT starts over
+	std::vector<float> re; // [rangeBins], range gate of range FFT
+	std::vector<float> im;
+};
+
+struct FrameSlot {
+	uint64_t id = 0;
+	double time = 0;
+	double yaw = 0;
+	double pitch = 0;
+	float decay = 1.0f;
+	bool hasDoppler = true;          // rangeDoppler is valid, false when Doppler was shed
+	std::vector<float> profile;      // power range profile with r^4 compensation [rangeBins]
+	std::vector<float> rangeDoppler; // [rangeBins x dopplerBins]
+	std::vector<float> cfar;         // [rangeBins]
+};
+
+// Rings of one radar stream, consumed by its range and Doppler thread
+struct StreamLane {
+	SPSCRing<ChirpSlot> ingest;
+	SPSCRing<RangeSlot> rangeRing;
+	SPSCRing<FrameSlot> detectionRing;
+	double mountYaw = 0;   // (deg)
+	double mountPitch = 0;
+};
+
+class RadarPipeline {
+	public:
+		PipelineStats stats;
+		BackpressureScheduler shedding;
+		PipelineMetrics metrics;
+
+		~RadarPipeline() { stop(); }
+
+		bool isRunning() const
+		{
+			return running.load(std::memory_order_acquire);
+		}
+
+		const PipelineConfig& getConfig() const
+		{
+			return config;
+		}
+
+		// timeline used for chirps pushed without pose, must outlive the pipeline
+		void setPoseTimeline(const PoseTimeline* timeline)
+		{
+			poses = timeline;
+		}
+
+		// Sector index following the cube it was opened on, updated by cube stage
+		// after every batch, nullptr detaches. Index must outlive the pipeline,
+		// update of closed index does nothing.
+		void setSectorIndex(SectorIndex* index)
+		{
+			sectorIndex.store(index, std::memory_order_release);
+		}
+
+		// Change detector compared with range profile of every frame written to
+		// the cubes, same lifetime rules as the sector index.
+		void setChangeDetector(ChangeDetector* detector)
+		{
+			changeDetector.store(detector, std::memory_order_release);
+		}
+
+		void start(const PipelineConfig& cfg)
+		{
+			stop();
+			config = cfg;
+			if (config.rangeNFFT < 2 || !isPowerOfTwo(config.rangeNFFT))
+				throw std::runtime_error("rangeNFFT must be a power of two.");
+			if (config.calcSpeed && config.speedNFFT == 0)
+				throw std::runtime_error("speedNFFT must be positive.");
+			if (config.batchSize == 0)
+				throw std::runtime_error("batchSize must be positive.");
+			if (!config.spreadPattern.empty() && config.spreadPattern.size() != config.patternYaw * config.patternPitch)
+				throw std::runtime_error("spread pattern doesn't match its dimensions.");
+			if (config.streams == 0)
+				throw std::runtime_error("streams must be positive.");
+			if (config.dirtyTileSize == 0)
+				throw std::runtime_error("dirtyTileSize must be positive.");
+			if (config.rangeBins() == 0)
+				throw std::runtime_error("range gate is outside of range FFT.");
+			if (config.yawBinMax < config.yawBinMin || config.pitchBinMax < config.pitchBinMin ||
+					(config.roiGating && config.yawBins() > 360))
+				throw std::runtime_error("yaw or pitch bins are out of order.");
+
+			const size_t R = config.rangeBins();
+			const size_t D = config.dopplerBins();
+			const size_t cells = config.yawBins() * config.pitchBins();
+			if (config.calcRaw)
+				rawCube.open(config.rawCubePath, R * D * cells);
+			if (config.calcCFAR)
+				cfarCube.open(config.cfarCubePath, R * cells);
+			if (config.clutterEnable)
+				clutterCube.open(config.clutterCubePath, R * cells);
+
+			allocate();
+			stats.reset();
+			metrics.reset();
+			metrics.enabled.store(config.metrics, std::memory_order_relaxed);
+			lastPolled = 0;
+			shedding.init(config.shedding, config.shedHighWater, config.shedLowWater, std::max<size_t>(config.ringSize / 2, 1));
+			generation.store(0, std::memory_order_relaxed);
+			batchDirty.init(config.yawBins(), config.pitchBins(), config.dirtyTileSize, R);
+			{
+				std::lock_guard<std::mutex> lock(dirtyMutex);
+				pendingDirty.init(config.yawBins(), config.pitchBins(), config.dirtyTileSize, R);
+			}
+			zeroRequested.store(false, std::memory_order_relaxed);
+
+			running.store(true, std::memory_order_release);
+			for (size_t k = 0; k < lanes.size(); k++) {
+				threads.emplace_back(&RadarPipeline::rangeStage, this, k);
+				threads.emplace_back(&RadarPipeline::dopplerStage, this, k);
+			}
+			threads.emplace_back(&RadarPipeline::cfarStage, this);
+			threads.emplace_back(&RadarPipeline::cubeStage, this);
+		}
+
+		void stop()
+		{
+			running.store(false, std::memory_order_release);
+			for (std::thread& t : threads)
+				t.join();
+			threads.clear();
+			rawCube.close();
+			cfarCube.close();
+			clutterCube.close();
+		}
+
+		// Offer one chirp to ingest ring, never blocks. Single producer, only one
+		// thread may push. Returns false if the chirp was dropped.
+		bool pushChirp(const float* i, const float* q, size_t n, double time, double yaw, double pitch)
+		{
+			return pushChirp(0, i, q, n, time, yaw, pitch, true);
+		}
+
+		// chirp whose pose is interpolated from pose timeline at its timestamp
+		bool pushChirp(const float* i, const float* q, size_t n, double time)
+		{
+			return pushChirp(0, i, q, n, time, 0.0, 0.0, false);
+		}
+
+		// chirp of stream < streams, yaw and pitch are platform pose, mounting
+		// offset of the stream is added by its range stage. Every stream has
+		// its own ingest ring, so each may be pushed by a different thread.
+		bool pushChirp(size_t stream, const float* i, const float* q, size_t n, double time, double yaw, double pitch)
+		{
+			return pushChirp(stream, i, q, n, time, yaw, pitch, true);
+		}
+
+		bool pushChirp(size_t stream, const float* i, const float* q, size_t n, double time)
+		{
+			return pushChirp(stream, i, q, n, time, 0.0, 0.0, false);
+		}
+
+		size_t streamCount() const
+		{
+			return lanes.size();
+		}
+
+		// cubes are zeroed by cube stage before next batch is written
+		void requestZero()
+		{
+			zeroRequested.store(true, std::memory_order_release);
+		}
+
+		// number of finished cube updates and position of the last one
+		uint64_t getGeneration(double& yaw, double& pitch) const
+		{
+			uint64_t g = generation.load(std::memory_order_acquire);
+			yaw = lastYaw.load(std::memory_order_relaxed);
+			pitch = lastPitch.load(std::memory_order_relaxed);
+			return g;
+		}
+
+		// Tiles rewritten since the last take are moved to dirty, returned
+		// generation is the one they are complete for. Single poller.
+		uint64_t takeDirty(DirtyTiles& dirty)
+		{
+			std::lock_guard<std::mutex> lock(dirtyMutex);
+			dirty = pendingDirty;
+			pendingDirty.clear();
+			return generation.load(std::memory_order_acquire);
+		}
+
+		// records hand-off latency when poller sees new generation, single poller
+		void notePolled(uint64_t polled)
+		{
+			if (polled != lastPolled && metrics.on())
+				metrics.latency[LATENCY_HANDOFF].recordSeconds(steadySeconds() - generationTime.load(std::memory_order_relaxed));
+			if (polled != lastPolled) {
+				TraceRecorder& trace = TraceRecorder::instance();
+				static const uint16_t event = trace.name("polled");
+				trace.instant(event, polled);
+			}
+			lastPolled = polled;
+		}
+
+		size_t ingestOccupancy(size_t stream) const
+		{
+			return lanes[stream]->ingest.size();
+		}
+
+		// rings of several streams report the fullest one
+		size_t ringOccupancy(int ring) const
+		{
+			if (ring > 2)
+				return cubeRing.size();
+			size_t fill = 0;
+			for (const std::unique_ptr<StreamLane>& lane : lanes) {
+				switch (ring) {
+					case 0: fill = std::max(fill, lane->ingest.size()); break;
+					case 1: fill = std::max(fill, lane->rangeRing.size()); break;
+					default: fill = std::max(fill, lane->detectionRing.size()); break;
+				}
+			}
+			return fill;
+		}
+
+	private:
+		PipelineConfig config;
+		std::atomic<bool> running{false};
+		std::vector<std::thread> threads;
+
+		std::vector<std::unique_ptr<StreamLane>> lanes;
+		SPSCRing<FrameSlot> cubeRing;
+		std::atomic<bool> evaluating{false}; // range stage evaluating shed level
+		bool sharedStages = false;           // range and Doppler stage run per stream
+
+		MappedCube rawCube;
+		MappedCube cfarCube;
+		MappedCube clutterCube;
+
+		FFTPlan rangePlan;
+		std::vector<float> window;            // hann(samples)
+		std::vector<float> rangeCompensation; // (r*binWidth)^4
+		std::vector<float> batchWeights;      // prod(decay(i:end)) of current batch
+
+		std::atomic<uint64_t> generation{0};
+		std::atomic<double> lastYaw{0.0};
+		std::atomic<double> lastPitch{0.0};
+		std::atomic<bool> zeroRequested{false};
+		std::atomic<double> generationTime{0.0}; // steady clock of the last cube update
+		uint64_t lastPolled = 0;
+		const PoseTimeline* poses = nullptr;
+		std::atomic<SectorIndex*> sectorIndex{nullptr};
+		std::vector<SectorCell> sectorCells;
+		std::atomic<ChangeDetector*> changeDetector{nullptr};
+		std::vector<ChangeFrame> changeFrames;
+		DirtyTiles batchDirty;               // cube stage, tiles of batch being written
+		std::mutex dirtyMutex;               // pendingDirty and its generation
+		DirtyTiles pendingDirty;             // tiles of generations since last takeDirty
+
+		bool pushChirp(size_t stream, const float* i, const float* q, size_t n, double time, double yaw, double pitch, bool hasPose)
+		{
+			SPSCRing<ChirpSlot>& ingest = lanes[stream]->ingest;
+			TraceRecorder& trace = TraceRecorder::instance();
+			static const uint16_t event = trace.name("push");
+			uint64_t id = trace.on() ? trace.linkedId(time) : trace.nextChirpId();
+			trace.begin(event, id);
+			stats.pushed.fetch_add(1, std::memory_order_relaxed);
+			ChirpSlot* slot = ingest.claim();
+			if (!slot) {
+				stats.droppedIngest.fetch_add(1, std::memory_order_relaxed);
+				trace.end(event, id);
+				return false;
+			}
+			n = std::min(n, slot->i.size());
+			std::memcpy(slot->i.data(), i, n * sizeof(float));
+			std::memcpy(slot->q.data(), q, n * sizeof(float));
+			slot->samples = n;
+			slot->id = id;
+			slot->time = time;
+			slot->yaw = yaw;
+			slot->pitch = pitch;
+			slot->hasPose = hasPose;
+			slot->pushTime = metrics.on() ? steadySeconds() : 0.0;
+			ingest.publish();
+			trace.end(event, id);
+			return true;
+		}
+
+		void allocate()
+		{
+			const size_t R = config.rangeBins();
+			const size_t D = config.dopplerBins();
+
+			auto frame = [&](FrameSlot& s) {
+				s.profile.assign(R, 0.0f);
+				s.rangeDoppler.assign(R * D, 0.0f);
+				s.cfar.assign(R, 0.0f);
+			};
+			lanes.clear();
+			for (size_t k = 0; k < config.streams; k++) {
+				std::unique_ptr<StreamLane> lane(new StreamLane());
+				lane->ingest.init(config.ringSize);
+				lane->ingest.forEach([&](ChirpSlot& s) {
+					s.i.assign(config.samples, 0.0f);
+					s.q.assign(config.samples, 0.0f);
+				});
+				lane->rangeRing.init(config.ringSize);
+				lane->rangeRing.forEach([&](RangeSlot& s) {
+					s.re.assign(R, 0.0f);
+					s.im.assign(R, 0.0f);
+				});
+				lane->detectionRing.init(config.ringSize);
+				lane->detectionRing.forEach(frame);
+				lane->mountYaw = k < config.mountYaw.size() ? config.mountYaw[k] : 0.0;
+				lane->mountPitch = k < config.mountPitch.size() ? config.mountPitch[k] : 0.0;
+				lanes.push_back(std::move(lane));
+			}
+			sharedStages = lanes.size() > 1;
+			cubeRing.init(config.ringSize);
+			cubeRing.forEach(frame);
+
+			rangePlan.init(config.rangeNFFT);
+			window.resize(config.samples);
+			for (size_t k = 0; k < config.samples; k++) {
+				window[k] = config.samples > 1 ?
+					(float)(0.5 - 0.5 * std::cos(2.0 * M_PI * k / (config.samples - 1))) : 1.0f;
+			}
+			batchWeights.resize(config.batchSize);
+			rangeCompensation.resize(R);
+			for (size_t r = 0; r < R; r++) {
+				double d = (config.rangeBinMin + r) * config.rangeBinWidth;
+				rangeCompensation[r] = (float)(d * d * d * d);
+			}
+		}
+
+		// with roiGating yaw bins are a sector which may wrap over 0 deg, only
+		// chirps inside it get there
+		size_t yawIndex(double yaw) const
+		{
+			long idx = std::lround(yaw) - config.yawBinMin;
+			if (config.roiGating)
+				idx = (idx % 360 + 360) % 360;
+			return (size_t)std::min(std::max(idx, 0L), (long)config.yawBins() - 1);
+		}
+
+		bool insideRoi(double yaw, double pitch) const
+		{
+			long y = ((std::lround(yaw) - config.yawBinMin) % 360 + 360) % 360;
+			long p = std::lround(pitch) - config.pitchBinMin;
+			return y < (long)config.yawBins() && p >= 0 && p < (long)config.pitchBins();
+		}
+
+		size_t pitchIndex(double pitch) const
+		{
+			long idx = std::lround(pitch) - config.pitchBinMin;
+			return (size_t)std::min(std::max(idx, 0L), (long)config.pitchBins() - 1);
+		}
+
+		// core of range (stage 0) or Doppler (stage 1) thread of stream
+		int streamCore(size_t stream, int stage) const
+		{
+			if (stream == 0)
+				return config.affinity[stage];
+			return config.affinity[3] < 0 ? -1 : config.affinity[3] + (int)(2 * stream - 1) + stage;
+		}
+
+		std::string streamThreadName(const char* stage, size_t stream) const
+		{
+			return stream == 0 ? std::string(stage) : std::string(stage) + std::to_string(stream + 1);
+		}
+
+		// platform pose -> pose of the stream's antenna, yaw is kept in 0-360
+		void mount(const StreamLane& lane, double& yaw, double& pitch) const
+		{
+			if (lane.mountYaw != 0.0) {
+				yaw = std::fmod(yaw + lane.mountYaw, 360.0);
+				if (yaw < 0)
+					yaw += 360.0;
+			}
+			pitch += lane.mountPitch;
+		}
+
+		// shed level is evaluated by whichever range stage gets there first
+		void evaluateShedding()
+		{
+			if (evaluating.exchange(true, std::memory_order_acquire))
+				return;
+			double occupancy[BackpressureScheduler::numStages] = {
+				(double)ringOccupancy(1) / config.ringSize,
+				(double)ringOccupancy(2) / config.ringSize,
+				(double)cubeRing.size() / config.ringSize};
+			shedding.update(occupancy);
+			evaluating.store(false, std::memory_order_release);
+		}
+
+		// windowed range FFT of every chirp inside ROI, keeps range gate bins
+		void rangeStage(size_t stream)
+		{
+			pinThread(streamCore(stream, 0));
+			TraceRecorder& trace = TraceRecorder::instance();
+			trace.threadName(streamThreadName("rangeStage", stream));
+			const uint16_t event = trace.name("rangeFFT");
+			IdleBackoff backoff;
+			const size_t N = config.rangeNFFT;
+			const size_t R = config.rangeBins();
+			std::vector<float> re(N), im(N);
+			StreamLane& lane = *lanes[stream];
+			SPSCRing<ChirpSlot>& ingest = lane.ingest;
+			SPSCRing<RangeSlot>& rangeRing = lane.rangeRing;
+			bool outside = false;
+
+			while (running.load(std::memory_order_acquire)) {
+				ChirpSlot* in = ingest.peek();
+				if (!in) {
+					backoff.idle();
+					continue;
+				}
+				backoff.reset();
+				evaluateShedding();
+				bool measure = metrics.on();
+				double begin = measure ? steadySeconds() : 0.0;
+				if (measure && in->pushTime > 0)
+					metrics.latency[LATENCY_INGEST].recordSeconds(begin - in->pushTime, sharedStages);
+				trace.begin(event, in->id);
+
+				double yaw = in->yaw, pitch = in->pitch;
+				if (!in->hasPose && poses)
+					poses->at(in->time, yaw, pitch, config.poseInterpolation);
+				mount(lane, yaw, pitch);
+				if (config.roiGating && !insideRoi(yaw, pitch)) {
+					stats.outsideRoi.fetch_add(1, std::memory_order_relaxed);
+					outside = true;
+					trace.end(event, in->id);
+					ingest.release();
+					stats.rangeProcessed.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+
+				size_t n = std::min(in->samples, N);
+				for (size_t k = 0; k < n; k++) {
+					re[k] = in->i[k] * window[k];
+					im[k] = in->q[k] * window[k];
+				}
+				std::fill(re.begin() + n, re.end(), 0.0f);
+				std::fill(im.begin() + n, im.end(), 0.0f);
+				fftBatched(rangePlan, re.data(), im.data(), 1);
+
+				RangeSlot* out = rangeRing.claim();
+				if (out) {
+					out->id = in->id;
+					out->time = in->time;
+					out->yaw = yaw;
+					out->pitch = pitch;
+					out->restart = outside;
+					outside = false;
+					std::memcpy(out->re.data(), re.data() + config.rangeBinMin, R * sizeof(float));
+					std::memcpy(out->im.data(), im.data() + config.rangeBinMin, R * sizeof(float));
+					rangeRing.publish();
+				} else {
+					stats.droppedRange.fetch_add(1, std::memory_order_relaxed);
+				}
+				trace.end(event, in->id);
+				ingest.release();
+				stats.rangeProcessed.fetch_add(1, std::memory_order_relaxed);
+				if (measure)
+					metrics.latency[LATENCY_RANGE].recordSeconds(steadySeconds() - begin, sharedStages);
+			}
+		}
+
+		// sliding DFT over every chirp, range profile and range-Doppler power map
+		// for chirps where platform moved
+		void dopplerStage(size_t stream)
+		{
+			pinThread(streamCore(stream, 1));
+			TraceRecorder& trace = TraceRecorder::instance();
+			trace.threadName(streamThreadName("dopplerStage", stream));
+			const uint16_t event = trace.name("doppler");
+			IdleBackoff backoff;
+			const size_t R = config.rangeBins();
+			const size_t D = config.dopplerBins();
+			SlidingDFT sdft;
+			if (config.calcSpeed)
+				sdft.init(R, config.speedNFFT, config.speedNFFT, 1024);
+			std::vector<float> specRe(config.calcSpeed ? R * D : 0);
+			std::vector<float> specIm(config.calcSpeed ? R * D : 0);
+			bool first = true;
+			double prevYaw = 0, prevPitch = 0, prevTime = 0;
+			SPSCRing<RangeSlot>& rangeRing = lanes[stream]->rangeRing;
+			SPSCRing<FrameSlot>& detectionRing = lanes[stream]->detectionRing;
+			// utilization of the stage is mean over its threads
+			const double busyShare = 1.0 / lanes.size();
+
+			while (running.load(std::memory_order_acquire)) {
+				RangeSlot* in = rangeRing.peek();
+				if (!in) {
+					backoff.idle();
+					continue;
+				}
+				backoff.reset();
+				double begin = steadySeconds();
+				trace.begin(event, in->id);
+
+				// window would span the gap, Doppler starts over like after start
+				if (config.calcSpeed && in->restart)
+					sdft.init(R, config.speedNFFT, config.speedNFFT, 1024);
+				if (config.calcSpeed)
+					sdft.push(in->re.data(), in->im.data());
+
+				double diffYaw = std::fabs(std::fmod(in->yaw - prevYaw + 540.0, 360.0) - 180.0);
+				double diffPitch = in->pitch - prevPitch;
+				double distance = std::sqrt(diffYaw * diffYaw + diffPitch * diffPitch);
+				if (!first && config.requirePosChange && distance < 0.99) {
+					stats.skippedStatic.fetch_add(1, std::memory_order_relaxed);
+					trace.end(event, in->id);
+					rangeRing.release();
+					stats.dopplerProcessed.fetch_add(1, std::memory_order_relaxed);
+					double elapsed = steadySeconds() - begin;
+					shedding.addBusy(0, elapsed * busyShare);
+					if (metrics.on())
+						metrics.latency[LATENCY_DOPPLER].recordSeconds(elapsed, sharedStages);
+					continue;
+				}
+
+				FrameSlot* out = detectionRing.claim();
+				if (out) {
+					double speed = first ? 0.0 : distance / (in->time - prevTime + 1e-6);
+					out->id = in->id;
+					out->time = in->time;
+					out->yaw = in->yaw;
+					out->pitch = in->pitch;
+					out->decay = (float)std::exp(-speed / 500.0);
+					for (size_t r = 0; r < R; r++)
+						out->profile[r] = (in->re[r] * in->re[r] + in->im[r] * in->im[r]) * rangeCompensation[r];
+					// sliding DFT state is kept up to date, only the map is skipped
+					out->hasDoppler = !(config.calcRaw && config.calcSpeed && shedding.level() >= SHED_SKIP_DOPPLER);
+					if (!out->hasDoppler)
+						stats.skippedDoppler.fetch_add(1, std::memory_order_relaxed);
+					else if (config.calcRaw && config.calcSpeed) {
+						sdft.spectrumShifted(specRe.data(), specIm.data());
+						rangeDopplerPower(specRe.data(), specIm.data(), R, R, D,
+								rangeCompensation.data(), false, config.logCompress, out->rangeDoppler.data());
+					}
+					detectionRing.publish();
+				} else {
+					stats.droppedDoppler.fetch_add(1, std::memory_order_relaxed);
+				}
+				first = false;
+				prevYaw = in->yaw;
+				prevPitch = in->pitch;
+				prevTime = in->time;
+				trace.end(event, in->id);
+				rangeRing.release();
+				stats.dopplerProcessed.fetch_add(1, std::memory_order_relaxed);
+				double elapsed = steadySeconds() - begin;
+				shedding.addBusy(0, elapsed * busyShare);
+				if (metrics.on())
+					metrics.latency[LATENCY_DOPPLER].recordSeconds(elapsed, sharedStages);
+			}
+		}
+
+		// clutter map subtraction and CA-CFAR on range profile, merges streams
+		void cfarStage()
+		{
+			pinThread(config.affinity[2]);
+			TraceRecorder& trace = TraceRecorder::instance();
+			trace.threadName("cfarStage");
+			const uint16_t event = trace.name("cfar");
+			IdleBackoff backoff;
+			const size_t R = config.rangeBins();
+			const size_t yawBins = config.yawBins();
+			CACFAR detector;
+			detector.init(config.cfarTraining, config.cfarGuard, config.cfarPfa);
+			size_t next = 0;
+
+			while (running.load(std::memory_order_acquire)) {
+				// round robin, stream after the served one is asked first
+				SPSCRing<FrameSlot>* detectionRing = nullptr;
+				FrameSlot* in = nullptr;
+				for (size_t k = 0; k < lanes.size() && !in; k++) {
+					detectionRing = &lanes[next]->detectionRing;
+					next = (next + 1) % lanes.size();
+					in = detectionRing->peek();
+				}
+				if (!in) {
+					backoff.idle();
+					continue;
+				}
+				backoff.reset();
+				double begin = steadySeconds();
+				trace.begin(event, in->id);
+
+				if (config.clutterEnable) {
+					size_t cell = yawIndex(in->yaw) + pitchIndex(in->pitch) * yawBins;
+					clutterSubtract(clutterCube.data + cell * R, in->profile.data(), in->profile.data(), R, config.clutterAlpha);
+				}
+				if (config.calcCFAR)
+					detector.run(in->profile.data(), in->cfar.data(), R);
+				if (config.calcRaw && !config.calcSpeed)
+					std::memcpy(in->rangeDoppler.data(), in->profile.data(), R * sizeof(float));
+
+				trace.end(event, in->id);
+				FrameSlot* out = cubeRing.claim();
+				if (out) {
+					std::swap(*out, *in); // slots hold equally sized buffers, swap avoids copy
+					cubeRing.publish();
+				} else {
+					stats.droppedCfar.fetch_add(1, std::memory_order_relaxed);
+				}
+				detectionRing->release();
+				stats.cfarProcessed.fetch_add(1, std::memory_order_relaxed);
+				double elapsed = steadySeconds() - begin;
+				shedding.addBusy(1, elapsed);
+				if (metrics.on())
+					metrics.latency[LATENCY_CFAR].recordSeconds(elapsed);
+			}
+		}
+
+		// gathers frames to batches and writes them to cubes
+		void cubeStage()
+		{
+			pinThread(config.affinity[3]);
+			TraceRecorder& trace = TraceRecorder::instance();
+			trace.threadName("cubeStage");
+			const uint16_t batched = trace.name("batched");
+			const uint16_t coalesced = trace.name("coalesced");
+			const uint16_t update = trace.name("cubeUpdate");
+			IdleBackoff backoff;
+			const size_t R = config.rangeBins();
+			const size_t D = config.dopplerBins();
+			const size_t batch = config.batchSize;
+			// frames are swapped with ring slots, so they need same buffers
+			std::vector<FrameSlot> frames(batch);
+			for (FrameSlot& f : frames) {
+				f.profile.assign(R, 0.0f);
+				f.rangeDoppler.assign(R * D, 0.0f);
+				f.cfar.assign(R, 0.0f);
+			}
+			size_t fill = 0;
+
+			while (running.load(std::memory_order_acquire)) {
+				FrameSlot* in = cubeRing.peek();
+				if (!in) {
+					if (zeroRequested.load(std::memory_order_acquire) && fill == 0)
+						zeroCubes();
+					backoff.idle();
+					continue;
+				}
+				backoff.reset();
+				double begin = steadySeconds();
+
+				// newer frame of the same cell replaces the previous one, decay of
+				// the replaced frame is carried over so cube decays the same. Newer
+				// frame with Doppler shed keeps range-Doppler map of the older one
+				if (fill > 0 && shedding.level() >= SHED_COALESCE && sameCell(frames[fill - 1], *in)) {
+					float decay = frames[fill - 1].decay;
+					std::swap(frames[fill - 1], *in);
+					frames[fill - 1].decay *= decay;
+					if (!frames[fill - 1].hasDoppler && in->hasDoppler) {
+						std::swap(frames[fill - 1].rangeDoppler, in->rangeDoppler);
+						frames[fill - 1].hasDoppler = true;
+					}
+					stats.coalesced.fetch_add(1, std::memory_order_relaxed);
+					trace.instant(coalesced, frames[fill - 1].id);
+				} else {
+					std::swap(frames[fill], *in);
+					trace.instant(batched, frames[fill].id);
+					fill++;
+				}
+				cubeRing.release();
+
+				if (fill == batch) {
+					double writeBegin = steadySeconds();
+					// ID of update is its generation, frames are linked by batched events
+					uint64_t nextGeneration = generation.load(std::memory_order_relaxed) + 1;
+					trace.begin(update, nextGeneration);
+					writeBatch(frames.data(), fill, shedding.level() >= SHED_SKIP_RAW);
+					trace.end(update, nextGeneration);
+					double written = steadySeconds();
+					if (metrics.on())
+						metrics.latency[LATENCY_CUBE].recordSeconds(written - writeBegin);
+					generationTime.store(written, std::memory_order_relaxed);
+					stats.cubeFrames.fetch_add(fill, std::memory_order_relaxed);
+					const FrameSlot& last = frames[fill - 1];
+					lastYaw.store(config.yawBinMin + (double)yawIndex(last.yaw), std::memory_order_relaxed);
+					lastPitch.store(config.pitchBinMin + (double)pitchIndex(last.pitch), std::memory_order_relaxed);
+					{
+						std::lock_guard<std::mutex> lock(dirtyMutex);
+						pendingDirty.merge(batchDirty);
+						generation.fetch_add(1, std::memory_order_release);
+					}
+					batchDirty.clear();
+					fill = 0;
+				}
+				shedding.addBusy(2, steadySeconds() - begin);
+			}
+		}
+
+		bool sameCell(const FrameSlot& a, const FrameSlot& b) const
+		{
+			return yawIndex(a.yaw) == yawIndex(b.yaw) && pitchIndex(a.pitch) == pitchIndex(b.pitch);
+		}
+
+		void zeroCubes()
+		{
+			zeroRequested.store(false, std::memory_order_relaxed);
+			if (rawCube.data)
+				std::memset(rawCube.data, 0, rawCube.elements * sizeof(float));
+			if (cfarCube.data)
+				std::memset(cfarCube.data, 0, cfarCube.elements * sizeof(float));
+			if (SectorIndex* index = sectorIndex.load(std::memory_order_acquire))
+				index->reset();
+			batchDirty.markAll();
+		}
+
+		// same update as radarDataCube.processBatch: whole cube decays by product of
+		// batch decays, contribution of frame i is scaled by prod(decay(i:end)).
+		// With skipRaw raw cube is left as is (neither decayed nor written).
+		void writeBatch(const FrameSlot* frames, size_t n, bool skipRaw)
+		{
+			if (zeroRequested.load(std::memory_order_acquire))
+				zeroCubes();
+
+			const size_t R = config.rangeBins();
+			const size_t D = config.dopplerBins();
+			const size_t RD = R * D;
+			const size_t yawBins = config.yawBins();
+			const size_t pitchBins = config.pitchBins();
+
+			std::vector<float>& weights = batchWeights;
+			float acc = 1.0f;
+			for (size_t k = n; k-- > 0;) {
+				acc *= config.decay ? frames[k].decay : 1.0f;
+				weights[k] = acc;
+			}
+
+			float* raw = skipRaw ? nullptr : rawCube.data;
+			if (rawCube.data && skipRaw)
+				stats.skippedRaw.fetch_add(n, std::memory_order_relaxed);
+
+			if (config.decay) {
+				if (raw)
+					pipelineScale(raw, weights[0], rawCube.elements);
+				if (cfarCube.data)
+					pipelineScale(cfarCube.data, weights[0], cfarCube.elements);
+			}
+
+			for (size_t k = 0; k < n; k++) {
+				const FrameSlot& f = frames[k];
+				size_t yawIdx = yawIndex(f.yaw);
+				size_t pitchIdx = pitchIndex(f.pitch);
+
+				if (!f.hasDoppler) {
+					// CFAR only, raw cell keeps its previous (decayed) content
+				} else if (raw && config.spreadPattern.empty()) {
+					float* dst = raw + (yawIdx + pitchIdx * yawBins) * RD;
+					// replaced content changes where old or new is nonzero
+					batchDirty.markCell(yawIdx, pitchIdx);
+					batchDirty.markNonzeroRange(dst, D);
+					batchDirty.markNonzeroRange(f.rangeDoppler.data(), D);
+					for (size_t i = 0; i < RD; i++)
+						dst[i] = f.rangeDoppler[i] * weights[k];
+				} else if (raw) {
+					batchDirty.markCell(yawIdx, pitchIdx, config.patternYaw, config.patternPitch);
+					batchDirty.markNonzeroRange(f.rangeDoppler.data(), D);
+					// yaw wraps around full circle, pitch and yaw sector are clipped
+					long halfYaw = (long)config.patternYaw / 2;
+					long halfPitch = (long)config.patternPitch / 2;
+					for (long p = 0; p < (long)config.patternPitch; p++) {
+						long pitch = (long)pitchIdx + p - halfPitch;
+						if (pitch < 0 || pitch >= (long)pitchBins)
+							continue;
+						for (long y = 0; y < (long)config.patternYaw; y++) {
+							long yaw = (long)yawIdx + y - halfYaw;
+							if (yawBins >= 360)
+								yaw = (yaw % (long)yawBins + (long)yawBins) % (long)yawBins;
+							else if (yaw < 0 || yaw >= (long)yawBins)
+								continue;
+							float w = config.spreadPattern[y + p * config.patternYaw] * weights[k];
+							pipelineAxpy(raw + (yaw + pitch * yawBins) * RD, f.rangeDoppler.data(), w, RD);
+						}
+					}
+				}
+
+				if (cfarCube.data) {
+					float* dst = cfarCube.data + (yawIdx + pitchIdx * yawBins) * R;
+					batchDirty.markCell(yawIdx, pitchIdx);
+					batchDirty.markNonzeroRange(dst, 1);
+					batchDirty.markNonzeroRange(f.cfar.data(), 1);
+					for (size_t i = 0; i < R; i++)
+						dst[i] = f.cfar[i] * weights[k];
+				}
+			}
+			updateSectorIndex(frames, n, raw != nullptr);
+
+			if (ChangeDetector* detector = changeDetector.load(std::memory_order_acquire)) {
+				changeFrames.clear();
+				for (size_t k = 0; k < n; k++)
+					changeFrames.push_back({yawIndex(frames[k].yaw), pitchIndex(frames[k].pitch), frames[k].time,
+						frames[k].profile.data()});
+				detector->process(changeFrames.data(), n);
+			}
+		}
+
+		// index of raw cube follows only batches written to it (skipRaw)
+		void updateSectorIndex(const FrameSlot* frames, size_t n, bool rawWritten)
+		{
+			SectorIndex* index = sectorIndex.load(std::memory_order_acquire);
+			if (!index)
+				return;
+			const bool raw = index->isRaw();
+			if (raw && !rawWritten)
+				return;
+			sectorCells.clear();
+			for (size_t k = 0; k < n; k++)
+				if (!raw || frames[k].hasDoppler)
+					sectorCells.push_back({yawIndex(frames[k].yaw), pitchIndex(frames[k].pitch)});
+			const bool spread = raw && !config.spreadPattern.empty();
+			index->update(config.decay ? batchWeights[0] : 1.0f, sectorCells,
+					spread ? config.patternYaw : 1, spread ? config.patternPitch : 1);
+		}
+};
+
+#endif /* !RADAR_PIPELINE_H */
@@ -0,0 +1,223 @@
+#ifndef RADAR_READER_H
+#define RADAR_READER_H
+
+#include "rawCapture.h"
+#include "serialPort.h"
+#include "spscRing.h"
+#include "traceRecorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Native reader of SiRad raw ADC frames
+//
+// Frame is 9 byte header with 'M' at offset 4, samples interleaved I/Q int16
+// little endian pairs and CR/LF, 4*samples + 11 bytes in total. Payload can
+// contain CR/LF itself, so frames are located by length and checked by header
+// and terminator, on mismatch reader resynchronizes after the next LF.
+//
+// Port is read in large blocks, VMIN is set to frame length (max 255) and
+// VTIME to 0.1 s so read returns once a good part of frame arrived. VMIN
+// read blocks until first byte comes, so it is entered only after poll()
+// reported data, idle line never keeps thread from stopping. Frame is
+// stamped with CLOCK_MONOTONIC of the read that delivered its last byte,
+// corrected by transfer time of bytes that followed it in the same block, and
+// pushed to lock-free queue. Full queue drops the frame and counts it. Every
+// frame gets chirp ID linked to its timestamp for tracing (traceRecorder.h).
+// Optional capture sink (rawCapture.h) is offered every frame before it is
+// queued.
+
+struct RadarFrame {
+	double time = 0; // MATLAB time base, completion of the frame
+	uint64_t id = 0; // chirp ID
+	std::vector<int16_t> i;
+	std::vector<int16_t> q;
+};
+
+struct RadarReaderStats {
+	std::atomic<uint64_t> bytes{0};
+	std::atomic<uint64_t> frames{0};
+	std::atomic<uint64_t> droppedFrames{0}; // queue full
+	std::atomic<uint64_t> skippedBytes{0};  // resynchronization, other replies
+};
+
+class RadarReader {
+	public:
+		RadarReaderStats stats;
+
+		~RadarReader() { stop(); }
+
+		bool isRunning() const
+		{
+			return running.load(std::memory_order_acquire);
+		}
+
+		size_t samples() const
+		{
+			return frameSamples;
+		}
+
+		static size_t frameLength(size_t samples)
+		{
+			return 4 * samples + 11;
+		}
+
+		// timeNow is current time in MATLAB time base (toc(startTime))
+		void start(const std::string& port, int baudrate, size_t samples, double timeNow, size_t queueSize = 256)
+		{
+			stop();
+			frameSamples = samples;
+			size_t length = frameLength(samples);
+			fd = openSerial(port, baudrate, (int)std::min<size_t>(length, 255), 1);
+			byteTime = 10.0 / baudrate; // 8N1
+			timeBase = timeNow - monotonicSeconds();
+			queue.init(queueSize);
+			queue.forEach([samples](RadarFrame& f) {
+				f.i.assign(samples, 0);
+				f.q.assign(samples, 0);
+			});
+			for (std::atomic<uint64_t>* c : {&stats.bytes, &stats.frames, &stats.droppedFrames, &stats.skippedBytes})
+				c->store(0, std::memory_order_relaxed);
+			running.store(true, std::memory_order_release);
+			thread = std::thread(&RadarReader::readLoop, this);
+		}
+
+		void stop()
+		{
+			running.store(false, std::memory_order_release);
+			if (thread.joinable())
+				thread.join();
+			if (fd >= 0)
+				::close(fd);
+			fd = -1;
+		}
+
+		// command line, CR/LF terminator is appended. Gateway and trigger
+		// thread both write, lines are never interleaved.
+		bool writeLine(const std::string& line)
+		{
+			std::lock_guard<std::mutex> lock(writeMutex);
+			if (fd < 0)
+				return false;
+			std::string out = line + "\r\n";
+			return writeAll(fd, out.data(), out.size());
+		}
+
+		// frames are offered to sink before they are queued, nullptr = none.
+		// Returns once reader no longer uses the previous sink.
+		void setCapture(RawCapture* sink)
+		{
+			capture.store(sink, std::memory_order_seq_cst);
+			while (capturing.load(std::memory_order_seq_cst))
+				std::this_thread::yield();
+		}
+
+		// consumer side, single consumer, returns nullptr if queue is empty
+		const RadarFrame* peek()
+		{
+			return queue.peek();
+		}
+
+		void release()
+		{
+			queue.release();
+		}
+
+		size_t pending() const
+		{
+			return queue.size();
+		}
+
+	private:
+		int fd = -1;
+		std::thread thread;
+		std::atomic<bool> running{false};
+		size_t frameSamples = 0;
+		double byteTime = 0;
+		double timeBase = 0;
+		SPSCRing<RadarFrame> queue;
+		std::atomic<RawCapture*> capture{nullptr};
+		std::atomic<bool> capturing{false}; // reader is inside capture offer
+		std::mutex writeMutex;
+
+		void readLoop()
+		{
+			TraceRecorder::instance().threadName("radarReader");
+			const size_t length = frameLength(frameSamples);
+			std::vector<uint8_t> buffer(std::max<size_t>(1 << 16, 4 * length));
+			size_t fill = 0;
+			struct pollfd pfd = {fd, POLLIN, 0};
+			while (running.load(std::memory_order_acquire)) {
+				if (::poll(&pfd, 1, 100) <= 0)
+					continue;
+				ssize_t n = ::read(fd, buffer.data() + fill, buffer.size() - fill);
+				if (n <= 0)
+					continue; // interrupted
+				double readTime = monotonicSeconds() + timeBase;
+				stats.bytes.fetch_add((uint64_t)n, std::memory_order_relaxed);
+				size_t blockStart = fill;
+				fill += (size_t)n;
+
+				size_t start = 0;
+				while (fill - start >= length) {
+					const uint8_t* f = buffer.data() + start;
+					if (f[4] == 'M' && f[length - 2] == '\r' && f[length - 1] == '\n') {
+						// bytes of this block received after the last byte of the frame
+						size_t last = start + length - 1;
+						size_t after = last >= blockStart ? fill - 1 - last : fill - blockStart;
+						deliver(f, readTime - (double)after * byteTime);
+						start += length;
+						continue;
+					}
+					// not a frame start, skip behind next LF
+					const uint8_t* lf = (const uint8_t*)std::memchr(f, '\n', fill - start);
+					size_t skip = lf ? (size_t)(lf - f) + 1 : fill - start;
+					stats.skippedBytes.fetch_add(skip, std::memory_order_relaxed);
+					start += skip;
+				}
+				if (start > 0) {
+					std::memmove(buffer.data(), buffer.data() + start, fill - start);
+					fill -= start;
+				}
+			}
+		}
+
+		void deliver(const uint8_t* f, double time)
+		{
+			TraceRecorder& trace = TraceRecorder::instance();
+			static const uint16_t event = trace.name("radarFrame");
+			uint64_t id = trace.nextChirpId();
+			trace.begin(event, id);
+			if (trace.on())
+				trace.link(time, id);
+			capturing.store(true, std::memory_order_seq_cst);
+			if (RawCapture* sink = capture.load(std::memory_order_seq_cst))
+				sink->offer(f + 9, frameSamples, time, id);
+			capturing.store(false, std::memory_order_release);
+			RadarFrame* slot = queue.claim();
+			if (!slot) {
+				trace.end(event, id);
+				stats.droppedFrames.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			const uint8_t* data = f + 9;
+			for (size_t k = 0; k < frameSamples; k++) {
+				slot->i[k] = (int16_t)(uint16_t)(data[4 * k] | (data[4 * k + 1] << 8));
+				slot->q[k] = (int16_t)(uint16_t)(data[4 * k + 2] | (data[4 * k + 3] << 8));
+			}
+			slot->time = time;
+			slot->id = id;
+			queue.publish();
+			stats.frames.fetch_add(1, std::memory_order_relaxed);
+			trace.end(event, id);
+		}
+};
+
+#endif /* !RADAR_READER_H */
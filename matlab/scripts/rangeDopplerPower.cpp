@@ -0,0 +1,47 @@
+#include "mex.h"
+#include "powerMap.h"
+
+// rangeDoppler = rangeDopplerPower(spectrum, rangeCompensation, shift, logCompress)
+//
+// spectrum ... complex single/double Doppler output [rangeNFFT x speedNFFT],
+//              only first numel(rangeCompensation) rows are used
+// rangeCompensation ... single r^4 table [rangeBins x 1]
+// shift ... apply fftshift along Doppler dimension
+// logCompress ... store 10*log10(1+power) instead of power
+//
+// Returns single [rangeBins x speedNFFT] map.
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	// Validate inputs
+	if (nrhs != 4) {
+		mexErrMsgTxt("Inputs required: spectrum, rangeCompensation, shift, logCompress");
+	}
+	if (!mxIsSingle(prhs[0]) && !mxIsDouble(prhs[0])) {
+		mexErrMsgTxt("spectrum must be single or double precision.");
+	}
+	if (!mxIsSingle(prhs[1])) {
+		mexErrMsgTxt("rangeCompensation must be single precision.");
+	}
+
+	mwSize inRows = mxGetM(prhs[0]);
+	mwSize cols = mxGetN(prhs[0]);
+	mwSize rows = mxGetNumberOfElements(prhs[1]);
+	bool shift = mxGetScalar(prhs[2]) != 0;
+	bool logCompress = mxGetScalar(prhs[3]) != 0;
+	const float* rangeCompensation = (const float*)mxGetData(prhs[1]);
+
+	if (rows > inRows) {
+		mexErrMsgTxt("rangeCompensation is longer than number of spectrum rows.");
+	}
+
+	plhs[0] = mxCreateNumericMatrix(rows, cols, mxSINGLE_CLASS, mxREAL);
+	float* out = (float*)mxGetData(plhs[0]);
+
+	if (mxIsSingle(prhs[0])) {
+		rangeDopplerPower((const float*)mxGetData(prhs[0]), (const float*)mxGetImagData(prhs[0]),
+				inRows, rows, cols, rangeCompensation, shift, logCompress, out);
+	} else {
+		rangeDopplerPower(mxGetPr(prhs[0]), mxGetPi(prhs[0]),
+				inRows, rows, cols, rangeCompensation, shift, logCompress, out);
+	}
+}
@@ -0,0 +1,439 @@
+#ifndef RAW_CAPTURE_H
+#define RAW_CAPTURE_H
+
+#include "poseTimeline.h"
+#include "serialPort.h"
+#include "spscRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Raw I/Q capture of radar frames for offline reprocessing
+//
+// Native radar reader offers every frame it assembled before queueing it for
+// MATLAB. Payload (int16 I/Q little endian pairs exactly as sent by radar) is
+// copied to a preallocated slot of lock-free queue, full queue drops the frame
+// and counts it, so capture never blocks the reader. Writer thread takes
+// frames from the queue, looks up interpolated platform pose at receive time
+// (waiting at most poseWait for platform to report poses past it) and copies
+// them to the mapped segment file.
+//
+// Capture is a sequence of segment files <dir>/<yyyymmddThhmmss>_<n>.iq.
+// Segment is preallocated with posix_fallocate and mapped MAP_SHARED, so
+// writing a record never allocates disk and can't fault on full disk. When
+// segment can't be allocated (disk full, maxSegments reached) frames are
+// counted as dropped and allocation is retried every second. Segment layout:
+//
+//   CaptureHeader        4096 bytes
+//   CaptureIndexEntry    [capacity], fixed size, time and pose of record k
+//   records              [capacity x 4*samples] from dataOffset (page aligned)
+//
+// Header count is stored with release after index entry and record, so
+// segment being written can be read up to count. Closed segment has closed
+// set and is truncated behind its last record.
+
+struct CaptureHeader {
+	static constexpr uint32_t currentVersion = 1;
+	static constexpr size_t bytes = 4096;
+
+	char magic[8];                // "FMCWIQ"
+	uint32_t version;
+	uint32_t samples;             // per chirp
+	uint64_t segment;             // index of segment in capture
+	uint64_t capacity;            // records segment has room for
+	std::atomic<uint64_t> count;  // records written
+	uint32_t closed;              // 1 once capture finished the segment
+	uint32_t reserved;
+	uint64_t indexOffset;         // bytes from file start
+	uint64_t dataOffset;
+	uint64_t recordBytes;         // 4*samples
+	int64_t startTime;            // unix time capture was opened (s)
+	double bandwidth;             // (MHz)
+	double frontend;              // (GHz)
+	double chirpPeriod;           // trigger period (s)
+};
+
+static_assert(sizeof(CaptureHeader) <= CaptureHeader::bytes, "capture header exceeds its page");
+
+enum CaptureFlags {
+	CAPTURE_POSE = 1 // yaw and pitch were interpolated from pose timeline
+};
+
+struct CaptureIndexEntry {
+	double time;       // receive time, MATLAB time base (s)
+	double yaw;        // platform pose (deg)
+	double pitch;
+	uint64_t id;       // chirp ID
+	uint32_t flags;    // CaptureFlags
+	uint32_t reserved;
+};
+
+struct CaptureConfig {
+	std::string dir;
+	size_t samples = 128;
+	size_t segmentRecords = 65536; // records per segment file
+	size_t maxSegments = 0;        // 0 = unlimited
+	size_t queueSize = 1024;       // frames between reader and writer
+	double poseWait = 0.25;        // longest wait for poses past frame (s)
+	int poseInterpolation = POSE_LINEAR;
+	double bandwidth = 0;          // stored in header for reprocessing
+	double frontend = 0;
+	double chirpPeriod = 0;
+};
+
+struct CaptureStats {
+	std::atomic<uint64_t> offered{0};
+	std::atomic<uint64_t> written{0};
+	std::atomic<uint64_t> droppedQueue{0}; // writer behind, queue full
+	std::atomic<uint64_t> droppedDisk{0};  // no segment (disk full, maxSegments)
+	std::atomic<uint64_t> withoutPose{0};  // pose timeline was empty
+	std::atomic<uint64_t> segments{0};
+	std::atomic<uint64_t> bytes{0};        // allocated by segments
+	std::atomic<uint64_t> truncateFailed{0}; // closed segment kept its full size
+};
+
+struct CaptureSlot {
+	double time = 0;
+	double arrival = 0; // monotonic time of offer
+	uint64_t id = 0;
+	std::vector<uint8_t> data;
+};
+
+class RawCapture {
+	public:
+		CaptureStats stats;
+
+		RawCapture() = default;
+		RawCapture(const RawCapture&) = delete;
+		RawCapture& operator=(const RawCapture&) = delete;
+		~RawCapture() { close(); }
+
+		bool isOpen() const
+		{
+			return running.load(std::memory_order_acquire);
+		}
+
+		// timeline the pose of frames is interpolated from, must outlive capture
+		void setPoseTimeline(const PoseTimeline* timeline)
+		{
+			poses = timeline;
+		}
+
+		void open(const CaptureConfig& cfg)
+		{
+			close();
+			if (cfg.samples == 0 || cfg.segmentRecords == 0)
+				throw std::runtime_error("Capture needs samples and segmentRecords.");
+			struct stat st;
+			if (stat(cfg.dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+				throw std::runtime_error("Capture directory " + cfg.dir + " doesn't exist.");
+			config = cfg;
+			recordBytes = 4 * config.samples;
+			indexOffset = CaptureHeader::bytes;
+			size_t page = (size_t)sysconf(_SC_PAGESIZE);
+			dataOffset = (indexOffset + config.segmentRecords * sizeof(CaptureIndexEntry) + page - 1) / page * page;
+			segmentBytes = dataOffset + config.segmentRecords * recordBytes;
+
+			startTime = (int64_t)std::time(nullptr);
+			time_t t = (time_t)startTime;
+			struct tm local;
+			localtime_r(&t, &local);
+			char stamp[32];
+			std::strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%S", &local);
+			prefix = config.dir + "/" + stamp;
+			// capture reopened within the same second doesn't overwrite the previous one
+			for (int k = 1; stat((prefix + "_000000.iq").c_str(), &st) == 0; k++)
+				prefix = config.dir + "/" + stamp + "-" + std::to_string(k);
+
+			queue.init(config.queueSize);
+			queue.forEach([this](CaptureSlot& s) { s.data.assign(recordBytes, 0); });
+			for (std::atomic<uint64_t>* c : {&stats.offered, &stats.written, &stats.droppedQueue,
+					&stats.droppedDisk, &stats.withoutPose, &stats.segments, &stats.bytes, &stats.truncateFailed})
+				c->store(0, std::memory_order_relaxed);
+			nextSegment = 0;
+			retryAt = 0;
+			running.store(true, std::memory_order_release);
+			writer = std::thread(&RawCapture::writeLoop, this);
+		}
+
+		// queued frames are written before segment is closed
+		void close()
+		{
+			running.store(false, std::memory_order_release);
+			if (writer.joinable())
+				writer.join();
+			finishSegment();
+		}
+
+		size_t samples() const
+		{
+			return config.samples;
+		}
+
+		// path of segment n is prefix_n.iq
+		const std::string& pathPrefix() const
+		{
+			return prefix;
+		}
+
+		size_t pending() const
+		{
+			return queue.size();
+		}
+
+		// producer side (radar reader), never blocks, false if frame was dropped
+		bool offer(const uint8_t* payload, size_t samples, double time, uint64_t id)
+		{
+			if (!isOpen())
+				return false;
+			stats.offered.fetch_add(1, std::memory_order_relaxed);
+			CaptureSlot* slot = queue.claim();
+			if (!slot) {
+				stats.droppedQueue.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			size_t n = std::min(4 * samples, recordBytes);
+			std::memcpy(slot->data.data(), payload, n);
+			std::memset(slot->data.data() + n, 0, recordBytes - n);
+			slot->time = time;
+			slot->id = id;
+			slot->arrival = monotonicSeconds();
+			queue.publish();
+			return true;
+		}
+
+	private:
+		CaptureConfig config;
+		std::atomic<bool> running{false};
+		std::thread writer;
+		SPSCRing<CaptureSlot> queue;
+		const PoseTimeline* poses = nullptr;
+
+		size_t recordBytes = 0;
+		size_t indexOffset = 0;
+		size_t dataOffset = 0;
+		size_t segmentBytes = 0;
+		int64_t startTime = 0;
+		std::string prefix;
+
+		int fd = -1;
+		uint8_t* segment = nullptr;  // mapping of current segment
+		size_t nextSegment = 0;
+		double retryAt = 0;          // monotonic time of next allocation attempt
+
+		CaptureHeader* header() const
+		{
+			return (CaptureHeader*)segment;
+		}
+
+		void writeLoop()
+		{
+			IdleBackoff backoff;
+			for (;;) {
+				CaptureSlot* in = queue.peek();
+				if (!in) {
+					if (!running.load(std::memory_order_acquire))
+						break;
+					backoff.idle();
+					continue;
+				}
+				backoff.reset();
+
+				// platform reports poses with its own delay, frame waits for the
+				// pose past it unless capture is closing
+				double poseTime;
+				if (poses && poses->newest(poseTime) && poseTime < in->time &&
+						monotonicSeconds() - in->arrival < config.poseWait &&
+						running.load(std::memory_order_acquire)) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					continue;
+				}
+				write(*in);
+				queue.release();
+			}
+		}
+
+		void write(const CaptureSlot& in)
+		{
+			if (!ensureSegment()) {
+				stats.droppedDisk.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			CaptureHeader* h = header();
+			uint64_t k = h->count.load(std::memory_order_relaxed);
+			CaptureIndexEntry& e = ((CaptureIndexEntry*)(segment + indexOffset))[k];
+			e.time = in.time;
+			e.id = in.id;
+			e.flags = 0;
+			e.yaw = 0;
+			e.pitch = 0;
+			if (poses && poses->at(in.time, e.yaw, e.pitch, config.poseInterpolation))
+				e.flags |= CAPTURE_POSE;
+			else
+				stats.withoutPose.fetch_add(1, std::memory_order_relaxed);
+			std::memcpy(segment + dataOffset + k * recordBytes, in.data.data(), recordBytes);
+			h->count.store(k + 1, std::memory_order_release);
+			stats.written.fetch_add(1, std::memory_order_relaxed);
+			if (k + 1 == h->capacity)
+				finishSegment();
+		}
+
+		// current segment with free record, opens next one when needed
+		bool ensureSegment()
+		{
+			if (segment)
+				return true;
+			if (config.maxSegments > 0 && nextSegment >= config.maxSegments)
+				return false;
+			double now = monotonicSeconds();
+			if (now < retryAt)
+				return false;
+
+			char suffix[32];
+			std::snprintf(suffix, sizeof(suffix), "_%06zu.iq", nextSegment);
+			std::string path = prefix + suffix;
+			fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0) {
+				retryAt = now + 1.0;
+				return false;
+			}
+			void* p = MAP_FAILED;
+			if (posix_fallocate(fd, 0, (off_t)segmentBytes) == 0)
+				p = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (p == MAP_FAILED) {
+				::close(fd);
+				fd = -1;
+				unlink(path.c_str());
+				retryAt = now + 1.0;
+				return false;
+			}
+			segment = (uint8_t*)p;
+			madvise(segment + dataOffset, segmentBytes - dataOffset, MADV_SEQUENTIAL);
+
+			CaptureHeader* h = header();
+			std::memset(segment, 0, CaptureHeader::bytes);
+			std::memcpy(h->magic, "FMCWIQ", 7);
+			h->version = CaptureHeader::currentVersion;
+			h->samples = (uint32_t)config.samples;
+			h->segment = nextSegment;
+			h->capacity = config.segmentRecords;
+			h->indexOffset = indexOffset;
+			h->dataOffset = dataOffset;
+			h->recordBytes = recordBytes;
+			h->startTime = startTime;
+			h->bandwidth = config.bandwidth;
+			h->frontend = config.frontend;
+			h->chirpPeriod = config.chirpPeriod;
+			h->count.store(0, std::memory_order_release);
+
+			nextSegment++;
+			stats.segments.fetch_add(1, std::memory_order_relaxed);
+			stats.bytes.fetch_add(segmentBytes, std::memory_order_relaxed);
+			return true;
+		}
+
+		// writeback is left to the kernel, unused records are cut off
+		void finishSegment()
+		{
+			if (!segment)
+				return;
+			CaptureHeader* h = header();
+			uint64_t count = h->count.load(std::memory_order_relaxed);
+			h->closed = 1;
+			msync(segment, segmentBytes, MS_ASYNC);
+			munmap(segment, segmentBytes);
+			segment = nullptr;
+			// full size file is still valid, count tells how much of it is used
+			if (count < config.segmentRecords && ftruncate(fd, (off_t)(dataOffset + count * recordBytes)) != 0)
+				stats.truncateFailed.fetch_add(1, std::memory_order_relaxed);
+			::close(fd);
+			fd = -1;
+		}
+};
+
+// Read-only mapping of one segment file, records [0, count()) are valid
+class CaptureSegment {
+	public:
+		CaptureSegment() = default;
+		CaptureSegment(const CaptureSegment&) = delete;
+		CaptureSegment& operator=(const CaptureSegment&) = delete;
+		~CaptureSegment() { close(); }
+
+		void open(const std::string& path)
+		{
+			close();
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::runtime_error("Failed to open capture segment " + path);
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size < CaptureHeader::bytes) {
+				::close(fd);
+				throw std::runtime_error(path + " is not a capture segment.");
+			}
+			void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (p == MAP_FAILED)
+				throw std::runtime_error("Failed to map capture segment " + path);
+			data = (const uint8_t*)p;
+			bytes = (size_t)st.st_size;
+			const CaptureHeader& h = header();
+			if (std::memcmp(h.magic, "FMCWIQ", 7) != 0 || h.version != CaptureHeader::currentVersion) {
+				close();
+				throw std::runtime_error(path + " is not a capture segment of known version.");
+			}
+			// count of segment still being written is limited by what the file holds
+			records = std::min<uint64_t>(h.count.load(std::memory_order_acquire), h.capacity);
+			if (h.recordBytes > 0 && bytes < h.dataOffset + records * h.recordBytes)
+				records = bytes > h.dataOffset ? (bytes - h.dataOffset) / h.recordBytes : 0;
+		}
+
+		void close()
+		{
+			if (data)
+				munmap((void*)data, bytes);
+			data = nullptr;
+			bytes = 0;
+			records = 0;
+		}
+
+		const CaptureHeader& header() const
+		{
+			return *(const CaptureHeader*)data;
+		}
+
+		size_t count() const
+		{
+			return records;
+		}
+
+		const CaptureIndexEntry& entry(size_t k) const
+		{
+			return ((const CaptureIndexEntry*)(data + header().indexOffset))[k];
+		}
+
+		// I/Q int16 little endian pairs, samples() of them
+		const int16_t* record(size_t k) const
+		{
+			return (const int16_t*)(data + header().dataOffset + k * header().recordBytes);
+		}
+
+	private:
+		const uint8_t* data = nullptr;
+		size_t bytes = 0;
+		size_t records = 0;
+};
+
+#endif /* !RAW_CAPTURE_H */
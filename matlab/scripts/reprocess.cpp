@@ -0,0 +1,690 @@
+#include "iniFile.h"
+#include "radarPipeline.h"
+#include "rawCapture.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Offline reprocessing of raw I/Q captures (rawCapture.h)
+//
+//   reprocess [options] segment.iq...
+//
+// Chirps of the capture are run through the same range FFT, sliding DFT,
+// clutter map, CFAR and cube update as the native pipeline with [processing]
+// settings of fmcw.conf overridden from command line, so a parameter sweep
+// runs far faster than live replay. Records are split into --segments runs of
+// consecutive chirps which are processed on all cores, the sliding DFT of
+// each run is warmed up with the chirps preceding it.
+//
+// Cube update is multiplication of the whole cube by frame decay followed by
+// writing (or adding, with spread pattern) the frame scaled by its decay.
+// Which frames are processed and their decays depend only on poses, so they
+// are settled by a cheap sequential pass first. Run then keeps only cells it
+// touched, each with the product of decays at its last update (log of it,
+// zeroing of yaw triggered decay counts as epoch), and scales them to the end
+// of the run lazily. Runs are merged in time order the same way, cells of the
+// merged cube are brought to the end of the run and written or added, so no
+// step touches the whole cube. Result is the same for any number of threads,
+// for another --segments it differs only by rounding. Clutter map depends on
+// every earlier visit of the cell, so with clutterEnable clutter and CFAR run
+// sequentially over profiles the runs left.
+//
+// Options:
+//   --conf path        fmcw.conf, [processing] settings and [radar] bandwidth
+//                      used when segment header has none
+//   --set key=value    overrides [processing] key, may repeat
+//   --from s, --to s   time window (capture time base)
+//   --segments n       runs merged in time order (default 64)
+//   --threads n        worker threads (default all cores)
+//   --out dir          rawCube.dat, cfarCube.dat and detections.csv (default .)
+//
+// Output cubes have layout of rawCube.dat and cfarCube.dat of radarDataCube,
+// detections.csv lists CFAR hits of every frame: time, range (m), yaw, pitch
+// (deg) and power.
+//
+// Build: g++ -std=c++17 -O3 -mavx2 -pthread reprocess.cpp -o reprocess
+
+struct ReprocessSettings {
+	PipelineConfig pipeline;   // processing and cube geometry
+	bool yawTriggered = false; // decayType 0, cube is zeroed when yaw crosses triggerYaw
+	double triggerYaw = 0;
+	size_t segments = 64;
+	size_t threads = 0;
+	double from = -1e300;
+	double to = 1e300;
+	double bandwidth = 0;      // (MHz) from [radar] of conf
+	bool roi = false;
+	double roiBounds[6] = {0, 359, -20, 60, 0, 0}; // yaw, pitch (deg) and range (m) min and max
+	std::string out = ".";
+};
+
+struct Record {
+	const CaptureIndexEntry* entry;
+	const int16_t* iq;
+};
+
+// result of the sequential pass over poses
+struct FramePlan {
+	bool kept = false;   // processed (platform moved), otherwise only fed to sliding DFT
+	bool outside = false; // outside ROI, skipped entirely
+	bool restart = false; // first chirp inside ROI after outside ones, sliding DFT starts over
+	bool zero = false;   // cube is zeroed before this frame
+	float decay = 1.0f;
+	double logScale = 0; // log of product of decays up to and including this frame
+	uint32_t epoch = 0;  // zeroings up to this frame
+};
+
+struct Detection {
+	double time;
+	float range;
+	float yaw;
+	float pitch;
+	float value;
+};
+
+// Cells one run touched, kept at the scale of their last update
+class RunCube {
+	public:
+		void init(size_t numCells, size_t cellLength)
+		{
+			length = cellLength;
+			slot.assign(numCells, -1);
+		}
+
+		// cell brought to scale (epoch, logScale), data are zero if cell is new
+		float* at(size_t cell, uint32_t epoch, double logScale)
+		{
+			int32_t s = slot[cell];
+			if (s < 0) {
+				s = (int32_t)cells.size();
+				slot[cell] = s;
+				cells.push_back(cell);
+				epochs.push_back(epoch);
+				scales.push_back(logScale);
+				data.resize(data.size() + length, 0.0f);
+				return &data[(size_t)s * length];
+			}
+			rescale((size_t)s, epoch, logScale);
+			return &data[(size_t)s * length];
+		}
+
+		void finish(uint32_t epoch, double logScale)
+		{
+			for (size_t s = 0; s < cells.size(); s++)
+				rescale(s, epoch, logScale);
+		}
+
+		// cells of run brought to end of previous runs, then replaced (overwrite) or added
+		void mergeInto(RunCube& target, uint32_t epoch, double logScale, bool overwrite) const
+		{
+			for (size_t s = 0; s < cells.size(); s++) {
+				float* dst = target.at(cells[s], epoch, logScale);
+				const float* src = &data[s * length];
+				if (overwrite)
+					std::memcpy(dst, src, length * sizeof(float));
+				else
+					pipelineAxpy(dst, src, 1.0f, length);
+			}
+		}
+
+		// dense cube, untouched cells are zero
+		void copyTo(float* cube) const
+		{
+			for (size_t s = 0; s < cells.size(); s++)
+				std::memcpy(cube + cells[s] * length, &data[s * length], length * sizeof(float));
+		}
+
+	private:
+		size_t length = 0;
+		std::vector<int32_t> slot;   // per cube cell, -1 = untouched
+		std::vector<size_t> cells;
+		std::vector<uint32_t> epochs;
+		std::vector<double> scales;
+		std::vector<float> data;
+
+		void rescale(size_t s, uint32_t epoch, double logScale)
+		{
+			float* d = &data[s * length];
+			if (epochs[s] != epoch)
+				std::memset(d, 0, length * sizeof(float));
+			else if (scales[s] != logScale)
+				pipelineScale(d, (float)std::exp(logScale - scales[s]), length);
+			epochs[s] = epoch;
+			scales[s] = logScale;
+		}
+};
+
+struct RunResult {
+	RunCube raw;
+	RunCube cfar;
+	std::vector<Detection> detections;
+	std::vector<size_t> frames;     // kept frames, order of profiles
+	std::vector<float> profiles;    // [rangeBins x frames], only with clutterEnable
+};
+
+class Reprocessor {
+	public:
+		Reprocessor(const ReprocessSettings& s, const std::vector<Record>& r, size_t samples) :
+			settings(s), config(s.pipeline), records(r), samples(samples)
+		{
+			R = config.rangeBins();
+			D = config.dopplerBins();
+			cells = config.yawBins() * config.pitchBins();
+			rangePlan.init(config.rangeNFFT);
+			window.resize(samples);
+			for (size_t k = 0; k < samples; k++) {
+				window[k] = samples > 1 ?
+					(float)(0.5 - 0.5 * std::cos(2.0 * M_PI * k / (samples - 1))) : 1.0f;
+			}
+			rangeCompensation.resize(R);
+			for (size_t r = 0; r < R; r++) {
+				double d = (config.rangeBinMin + r) * config.rangeBinWidth;
+				rangeCompensation[r] = (float)(d * d * d * d);
+			}
+		}
+
+		// frames kept by requirePosChange, their decays and zeroings, same rules
+		// as Doppler stage of the pipeline
+		void plan()
+		{
+			frames.assign(records.size(), FramePlan());
+			bool first = true, pendingZero = false, outside = false;
+			double prevYaw = 0, prevPitch = 0, prevTime = 0, lastYaw = 0;
+			double logScale = 0;
+			uint32_t epoch = 0;
+			for (size_t k = 0; k < records.size(); k++) {
+				const CaptureIndexEntry& e = *records[k].entry;
+				FramePlan& f = frames[k];
+				if (settings.yawTriggered && k > 0 && crossed(lastYaw, e.yaw, settings.triggerYaw))
+					pendingZero = true;
+				lastYaw = e.yaw;
+				if (config.roiGating && !insideRoi(e.yaw, e.pitch)) {
+					f.outside = outside = true;
+					f.logScale = logScale;
+					f.epoch = epoch;
+					continue;
+				}
+				f.restart = outside;
+				outside = false;
+				double diffYaw = std::fabs(std::fmod(e.yaw - prevYaw + 540.0, 360.0) - 180.0);
+				double diffPitch = e.pitch - prevPitch;
+				double distance = std::sqrt(diffYaw * diffYaw + diffPitch * diffPitch);
+				if (!first && config.requirePosChange && distance < 0.99) {
+					f.logScale = logScale;
+					f.epoch = epoch;
+					continue;
+				}
+				double speed = first ? 0.0 : distance / (e.time - prevTime + 1e-6);
+				f.kept = true;
+				f.zero = pendingZero;
+				pendingZero = false;
+				f.decay = config.decay ? (float)std::exp(-speed / 500.0) : 1.0f;
+				if (f.zero)
+					epoch++;
+				logScale += std::log((double)f.decay);
+				f.logScale = logScale;
+				f.epoch = epoch;
+				first = false;
+				prevYaw = e.yaw;
+				prevPitch = e.pitch;
+				prevTime = e.time;
+			}
+		}
+
+		void run()
+		{
+			size_t numRuns = std::max<size_t>(1, std::min(settings.segments, records.size()));
+			results.clear();
+			for (size_t k = 0; k < numRuns; k++)
+				results.emplace_back(new RunResult());
+			std::atomic<size_t> next{0};
+			size_t numThreads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+			std::vector<std::thread> workers;
+			for (size_t t = 0; t < std::min(numThreads, numRuns); t++) {
+				workers.emplace_back([&]() {
+					for (size_t k; (k = next.fetch_add(1)) < numRuns;)
+						processRun(k, numRuns);
+				});
+			}
+			for (std::thread& w : workers)
+				w.join();
+			if (config.clutterEnable)
+				clutterPass();
+		}
+
+		// runs merged in time order, cube is kept at scale of the last merged run
+		void merge(std::vector<float>& rawCube, std::vector<float>& cfarCube, std::vector<Detection>& detections) const
+		{
+			RunCube raw, cfar;
+			raw.init(cells, R * D);
+			cfar.init(cells, R);
+			detections.clear();
+			for (size_t k = 0; k < results.size(); k++) {
+				const FramePlan& last = frames[runEnd(k, results.size()) - 1];
+				results[k]->raw.mergeInto(raw, last.epoch, last.logScale, config.spreadPattern.empty());
+				results[k]->cfar.mergeInto(cfar, last.epoch, last.logScale, true);
+				detections.insert(detections.end(), results[k]->detections.begin(), results[k]->detections.end());
+			}
+			if (config.clutterEnable) {
+				sequentialRaw.mergeInto(raw, frames.back().epoch, frames.back().logScale, config.spreadPattern.empty());
+				sequentialCfar.mergeInto(cfar, frames.back().epoch, frames.back().logScale, true);
+				detections = sequentialDetections;
+			}
+			raw.finish(frames.back().epoch, frames.back().logScale);
+			cfar.finish(frames.back().epoch, frames.back().logScale);
+			rawCube.assign(config.calcRaw ? R * D * cells : 0, 0.0f);
+			cfarCube.assign(config.calcCFAR ? R * cells : 0, 0.0f);
+			if (!rawCube.empty())
+				raw.copyTo(rawCube.data());
+			if (!cfarCube.empty())
+				cfar.copyTo(cfarCube.data());
+		}
+
+		size_t keptFrames() const
+		{
+			size_t n = 0;
+			for (const FramePlan& f : frames)
+				n += f.kept;
+			return n;
+		}
+
+	private:
+		const ReprocessSettings& settings;
+		PipelineConfig config;
+		const std::vector<Record>& records;
+		size_t samples;
+		size_t R = 0, D = 0, cells = 0;
+		FFTPlan rangePlan;
+		std::vector<float> window;
+		std::vector<float> rangeCompensation;
+		std::vector<FramePlan> frames;
+		std::vector<std::unique_ptr<RunResult>> results;
+		RunCube sequentialCfar;
+		RunCube sequentialRaw;
+		std::vector<Detection> sequentialDetections;
+
+		static bool crossed(double from, double to, double trigger)
+		{
+			// shortest way from -> to passes trigger
+			double step = std::fmod(to - from + 540.0, 360.0) - 180.0;
+			double a = std::fmod(trigger - from + 720.0, 360.0);
+			return step > 0 ? a > 0 && a <= step : step < 0 && a >= 360.0 + step && a < 360.0;
+		}
+
+		size_t runBegin(size_t k, size_t n) const
+		{
+			return records.size() * k / n;
+		}
+
+		size_t runEnd(size_t k, size_t n) const
+		{
+			return records.size() * (k + 1) / n;
+		}
+
+		size_t yawIndex(double yaw) const
+		{
+			long idx = std::lround(yaw) - config.yawBinMin;
+			if (config.roiGating)
+				idx = (idx % 360 + 360) % 360;
+			return (size_t)std::min(std::max(idx, 0L), (long)config.yawBins() - 1);
+		}
+
+		bool insideRoi(double yaw, double pitch) const
+		{
+			long y = ((std::lround(yaw) - config.yawBinMin) % 360 + 360) % 360;
+			long p = std::lround(pitch) - config.pitchBinMin;
+			return y < (long)config.yawBins() && p >= 0 && p < (long)config.pitchBins();
+		}
+
+		size_t pitchIndex(double pitch) const
+		{
+			long idx = std::lround(pitch) - config.pitchBinMin;
+			return (size_t)std::min(std::max(idx, 0L), (long)config.pitchBins() - 1);
+		}
+
+		void rangeFFT(const Record& rec, float* re, float* im) const
+		{
+			const size_t N = config.rangeNFFT;
+			size_t n = std::min(samples, N);
+			for (size_t k = 0; k < n; k++) {
+				re[k] = rec.iq[2 * k] * window[k];
+				im[k] = rec.iq[2 * k + 1] * window[k];
+			}
+			std::fill(re + n, re + N, 0.0f);
+			std::fill(im + n, im + N, 0.0f);
+			fftBatched(rangePlan, re, im, 1);
+		}
+
+		// raw cube update of one frame, same as RadarPipeline::writeBatch
+		void writeRaw(RunCube& cube, const FramePlan& f, size_t cell, const float* map) const
+		{
+			const size_t RD = R * D;
+			const size_t yawBins = config.yawBins();
+			if (config.spreadPattern.empty()) {
+				float* dst = cube.at(cell, f.epoch, f.logScale);
+				for (size_t i = 0; i < RD; i++)
+					dst[i] = map[i] * f.decay;
+				return;
+			}
+			size_t yawIdx = cell % yawBins;
+			size_t pitchIdx = cell / yawBins;
+			long halfYaw = (long)config.patternYaw / 2;
+			long halfPitch = (long)config.patternPitch / 2;
+			for (long p = 0; p < (long)config.patternPitch; p++) {
+				long pitch = (long)pitchIdx + p - halfPitch;
+				if (pitch < 0 || pitch >= (long)config.pitchBins())
+					continue;
+				for (long y = 0; y < (long)config.patternYaw; y++) {
+					long yaw = (long)yawIdx + y - halfYaw;
+					if (yawBins >= 360)
+						yaw = (yaw % (long)yawBins + (long)yawBins) % (long)yawBins;
+					else if (yaw < 0 || yaw >= (long)yawBins)
+						continue;
+					float w = config.spreadPattern[y + p * config.patternYaw] * f.decay;
+					pipelineAxpy(cube.at((size_t)yaw + (size_t)pitch * yawBins, f.epoch, f.logScale), map, w, RD);
+				}
+			}
+		}
+
+		void writeCfar(RunCube& cube, std::vector<Detection>& detections, const FramePlan& f,
+				const CaptureIndexEntry& e, size_t cell, const float* profile, const float* cfar) const
+		{
+			float* dst = cube.at(cell, f.epoch, f.logScale);
+			for (size_t r = 0; r < R; r++) {
+				dst[r] = cfar[r] * f.decay;
+				if (cfar[r] > 0)
+					detections.push_back({e.time, (float)((config.rangeBinMin + r) * config.rangeBinWidth),
+							(float)e.yaw, (float)e.pitch, profile[r]});
+			}
+		}
+
+		void processRun(size_t k, size_t numRuns)
+		{
+			RunResult& out = *results[k];
+			size_t begin = runBegin(k, numRuns);
+			size_t end = runEnd(k, numRuns);
+			out.raw.init(cells, R * D);
+			out.cfar.init(cells, R);
+
+			const size_t N = config.rangeNFFT;
+			std::vector<float> re(N), im(N);
+			std::vector<float> profile(R), map(R * D), cfar(R);
+			std::vector<float> specRe(config.calcSpeed ? R * D : 0), specIm(config.calcSpeed ? R * D : 0);
+			SlidingDFT sdft;
+			size_t warmup = 0;
+			if (config.calcSpeed) {
+				sdft.init(R, config.speedNFFT, config.speedNFFT, 1024);
+				warmup = std::min(begin, config.speedNFFT - 1);
+				// sliding DFT state doesn't reach over chirps outside ROI
+				for (size_t k = 0; k < warmup; k++) {
+					if (frames[begin - 1 - k].outside) {
+						warmup = k;
+						break;
+					}
+				}
+			}
+			CACFAR detector;
+			detector.init(config.cfarTraining, config.cfarGuard, config.cfarPfa);
+			const bool rawHere = config.calcRaw && (config.calcSpeed || !config.clutterEnable);
+
+			const float* gateRe = re.data() + config.rangeBinMin;
+			const float* gateIm = im.data() + config.rangeBinMin;
+			for (size_t i = begin - warmup; i < end; i++) {
+				if (frames[i].outside)
+					continue;
+				rangeFFT(records[i], re.data(), im.data());
+				if (config.calcSpeed && frames[i].restart)
+					sdft.init(R, config.speedNFFT, config.speedNFFT, 1024);
+				if (config.calcSpeed)
+					sdft.push(gateRe, gateIm);
+				if (i < begin || !frames[i].kept)
+					continue;
+				const FramePlan& f = frames[i];
+				const CaptureIndexEntry& e = *records[i].entry;
+				size_t cell = yawIndex(e.yaw) + pitchIndex(e.pitch) * config.yawBins();
+				for (size_t r = 0; r < R; r++)
+					profile[r] = (gateRe[r] * gateRe[r] + gateIm[r] * gateIm[r]) * rangeCompensation[r];
+
+				if (rawHere) {
+					if (config.calcSpeed) {
+						sdft.spectrumShifted(specRe.data(), specIm.data());
+						rangeDopplerPower(specRe.data(), specIm.data(), R, R, D,
+								rangeCompensation.data(), false, config.logCompress, map.data());
+						writeRaw(out.raw, f, cell, map.data());
+					} else {
+						writeRaw(out.raw, f, cell, profile.data());
+					}
+				}
+				if (config.clutterEnable) {
+					out.frames.push_back(i);
+					out.profiles.insert(out.profiles.end(), profile.begin(), profile.end());
+				} else if (config.calcCFAR) {
+					detector.run(profile.data(), cfar.data(), R);
+					writeCfar(out.cfar, out.detections, f, e, cell, profile.data(), cfar.data());
+				}
+			}
+			if (end > begin) {
+				out.raw.finish(frames[end - 1].epoch, frames[end - 1].logScale);
+				out.cfar.finish(frames[end - 1].epoch, frames[end - 1].logScale);
+			}
+		}
+
+		// clutter map and CFAR over profiles of all runs in time order
+		void clutterPass()
+		{
+			std::vector<float> clutter(R * cells, 0.0f);
+			std::vector<float> cfar(R);
+			CACFAR detector;
+			detector.init(config.cfarTraining, config.cfarGuard, config.cfarPfa);
+			sequentialCfar.init(cells, R);
+			sequentialRaw.init(cells, R * D);
+			sequentialDetections.clear();
+			for (const std::unique_ptr<RunResult>& run : results) {
+				for (size_t j = 0; j < run->frames.size(); j++) {
+					const FramePlan& f = frames[run->frames[j]];
+					const CaptureIndexEntry& e = *records[run->frames[j]].entry;
+					size_t cell = yawIndex(e.yaw) + pitchIndex(e.pitch) * config.yawBins();
+					float* profile = &run->profiles[j * R];
+					clutterSubtract(clutter.data() + cell * R, profile, profile, R, config.clutterAlpha);
+					if (config.calcRaw && !config.calcSpeed)
+						writeRaw(sequentialRaw, f, cell, profile);
+					if (config.calcCFAR) {
+						detector.run(profile, cfar.data(), R);
+						writeCfar(sequentialCfar, sequentialDetections, f, e, cell, profile, cfar.data());
+					}
+				}
+			}
+			if (!frames.empty()) {
+				sequentialCfar.finish(frames.back().epoch, frames.back().logScale);
+				sequentialRaw.finish(frames.back().epoch, frames.back().logScale);
+			}
+		}
+};
+
+// pattern of radarDataCube.generateSpreadPattern, [(2*yaw+1) x (2*pitch+1)]
+static void spreadPattern(PipelineConfig& cfg, double halfYaw, double halfPitch)
+{
+	long ny = (long)halfYaw, np = (long)halfPitch;
+	cfg.patternYaw = (size_t)(2 * ny + 1);
+	cfg.patternPitch = (size_t)(2 * np + 1);
+	cfg.spreadPattern.resize(cfg.patternYaw * cfg.patternPitch);
+	double yawSigma = 3 * halfYaw / std::sqrt(8 * std::log(2.0));
+	double pitchSigma = 1.5 * halfPitch / std::sqrt(8 * std::log(2.0));
+	// MATLAB meshgrid there pairs pitch offsets with yawSigma and vice versa
+	for (long p = -np; p <= np; p++) {
+		for (long y = -ny; y <= ny; y++) {
+			double a = p / yawSigma, b = y / pitchSigma;
+			cfg.spreadPattern[(size_t)(y + ny) + (size_t)(p + np) * cfg.patternYaw] = (float)std::exp(-0.5 * (a * a + b * b));
+		}
+	}
+}
+
+static void applyProcessing(ReprocessSettings& s, const IniFile& ini)
+{
+	PipelineConfig& p = s.pipeline;
+	const char* sec = "processing";
+	p.rangeNFFT = (size_t)iniNumber(ini, sec, "rangeNFFT", (double)p.rangeNFFT);
+	p.speedNFFT = (size_t)iniNumber(ini, sec, "speedNFFT", (double)p.speedNFFT);
+	p.calcSpeed = iniNumber(ini, sec, "calcSpeed", p.calcSpeed) != 0;
+	p.calcRaw = iniNumber(ini, sec, "calcRaw", p.calcRaw) != 0;
+	p.calcCFAR = iniNumber(ini, sec, "calcCFAR", p.calcCFAR) != 0;
+	p.requirePosChange = iniNumber(ini, sec, "requirePosChange", p.requirePosChange) != 0;
+	p.cfarGuard = (size_t)iniNumber(ini, sec, "cfarGuard", (double)p.cfarGuard);
+	p.cfarTraining = (size_t)iniNumber(ini, sec, "cfarTraining", (double)p.cfarTraining);
+	p.cfarPfa = iniNumber(ini, sec, "cfarPfa", p.cfarPfa);
+	p.clutterEnable = iniNumber(ini, sec, "clutterEnable", p.clutterEnable) != 0;
+	p.clutterAlpha = (float)iniNumber(ini, sec, "clutterAlpha", p.clutterAlpha);
+	p.logCompress = iniNumber(ini, sec, "logCompress", p.logCompress) != 0;
+	p.decay = iniNumber(ini, sec, "decayType", p.decay) != 0;
+	s.yawTriggered = !p.decay;
+	s.triggerYaw = iniNumber(ini, sec, "triggerYaw", s.triggerYaw);
+	p.spreadPattern.clear();
+	p.patternYaw = p.patternPitch = 0;
+	double spreadYaw = iniNumber(ini, sec, "spreadPatternYaw", 0);
+	double spreadPitch = iniNumber(ini, sec, "spreadPatternPitch", 0);
+	if (iniNumber(ini, sec, "spreadPatternEnabled", 0) != 0 && spreadYaw != 0 && spreadPitch != 0)
+		spreadPattern(p, spreadYaw, spreadPitch);
+	s.roi = iniNumber(ini, sec, "roiEnable", s.roi) != 0;
+	const char* roiKeys[6] = {"roiYawMin", "roiYawMax", "roiPitchMin", "roiPitchMax", "roiRangeMin", "roiRangeMax"};
+	for (int k = 0; k < 6; k++)
+		s.roiBounds[k] = iniNumber(ini, sec, roiKeys[k], s.roiBounds[k]);
+	s.bandwidth = std::fabs(iniNumber(ini, "radar", "bandwidth", s.bandwidth));
+}
+
+static void writeFile(const std::string& path, const void* data, size_t bytes)
+{
+	FILE* f = std::fopen(path.c_str(), "wb");
+	if (!f || std::fwrite(data, 1, bytes, f) != bytes) {
+		if (f)
+			std::fclose(f);
+		throw std::runtime_error("Failed to write " + path);
+	}
+	std::fclose(f);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::fprintf(stderr, "usage: %s [--conf fmcw.conf] [--set key=value]... [--from s] [--to s]\n"
+				"  [--segments n] [--threads n] [--out dir] segment.iq...\n", argv[0]);
+		return 2;
+	}
+	try {
+		ReprocessSettings settings;
+		// radarDataCube geometry, decayType 1 unless configured
+		IniFile ini;
+		std::vector<std::string> paths;
+		std::vector<std::pair<std::string, std::string>> overrides;
+		for (int k = 1; k < argc; k++) {
+			std::string key = argv[k];
+			if (key.compare(0, 2, "--") != 0) {
+				paths.push_back(key);
+				continue;
+			}
+			if (k + 1 >= argc)
+				throw std::runtime_error("Missing value of " + key);
+			std::string value = argv[++k];
+			if (key == "--conf")
+				ini = readIni(value);
+			else if (key == "--set") {
+				size_t eq = value.find('=');
+				if (eq == std::string::npos)
+					throw std::runtime_error("--set needs key=value.");
+				overrides.push_back({value.substr(0, eq), value.substr(eq + 1)});
+			} else if (key == "--from")
+				settings.from = std::atof(value.c_str());
+			else if (key == "--to")
+				settings.to = std::atof(value.c_str());
+			else if (key == "--segments")
+				settings.segments = std::max<size_t>((size_t)std::atol(value.c_str()), 1);
+			else if (key == "--threads")
+				settings.threads = (size_t)std::atol(value.c_str());
+			else if (key == "--out")
+				settings.out = value;
+			else
+				throw std::runtime_error("Unknown option " + key);
+		}
+		for (const auto& o : overrides)
+			ini["processing"][o.first] = o.second;
+		applyProcessing(settings, ini);
+		if (paths.empty())
+			throw std::runtime_error("No capture segments given.");
+
+		// segments in order of their index, records in time window
+		std::vector<std::unique_ptr<CaptureSegment>> segments;
+		for (const std::string& path : paths) {
+			segments.emplace_back(new CaptureSegment());
+			segments.back()->open(path);
+		}
+		std::sort(segments.begin(), segments.end(), [](const std::unique_ptr<CaptureSegment>& a,
+					const std::unique_ptr<CaptureSegment>& b) { return a->header().segment < b->header().segment; });
+		const CaptureHeader& first = segments.front()->header();
+		size_t samples = first.samples;
+		double bandwidth = first.bandwidth != 0 ? std::fabs(first.bandwidth) : settings.bandwidth;
+		if (bandwidth == 0)
+			throw std::runtime_error("Bandwidth is unknown, give --conf with [radar] bandwidth.");
+		std::vector<Record> records;
+		for (const std::unique_ptr<CaptureSegment>& seg : segments) {
+			if (seg->header().samples != samples || seg->header().startTime != first.startTime)
+				throw std::runtime_error("Segments don't belong to the same capture.");
+			for (size_t k = 0; k < seg->count(); k++) {
+				const CaptureIndexEntry& e = seg->entry(k);
+				if (e.time >= settings.from && e.time <= settings.to)
+					records.push_back({&e, seg->record(k)});
+			}
+		}
+		if (records.empty())
+			throw std::runtime_error("No records in time window.");
+
+		PipelineConfig& cfg = settings.pipeline;
+		if (cfg.rangeNFFT < 2 || !isPowerOfTwo(cfg.rangeNFFT) || (cfg.calcSpeed && cfg.speedNFFT == 0))
+			throw std::runtime_error("rangeNFFT must be a power of two and speedNFFT positive.");
+		cfg.rangeBinWidth = 299792458.0 * (double)(samples + 85) / (2.0 * bandwidth * 1e6 * (double)cfg.rangeNFFT);
+		if (settings.roi) {
+			const double* b = settings.roiBounds;
+			setRegionOfInterest(cfg, b[0], b[1], b[2], b[3], b[4], b[5]);
+		}
+
+		double t0 = steadySeconds();
+		Reprocessor processor(settings, records, samples);
+		processor.plan();
+		double t1 = steadySeconds();
+		processor.run();
+		double t2 = steadySeconds();
+		std::vector<float> rawCube, cfarCube;
+		std::vector<Detection> detections;
+		processor.merge(rawCube, cfarCube, detections);
+		double t3 = steadySeconds();
+
+		if (!rawCube.empty())
+			writeFile(settings.out + "/rawCube.dat", rawCube.data(), rawCube.size() * sizeof(float));
+		if (!cfarCube.empty())
+			writeFile(settings.out + "/cfarCube.dat", cfarCube.data(), cfarCube.size() * sizeof(float));
+		std::string csv = settings.out + "/detections.csv";
+		FILE* f = std::fopen(csv.c_str(), "w");
+		if (!f)
+			throw std::runtime_error("Failed to write " + csv);
+		std::fprintf(f, "time,range,yaw,pitch,value\n");
+		for (const Detection& d : detections)
+			std::fprintf(f, "%.6f,%.4f,%.3f,%.3f,%.6g\n", d.time, d.range, d.yaw, d.pitch, d.value);
+		std::fclose(f);
+
+		double span = records.back().entry->time - records.front().entry->time;
+		std::printf("records: %zu (%zu processed) over %.1f s from %zu segment files, range bin %.4f m\n",
+				records.size(), processor.keptFrames(), span, segments.size(), cfg.rangeBinWidth);
+		std::printf("cube: %zu x %zu x %zu x %zu (range from %.2f m, yaw from %d deg), %zu detections\n",
+				cfg.rangeBins(), cfg.dopplerBins(), cfg.yawBins(), cfg.pitchBins(),
+				cfg.rangeBinMin * cfg.rangeBinWidth, cfg.yawBinMin, detections.size());
+		std::printf("time: plan %.3f s, runs %.3f s, merge %.3f s, %.1fx real time\n",
+				t1 - t0, t2 - t1, t3 - t2, t3 > t0 ? span / (t3 - t0) : 0.0);
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,683 @@
+#include "iniFile.h"
+#include "radarPipeline.h"
+#include "sceneGenerator.h"
+#include "serialPort.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <random>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Headless radar and indexing table for benchmarks and regression runs
+//
+//   sceneBench direct [options]  synthetic chirps are pushed straight to
+//                                RadarPipeline at speed x real time, sustained
+//                                chirp rate, drops and stage latencies are
+//                                reported at the end
+//   sceneBench pty [options]     two pseudo terminals stand in for the SiRad
+//                                radar (frame on every !N) and the indexing
+//                                table (!P pose lines), their paths are
+//                                printed so they can be put to fmcw.conf
+//
+// Options:
+//   --conf path        fmcw.conf to take [radar], [platform] and [processing] from
+//   --program name     scan program of [programs] section (default full)
+//   --gcode text       scan program given directly, lines separated by \n
+//   --target r,yaw,pitch[,amplitude[,speed]]  point target, may repeat
+//   --noise rms        receiver noise (ADC counts)
+//   --clutter n        number of static clutter scatterers
+//   --seed n
+//   --duration s       simulated time (s), pty runs until interrupted when 0
+//   --speed n          multiple of real time, 0 = as fast as ingest takes chirps,
+//                      producer waits instead of dropping (direct only)
+//   --pose-period s    period of !P lines (pty only)
+//   --dir path         directory for cube files, created if missing (direct
+//                      only, default /tmp)
+//   --streams n        radars mounted 360/n degrees apart in yaw, each pushed
+//                      by its own thread to its own pipeline stream (direct only)
+//   --strict           exit with 1 if any frame was dropped (direct only)
+//   --sectors n        sector index follows raw (CFAR without raw) cube during
+//                      the run, n random sector queries are compared with fresh
+//                      index and slicing of the cube at the end (direct only)
+//   --changes n        sweep to sweep change detection on every cube update,
+//                      n strongest changes are printed at the end, static scene
+//                      (no moving target) exits with 1 if any change was
+//                      recorded (direct only)
+//
+// Build: g++ -std=c++17 -O3 -mavx2 -pthread sceneBench.cpp -o sceneBench -lutil
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int)
+{
+	interrupted = 1;
+}
+
+static SceneTarget parseTarget(const std::string& text)
+{
+	SceneTarget t;
+	double v[5] = {t.range, t.yaw, t.pitch, t.amplitude, t.speed};
+	int n = std::sscanf(text.c_str(), "%lf,%lf,%lf,%lf,%lf", &v[0], &v[1], &v[2], &v[3], &v[4]);
+	if (n < 3)
+		throw std::runtime_error("Target is range,yaw,pitch[,amplitude[,speed]].");
+	t.range = v[0];
+	t.yaw = v[1];
+	t.pitch = v[2];
+	t.amplitude = v[3];
+	t.speed = v[4];
+	return t;
+}
+
+static void createCube(const std::string& path, size_t elements)
+{
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, (off_t)(elements * sizeof(float))) != 0) {
+		std::string error = std::strerror(errno);
+		if (fd >= 0)
+			::close(fd);
+		throw std::runtime_error("Failed to create cube file " + path + ": " + error);
+	}
+	::close(fd);
+}
+
+// sleeps until monotonic time (s)
+static void sleepUntil(double deadline)
+{
+	struct timespec ts;
+	ts.tv_sec = (time_t)deadline;
+	ts.tv_nsec = (long)((deadline - (double)ts.tv_sec) * 1e9);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR && !interrupted) {
+	}
+}
+
+struct BenchOptions {
+	SceneConfig scene;
+	PipelineConfig pipeline;
+	std::string program;
+	double stepCountYaw = 400;
+	double stepCountPitch = 400;
+	double chirpPeriod = 0.02; // (s)
+	double duration = 10;
+	double speed = 1;
+	double posePeriod = 0.01;
+	std::string dir = "/tmp";
+	size_t streams = 1;
+	bool strict = false;
+	bool roi = false;
+	size_t sectors = 0;
+	size_t changes = 0;
+	double roiBounds[6] = {0, 359, -20, 60, 0, 0}; // yaw, pitch (deg) and range (m) min and max
+};
+
+struct ProducerResult {
+	size_t pushed = 0;
+	double generateTime = 0; // (s)
+	double maxLag = 0;       // (s)
+};
+
+// chirps of one radar mounted mountYaw from platform yaw, pushed to stream
+static void produceChirps(const BenchOptions& opt, ScanProgram scan, RadarPipeline& pipeline,
+		size_t stream, double mountYaw, double start, ProducerResult& result)
+{
+	const PipelineConfig& cfg = opt.pipeline;
+	SceneGenerator scene;
+	scene.init(opt.scene);
+	const size_t chirps = (size_t)(opt.duration / opt.chirpPeriod);
+	size_t ingestCapacity = 1;
+	while (ingestCapacity < cfg.ringSize)
+		ingestCapacity <<= 1;
+	std::vector<int16_t> i16(cfg.samples), q16(cfg.samples);
+	std::vector<float> i(cfg.samples), q(cfg.samples);
+	size_t& pushed = result.pushed;
+	for (; pushed < chirps && !interrupted; pushed++) {
+		double t = (double)pushed * opt.chirpPeriod;
+		double yaw, pitch;
+		scan.pose(t, yaw, pitch);
+		yaw = std::fmod(yaw, 360.0);
+		yaw = yaw < 0 ? yaw + 360.0 : yaw;
+		pitch = std::remainder(pitch, 360.0);
+		double beamYaw = std::fmod(yaw + mountYaw, 360.0);
+
+		double g0 = monotonicSeconds();
+		scene.chirp(t, beamYaw, pitch, i16.data(), q16.data());
+		for (size_t k = 0; k < cfg.samples; k++) {
+			i[k] = (float)i16[k];
+			q[k] = (float)q16[k];
+		}
+		double g1 = monotonicSeconds();
+		result.generateTime += g1 - g0;
+
+		if (opt.speed > 0) {
+			double deadline = start + t / opt.speed;
+			if (g1 < deadline)
+				sleepUntil(deadline);
+			else
+				result.maxLag = std::max(result.maxLag, g1 - deadline);
+		} else {
+			while (pipeline.ingestOccupancy(stream) >= ingestCapacity)
+				std::this_thread::yield();
+		}
+		pipeline.pushChirp(stream, i.data(), q.data(), cfg.samples, t, yaw, pitch);
+	}
+}
+
+// sum and maximum of sector by slicing the cube, what MATLAB does without index
+static SectorResult sliceSector(const float* cube, const SectorIndexConfig& c, const SectorQuery& q)
+{
+	SectorResult result;
+	const size_t D = c.raw ? c.dopplerBins : 1;
+	long start = std::lround(q.yawMin);
+	long length = q.yawMax - q.yawMin >= 359.5 ? 359 : ((std::lround(q.yawMax) - start) % 360 + 360) % 360;
+	for (size_t p = 0; p < c.pitchBins; p++) {
+		long pitch = c.pitchBinMin + (long)p;
+		if (pitch < std::lround(q.pitchMin) || pitch > std::lround(q.pitchMax))
+			continue;
+		for (size_t y = 0; y < c.yawBins; y++) {
+			if (((c.yawBinMin + (long)y - start) % 360 + 360) % 360 > length)
+				continue;
+			const float* column = cube + (y + p * c.yawBins) * c.rangeBins * D;
+			for (size_t r = 0; r < c.rangeBins; r++) {
+				long bin = (long)(r + c.rangeBinMin);
+				if (bin < std::lround(q.rangeMin / c.rangeBinWidth) ||
+						(q.rangeMax > 0 && bin > std::lround(q.rangeMax / c.rangeBinWidth)))
+					continue;
+				double v = 0;
+				for (size_t d = 0; d < D; d++)
+					v += column[r + d * c.rangeBins];
+				result.max = result.cells > 0 ? std::max(result.max, v) : v;
+				result.sum += v;
+				result.cells++;
+			}
+		}
+	}
+	return result;
+}
+
+static void reportSectors(size_t n, SectorIndex& index, unsigned seed)
+{
+	const SectorIndexConfig& c = index.getConfig();
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	const double maxRange = (double)(c.rangeBinMin + c.rangeBins) * c.rangeBinWidth;
+	std::vector<SectorQuery> queries(n);
+	for (SectorQuery& q : queries) {
+		q.yawMin = c.yawBinMin + unit(random) * (double)c.yawBins;
+		q.yawMax = q.yawMin + 10 + unit(random) * 80;
+		q.pitchMin = c.pitchBinMin + unit(random) * (double)c.pitchBins;
+		q.pitchMax = q.pitchMin + unit(random) * 30;
+		q.rangeMin = unit(random) * maxRange;
+		q.rangeMax = q.rangeMin + unit(random) * maxRange / 2;
+	}
+	std::vector<SectorResult> incremental(n), rebuilt(n);
+	double t0 = monotonicSeconds();
+	index.query(queries.data(), incremental.data(), n);
+	double t1 = monotonicSeconds();
+
+	SectorIndex fresh;
+	fresh.open(c);
+	fresh.query(queries.data(), rebuilt.data(), n);
+	int fd = ::open(c.cubePath.c_str(), O_RDONLY);
+	const size_t bytes = c.rangeBins * (c.raw ? c.dopplerBins : 1) * c.yawBins * c.pitchBins * sizeof(float);
+	void* cube = fd >= 0 ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	if (fd >= 0)
+		::close(fd);
+	if (cube == MAP_FAILED)
+		throw std::runtime_error("Failed to map cube file " + c.cubePath);
+	// sums of nearly empty sectors are differences of large prefix sums, their
+	// deviation is relative to the total of the cube
+	SectorQuery all = {0, 360, (double)c.pitchBinMin, (double)c.pitchBinMin + (double)c.pitchBins, 0, 0};
+	SectorResult total;
+	fresh.query(&all, &total, 1);
+	double deviation = 0, sliceTime = 0;
+	for (size_t k = 0; k < n; k++) {
+		double s0 = monotonicSeconds();
+		SectorResult slice = sliceSector((const float*)cube, c, queries[k]);
+		sliceTime += monotonicSeconds() - s0;
+		for (const SectorResult* r : {&incremental[k], &rebuilt[k]}) {
+			double scale = std::max(std::fabs(slice.sum), std::max(std::fabs(total.sum) * 1e-6, 1e-30));
+			deviation = std::max(deviation, std::fabs(r->sum - slice.sum) / scale);
+			if (slice.cells > 0)
+				deviation = std::max(deviation, std::fabs(r->max - slice.max) / std::max(std::fabs(slice.max), 1e-30));
+		}
+	}
+	munmap(cube, bytes);
+	std::printf("sectors: %zu queries of %s cube, index %.2f us/query, slicing %.1f us/query, max deviation %.2g\n",
+			n, c.raw ? "raw" : "CFAR", n ? (t1 - t0) / n * 1e6 : 0.0, n ? sliceTime / n * 1e6 : 0.0, deviation);
+	std::printf("sector index: updates %llu, tiles %llu, rebuilds %llu\n", (unsigned long long)index.stats.updates.load(),
+			(unsigned long long)index.stats.tiles.load(), (unsigned long long)index.stats.rebuilds.load());
+}
+
+static void reportChanges(size_t n, const ChangeDetector& detector, std::vector<ChangeRecord>& records)
+{
+	const ChangeDetectorStats& s = detector.stats;
+	std::printf("changes: %llu records from %llu frames, %llu visits, %llu seeding frames, %llu dropped\n",
+			(unsigned long long)s.changes.load(), (unsigned long long)s.frames.load(), (unsigned long long)s.visits.load(),
+			(unsigned long long)s.seeded.load(), (unsigned long long)s.dropped.load());
+	n = std::min(n, records.size());
+	std::partial_sort(records.begin(), records.begin() + n, records.end(), [](const ChangeRecord& a, const ChangeRecord& b) {
+		return std::fabs(a.value - a.reference) > std::fabs(b.value - b.reference);
+	});
+	for (size_t k = 0; k < n; k++) {
+		const ChangeRecord& c = records[k];
+		std::printf("  t %8.3f s  range %6.2f m  yaw %4.0f  pitch %3.0f  value %10.4g  reference %10.4g\n",
+				c.time, c.range, c.yaw, c.pitch, c.value, c.reference);
+	}
+}
+
+static void printLatency(const RadarPipeline& pipeline)
+{
+	std::printf("%-12s %10s %10s %10s %10s %10s %10s\n", "latency(us)", "count", "p50", "p90", "p99", "p99.9", "max");
+	for (int k = 0; k < LATENCY_COUNT; k++) {
+		const LatencyHistogram& h = pipeline.metrics.latency[k];
+		std::printf("%-12s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", pipelineLatencyNames[k],
+				(unsigned long long)h.count(), h.percentile(0.5) * 1e-3, h.percentile(0.9) * 1e-3,
+				h.percentile(0.99) * 1e-3, h.percentile(0.999) * 1e-3, (double)h.max() * 1e-3);
+	}
+}
+
+static int runDirect(BenchOptions& opt, ScanProgram& scan)
+{
+	PipelineConfig& cfg = opt.pipeline;
+	SceneGenerator scene;
+	scene.init(opt.scene);
+	cfg.samples = opt.scene.samples;
+	cfg.rangeBinWidth = scene.rangeBinWidth(cfg.rangeNFFT);
+	if (opt.roi) {
+		const double* b = opt.roiBounds;
+		setRegionOfInterest(cfg, b[0], b[1], b[2], b[3], b[4], b[5]);
+	}
+	cfg.metrics = true;
+	cfg.streams = opt.streams;
+	cfg.mountYaw.clear();
+	for (size_t k = 0; k < opt.streams; k++)
+		cfg.mountYaw.push_back(360.0 * k / opt.streams);
+	const size_t cells = cfg.yawBins() * cfg.pitchBins();
+	if (::mkdir(opt.dir.c_str(), 0755) != 0 && errno != EEXIST)
+		throw std::runtime_error("Failed to create directory " + opt.dir + ": " + std::strerror(errno));
+	if (cfg.calcRaw) {
+		cfg.rawCubePath = opt.dir + "/benchRawCube.dat";
+		createCube(cfg.rawCubePath, cfg.rangeBins() * cfg.dopplerBins() * cells);
+	}
+	if (cfg.calcCFAR) {
+		cfg.cfarCubePath = opt.dir + "/benchCfarCube.dat";
+		createCube(cfg.cfarCubePath, cfg.rangeBins() * cells);
+	}
+	if (cfg.clutterEnable) {
+		cfg.clutterCubePath = opt.dir + "/benchClutterCube.dat";
+		createCube(cfg.clutterCubePath, cfg.rangeBins() * cells);
+	}
+
+	SectorIndex sectorIndex;
+	if (opt.sectors > 0 && (cfg.calcRaw || cfg.calcCFAR)) {
+		SectorIndexConfig sc;
+		sc.raw = cfg.calcRaw;
+		sc.cubePath = cfg.calcRaw ? cfg.rawCubePath : cfg.cfarCubePath;
+		sc.rangeBins = cfg.rangeBins();
+		sc.dopplerBins = cfg.dopplerBins();
+		sc.yawBins = cfg.yawBins();
+		sc.pitchBins = cfg.pitchBins();
+		sc.rangeBinWidth = cfg.rangeBinWidth;
+		sc.rangeBinMin = cfg.rangeBinMin;
+		sc.yawBinMin = cfg.yawBinMin;
+		sc.pitchBinMin = cfg.pitchBinMin;
+		sectorIndex.open(sc);
+	}
+
+	ChangeDetector changeDetector;
+	std::vector<ChangeRecord> changes, polled;
+	if (opt.changes > 0) {
+		ChangeDetectorConfig cc;
+		cc.rangeBins = cfg.rangeBins();
+		cc.yawBins = cfg.yawBins();
+		cc.pitchBins = cfg.pitchBins();
+		cc.rangeBinWidth = cfg.rangeBinWidth;
+		cc.rangeBinMin = cfg.rangeBinMin;
+		cc.yawBinMin = cfg.yawBinMin;
+		cc.pitchBinMin = cfg.pitchBinMin;
+		cc.training = cfg.cfarTraining;
+		cc.guard = cfg.cfarGuard;
+		changeDetector.open(cc);
+	}
+	// records are collected while producers run, detector keeps only maxRecords
+	auto pollChanges = [&]() {
+		if (!changeDetector.isOpen())
+			return;
+		changeDetector.poll(polled);
+		changes.insert(changes.end(), polled.begin(), polled.end());
+	};
+
+	// poll takes tiles rewritten since the previous one, as MATLAB does
+	DirtyTiles dirty;
+	uint64_t polledGeneration = 0, dirtyPolls = 0;
+	double dirtyTiles = 0, dirtyRange = 0;
+	auto poll = [&](RadarPipeline& pipeline) {
+		uint64_t generation = pipeline.takeDirty(dirty);
+		pipeline.notePolled(generation);
+		if (generation == polledGeneration)
+			return;
+		polledGeneration = generation;
+		dirtyPolls++;
+		dirty.forEach([&](size_t, size_t) { dirtyTiles++; });
+		if (dirty.hasRange())
+			dirtyRange += (double)(dirty.getRangeLast() - dirty.getRangeFirst() + 1);
+	};
+
+	RadarPipeline pipeline;
+	pipeline.setSectorIndex(sectorIndex.isOpen() ? &sectorIndex : nullptr);
+	pipeline.setChangeDetector(changeDetector.isOpen() ? &changeDetector : nullptr);
+	pipeline.start(cfg);
+
+	double start = monotonicSeconds();
+	std::vector<ProducerResult> results(opt.streams);
+	std::vector<std::thread> producers;
+	std::atomic<size_t> finished{0};
+	for (size_t k = 0; k < opt.streams; k++) {
+		producers.emplace_back([&, k]() {
+			produceChirps(opt, scan, pipeline, k, cfg.mountYaw[k], start, results[k]);
+			finished.fetch_add(1, std::memory_order_release);
+		});
+	}
+	// poll like MATLAB does while producers run
+	while (finished.load(std::memory_order_acquire) < opt.streams) {
+		usleep(1000);
+		poll(pipeline);
+		pollChanges();
+	}
+	for (std::thread& t : producers)
+		t.join();
+	double pushEnd = monotonicSeconds();
+	size_t pushed = 0;
+	double generateTime = 0, maxLag = 0;
+	for (const ProducerResult& r : results) {
+		pushed += r.pushed;
+		generateTime += r.generateTime;
+		maxLag = std::max(maxLag, r.maxLag);
+	}
+
+	// drain, stages are done when their counters stop moving
+	uint64_t last = UINT64_MAX;
+	double processEnd = pushEnd;
+	for (int idle = 0; idle < 20;) {
+		usleep(5000);
+		poll(pipeline);
+		uint64_t now = pipeline.stats.rangeProcessed + pipeline.stats.cfarProcessed + pipeline.stats.cubeFrames;
+		if (now != last)
+			processEnd = monotonicSeconds();
+		idle = now == last ? idle + 1 : 0;
+		last = now;
+	}
+	pipeline.stop();
+	pollChanges();
+
+	const PipelineStats& s = pipeline.stats;
+	double elapsed = pushEnd - start;
+	double processed = processEnd - start;
+	uint64_t dropped = s.droppedIngest + s.droppedRange + s.droppedDoppler + s.droppedCfar;
+	std::printf("scene: %zu samples, %.0f MHz, %d GHz, range bin %.4f m, max speed %.2f m/s, %zu targets\n",
+			opt.scene.samples, opt.scene.bandwidth, opt.scene.frontend, cfg.rangeBinWidth,
+			scene.maxSpeed(opt.chirpPeriod), opt.scene.targets.size());
+	std::printf("chirps: %zu from %zu streams in %.3f s, offered %.1f chirps/s (%.1fx real time), generator %.1f us/chirp, max lag %.3f ms\n",
+			pushed, opt.streams, elapsed, elapsed > 0 ? pushed / elapsed : 0.0,
+			elapsed > 0 ? pushed / opt.streams * opt.chirpPeriod / elapsed : 0.0,
+			pushed ? generateTime / pushed * 1e6 : 0.0, maxLag * 1e3);
+	std::printf("sustained: range %.1f chirps/s, cube %.1f frames/s over %.3f s\n",
+			processed > 0 ? s.rangeProcessed / processed : 0.0, processed > 0 ? s.cubeFrames / processed : 0.0, processed);
+	std::printf("frames: range %llu, outside ROI %llu, doppler %llu, static %llu, cfar %llu, cube %llu\n",
+			(unsigned long long)s.rangeProcessed.load(), (unsigned long long)s.outsideRoi.load(),
+			(unsigned long long)s.dopplerProcessed.load(), (unsigned long long)s.skippedStatic.load(),
+			(unsigned long long)s.cfarProcessed.load(), (unsigned long long)s.cubeFrames.load());
+	std::printf("cube: %zu x %zu x %zu x %zu (range from %.2f m), %.1f MB\n", cfg.rangeBins(), cfg.dopplerBins(),
+			cfg.yawBins(), cfg.pitchBins(), cfg.rangeBinMin * cfg.rangeBinWidth,
+			((cfg.calcRaw ? cfg.dopplerBins() : 0) + cfg.calcCFAR + cfg.clutterEnable) * cfg.rangeBins() * cells *
+			sizeof(float) / 1048576.0);
+	std::printf("dropped: ingest %llu, range %llu, doppler %llu, cfar %llu\n",
+			(unsigned long long)s.droppedIngest.load(), (unsigned long long)s.droppedRange.load(),
+			(unsigned long long)s.droppedDoppler.load(), (unsigned long long)s.droppedCfar.load());
+	std::printf("shed: coalesced %llu, skipped doppler %llu, skipped raw %llu, level raises %llu\n",
+			(unsigned long long)s.coalesced.load(), (unsigned long long)s.skippedDoppler.load(),
+			(unsigned long long)s.skippedRaw.load(), (unsigned long long)pipeline.shedding.raises.load());
+	std::printf("dirty: %llu polls with updates, %.1f of %zu tiles of %zux%zu cells and %.1f of %zu range bins per poll\n",
+			(unsigned long long)dirtyPolls, dirtyPolls ? dirtyTiles / dirtyPolls : 0.0,
+			dirty.getTilesYaw() * dirty.getTilesPitch(), cfg.dirtyTileSize, cfg.dirtyTileSize, dirtyPolls ? dirtyRange / dirtyPolls : 0.0,
+			cfg.rangeBins());
+	printLatency(pipeline);
+	if (sectorIndex.isOpen())
+		reportSectors(opt.sectors, sectorIndex, opt.scene.seed);
+	bool falseChanges = false;
+	if (changeDetector.isOpen()) {
+		reportChanges(opt.changes, changeDetector, changes);
+		// first visits only seed references, anything later is false alarm
+		bool moving = std::any_of(opt.scene.targets.begin(), opt.scene.targets.end(),
+				[](const SceneTarget& t) { return t.speed != 0; });
+		if (!moving) {
+			std::printf("static scene: %zu change records, expected none\n", changes.size());
+			falseChanges = !changes.empty();
+		}
+	}
+	return (opt.strict && dropped > 0) || falseChanges ? 1 : 0;
+}
+
+static int openPty(std::string& name)
+{
+	int master, slave;
+	char path[256];
+	if (openpty(&master, &slave, path, nullptr, nullptr) != 0)
+		throw std::runtime_error(std::string("openpty failed: ") + std::strerror(errno));
+	// raw line discipline, frames are binary
+	struct termios tio;
+	tcgetattr(slave, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+	// slave stays open so the master doesn't see hang up between clients
+	name = path;
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	return master;
+}
+
+// writes whole buffer to non blocking master, gives up when client stops reading
+static void writeAll(int fd, const uint8_t* data, size_t n)
+{
+	while (n > 0 && !interrupted) {
+		ssize_t w = write(fd, data, n);
+		if (w > 0) {
+			data += w;
+			n -= (size_t)w;
+		} else if (w < 0 && errno == EAGAIN) {
+			struct pollfd p = {fd, POLLOUT, 0};
+			if (poll(&p, 1, 100) == 0)
+				return;
+		} else if (w < 0 && errno != EINTR) {
+			return;
+		}
+	}
+}
+
+static int runPty(BenchOptions& opt, ScanProgram& scan)
+{
+	SceneGenerator scene;
+	scene.init(opt.scene);
+	std::string radarName, platformName;
+	int radar = openPty(radarName);
+	int platform = openPty(platformName);
+	std::printf("radar port %s\nplatform port %s\n", radarName.c_str(), platformName.c_str());
+	std::fflush(stdout);
+
+	const double speed = opt.speed > 0 ? opt.speed : 1.0;
+	std::vector<int16_t> i(opt.scene.samples), q(opt.scene.samples);
+	std::vector<uint8_t> frame(4 * opt.scene.samples + 11);
+	std::string command;
+	char line[128];
+	uint64_t frames = 0;
+	double start = monotonicSeconds();
+	double nextPose = start;
+	while (!interrupted) {
+		double now = monotonicSeconds();
+		double t = (now - start) * speed;
+		if (opt.duration > 0 && t > opt.duration)
+			break;
+		if (now >= nextPose) {
+			double yaw, pitch;
+			scan.pose(t, yaw, pitch);
+			int n = formatPoseLine(line, sizeof(line), (long long)(t * 1e3), yaw, pitch);
+			writeAll(platform, (const uint8_t*)line, (size_t)n);
+			nextPose += opt.posePeriod / speed;
+		}
+
+		struct pollfd fds[2] = {{radar, POLLIN, 0}, {platform, POLLIN, 0}};
+		int timeout = (int)std::max(0.0, std::ceil((nextPose - monotonicSeconds()) * 1e3));
+		if (poll(fds, 2, timeout) <= 0)
+			continue;
+		uint8_t buffer[256];
+		// commands to the table are accepted and ignored, scan is given up front
+		if (fds[1].revents & POLLIN)
+			while (read(platform, buffer, sizeof(buffer)) > 0) {
+			}
+		if (!(fds[0].revents & POLLIN))
+			continue;
+		ssize_t n;
+		while ((n = read(radar, buffer, sizeof(buffer))) > 0)
+			command.append((const char*)buffer, (size_t)n);
+		for (size_t lf; (lf = command.find('\n')) != std::string::npos; command.erase(0, lf + 1)) {
+			if (command.compare(0, 2, "!N") != 0)
+				continue; // configuration commands (!S, !B, !F, !P) keep the scene as configured
+			double ft = (monotonicSeconds() - start) * speed;
+			double yaw, pitch;
+			scan.pose(ft, yaw, pitch);
+			scene.chirp(ft, yaw, pitch, i.data(), q.data());
+			size_t length = encodeRadarFrame(i.data(), q.data(), opt.scene.samples, frame.data());
+			writeAll(radar, frame.data(), length);
+			frames++;
+		}
+	}
+	std::printf("%llu frames sent\n", (unsigned long long)frames);
+	close(radar);
+	close(platform);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || (std::strcmp(argv[1], "direct") != 0 && std::strcmp(argv[1], "pty") != 0)) {
+		std::fprintf(stderr, "usage: %s direct|pty [--conf fmcw.conf] [--program name] [--gcode text]\n"
+				"  [--target r,yaw,pitch[,amplitude[,speed]]]... [--noise rms] [--clutter n] [--seed n]\n"
+				"  [--duration s] [--speed n] [--pose-period s] [--dir path] [--streams n] [--sectors n] [--changes n] [--strict]\n", argv[0]);
+		return 2;
+	}
+	std::signal(SIGINT, onSignal);
+	std::signal(SIGTERM, onSignal);
+
+	try {
+		BenchOptions opt;
+		std::string conf, programName = "full";
+		bool noConfTargets = false;
+		for (int k = 2; k < argc; k++) {
+			std::string key = argv[k];
+			if (key == "--strict") {
+				opt.strict = true;
+				continue;
+			}
+			if (k + 1 >= argc)
+				throw std::runtime_error("Missing value of " + key);
+			std::string value = argv[++k];
+			if (key == "--conf")
+				conf = value;
+			else if (key == "--program")
+				programName = value;
+			else if (key == "--gcode")
+				opt.program = value;
+			else if (key == "--target") {
+				if (!noConfTargets)
+					opt.scene.targets.clear();
+				noConfTargets = true;
+				opt.scene.targets.push_back(parseTarget(value));
+			} else if (key == "--noise")
+				opt.scene.noise = std::atof(value.c_str());
+			else if (key == "--clutter")
+				opt.scene.clutterPoints = (size_t)std::atol(value.c_str());
+			else if (key == "--seed")
+				opt.scene.seed = (unsigned)std::atol(value.c_str());
+			else if (key == "--duration")
+				opt.duration = std::atof(value.c_str());
+			else if (key == "--speed")
+				opt.speed = std::atof(value.c_str());
+			else if (key == "--pose-period")
+				opt.posePeriod = std::max(std::atof(value.c_str()), 1e-3);
+			else if (key == "--dir")
+				opt.dir = value;
+			else if (key == "--streams")
+				opt.streams = std::max<size_t>((size_t)std::atol(value.c_str()), 1);
+			else if (key == "--sectors")
+				opt.sectors = (size_t)std::atol(value.c_str());
+			else if (key == "--changes")
+				opt.changes = (size_t)std::atol(value.c_str());
+			else
+				throw std::runtime_error("Unknown option " + key);
+		}
+		if (!noConfTargets) {
+			SceneTarget person;
+			person.range = 4;
+			person.yaw = 90;
+			person.pitch = 0;
+			person.speed = 0.01;
+			opt.scene.targets.push_back(person);
+		}
+
+		if (!conf.empty()) {
+			IniFile ini = readIni(conf);
+			opt.scene.samples = (size_t)iniNumber(ini, "radar", "samples", (double)opt.scene.samples);
+			opt.scene.bandwidth = iniNumber(ini, "radar", "bandwidth", opt.scene.bandwidth);
+			opt.scene.frontend = (int)iniNumber(ini, "radar", "header", opt.scene.frontend);
+			opt.chirpPeriod = iniNumber(ini, "radar", "trigger", opt.chirpPeriod * 1e3) * 1e-3;
+			opt.stepCountYaw = iniNumber(ini, "platform", "stepCountYaw", opt.stepCountYaw);
+			opt.stepCountPitch = iniNumber(ini, "platform", "stepCountPitch", opt.stepCountPitch);
+			PipelineConfig& p = opt.pipeline;
+			p.rangeNFFT = (size_t)iniNumber(ini, "processing", "rangeNFFT", (double)p.rangeNFFT);
+			p.speedNFFT = (size_t)iniNumber(ini, "processing", "speedNFFT", (double)p.speedNFFT);
+			p.calcSpeed = iniNumber(ini, "processing", "calcSpeed", p.calcSpeed) != 0;
+			p.calcCFAR = iniNumber(ini, "processing", "calcCFAR", p.calcCFAR) != 0;
+			p.calcRaw = iniNumber(ini, "processing", "calcRaw", p.calcRaw) != 0;
+			p.requirePosChange = iniNumber(ini, "processing", "requirePosChange", p.requirePosChange) != 0;
+			p.cfarGuard = (size_t)iniNumber(ini, "processing", "cfarGuard", (double)p.cfarGuard);
+			p.cfarTraining = (size_t)iniNumber(ini, "processing", "cfarTraining", (double)p.cfarTraining);
+			p.batchSize = (size_t)iniNumber(ini, "processing", "batchSize", (double)p.batchSize);
+			p.clutterEnable = iniNumber(ini, "processing", "clutterEnable", p.clutterEnable) != 0;
+			p.clutterAlpha = (float)iniNumber(ini, "processing", "clutterAlpha", p.clutterAlpha);
+			p.logCompress = iniNumber(ini, "processing", "logCompress", p.logCompress) != 0;
+			p.ringSize = (size_t)iniNumber(ini, "processing", "pipelineRingSize", (double)p.ringSize);
+			p.shedding = iniNumber(ini, "processing", "pipelineShedding", p.shedding) != 0;
+			p.dirtyTileSize = (size_t)iniNumber(ini, "processing", "dirtyTileSize", (double)p.dirtyTileSize);
+			opt.roi = iniNumber(ini, "processing", "roiEnable", opt.roi) != 0;
+			const char* roiKeys[6] = {"roiYawMin", "roiYawMax", "roiPitchMin", "roiPitchMax", "roiRangeMin", "roiRangeMax"};
+			for (int k = 0; k < 6; k++)
+				opt.roiBounds[k] = iniNumber(ini, "processing", roiKeys[k], opt.roiBounds[k]);
+			if (opt.program.empty() && ini["programs"].count(programName))
+				opt.program = ini["programs"][programName];
+		}
+		if (opt.program.empty())
+			opt.program = "G91\\nG21\\nG28\\nG92\\nM03 SY5 Y+\\nP29P91\\n"; // full turn at 5 rpm
+		if (opt.chirpPeriod <= 0)
+			throw std::runtime_error("Chirp period must be positive.");
+
+		ScanProgram scan(opt.stepCountYaw, opt.stepCountPitch);
+		std::string error;
+		if (!scan.load(opt.program, error))
+			throw std::runtime_error("Scan program: " + error);
+
+		return std::strcmp(argv[1], "direct") == 0 ? runDirect(opt, scan) : runPty(opt, scan);
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 2;
+	}
+}
@@ -0,0 +1,489 @@
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Synthetic FMCW scene for headless benchmarks
+//
+// SceneGenerator produces raw ADC chirps the SiRad frontend would return for
+// a set of point targets, static clutter and receiver noise. Chirp sweeps
+// bandwidth over samples+85 sample periods (same model as rangeBinWidth in
+// radar.m), so target at range R beats at 2*B*R/(c*(samples+85)) cycles per
+// sample and carries carrier phase 4*pi*f0*R/c which makes Doppler of moving
+// target between chirps. Echo amplitude falls with R^2 and antenna gain is
+// Gaussian beam around boresight. Samples are quantized to int16 with
+// saturation and encodeRadarFrame packs them to the same frame radarReader.h
+// parses.
+//
+// ScanProgram interprets G-code program of [programs] section the way
+// indexing table firmware runs it and gives platform pose at any time, so
+// matching !P lines can be produced. Both axes have their own command queue,
+// commands with both axes (G28, G92, W3, G0 Y P) start when both are idle.
+// Supported commands are G20/G21, G90/G91, G28, G92, G0 Y P S SY SP,
+// M03 Y+/Y-/P+/P- S SY SP, M05, W0/W1 Y P, W3 T and P29/P91 loop, motion is
+// constant speed without acceleration ramps.
+
+struct SceneTarget {
+	double range = 5;     // (m) at time 0
+	double yaw = 0;       // (deg)
+	double pitch = 0;     // (deg)
+	double amplitude = 2e4; // ADC counts at 1 m on boresight
+	double speed = 0;     // radial (m/s), positive moves away
+};
+
+struct SceneConfig {
+	size_t samples = 128;
+	double bandwidth = 5000;  // (MHz)
+	int frontend = 122;       // (GHz) carrier of SiRad frontend, 24 or 122
+	double beamYaw = 12;      // -3 dB beam width (deg)
+	double beamPitch = 12;
+	double noise = 4;         // rms of receiver noise (ADC counts)
+	size_t clutterPoints = 64; // static scatterers spread over all directions
+	double clutterAmplitude = 2e3; // ADC counts at 1 m, scatterer gets random fraction of it
+	double clutterRange = 8;  // (m) scatterers lie between 1 m and clutterRange
+	double leakage = 200;     // TX-RX leakage at zero range (ADC counts)
+	unsigned seed = 1;
+	std::vector<SceneTarget> targets;
+};
+
+// 9 byte header ('M' at offset 4), I/Q int16 little endian pairs and CR/LF,
+// out has to hold 4*samples + 11 bytes, returns frame length
+inline size_t encodeRadarFrame(const int16_t* i, const int16_t* q, size_t samples, uint8_t* out)
+{
+	static const uint8_t header[9] = {'!', 'M', '0', '0', 'M', '0', '0', '0', '0'};
+	std::memcpy(out, header, sizeof(header));
+	uint8_t* p = out + sizeof(header);
+	for (size_t k = 0; k < samples; k++) {
+		uint16_t vi = (uint16_t)i[k];
+		uint16_t vq = (uint16_t)q[k];
+		p[4 * k] = (uint8_t)(vi & 0xff);
+		p[4 * k + 1] = (uint8_t)(vi >> 8);
+		p[4 * k + 2] = (uint8_t)(vq & 0xff);
+		p[4 * k + 3] = (uint8_t)(vq >> 8);
+	}
+	p += 4 * samples;
+	p[0] = '\r';
+	p[1] = '\n';
+	return 4 * samples + 11;
+}
+
+// firmware reports both angles normalized to 0-360
+inline int formatPoseLine(char* out, size_t size, long long ms, double yaw, double pitch)
+{
+	auto normalize = [](double a) {
+		a = std::fmod(a, 360.0);
+		return a < 0 ? a + 360.0 : a;
+	};
+	return std::snprintf(out, size, "!P %lld, %f, %f\n", ms, normalize(yaw), normalize(pitch));
+}
+
+class SceneGenerator {
+	public:
+		static constexpr double c = 299792458.0;
+
+		void init(const SceneConfig& cfg)
+		{
+			config = cfg;
+			rng.seed(cfg.seed);
+			gauss = std::normal_distribution<double>(0.0, 1.0);
+			clutter.clear();
+			std::uniform_real_distribution<double> u(0.0, 1.0);
+			for (size_t k = 0; k < cfg.clutterPoints; k++) {
+				SceneTarget t;
+				t.yaw = 360.0 * u(rng);
+				t.pitch = -30.0 + 90.0 * u(rng);
+				t.range = 1.0 + (std::max(cfg.clutterRange, 1.0) - 1.0) * u(rng);
+				t.amplitude = cfg.clutterAmplitude * u(rng);
+				clutter.push_back(t);
+			}
+			re.assign(cfg.samples, 0.0);
+			im.assign(cfg.samples, 0.0);
+		}
+
+		const SceneConfig& getConfig() const
+		{
+			return config;
+		}
+
+		// range bin width (m) of range FFT of rangeNFFT points, radar.m model
+		double rangeBinWidth(size_t rangeNFFT) const
+		{
+			return c * (double)(config.samples + 85) / (2.0 * config.bandwidth * 1e6 * (double)rangeNFFT);
+		}
+
+		// unambiguous radial speed (m/s) for chirp period (s)
+		double maxSpeed(double chirpPeriod) const
+		{
+			return c / (4.0 * config.frontend * 1e9 * chirpPeriod);
+		}
+
+		// chirp received at time (s) with antenna pointing to yaw, pitch (deg)
+		void chirp(double time, double yaw, double pitch, int16_t* i, int16_t* q)
+		{
+			std::fill(re.begin(), re.end(), 0.0);
+			std::fill(im.begin(), im.end(), 0.0);
+			for (size_t k = 0; k < config.samples; k++)
+				re[k] = config.leakage;
+			for (const SceneTarget& t : clutter)
+				echo(t, t.range, yaw, pitch);
+			for (const SceneTarget& t : config.targets)
+				echo(t, t.range + t.speed * time, yaw, pitch);
+			for (size_t k = 0; k < config.samples; k++) {
+				i[k] = quantize(re[k] + config.noise * gauss(rng));
+				q[k] = quantize(im[k] + config.noise * gauss(rng));
+			}
+		}
+
+	private:
+		SceneConfig config;
+		std::vector<SceneTarget> clutter;
+		std::mt19937 rng;
+		std::normal_distribution<double> gauss;
+		std::vector<double> re;
+		std::vector<double> im;
+
+		// antenna gain (amplitude) of direction relative to boresight
+		double gain(double yaw, double pitch, double boresightYaw, double boresightPitch) const
+		{
+			double dy = std::remainder(yaw - boresightYaw, 360.0) / config.beamYaw;
+			double dp = (pitch - boresightPitch) / config.beamPitch;
+			// -3 dB of power at half of beam width
+			return std::exp(-2.0 * std::log(2.0) * (dy * dy + dp * dp));
+		}
+
+		void echo(const SceneTarget& t, double range, double yaw, double pitch)
+		{
+			if (range <= 0)
+				return;
+			double a = t.amplitude * gain(t.yaw, t.pitch, yaw, pitch) / (range * range);
+			if (a < 1e-3 * config.noise)
+				return;
+			double beat = 2.0 * M_PI * 2.0 * config.bandwidth * 1e6 * range / (c * (double)(config.samples + 85));
+			double wavelengths = 2.0 * range * config.frontend * 1e9 / c;
+			double phase = 2.0 * M_PI * (wavelengths - std::floor(wavelengths));
+			// phasor recurrence, error grows linearly over a few hundred samples
+			double pr = a * std::cos(phase), pi = a * std::sin(phase);
+			double sr = std::cos(beat), si = std::sin(beat);
+			for (size_t k = 0; k < config.samples; k++) {
+				re[k] += pr;
+				im[k] += pi;
+				double nr = pr * sr - pi * si;
+				pi = pr * si + pi * sr;
+				pr = nr;
+			}
+		}
+
+		static int16_t quantize(double v)
+		{
+			v = std::round(v);
+			return (int16_t)std::min(std::max(v, -32768.0), 32767.0);
+		}
+};
+
+class ScanProgram {
+	public:
+		// steps per revolution of both axes, used by G21 (step) units
+		ScanProgram(double stepCountYaw = 400, double stepCountPitch = 400)
+		{
+			axes[0].stepCount = stepCountYaw;
+			axes[1].stepCount = stepCountPitch;
+		}
+
+		// program as stored in fmcw.conf, lines separated by newline or
+		// literal \n, returns false and fills error on unsupported command
+		bool load(const std::string& program, std::string& error)
+		{
+			header.clear();
+			main.clear();
+			loop = false;
+			std::string text = program;
+			for (size_t p; (p = text.find("\\n")) != std::string::npos;)
+				text.replace(p, 2, "\n");
+			// P29 and P91 may share line with each other (P29P91)
+			for (size_t p; (p = text.find("P91")) != std::string::npos && p > 0 && text[p - 1] != '\n';)
+				text.insert(p, "\n");
+
+			std::vector<Command>* destination = &header;
+			std::istringstream lines(text);
+			std::string line;
+			while (std::getline(lines, line)) {
+				Command cmd;
+				if (!parse(line, cmd)) {
+					error = "unsupported command '" + line + "'";
+					return false;
+				}
+				if (cmd.code.empty())
+					continue;
+				if (cmd.code == "P29") {
+					loop = true;
+				} else if (cmd.code == "P91") {
+					destination = &main;
+				} else {
+					destination->push_back(cmd);
+				}
+			}
+			reset();
+			return true;
+		}
+
+		void reset()
+		{
+			for (Axis& a : axes) {
+				a.segments.assign(1, Segment());
+				a.clock = 0;
+				a.origin = 0;
+				a.rpm = 5;
+				a.spinning = false;
+			}
+			degrees = false;
+			relative = false;
+			for (const Command& cmd : header)
+				execute(cmd);
+		}
+
+		// pose (deg) at time (s) since program start, relative to G92 home
+		void pose(double time, double& yaw, double& pitch)
+		{
+			extend(time);
+			yaw = axes[0].at(time);
+			pitch = axes[1].at(time);
+		}
+
+	private:
+		struct Command {
+			std::string code;
+			bool has[2] = {false, false};  // Y, P
+			double value[2] = {0, 0};
+			int direction[2] = {0, 0};     // M03 Y+ / Y-
+			double rpm[2] = {-1, -1};      // S, SY, SP
+			double seconds = 0;            // waits
+		};
+
+		struct Segment {
+			double start = 0;    // (s)
+			double position = 0; // (deg) at start, relative to home
+			double rate = 0;     // (deg/s)
+		};
+
+		struct Axis {
+			double stepCount = 400;
+			std::vector<Segment> segments;
+			double clock = 0;    // queue of the axis is idle from here
+			double origin = 0;   // machine position of home (deg)
+			double rpm = 5;
+			bool spinning = false;
+
+			double at(double time) const
+			{
+				auto it = std::upper_bound(segments.begin(), segments.end(), time,
+						[](double t, const Segment& s) { return t < s.start; });
+				const Segment& s = it == segments.begin() ? segments.front() : *(it - 1);
+				return s.position + s.rate * (time - s.start);
+			}
+
+			void change(double time, double rate)
+			{
+				Segment s;
+				s.start = time;
+				s.position = at(time);
+				s.rate = rate;
+				while (!segments.empty() && segments.back().start >= time)
+					segments.pop_back();
+				segments.push_back(s);
+			}
+
+			void stop()
+			{
+				if (spinning)
+					change(clock, 0.0);
+				spinning = false;
+			}
+
+			void move(double target)
+			{
+				stop();
+				double from = at(clock);
+				double rate = rpm * 6.0;
+				if (target == from || rate <= 0)
+					return;
+				double duration = std::fabs(target - from) / rate;
+				change(clock, target > from ? rate : -rate);
+				clock += duration;
+				change(clock, 0.0);
+				segments.back().position = target;
+			}
+		};
+
+		Axis axes[2];
+		std::vector<Command> header;
+		std::vector<Command> main;
+		bool loop = false;
+		bool degrees = false;
+		bool relative = false;
+
+		static bool parse(std::string line, Command& cmd)
+		{
+			size_t comment = line.find(';');
+			if (comment != std::string::npos)
+				line.resize(comment);
+			std::string token;
+			std::istringstream words(line);
+			if (!(words >> token))
+				return true;
+			for (char& ch : token)
+				ch = (char)std::toupper((unsigned char)ch);
+			cmd.code = token;
+			static const char* const known[] = {"G20", "G21", "G90", "G91", "G28", "G92", "G0", "G00",
+				"M03", "M3", "M05", "M5", "W0", "W1", "W3", "P29", "P91"};
+			if (std::find_if(std::begin(known), std::end(known),
+					[&](const char* k) { return token == k; }) == std::end(known))
+				return false;
+			if (cmd.code == "G00")
+				cmd.code = "G0";
+			if (cmd.code == "M3")
+				cmd.code = "M03";
+			if (cmd.code == "M5")
+				cmd.code = "M05";
+			while (words >> token) {
+				char* end = nullptr;
+				auto number = [&](size_t from) {
+					double v = std::strtod(token.c_str() + from, &end);
+					return end != token.c_str() + from ? v : std::numeric_limits<double>::quiet_NaN();
+				};
+				char key = (char)std::toupper((unsigned char)token[0]);
+				char sub = token.size() > 1 ? (char)std::toupper((unsigned char)token[1]) : 0;
+				if (key == 'S' && (sub == 'Y' || sub == 'P')) {
+					cmd.rpm[sub == 'Y' ? 0 : 1] = number(2);
+				} else if (key == 'S') {
+					cmd.rpm[0] = cmd.rpm[1] = number(1);
+				} else if (key == 'T') {
+					cmd.seconds = number(1) * 1e-3;
+				} else if (key == 'Y' || key == 'P') {
+					int a = key == 'Y' ? 0 : 1;
+					cmd.has[a] = true;
+					if (token.size() == 2 && (sub == '+' || sub == '-'))
+						cmd.direction[a] = sub == '+' ? 1 : -1;
+					else if (token.size() > 1)
+						cmd.value[a] = number(1);
+				} else {
+					return false;
+				}
+				if (std::isnan(cmd.value[0]) || std::isnan(cmd.value[1]) || std::isnan(cmd.seconds))
+					return false;
+			}
+			return true;
+		}
+
+		double toDegrees(int a, double v) const
+		{
+			return degrees ? v : v * 360.0 / axes[a].stepCount;
+		}
+
+		// both axes continue when the later one is idle
+		void sync()
+		{
+			double t = std::max(axes[0].clock, axes[1].clock);
+			axes[0].clock = axes[1].clock = t;
+		}
+
+		void execute(const Command& cmd)
+		{
+			bool any = cmd.has[0] || cmd.has[1];
+			for (int a = 0; a < 2; a++) {
+				if (cmd.rpm[a] > 0)
+					axes[a].rpm = cmd.rpm[a];
+			}
+			if (cmd.code == "G20") {
+				degrees = true;
+			} else if (cmd.code == "G21") {
+				degrees = false;
+			} else if (cmd.code == "G90") {
+				relative = false;
+			} else if (cmd.code == "G91") {
+				relative = true;
+			} else if (cmd.code == "G28" || cmd.code == "G92") {
+				sync();
+				for (int a = 0; a < 2; a++) {
+					if (any && !cmd.has[a])
+						continue;
+					Axis& x = axes[a];
+					if (cmd.code == "G28") {
+						x.move(-x.origin);
+					} else {
+						x.stop();
+						double here = x.at(x.clock);
+						x.origin += here;
+						x.change(x.clock, 0.0);
+						x.segments.back().position = 0;
+					}
+				}
+				sync();
+			} else if (cmd.code == "G0") {
+				if (cmd.has[0] && cmd.has[1])
+					sync();
+				for (int a = 0; a < 2; a++) {
+					if (!cmd.has[a])
+						continue;
+					Axis& x = axes[a];
+					double v = toDegrees(a, cmd.value[a]);
+					x.move(relative ? x.at(x.clock) + v : v);
+				}
+				if (cmd.has[0] && cmd.has[1])
+					sync();
+			} else if (cmd.code == "M03") {
+				for (int a = 0; a < 2; a++) {
+					if (!cmd.has[a])
+						continue;
+					Axis& x = axes[a];
+					x.change(x.clock, (cmd.direction[a] < 0 ? -6.0 : 6.0) * x.rpm);
+					x.spinning = true;
+				}
+			} else if (cmd.code == "M05") {
+				for (int a = 0; a < 2; a++) {
+					if (!any || cmd.has[a])
+						axes[a].stop();
+				}
+			} else if (cmd.code == "W0" || cmd.code == "W1") {
+				double scale = cmd.code == "W0" ? 1.0 : 1e-3;
+				for (int a = 0; a < 2; a++) {
+					if (cmd.has[a])
+						axes[a].clock += cmd.value[a] * scale;
+				}
+			} else if (cmd.code == "W3") {
+				sync();
+				axes[0].clock += cmd.seconds;
+				axes[1].clock += cmd.seconds;
+			}
+		}
+
+		// runs main part of looped program until both queues reach time
+		void extend(double time)
+		{
+			if (!loop || main.empty())
+				return;
+			// axis the loop doesn't advance (idle or spinning) keeps its motion
+			bool advances[2] = {true, true};
+			while ((advances[0] && axes[0].clock <= time) || (advances[1] && axes[1].clock <= time)) {
+				double before[2] = {axes[0].clock, axes[1].clock};
+				for (const Command& cmd : main)
+					execute(cmd);
+				advances[0] = axes[0].clock > before[0];
+				advances[1] = axes[1].clock > before[1];
+				if (!advances[0] && !advances[1])
+					return;
+			}
+		}
+};
+
+#endif /* !SCENE_GENERATOR_H */
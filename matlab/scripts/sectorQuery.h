@@ -0,0 +1,521 @@
+#ifndef SECTOR_QUERY_H
+#define SECTOR_QUERY_H
+
+#include "dirtyTiles.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Sector queries over raw or CFAR cube
+//
+// Answers "total and maximum energy in yaw 40..80 deg, pitch 0..20 deg,
+// range 5..15 m" without slicing the cube. Cell value is the raw cube summed
+// over Doppler (or CFAR cube), index keeps per range bin summed-area tables
+// over yaw x pitch, cumulative over range as well, so sector sum is 8 corner
+// lookups of 3-D prefix sum. Maximum uses pyramid of 2x2x2 maxima, query
+// descends only into nodes partially covered by the sector that may still
+// beat the best value found.
+//
+// Prefix over yaw x pitch is split to tiles of tileSize x tileSize cells so
+// that batch written to the cube rebuilds only tiles it touched:
+//
+//   P(y, p) = C(i, j) + BR(y, j) + BC(p, i) + L(y, p)
+//
+// y = i*T + a, p = j*T + b, L is prefix inside the tile, BR sums full tiles
+// j' < j of yaw rows iT..y, BC full tiles i' < i of pitch columns jT..p and C
+// is prefix of tile totals. Dirty tile rebuilds its L, BR and BC of its band
+// from the tile on and C from the tile on, tile totals are L of the tile's
+// last cell.
+//
+// Whole cube decays every batch, index stores values divided by global scale
+// instead of touching every cell, scale is multiplied by batch decay and
+// results by scale. Values are renormalized by full rebuild when scale gets
+// small.
+//
+// Cube is mapped read-only, update has to be called by the thread writing the
+// cube after the batch (cube stage of RadarPipeline or MATLAB after
+// processBatch). Queries and updates are serialized by mutex.
+
+struct SectorIndexConfig {
+	std::string cubePath;
+	bool raw = true;               // raw cube summed over Doppler, otherwise CFAR cube
+	size_t rangeBins = 0;
+	size_t dopplerBins = 1;        // raw cube only
+	size_t yawBins = 0;
+	size_t pitchBins = 0;
+	double rangeBinWidth = 1.0;    // (m)
+	size_t rangeBinMin = 0;        // range FFT bin of first range bin (range gate)
+	int yawBinMin = 0;             // angle of first yaw and pitch bin (deg)
+	int pitchBinMin = -20;
+	size_t tileSize = 8;
+};
+
+// yaw arc goes from yawMin up to yawMax and may cross 0 deg (350..10),
+// yawMax - yawMin >= 360 is full circle, rangeMax 0 = up to the last bin
+struct SectorQuery {
+	double yawMin, yawMax;         // (deg)
+	double pitchMin, pitchMax;     // (deg)
+	double rangeMin, rangeMax;     // (m)
+};
+
+struct SectorResult {
+	double sum = 0.0;
+	double max = NAN;              // NaN for empty sector
+	double cells = 0.0;            // range x yaw x pitch cells in the sector
+};
+
+// cell of cube update, spread pattern around it is dirty as well
+struct SectorCell {
+	size_t yaw;
+	size_t pitch;
+};
+
+struct SectorIndexStats {
+	std::atomic<uint64_t> updates{0};   // batches applied
+	std::atomic<uint64_t> tiles{0};     // tiles rebuilt by updates
+	std::atomic<uint64_t> rebuilds{0};  // full rebuilds (open, renormalization)
+	std::atomic<uint64_t> queries{0};
+
+	void reset()
+	{
+		for (std::atomic<uint64_t>* c : {&updates, &tiles, &rebuilds, &queries})
+			c->store(0, std::memory_order_relaxed);
+	}
+};
+
+class SectorIndex {
+	public:
+		SectorIndexStats stats;
+
+		~SectorIndex()
+		{
+			close();
+		}
+
+		// With deferRebuild tables are built by the first update, for cube
+		// being written while index opens (running pipeline).
+		void open(const SectorIndexConfig& cfg, bool deferRebuild = false)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			unmap();
+			if (cfg.rangeBins == 0 || cfg.yawBins == 0 || cfg.pitchBins == 0 || cfg.tileSize == 0 ||
+					(cfg.raw && cfg.dopplerBins == 0) || !(cfg.rangeBinWidth > 0))
+				throw std::runtime_error("Invalid sector index dimensions.");
+			config = cfg;
+			raw.store(cfg.raw, std::memory_order_relaxed);
+			R = cfg.rangeBins;
+			Y = cfg.yawBins;
+			P = cfg.pitchBins;
+			T = cfg.tileSize;
+			tilesYaw = (Y + T - 1) / T;
+			tilesPitch = (P + T - 1) / T;
+			map(cfg.cubePath, R * (cfg.raw ? cfg.dopplerBins : 1) * Y * P);
+
+			local.assign(R * Y * P, 0.0);
+			rowBands.assign(R * Y * (tilesPitch + 1), 0.0);
+			columnBands.assign(R * P * (tilesYaw + 1), 0.0);
+			coarse.assign(R * (tilesYaw + 1) * (tilesPitch + 1), 0.0);
+			levels.clear();
+			size_t r = R, y = Y, p = P;
+			for (;;) {
+				levels.push_back({r, y, p, std::vector<float>(r * y * p, 0.0f)});
+				if (r == 1 && y == 1 && p == 1)
+					break;
+				r = (r + 1) / 2;
+				y = (y + 1) / 2;
+				p = (p + 1) / 2;
+			}
+			dirty.init(Y, P, T, R);
+			stats.reset();
+			scale = 1.0;
+			pendingRebuild = deferRebuild;
+			if (!deferRebuild)
+				rebuild();
+		}
+
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			unmap();
+			local = std::vector<double>();
+			rowBands = std::vector<double>();
+			columnBands = std::vector<double>();
+			coarse = std::vector<double>();
+			levels.clear();
+		}
+
+		bool isOpen() const
+		{
+			return cube != nullptr;
+		}
+
+		// index follows raw cube, otherwise CFAR cube
+		bool isRaw() const
+		{
+			return raw.load(std::memory_order_relaxed);
+		}
+
+		const SectorIndexConfig& getConfig() const
+		{
+			return config;
+		}
+
+		// Applies batch written to the cube: whole cube was scaled by decay and
+		// cells (with patternYaw x patternPitch spread around them, yaw wraps
+		// for full circle, otherwise clipped as by the cube update) rewritten.
+		void update(float decay, const std::vector<SectorCell>& cells, size_t patternYaw = 1, size_t patternPitch = 1)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!cube)
+				return;
+			stats.updates.fetch_add(1, std::memory_order_relaxed);
+			scale *= decay;
+			if (pendingRebuild || !(scale > minScale)) {
+				rebuild();
+				return;
+			}
+
+			for (const SectorCell& c : cells)
+				dirty.markCell(c.yaw, c.pitch, patternYaw, patternPitch);
+			if (dirty.empty())
+				return;
+
+			const double inverse = 1.0 / scale;
+			size_t iMin = tilesYaw, jMin = tilesPitch;
+			std::vector<size_t> bandPitchFrom(tilesYaw, tilesPitch), bandYawFrom(tilesPitch, tilesYaw);
+			dirty.forEach([&](size_t i, size_t j) {
+				loadTile(i, j, inverse);
+				buildTile(i, j);
+				updatePyramid(i * T, std::min((i + 1) * T, Y), j * T, std::min((j + 1) * T, P));
+				bandPitchFrom[i] = std::min(bandPitchFrom[i], j);
+				bandYawFrom[j] = std::min(bandYawFrom[j], i);
+				iMin = std::min(iMin, i);
+				jMin = std::min(jMin, j);
+				stats.tiles.fetch_add(1, std::memory_order_relaxed);
+			});
+			dirty.clear();
+			for (size_t i = 0; i < tilesYaw; i++)
+				if (bandPitchFrom[i] < tilesPitch)
+					buildRowBand(i, bandPitchFrom[i]);
+			for (size_t j = 0; j < tilesPitch; j++)
+				if (bandYawFrom[j] < tilesYaw)
+					buildColumnBand(j, bandYawFrom[j]);
+			buildCoarse(iMin, jMin);
+		}
+
+		// cube was zeroed
+		void reset()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!cube)
+				return;
+			std::fill(local.begin(), local.end(), 0.0);
+			std::fill(rowBands.begin(), rowBands.end(), 0.0);
+			std::fill(columnBands.begin(), columnBands.end(), 0.0);
+			std::fill(coarse.begin(), coarse.end(), 0.0);
+			for (Level& level : levels)
+				std::fill(level.max.begin(), level.max.end(), 0.0f);
+			scale = 1.0;
+			pendingRebuild = false;
+		}
+
+		void query(const SectorQuery* queries, SectorResult* results, size_t n)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.queries.fetch_add(n, std::memory_order_relaxed);
+			for (size_t k = 0; k < n; k++) {
+				results[k] = SectorResult();
+				if (cube && !pendingRebuild)
+					results[k] = query(queries[k]);
+			}
+		}
+
+	private:
+		static constexpr double minScale = 1e-12;
+
+		struct Level {
+			size_t R, Y, P;
+			std::vector<float> max; // [range x yaw x pitch]
+		};
+
+		SectorIndexConfig config;
+		std::atomic<bool> raw{true};
+		std::mutex mutex;
+		const float* cube = nullptr;
+		size_t cubeBytes = 0;
+		size_t R = 0, Y = 0, P = 0, T = 1;
+		size_t tilesYaw = 0, tilesPitch = 0;
+		double scale = 1.0;
+		bool pendingRebuild = false;
+
+		// all [range x ...] and cumulative over range
+		std::vector<double> local;       // L, [yaw x pitch]
+		std::vector<double> rowBands;    // BR, [yaw x (tilesPitch + 1)]
+		std::vector<double> columnBands; // BC, [pitch x (tilesYaw + 1)]
+		std::vector<double> coarse;      // C, [(tilesYaw + 1) x (tilesPitch + 1)]
+		std::vector<Level> levels;       // levels[0] holds cell values
+		DirtyTiles dirty;
+
+		void map(const std::string& path, size_t elements)
+		{
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::runtime_error("Failed to open cube file " + path);
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size < elements * sizeof(float)) {
+				::close(fd);
+				throw std::runtime_error("Cube file " + path + " is smaller than cube");
+			}
+			void* p = mmap(nullptr, elements * sizeof(float), PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (p == MAP_FAILED)
+				throw std::runtime_error("Failed to map cube file " + path);
+			cube = (const float*)p;
+			cubeBytes = elements * sizeof(float);
+		}
+
+		void unmap()
+		{
+			if (cube)
+				munmap((void*)cube, cubeBytes);
+			cube = nullptr;
+			cubeBytes = 0;
+		}
+
+		void rebuild()
+		{
+			stats.rebuilds.fetch_add(1, std::memory_order_relaxed);
+			scale = 1.0;
+			pendingRebuild = false;
+			dirty.clear();
+			for (size_t j = 0; j < tilesPitch; j++)
+				for (size_t i = 0; i < tilesYaw; i++) {
+					loadTile(i, j, 1.0);
+					buildTile(i, j);
+				}
+			updatePyramid(0, Y, 0, P);
+			for (size_t i = 0; i < tilesYaw; i++)
+				buildRowBand(i, 0);
+			for (size_t j = 0; j < tilesPitch; j++)
+				buildColumnBand(j, 0);
+			buildCoarse(0, 0);
+		}
+
+		// cell values of the tile from the cube
+		void loadTile(size_t i, size_t j, double inverse)
+		{
+			const size_t D = config.raw ? config.dopplerBins : 1;
+			float* values = levels[0].max.data();
+			for (size_t p = j * T; p < std::min((j + 1) * T, P); p++)
+				for (size_t y = i * T; y < std::min((i + 1) * T, Y); y++) {
+					const size_t cell = y + p * Y;
+					const float* src = cube + cell * R * D;
+					float* dst = values + cell * R;
+					for (size_t r = 0; r < R; r++) {
+						double v = src[r];
+						for (size_t d = 1; d < D; d++)
+							v += src[r + d * R];
+						dst[r] = (float)(v * inverse);
+					}
+				}
+		}
+
+		// prefix L inside the tile, cumulative over range
+		void buildTile(size_t i, size_t j)
+		{
+			const float* values = levels[0].max.data();
+			const size_t y0 = i * T, p0 = j * T;
+			for (size_t p = p0; p < std::min(p0 + T, P); p++)
+				for (size_t y = y0; y < std::min(y0 + T, Y); y++) {
+					const float* v = values + (y + p * Y) * R;
+					double* dst = local.data() + (y + p * Y) * R;
+					const double* left = y > y0 ? dst - R : nullptr;
+					const double* below = p > p0 ? dst - Y * R : nullptr;
+					const double* corner = left && below ? below - R : nullptr;
+					double column = 0.0;
+					for (size_t r = 0; r < R; r++) {
+						column += v[r];
+						double s = column;
+						if (left)
+							s += left[r];
+						if (below)
+							s += below[r];
+						if (corner)
+							s -= corner[r];
+						dst[r] = s;
+					}
+				}
+		}
+
+		// BR(y, j + 1) = BR(y, j) + L(y, last pitch of tile j) for yaw rows of band i
+		void buildRowBand(size_t i, size_t from)
+		{
+			for (size_t y = i * T; y < std::min((i + 1) * T, Y); y++)
+				for (size_t j = from; j < tilesPitch; j++) {
+					size_t last = std::min((j + 1) * T, P) - 1;
+					const double* prev = rowBands.data() + (y + j * Y) * R;
+					const double* tile = local.data() + (y + last * Y) * R;
+					double* dst = rowBands.data() + (y + (j + 1) * Y) * R;
+					for (size_t r = 0; r < R; r++)
+						dst[r] = prev[r] + tile[r];
+				}
+		}
+
+		// BC(p, i + 1) = BC(p, i) + L(last yaw of tile i, p) for pitch columns of band j
+		void buildColumnBand(size_t j, size_t from)
+		{
+			for (size_t p = j * T; p < std::min((j + 1) * T, P); p++)
+				for (size_t i = from; i < tilesYaw; i++) {
+					size_t last = std::min((i + 1) * T, Y) - 1;
+					const double* prev = columnBands.data() + (p + i * P) * R;
+					const double* tile = local.data() + (last + p * Y) * R;
+					double* dst = columnBands.data() + (p + (i + 1) * P) * R;
+					for (size_t r = 0; r < R; r++)
+						dst[r] = prev[r] + tile[r];
+				}
+		}
+
+		// C(i + 1, j + 1) = C(i, j + 1) + C(i + 1, j) - C(i, j) + total(i, j)
+		void buildCoarse(size_t iMin, size_t jMin)
+		{
+			const size_t stride = tilesYaw + 1;
+			for (size_t j = jMin; j < tilesPitch; j++)
+				for (size_t i = iMin; i < tilesYaw; i++) {
+					size_t lastYaw = std::min((i + 1) * T, Y) - 1;
+					size_t lastPitch = std::min((j + 1) * T, P) - 1;
+					const double* total = local.data() + (lastYaw + lastPitch * Y) * R;
+					const double* a = coarse.data() + (i + (j + 1) * stride) * R;
+					const double* b = coarse.data() + ((i + 1) + j * stride) * R;
+					const double* c = coarse.data() + (i + j * stride) * R;
+					double* dst = coarse.data() + ((i + 1) + (j + 1) * stride) * R;
+					for (size_t r = 0; r < R; r++)
+						dst[r] = a[r] + b[r] - c[r] + total[r];
+				}
+		}
+
+		// maxima of levels above changed cells [y0, y1) x [p0, p1)
+		void updatePyramid(size_t y0, size_t y1, size_t p0, size_t p1)
+		{
+			for (size_t l = 1; l < levels.size(); l++) {
+				const Level& child = levels[l - 1];
+				Level& level = levels[l];
+				y0 /= 2;
+				p0 /= 2;
+				y1 = (y1 - 1) / 2 + 1;
+				p1 = (p1 - 1) / 2 + 1;
+				for (size_t p = p0; p < p1; p++)
+					for (size_t y = y0; y < y1; y++) {
+						float* dst = level.max.data() + (y + p * level.Y) * level.R;
+						for (size_t r = 0; r < level.R; r++) {
+							float m = -INFINITY;
+							for (size_t cp = 2 * p; cp < std::min(2 * p + 2, child.P); cp++)
+								for (size_t cy = 2 * y; cy < std::min(2 * y + 2, child.Y); cy++) {
+									const float* src = child.max.data() + (cy + cp * child.Y) * child.R;
+									for (size_t cr = 2 * r; cr < std::min(2 * r + 2, child.R); cr++)
+										m = std::max(m, src[cr]);
+								}
+							dst[r] = m;
+						}
+					}
+			}
+		}
+
+		// prefix over yaw <= y, pitch <= p at range bin r (cumulative over range)
+		double prefix(long y, long p, long r) const
+		{
+			if (y < 0 || p < 0 || r < 0)
+				return 0.0;
+			const size_t i = (size_t)y / T, j = (size_t)p / T;
+			return coarse[(i + j * (tilesYaw + 1)) * R + r] +
+				rowBands[((size_t)y + j * Y) * R + r] +
+				columnBands[((size_t)p + i * P) * R + r] +
+				local[((size_t)y + (size_t)p * Y) * R + r];
+		}
+
+		double boxSum(long y0, long y1, long p0, long p1, long r0, long r1) const
+		{
+			auto plane = [&](long r) {
+				return prefix(y1, p1, r) - prefix(y0 - 1, p1, r) - prefix(y1, p0 - 1, r) + prefix(y0 - 1, p0 - 1, r);
+			};
+			return plane(r1) - plane(r0 - 1);
+		}
+
+		float boxMax(long y0, long y1, long p0, long p1, long r0, long r1) const
+		{
+			struct Node {
+				size_t level, r, y, p;
+			};
+			float best = -INFINITY;
+			std::vector<Node> stack;
+			stack.push_back({levels.size() - 1, 0, 0, 0});
+			while (!stack.empty()) {
+				Node n = stack.back();
+				stack.pop_back();
+				const Level& level = levels[n.level];
+				float value = level.max[(n.y + n.p * level.Y) * level.R + n.r];
+				if (value <= best)
+					continue;
+				// cells covered by the node
+				long ra = (long)(n.r << n.level), rb = ra + (1L << n.level) - 1;
+				long ya = (long)(n.y << n.level), yb = ya + (1L << n.level) - 1;
+				long pa = (long)(n.p << n.level), pb = pa + (1L << n.level) - 1;
+				if (rb < r0 || ra > r1 || yb < y0 || ya > y1 || pb < p0 || pa > p1)
+					continue;
+				if (ra >= r0 && std::min(rb, (long)R - 1) <= r1 && ya >= y0 && std::min(yb, (long)Y - 1) <= y1 &&
+						pa >= p0 && std::min(pb, (long)P - 1) <= p1) {
+					best = value;
+					continue;
+				}
+				const Level& child = levels[n.level - 1];
+				for (size_t cp = 2 * n.p; cp < std::min(2 * n.p + 2, child.P); cp++)
+					for (size_t cy = 2 * n.y; cy < std::min(2 * n.y + 2, child.Y); cy++)
+						for (size_t cr = 2 * n.r; cr < std::min(2 * n.r + 2, child.R); cr++)
+							stack.push_back({n.level - 1, cr, cy, cp});
+			}
+			return best;
+		}
+
+		SectorResult query(const SectorQuery& q) const
+		{
+			SectorResult result;
+			const double width = config.rangeBinWidth;
+			const double rangeMin = std::lround(q.rangeMin / width) - (double)config.rangeBinMin;
+			const double rangeMax = q.rangeMax > 0 ? std::lround(q.rangeMax / width) - (double)config.rangeBinMin : (double)R - 1;
+			const long r0 = (long)std::max(rangeMin, 0.0);
+			const long r1 = (long)std::min(rangeMax, (double)R - 1);
+			const long p0 = std::max(std::lround(q.pitchMin) - config.pitchBinMin, 0L);
+			const long p1 = std::min(std::lround(q.pitchMax) - config.pitchBinMin, (long)P - 1);
+			if (r0 > r1 || p0 > p1)
+				return result;
+
+			// yaw arc relative to the first yaw bin, its copy one turn lower
+			// covers the part behind 360 deg
+			long start = std::lround(q.yawMin);
+			long length = q.yawMax - q.yawMin >= 359.5 ? 359 : ((std::lround(q.yawMax) - start) % 360 + 360) % 360;
+			start = ((start - config.yawBinMin) % 360 + 360) % 360;
+			for (long shift : {0L, -360L}) {
+				long y0 = std::max(start + shift, 0L);
+				long y1 = std::min(start + shift + length, (long)Y - 1);
+				if (y0 > y1)
+					continue;
+				double max = (double)boxMax(y0, y1, p0, p1, r0, r1) * scale;
+				result.sum += boxSum(y0, y1, p0, p1, r0, r1) * scale;
+				result.max = result.cells > 0 ? std::max(result.max, max) : max;
+				result.cells += (double)((y1 - y0 + 1) * (p1 - p0 + 1) * (r1 - r0 + 1));
+			}
+			return result;
+		}
+};
+
+#endif /* !SECTOR_QUERY_H */
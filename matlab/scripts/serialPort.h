@@ -0,0 +1,98 @@
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+
+// POSIX serial port helpers shared by native readers
+
+// seconds of CLOCK_MONOTONIC, readers add offset to MATLAB time base
+inline double monotonicSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+inline speed_t serialSpeed(int baudrate)
+{
+	switch (baudrate) {
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+#ifdef B460800
+		case 460800: return B460800;
+#endif
+#ifdef B921600
+		case 921600: return B921600;
+#endif
+#ifdef B1000000
+		case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+		case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+		case 3000000: return B3000000;
+#endif
+		default: throw std::runtime_error("Unsupported baudrate " + std::to_string(baudrate));
+	}
+}
+
+// Opens port in raw 8N1 mode. read() returns as soon as vmin bytes arrived or
+// vtime tenths of second passed since the last byte (termios VMIN/VTIME), with
+// vmin = 0 it returns after vtime even if nothing came, so reader threads can
+// check their stop flag.
+inline int openSerial(const std::string& path, int baudrate, int vmin = 0, int vtime = 1)
+{
+	int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+
+	struct termios tio;
+	if (tcgetattr(fd, &tio) != 0) {
+		::close(fd);
+		throw std::runtime_error("Failed to get attributes of " + path);
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~CRTSCTS;
+	tio.c_cc[VMIN] = (cc_t)vmin;
+	tio.c_cc[VTIME] = (cc_t)vtime;
+	speed_t speed = serialSpeed(baudrate);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+		::close(fd);
+		throw std::runtime_error("Failed to configure " + path);
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+// writes whole buffer, false on error
+inline bool writeAll(int fd, const char* data, size_t length)
+{
+	while (length > 0) {
+		ssize_t n = ::write(fd, data, length);
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			return false;
+		}
+		data += n;
+		length -= (size_t)n;
+	}
+	return true;
+}
+
+#endif /* !SERIAL_PORT_H */
@@ -0,0 +1,535 @@
+#ifndef SHM_EXPORT_H
+#define SHM_EXPORT_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Export of cubes, projections and detections to POSIX shared memory
+//
+// Region starts with ShmHeader describing arrays (name, dtype, shape in
+// MATLAB column major order, offset within slot) followed by numSlots slots.
+// Every slot starts with ShmSlot (sequence, publication fields, valid count
+// of every array) followed by its own copy of the arrays, 64 byte aligned:
+//
+//   rawCube           single [range x doppler x yaw x pitch]
+//   cfarCube          single [range x yaw x pitch]
+//   rangeAzimuth      single [range x yaw], raw cube summed over Doppler,
+//                     maximum over pitch
+//   cfarRangeAzimuth  single [range x yaw], maximum over pitch
+//   detections        single [4 x maxDetections], (range (m), yaw, pitch (deg),
+//                     CFAR value) of cells over threshold, count rows valid
+//
+// Publication goes to the slot after current one, writer makes sequence of
+// the slot odd, writes it, makes it even again and only then stores slot
+// index to ShmHeader::current. Reader attaches read-only, reads current slot
+// in place and accepts what it read only if slot sequence was even and
+// unchanged around the read (ShmReader). Writer gets back to the slot reader
+// is in only after numSlots - 1 further publications, so reads taking as
+// long as cube copy succeed even when publication runs back to back.
+// Readers never block the writer.
+//
+// ShmExport copies from the cube files MATLAB and native pipeline write on
+// its own thread, publish only wakes it, so exporting costs cube update
+// nothing. Requests coming while copy is running are merged into one.
+
+enum ShmDtype {
+	SHM_SINGLE = 1
+};
+
+struct ShmArrayInfo {
+	char name[24];
+	uint32_t dtype;
+	uint32_t ndims;
+	uint64_t shape[4];   // unused dimensions are 1
+	uint64_t offset;     // bytes from slot start
+	uint64_t bytes;      // capacity
+};
+
+constexpr uint32_t shmMaxArrays = 8;
+
+struct ShmSlot {
+	std::atomic<uint64_t> sequence;  // odd while writer updates the slot
+	uint64_t generation;             // publications since open
+	double time;                     // unix time of publication (s)
+	double lastYaw;                  // position of last cube update (deg)
+	double lastPitch;
+	uint64_t count[shmMaxArrays];    // valid elements, rows of detections
+};
+
+struct ShmHeader {
+	static constexpr uint32_t currentVersion = 3;
+	static constexpr uint32_t maxArrays = shmMaxArrays;
+
+	char magic[8];                   // "FMCWSHM"
+	std::atomic<uint32_t> version;   // stored last, layout is complete once it is currentVersion
+	uint32_t numArrays;
+	uint64_t totalBytes;
+	uint64_t numSlots;
+	uint64_t slotOffset;             // bytes from region start to slot 0
+	uint64_t slotBytes;              // slot k starts at slotOffset + k * slotBytes
+	std::atomic<uint64_t> current;   // slot of the newest publication
+	double rangeBinWidth;            // (m)
+	int32_t yawBinMin;               // angle of first yaw and pitch bin (deg)
+	int32_t pitchBinMin;
+	uint32_t rangeBinMin;            // range FFT bin of first range bin (range gate)
+	uint32_t reserved;
+	ShmArrayInfo arrays[maxArrays];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock needs lock-free 64 bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "layout flag needs lock-free 32 bit atomics");
+
+struct ShmExportConfig {
+	std::string name = "/fmcwRadar";
+	size_t rangeBins = 64;
+	size_t dopplerBins = 1;
+	size_t yawBins = 360;
+	size_t pitchBins = 81;
+	bool raw = true;
+	bool cfar = true;
+	std::string rawCubePath;
+	std::string cfarCubePath;
+	double rangeBinWidth = 1.0;
+	int yawBinMin = 0;
+	int pitchBinMin = -20;
+	size_t rangeBinMin = 0;
+	float detectionThreshold = 0.2f;
+	size_t maxDetections = 4096;
+	size_t slots = 3;              // copies of the arrays, at least 2
+};
+
+struct ShmExportStats {
+	std::atomic<uint64_t> requests{0};
+	std::atomic<uint64_t> published{0};
+	std::atomic<uint64_t> truncated{0}; // publications with more detections than maxDetections
+};
+
+// read-only mapping of cube file
+class ShmSource {
+	public:
+		const float* data = nullptr;
+		size_t elements = 0;
+
+		ShmSource() = default;
+		ShmSource(const ShmSource&) = delete;
+		ShmSource& operator=(const ShmSource&) = delete;
+		~ShmSource() { close(); }
+
+		void open(const std::string& path, size_t numElements)
+		{
+			close();
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::runtime_error("Failed to open cube file " + path);
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size < numElements * sizeof(float)) {
+				::close(fd);
+				throw std::runtime_error("Cube file " + path + " is smaller than cube");
+			}
+			void* p = mmap(nullptr, numElements * sizeof(float), PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (p == MAP_FAILED)
+				throw std::runtime_error("Failed to map cube file " + path);
+			data = (const float*)p;
+			elements = numElements;
+		}
+
+		void close()
+		{
+			if (data)
+				munmap((void*)data, elements * sizeof(float));
+			data = nullptr;
+			elements = 0;
+		}
+};
+
+class ShmExport {
+	public:
+		ShmExportStats stats;
+
+		~ShmExport() { close(); }
+
+		bool isOpen() const
+		{
+			return region != nullptr;
+		}
+
+		void open(const ShmExportConfig& cfg)
+		{
+			close();
+			if (cfg.slots < 2)
+				throw std::runtime_error("Shared memory export needs at least 2 slots.");
+			config = cfg;
+			const size_t R = cfg.rangeBins, D = cfg.dopplerBins, Y = cfg.yawBins, P = cfg.pitchBins;
+			if (cfg.raw)
+				rawSource.open(cfg.rawCubePath, R * D * Y * P);
+			if (cfg.cfar)
+				cfarSource.open(cfg.cfarCubePath, R * Y * P);
+
+			ShmArrayInfo arrays[ShmHeader::maxArrays] = {};
+			uint32_t numArrays = 0;
+			size_t offset = align(sizeof(ShmSlot));
+			auto add = [&](const char* name, std::initializer_list<uint64_t> shape, int& index) {
+				ShmArrayInfo& a = arrays[numArrays];
+				std::strncpy(a.name, name, sizeof(a.name) - 1);
+				a.dtype = SHM_SINGLE;
+				a.ndims = (uint32_t)shape.size();
+				uint64_t elements = 1;
+				size_t d = 0;
+				for (uint64_t s : shape) {
+					a.shape[d++] = s;
+					elements *= s;
+				}
+				for (; d < 4; d++)
+					a.shape[d] = 1;
+				a.offset = offset;
+				a.bytes = elements * sizeof(float);
+				offset = align(offset + a.bytes);
+				index = (int)numArrays++;
+			};
+			rawIndex = cfarIndex = rawProjectionIndex = cfarProjectionIndex = -1;
+			if (cfg.raw) {
+				add("rawCube", {R, D, Y, P}, rawIndex);
+				add("rangeAzimuth", {R, Y}, rawProjectionIndex);
+			}
+			if (cfg.cfar) {
+				add("cfarCube", {R, Y, P}, cfarIndex);
+				add("cfarRangeAzimuth", {R, Y}, cfarProjectionIndex);
+			}
+			add("detections", {4, cfg.maxDetections}, detectionIndex);
+			const size_t slotBytes = offset;
+			const size_t slotOffset = align(sizeof(ShmHeader));
+			offset = slotOffset + cfg.slots * slotBytes;
+
+			// region left by crashed session is replaced, its readers have to
+			// attach again
+			shm_unlink(cfg.name.c_str());
+			int fd = shm_open(cfg.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+			if (fd < 0)
+				throw std::runtime_error("Failed to create shared memory " + cfg.name);
+			if (ftruncate(fd, (off_t)offset) != 0) {
+				::close(fd);
+				shm_unlink(cfg.name.c_str());
+				throw std::runtime_error("Failed to size shared memory " + cfg.name);
+			}
+			void* p = mmap(nullptr, offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (p == MAP_FAILED) {
+				shm_unlink(cfg.name.c_str());
+				throw std::runtime_error("Failed to map shared memory " + cfg.name);
+			}
+			region = (uint8_t*)p;
+			regionBytes = offset;
+			// fresh region is zeroed, version is stored once the layout is
+			// complete, readers attaching meanwhile retry. Slot 0 holds zero
+			// cubes until the first publication
+			header = (ShmHeader*)region;
+			std::memcpy(header->magic, "FMCWSHM", 8);
+			header->numArrays = numArrays;
+			header->totalBytes = offset;
+			header->numSlots = cfg.slots;
+			header->slotOffset = slotOffset;
+			header->slotBytes = slotBytes;
+			header->current.store(0, std::memory_order_relaxed);
+			header->rangeBinWidth = cfg.rangeBinWidth;
+			header->yawBinMin = cfg.yawBinMin;
+			header->pitchBinMin = cfg.pitchBinMin;
+			header->rangeBinMin = (uint32_t)cfg.rangeBinMin;
+			std::memcpy(header->arrays, arrays, sizeof(arrays));
+			for (size_t k = 0; k < cfg.slots; k++) {
+				ShmSlot* slot = slotAt(k);
+				slot->sequence.store(2, std::memory_order_relaxed);
+				for (uint32_t a = 0; a < numArrays; a++)
+					slot->count[a] = arrays[a].bytes / sizeof(float);
+				slot->count[detectionIndex] = 0;
+			}
+			generation = 0;
+			header->version.store(ShmHeader::currentVersion, std::memory_order_release);
+
+			stats.requests.store(0, std::memory_order_relaxed);
+			stats.published.store(0, std::memory_order_relaxed);
+			stats.truncated.store(0, std::memory_order_relaxed);
+			pending = false;
+			running = true;
+			worker = std::thread(&ShmExport::run, this);
+		}
+
+		// never blocks on copy, newer request replaces waiting one
+		void publish(double yaw, double pitch)
+		{
+			if (!isOpen())
+				return;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pendingYaw = yaw;
+				pendingPitch = pitch;
+				pending = true;
+			}
+			stats.requests.fetch_add(1, std::memory_order_relaxed);
+			wake.notify_one();
+		}
+
+		// region is unlinked, attached readers keep their mapping
+		void close()
+		{
+			if (worker.joinable()) {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					running = false;
+				}
+				wake.notify_one();
+				worker.join();
+			}
+			if (region) {
+				munmap(region, regionBytes);
+				shm_unlink(config.name.c_str());
+			}
+			region = nullptr;
+			header = nullptr;
+			rawSource.close();
+			cfarSource.close();
+		}
+
+	private:
+		ShmExportConfig config;
+		ShmSource rawSource;
+		ShmSource cfarSource;
+		uint8_t* region = nullptr;
+		size_t regionBytes = 0;
+		ShmHeader* header = nullptr;
+		int rawIndex = -1;
+		int cfarIndex = -1;
+		int rawProjectionIndex = -1;
+		int cfarProjectionIndex = -1;
+		int detectionIndex = -1;
+		uint64_t generation = 0;
+
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool running = false;
+		bool pending = false;
+		double pendingYaw = 0;
+		double pendingPitch = 0;
+
+		static size_t align(size_t n)
+		{
+			return (n + 63) & ~(size_t)63;
+		}
+
+		ShmSlot* slotAt(size_t k)
+		{
+			return (ShmSlot*)(region + header->slotOffset + k * header->slotBytes);
+		}
+
+		float* array(ShmSlot* slot, int index)
+		{
+			return (float*)((uint8_t*)slot + header->arrays[index].offset);
+		}
+
+		void run()
+		{
+			std::vector<float> sum(config.rangeBins);
+			while (true) {
+				double yaw, pitch;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&] { return pending || !running; });
+					if (!running)
+						return;
+					yaw = pendingYaw;
+					pitch = pendingPitch;
+					pending = false;
+				}
+				write(yaw, pitch, sum);
+			}
+		}
+
+		void write(double yaw, double pitch, std::vector<float>& sum)
+		{
+			const size_t R = config.rangeBins, D = config.dopplerBins, Y = config.yawBins, P = config.pitchBins;
+			// readers stay on current slot, the one after it is written
+			const size_t k = (header->current.load(std::memory_order_relaxed) + 1) % config.slots;
+			ShmSlot* slot = slotAt(k);
+			uint64_t s = slot->sequence.load(std::memory_order_relaxed);
+			slot->sequence.store(s + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			if (rawIndex >= 0) {
+				float* raw = array(slot, rawIndex);
+				std::memcpy(raw, rawSource.data, R * D * Y * P * sizeof(float));
+				float* projection = array(slot, rawProjectionIndex);
+				std::fill(projection, projection + R * Y, 0.0f);
+				for (size_t p = 0; p < P; p++) {
+					for (size_t y = 0; y < Y; y++) {
+						const float* cell = raw + (p * Y + y) * R * D;
+						std::copy(cell, cell + R, sum.begin());
+						for (size_t d = 1; d < D; d++) {
+							for (size_t r = 0; r < R; r++)
+								sum[r] += cell[d * R + r];
+						}
+						float* out = projection + y * R;
+						for (size_t r = 0; r < R; r++)
+							out[r] = std::max(out[r], sum[r]);
+					}
+				}
+			}
+
+			if (cfarIndex >= 0) {
+				float* cfar = array(slot, cfarIndex);
+				std::memcpy(cfar, cfarSource.data, R * Y * P * sizeof(float));
+				float* projection = array(slot, cfarProjectionIndex);
+				std::fill(projection, projection + R * Y, 0.0f);
+				float* detections = array(slot, detectionIndex);
+				size_t n = 0;
+				bool truncated = false;
+				for (size_t p = 0; p < P; p++) {
+					for (size_t y = 0; y < Y; y++) {
+						const float* cell = cfar + (p * Y + y) * R;
+						float* out = projection + y * R;
+						for (size_t r = 0; r < R; r++) {
+							out[r] = std::max(out[r], cell[r]);
+							if (cell[r] < config.detectionThreshold)
+								continue;
+							if (n == config.maxDetections) {
+								truncated = true;
+								continue;
+							}
+							float* d = detections + 4 * n++;
+							d[0] = (float)((config.rangeBinMin + r) * config.rangeBinWidth);
+							d[1] = (float)(config.yawBinMin + (int)y);
+							d[2] = (float)(config.pitchBinMin + (int)p);
+							d[3] = cell[r];
+						}
+					}
+				}
+				slot->count[detectionIndex] = n;
+				if (truncated)
+					stats.truncated.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			slot->time = (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+			slot->lastYaw = yaw;
+			slot->lastPitch = pitch;
+			slot->generation = ++generation;
+			slot->sequence.store(s + 2, std::memory_order_release);
+			header->current.store(k, std::memory_order_release);
+			stats.published.fetch_add(1, std::memory_order_relaxed);
+		}
+};
+
+// Consumer side, attaches read-only, never writes to the region
+class ShmReader {
+	public:
+		~ShmReader() { detach(); }
+
+		// false if region doesn't exist (yet) or its layout isn't complete
+		bool attach(const std::string& name)
+		{
+			detach();
+			int fd = shm_open(name.c_str(), O_RDONLY, 0);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmHeader)) {
+				::close(fd);
+				return false;
+			}
+			void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (p == MAP_FAILED)
+				return false;
+			region = (const uint8_t*)p;
+			regionBytes = (size_t)st.st_size;
+			const ShmHeader* h = header();
+			if (h->version.load(std::memory_order_acquire) != ShmHeader::currentVersion ||
+					h->numSlots == 0 || h->slotOffset + h->numSlots * h->slotBytes > regionBytes) {
+				detach();
+				return false;
+			}
+			return true;
+		}
+
+		void detach()
+		{
+			if (region)
+				munmap((void*)region, regionBytes);
+			region = nullptr;
+		}
+
+		const ShmHeader* header() const
+		{
+			return (const ShmHeader*)region;
+		}
+
+		// array by name, nullptr if not exported
+		const ShmArrayInfo* find(const char* name) const
+		{
+			const ShmHeader* h = header();
+			for (uint32_t k = 0; k < std::min(h->numArrays, ShmHeader::maxArrays); k++) {
+				if (std::strncmp(h->arrays[k].name, name, sizeof(h->arrays[k].name)) == 0)
+					return &h->arrays[k];
+			}
+			return nullptr;
+		}
+
+		const float* data(const ShmSlot& slot, const ShmArrayInfo& a) const
+		{
+			return (const float*)((const uint8_t*)&slot + a.offset);
+		}
+
+		uint64_t count(const ShmSlot& slot, const ShmArrayInfo& a) const
+		{
+			return slot.count[&a - header()->arrays];
+		}
+
+		// calls read(slot) on the newest publication until it ran over
+		// consistent one, read must not keep pointers into the region, false
+		// after retries attempts. Slot being rewritten means writer went
+		// around all slots meanwhile, reader backs off exponentially up to
+		// the time one slot takes to copy
+		template <typename F>
+		bool read(F&& read, int retries = 100) const
+		{
+			const ShmHeader* h = header();
+			const double slotSeconds = (double)h->slotBytes / copyBytesPerSecond;
+			double wait = 1e-6;
+			for (int k = 0; k < retries; k++) {
+				const uint64_t current = h->current.load(std::memory_order_acquire);
+				const ShmSlot& slot = *(const ShmSlot*)(region + h->slotOffset + current * h->slotBytes);
+				uint64_t s1 = slot.sequence.load(std::memory_order_acquire);
+				if (!(s1 & 1)) {
+					read(slot);
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (slot.sequence.load(std::memory_order_relaxed) == s1)
+						return true;
+				}
+				std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+				wait = std::min(wait * 2, std::max(slotSeconds, 1e-6));
+			}
+			return false;
+		}
+
+	private:
+		static constexpr double copyBytesPerSecond = 2e9; // rough memcpy throughput
+		const uint8_t* region = nullptr;
+		size_t regionBytes = 0;
+};
+
+#endif /* !SHM_EXPORT_H */
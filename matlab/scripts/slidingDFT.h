@@ -0,0 +1,130 @@
+#ifndef SLIDING_DFT_H
+#define SLIDING_DFT_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Streaming slow time DFT for all range bins at once.
+//
+// Keeps X_k = sum_{m=0}^{L-1} x(n-L+1+m) * exp(-2i*pi*k*m/N) for the last L
+// chirps and updates it per chirp with
+//   X_k <- (X_k - x(n-L)) * exp(2i*pi*k/N) + x(n) * exp(-2i*pi*k*(L-1)/N)
+// which is O(rangeBins * N). Rounding errors of the recursion accumulate, so
+// every reanchorPeriod chirps the state is recomputed directly from the
+// window which is kept anyway to know what leaves it.
+//
+// Data are split complex, chirps are [rangeBins] vectors and the spectrum is
+// [N x rangeBins] with range bins contiguous (MATLAB [rangeBins x N]).
+
+class SlidingDFT {
+	public:
+		size_t rangeBins = 0;
+		size_t dftSize = 0;        // N
+		size_t window = 0;         // L
+		size_t reanchorPeriod = 0; // 0 disables re-anchoring
+		size_t pushed = 0;         // number of chirps pushed since init
+
+		void init(size_t numRangeBins, size_t numBins, size_t windowLength, size_t reanchor)
+		{
+			rangeBins = numRangeBins;
+			dftSize = numBins;
+			window = windowLength;
+			reanchorPeriod = reanchor;
+			pushed = 0;
+			head = 0;
+			sinceAnchor = 0;
+			stateRe.assign(dftSize * rangeBins, 0.0f);
+			stateIm.assign(dftSize * rangeBins, 0.0f);
+			ringRe.assign(window * rangeBins, 0.0f);
+			ringIm.assign(window * rangeBins, 0.0f);
+			rotRe.resize(dftSize);
+			rotIm.resize(dftSize);
+			newRe.resize(dftSize);
+			newIm.resize(dftSize);
+			for (size_t k = 0; k < dftSize; k++) {
+				double a = 2.0 * M_PI * k / dftSize;
+				double b = -2.0 * M_PI * k * (double)(window - 1) / dftSize;
+				rotRe[k] = (float)std::cos(a);
+				rotIm[k] = (float)std::sin(a);
+				newRe[k] = (float)std::cos(b);
+				newIm[k] = (float)std::sin(b);
+			}
+		}
+
+		void push(const float* re, const float* im)
+		{
+			float* oldRe = &ringRe[head * rangeBins];
+			float* oldIm = &ringIm[head * rangeBins];
+
+			for (size_t k = 0; k < dftSize; k++) {
+				float* xr = &stateRe[k * rangeBins];
+				float* xi = &stateIm[k * rangeBins];
+				const float ar = rotRe[k], ai = rotIm[k];
+				const float br = newRe[k], bi = newIm[k];
+				for (size_t r = 0; r < rangeBins; r++) {
+					float dr = xr[r] - oldRe[r];
+					float di = xi[r] - oldIm[r];
+					xr[r] = dr * ar - di * ai + re[r] * br - im[r] * bi;
+					xi[r] = dr * ai + di * ar + re[r] * bi + im[r] * br;
+				}
+			}
+
+			std::memcpy(oldRe, re, rangeBins * sizeof(float));
+			std::memcpy(oldIm, im, rangeBins * sizeof(float));
+			head = (head + 1) % window;
+			pushed++;
+
+			if (reanchorPeriod != 0 && ++sinceAnchor >= reanchorPeriod) {
+				reanchor();
+			}
+		}
+
+		// recompute state directly from the window, O(rangeBins * N * L)
+		void reanchor()
+		{
+			std::memset(stateRe.data(), 0, stateRe.size() * sizeof(float));
+			std::memset(stateIm.data(), 0, stateIm.size() * sizeof(float));
+			for (size_t m = 0; m < window; m++) {
+				const float* xr = &ringRe[((head + m) % window) * rangeBins];
+				const float* xi = &ringIm[((head + m) % window) * rangeBins];
+				for (size_t k = 0; k < dftSize; k++) {
+					double a = -2.0 * M_PI * (double)((k * m) % dftSize) / dftSize;
+					float cr = (float)std::cos(a), ci = (float)std::sin(a);
+					float* sr = &stateRe[k * rangeBins];
+					float* si = &stateIm[k * rangeBins];
+					for (size_t r = 0; r < rangeBins; r++) {
+						sr[r] += xr[r] * cr - xi[r] * ci;
+						si[r] += xr[r] * ci + xi[r] * cr;
+					}
+				}
+			}
+			sinceAnchor = 0;
+		}
+
+		// copies spectrum in fftshift order (bin k = -N/2 first)
+		void spectrumShifted(float* outRe, float* outIm) const
+		{
+			for (size_t c = 0; c < dftSize; c++) {
+				size_t k = (c + dftSize / 2) % dftSize;
+				std::memcpy(outRe + c * rangeBins, &stateRe[k * rangeBins], rangeBins * sizeof(float));
+				std::memcpy(outIm + c * rangeBins, &stateIm[k * rangeBins], rangeBins * sizeof(float));
+			}
+		}
+
+		bool isFilled() const
+		{
+			return pushed >= window;
+		}
+
+	private:
+		size_t head = 0;          // ring slot holding the oldest chirp
+		size_t sinceAnchor = 0;
+		std::vector<float> stateRe, stateIm;  // [N x rangeBins]
+		std::vector<float> ringRe, ringIm;    // [L x rangeBins]
+		std::vector<float> rotRe, rotIm;      // exp(2i*pi*k/N)
+		std::vector<float> newRe, newIm;      // exp(-2i*pi*k*(L-1)/N)
+};
+
+#endif /* !SLIDING_DFT_H */
@@ -0,0 +1,74 @@
+#include "mex.h"
+#include "mexUtils.h"
+#include "slidingDFT.h"
+#include <vector>
+
+// Streaming Doppler engine, keeps sliding DFT state between calls
+//
+// slidingDoppler('init', rangeBins, speedNFFT, window, reanchorPeriod, firstBin)
+//   firstBin ... zero based first range bin of region of interest, 0 by default
+// spectrum = slidingDoppler('push', rangeFFT)
+//   rangeFFT ... complex range FFT of new chirp, rangeBins elements from firstBin are used
+// spectrum = slidingDoppler('spectrum')
+// filled = slidingDoppler('filled')
+//
+// spectrum is complex single [rangeBins x speedNFFT] in fftshift order, that is
+// same as fftshift(fft(lastChirps, speedNFFT, 2), 2) for window == speedNFFT
+
+static SlidingDFT sdft;
+static std::vector<float> chirpRe;
+static std::vector<float> chirpIm;
+static mwSize firstBin = 0;
+
+static mxArray* createSpectrum()
+{
+	mxArray* out = mxCreateNumericMatrix(sdft.rangeBins, sdft.dftSize, mxSINGLE_CLASS, mxCOMPLEX);
+	sdft.spectrumShifted((float*)mxGetData(out), (float*)mxGetImagData(out));
+	return out;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	std::string command = getCommand(nrhs, prhs);
+
+	if (command == "init") {
+		if (nrhs < 4) {
+			mexErrMsgTxt("init requires: rangeBins, speedNFFT, window[, reanchorPeriod, firstBin]");
+		}
+		mwSize rangeBins = (mwSize)mxGetScalar(prhs[1]);
+		mwSize N = (mwSize)mxGetScalar(prhs[2]);
+		mwSize window = (mwSize)mxGetScalar(prhs[3]);
+		mwSize reanchor = nrhs > 4 ? (mwSize)mxGetScalar(prhs[4]) : 1024;
+		firstBin = nrhs > 5 ? (mwSize)mxGetScalar(prhs[5]) : 0;
+		if (rangeBins == 0 || N == 0 || window == 0) {
+			mexErrMsgTxt("rangeBins, speedNFFT and window must be positive.");
+		}
+		sdft.init(rangeBins, N, window, reanchor);
+		chirpRe.resize(rangeBins);
+		chirpIm.resize(rangeBins);
+		return;
+	}
+
+	if (sdft.rangeBins == 0) {
+		mexErrMsgTxt("slidingDoppler is not initialized, call init first.");
+	}
+
+	if (command == "push") {
+		if (nrhs < 2) {
+			mexErrMsgTxt("push requires range FFT of new chirp.");
+		}
+		if (mxGetNumberOfElements(prhs[1]) < firstBin + sdft.rangeBins) {
+			mexErrMsgTxt("range FFT is shorter than firstBin + number of range bins.");
+		}
+		toSplitFloat(prhs[1], chirpRe.data(), chirpIm.data(), sdft.rangeBins, firstBin);
+		sdft.push(chirpRe.data(), chirpIm.data());
+		if (nlhs > 0) {
+			plhs[0] = createSpectrum();
+		}
+	} else if (command == "spectrum") {
+		plhs[0] = createSpectrum();
+	} else if (command == "filled") {
+		plhs[0] = mxCreateLogicalScalar(sdft.isFilled());
+	} else {
+		mexErrMsgIdAndTxt("slidingDoppler:command", "Unknown command %s", command.c_str());
+	}
+}
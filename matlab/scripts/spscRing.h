@@ -0,0 +1,144 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Bounded single producer single consumer ring with preallocated slots
+//
+// Slots are constructed once in init() and reused, producer fills slot in
+// place between claim() and publish(), consumer reads it between peek() and
+// release(). Neither side allocates, locks or blocks, full ring is reported
+// by claim() returning nullptr and it is up to the producer to count the drop.
+// Head and tail live on separate cache lines, each side keeps cached copy of
+// the other index so shared line is only touched when ring looks full/empty.
+
+template <typename T>
+class SPSCRing {
+	public:
+		// capacity is rounded up to power of two
+		void init(size_t capacity)
+		{
+			size_t n = 1;
+			while (n < capacity)
+				n <<= 1;
+			slots.clear();
+			slots.resize(n);
+			mask = n - 1;
+			head.store(0, std::memory_order_relaxed);
+			tail.store(0, std::memory_order_relaxed);
+			cachedHead = 0;
+			cachedTail = 0;
+		}
+
+		// apply fn to every slot, used to preallocate slot buffers
+		template <typename F>
+		void forEach(F fn)
+		{
+			for (T& slot : slots)
+				fn(slot);
+		}
+
+		size_t capacity() const
+		{
+			return slots.size();
+		}
+
+		size_t size() const
+		{
+			return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+		}
+
+		// producer side
+		T* claim()
+		{
+			size_t t = tail.load(std::memory_order_relaxed);
+			if (t - cachedHead > mask) {
+				cachedHead = head.load(std::memory_order_acquire);
+				if (t - cachedHead > mask)
+					return nullptr;
+			}
+			return &slots[t & mask];
+		}
+
+		void publish()
+		{
+			tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// consumer side
+		T* peek()
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == cachedTail) {
+				cachedTail = tail.load(std::memory_order_acquire);
+				if (h == cachedTail)
+					return nullptr;
+			}
+			return &slots[h & mask];
+		}
+
+		void release()
+		{
+			head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+	private:
+		std::vector<T> slots;
+		size_t mask = 0;
+		alignas(64) std::atomic<size_t> head{0}; // written by consumer
+		alignas(64) size_t cachedTail = 0;       // consumer copy of tail
+		alignas(64) std::atomic<size_t> tail{0}; // written by producer
+		alignas(64) size_t cachedHead = 0;       // producer copy of head
+};
+
+// Idle strategy for stage threads: spin shortly, then yield, then sleep so
+// that idle pipeline doesn't burn whole cores
+class IdleBackoff {
+	public:
+		void idle()
+		{
+			if (count < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+				__builtin_ia32_pause();
+#endif
+			} else if (count < 128) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+			count++;
+		}
+
+		void reset()
+		{
+			count = 0;
+		}
+
+	private:
+		unsigned count = 0;
+};
+
+// pin calling thread to given core, cpu < 0 leaves scheduling to the OS
+inline bool pinThread(int cpu)
+{
+	if (cpu < 0)
+		return true;
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+#endif /* !SPSC_RING_H */
@@ -0,0 +1,71 @@
+#include "mex.h"
+#include "mexUtils.h"
+#include "targetTracker.h"
+
+// Persistent multi target tracker
+//
+// targetTracker('init', measurementNoise, processNoise, gate, confirmHits, maxMisses)
+//   all parameters are optional, see TrackerParameters for defaults
+// tracks = targetTracker('update', time, detections)
+//   time ... timestamp of the update [s]
+//   detections ... [n x 3] double, cartesian x, y, z [m]
+// tracks = targetTracker('tracks')
+// targetTracker('reset')
+//
+// tracks ... [numTracks x 10] double, one row per track:
+//   id, x, y, z, vx, vy, vz, age [s], hits, confirmed
+
+static TargetTracker tracker;
+
+static mxArray* createTracks()
+{
+	const mwSize columns = 10;
+	mwSize n = tracker.tracks.size();
+	mxArray* out = mxCreateDoubleMatrix(n, columns, mxREAL);
+	double* data = mxGetPr(out);
+	for (mwSize i = 0; i < n; i++) {
+		const Track& t = tracker.tracks[i];
+		double row[columns] = {(double)t.id, t.pos[0], t.pos[1], t.pos[2], t.vel[0], t.vel[1], t.vel[2],
+			t.lastUpdate - t.created, (double)t.hits, t.confirmed ? 1.0 : 0.0};
+		for (mwSize c = 0; c < columns; c++) {
+			data[i + c * n] = row[c];
+		}
+	}
+	return out;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	std::string command = getCommand(nrhs, prhs);
+
+	if (command == "init") {
+		TrackerParameters params;
+		if (nrhs > 1) params.measurementNoise = mxGetScalar(prhs[1]);
+		if (nrhs > 2) params.processNoise = mxGetScalar(prhs[2]);
+		if (nrhs > 3) params.gate = mxGetScalar(prhs[3]);
+		if (nrhs > 4) params.confirmHits = (unsigned)mxGetScalar(prhs[4]);
+		if (nrhs > 5) params.maxMisses = (unsigned)mxGetScalar(prhs[5]);
+		if (params.measurementNoise <= 0 || params.gate <= 0) {
+			mexErrMsgTxt("measurementNoise and gate must be positive.");
+		}
+		tracker.params = params;
+		tracker.reset();
+	} else if (command == "update") {
+		if (nrhs != 3) {
+			mexErrMsgTxt("update requires: time, detections");
+		}
+		if (!mxIsDouble(prhs[2]) || (mxGetNumberOfElements(prhs[2]) != 0 && mxGetN(prhs[2]) != 3)) {
+			mexErrMsgTxt("detections must be double [n x 3] matrix (x, y, z).");
+		}
+		mwSize n = mxGetNumberOfElements(prhs[2]) == 0 ? 0 : mxGetM(prhs[2]);
+		tracker.update(mxGetScalar(prhs[1]), mxGetPr(prhs[2]), n);
+		if (nlhs > 0) {
+			plhs[0] = createTracks();
+		}
+	} else if (command == "tracks") {
+		plhs[0] = createTracks();
+	} else if (command == "reset") {
+		tracker.reset();
+	} else {
+		mexErrMsgIdAndTxt("targetTracker:command", "Unknown command %s", command.c_str());
+	}
+}
@@ -0,0 +1,228 @@
+#ifndef TARGET_TRACKER_H
+#define TARGET_TRACKER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Multi target tracker working on cartesian detections
+//
+// Every track is a constant velocity Kalman filter. Axes are independent so
+// each one keeps 2x2 covariance of (position, velocity). Detections are
+// binned into a spatial hash with cell size equal to the widest gate, so every
+// track only looks at detections in adjacent cells. Gated pairs are assigned
+// greedily by increasing normalized distance (global nearest neighbour
+// approximation). Unassigned detections start tentative tracks, tracks are
+// confirmed after confirmHits updates and dropped after maxMisses updates
+// without detection.
+
+struct TrackerParameters {
+	double measurementNoise = 0.1; // std of detection position [m]
+	double processNoise = 1.0;     // std of acceleration [m/s^2]
+	double gate = 11.34;           // chi-square gate on normalized distance (3 dof, 99 %)
+	unsigned confirmHits = 3;      // hits needed to confirm track
+	unsigned maxMisses = 5;        // consecutive misses before track is deleted
+};
+
+struct Track {
+	uint32_t id;
+	double pos[3];
+	double vel[3];
+	double P[3][3];       // per axis covariance [pp, pv, vv]
+	double created;       // time of first detection
+	double lastUpdate;    // time of last update
+	unsigned hits;
+	unsigned misses;
+	bool confirmed;
+};
+
+class TargetTracker {
+	public:
+		TrackerParameters params;
+		std::vector<Track> tracks;
+
+		void reset()
+		{
+			tracks.clear();
+			nextId = 1;
+			lastTime = -1;
+		}
+
+		// detections ... [n x 3] column major x, y, z
+		void update(double time, const double* detections, size_t n)
+		{
+			double dt = lastTime < 0 ? 0.0 : std::max(time - lastTime, 0.0);
+			lastTime = time;
+
+			for (Track& t : tracks) {
+				predict(t, dt);
+			}
+
+			// spatial hash of detections, cell sized to the widest gate
+			double maxS = params.measurementNoise * params.measurementNoise;
+			for (const Track& t : tracks) {
+				for (int a = 0; a < 3; a++) {
+					maxS = std::max(maxS, t.P[a][0] + params.measurementNoise * params.measurementNoise);
+				}
+			}
+			cellSize = std::sqrt(params.gate * maxS);
+			hash.clear();
+			for (size_t d = 0; d < n; d++) {
+				hash[key(cell(detections[d]), cell(detections[n + d]), cell(detections[2 * n + d]))].push_back(d);
+			}
+
+			// gated candidate pairs
+			candidates.clear();
+			for (size_t ti = 0; ti < tracks.size(); ti++) {
+				const Track& t = tracks[ti];
+				int64_t cx = cell(t.pos[0]), cy = cell(t.pos[1]), cz = cell(t.pos[2]);
+				for (int64_t ix = cx - 1; ix <= cx + 1; ix++) {
+					for (int64_t iy = cy - 1; iy <= cy + 1; iy++) {
+						for (int64_t iz = cz - 1; iz <= cz + 1; iz++) {
+							auto it = hash.find(key(ix, iy, iz));
+							if (it == hash.end()) {
+								continue;
+							}
+							for (size_t d : it->second) {
+								double cost = distance(t, detections[d], detections[n + d], detections[2 * n + d]);
+								if (cost <= params.gate) {
+									candidates.push_back({cost, ti, d});
+								}
+							}
+						}
+					}
+				}
+			}
+			std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+				return a.cost < b.cost;
+			});
+
+			std::vector<uint8_t> trackUsed(tracks.size(), 0);
+			std::vector<uint8_t> detectionUsed(n, 0);
+			for (const Candidate& c : candidates) {
+				if (trackUsed[c.track] || detectionUsed[c.detection]) {
+					continue;
+				}
+				trackUsed[c.track] = 1;
+				detectionUsed[c.detection] = 1;
+				double z[3] = {detections[c.detection], detections[n + c.detection], detections[2 * n + c.detection]};
+				correct(tracks[c.track], z, time);
+			}
+
+			for (size_t ti = 0; ti < tracks.size(); ti++) {
+				if (!trackUsed[ti]) {
+					tracks[ti].misses++;
+				}
+			}
+			tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [&](const Track& t) {
+				return t.misses > params.maxMisses || (!t.confirmed && t.misses > 0);
+			}), tracks.end());
+
+			for (size_t d = 0; d < n; d++) {
+				if (!detectionUsed[d]) {
+					double z[3] = {detections[d], detections[n + d], detections[2 * n + d]};
+					spawn(z, time);
+				}
+			}
+		}
+
+	private:
+		struct Candidate {
+			double cost;
+			size_t track;
+			size_t detection;
+		};
+
+		uint32_t nextId = 1;
+		double lastTime = -1;
+		double cellSize = 1;
+		std::unordered_map<uint64_t, std::vector<size_t>> hash;
+		std::vector<Candidate> candidates;
+
+		int64_t cell(double v) const
+		{
+			return (int64_t)std::floor(v / cellSize);
+		}
+
+		static uint64_t key(int64_t cx, int64_t cy, int64_t cz)
+		{
+			const int64_t offset = 1 << 20;
+			return ((uint64_t)(cx + offset) & 0x1FFFFF) << 42
+				| ((uint64_t)(cy + offset) & 0x1FFFFF) << 21
+				| ((uint64_t)(cz + offset) & 0x1FFFFF);
+		}
+
+		void predict(Track& t, double dt) const
+		{
+			double q = params.processNoise * params.processNoise;
+			for (int a = 0; a < 3; a++) {
+				t.pos[a] += t.vel[a] * dt;
+				double pp = t.P[a][0], pv = t.P[a][1], vv = t.P[a][2];
+				// P = F P F' + Q, white acceleration model
+				t.P[a][0] = pp + 2 * dt * pv + dt * dt * vv + q * dt * dt * dt * dt / 4;
+				t.P[a][1] = pv + dt * vv + q * dt * dt * dt / 2;
+				t.P[a][2] = vv + q * dt * dt;
+			}
+		}
+
+		double distance(const Track& t, double x, double y, double z) const
+		{
+			double r = params.measurementNoise * params.measurementNoise;
+			double m[3] = {x, y, z};
+			double d = 0;
+			for (int a = 0; a < 3; a++) {
+				double innovation = m[a] - t.pos[a];
+				d += innovation * innovation / (t.P[a][0] + r);
+			}
+			return d;
+		}
+
+		void correct(Track& t, const double* z, double time)
+		{
+			double r = params.measurementNoise * params.measurementNoise;
+			for (int a = 0; a < 3; a++) {
+				double s = t.P[a][0] + r;
+				double kp = t.P[a][0] / s;
+				double kv = t.P[a][1] / s;
+				double innovation = z[a] - t.pos[a];
+				t.pos[a] += kp * innovation;
+				t.vel[a] += kv * innovation;
+				double pp = t.P[a][0], pv = t.P[a][1], vv = t.P[a][2];
+				t.P[a][0] = (1 - kp) * pp;
+				t.P[a][1] = (1 - kp) * pv;
+				t.P[a][2] = vv - kv * pv;
+			}
+			t.hits++;
+			t.misses = 0;
+			t.lastUpdate = time;
+			if (t.hits >= params.confirmHits) {
+				t.confirmed = true;
+			}
+		}
+
+		void spawn(const double* z, double time)
+		{
+			Track t{};
+			t.id = nextId++;
+			// initial velocity is unknown, allow target to move few meters per second
+			const double initialVelocity = 5.0;
+			double r = params.measurementNoise * params.measurementNoise;
+			for (int a = 0; a < 3; a++) {
+				t.pos[a] = z[a];
+				t.vel[a] = 0;
+				t.P[a][0] = r;
+				t.P[a][1] = 0;
+				t.P[a][2] = initialVelocity * initialVelocity;
+			}
+			t.created = time;
+			t.lastUpdate = time;
+			t.hits = 1;
+			t.confirmed = params.confirmHits <= 1;
+			tracks.push_back(t);
+		}
+};
+
+#endif /* !TARGET_TRACKER_H */
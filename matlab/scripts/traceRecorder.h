@@ -0,0 +1,285 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Event tracing for chirp to display latency analysis
+//
+// Every thread records begin/end (and instant) events into its own ring of
+// TraceRecord, so recording is a clock read and a few stores without any
+// synchronization, the oldest records are overwritten. Records carry chirp ID,
+// radar reader takes IDs from nextChirpId and links them to frame timestamp,
+// pipeline looks the timestamp up when the frame is pushed back from MATLAB,
+// so one chirp can be followed from serial port to cube update. Rings are
+// exported as Chrome Trace Event JSON (chrome://tracing, Perfetto).
+//
+// Disabled tracer costs one relaxed load per event. Rings of exited threads are
+// reused by new ones, thread ID is stored in every record.
+
+struct TraceRecord {
+	uint64_t ns = 0;   // steady clock
+	uint64_t id = 0;   // chirp ID, generation of cube update, batch...
+	uint32_t tid = 0;
+	uint16_t name = 0;
+	char phase = 'i';  // B, E, i, or async b, e
+};
+
+class TraceBuffer {
+	public:
+		std::atomic<bool> owned{true};
+		uint32_t tid = 0;
+
+		explicit TraceBuffer(size_t capacity)
+		{
+			size_t c = 1;
+			while (c < capacity)
+				c <<= 1;
+			records.resize(c);
+			mask = c - 1;
+		}
+
+		// owner thread only
+		void add(const TraceRecord& r)
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			records[h & mask] = r;
+			head.store(h + 1, std::memory_order_release);
+		}
+
+		// copies retained records, slack newest slots of lap are left out as
+		// owner may be overwriting them meanwhile
+		void snapshot(std::vector<TraceRecord>& out) const
+		{
+			const size_t slack = 16;
+			size_t h = head.load(std::memory_order_acquire);
+			size_t n = std::min(h, records.size() > slack ? records.size() - slack : 0);
+			for (size_t k = h - n; k < h; k++)
+				out.push_back(records[k & mask]);
+		}
+
+		void clear()
+		{
+			head.store(0, std::memory_order_release);
+		}
+
+	private:
+		std::vector<TraceRecord> records;
+		size_t mask = 0;
+		std::atomic<size_t> head{0};
+};
+
+class TraceRecorder {
+	public:
+		// never destroyed, exiting threads may still release their rings
+		static TraceRecorder& instance()
+		{
+			static TraceRecorder* recorder = new TraceRecorder();
+			return *recorder;
+		}
+
+		bool on() const
+		{
+			return enabled.load(std::memory_order_relaxed);
+		}
+
+		// capacity ... records per thread, applies to rings created afterwards
+		void enable(bool on, size_t capacity = 1 << 16)
+		{
+			ringCapacity.store(capacity, std::memory_order_relaxed);
+			enabled.store(on, std::memory_order_release);
+		}
+
+		// index of interned event name, characters not allowed in JSON string
+		// are replaced
+		uint16_t name(std::string text)
+		{
+			for (char& c : text) {
+				if (c == '"' || c == '\\' || (unsigned char)c < 0x20)
+					c = '_';
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t k = 0; k < names.size(); k++) {
+				if (names[k] == text)
+					return (uint16_t)k;
+			}
+			names.push_back(text);
+			return (uint16_t)(names.size() - 1);
+		}
+
+		// names calling thread in exported trace, ring itself is created with
+		// the first record
+		void threadName(const std::string& text)
+		{
+			mine().name = text;
+		}
+
+		void begin(uint16_t event, uint64_t id) { record(event, id, 'B'); }
+		void end(uint16_t event, uint64_t id) { record(event, id, 'E'); }
+		void instant(uint16_t event, uint64_t id) { record(event, id, 'i'); }
+
+		void record(uint16_t event, uint64_t id, char phase)
+		{
+			if (!on())
+				return;
+			TraceRecord r;
+			r.ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+			r.id = id;
+			r.name = event;
+			r.phase = phase;
+			TraceBuffer* b = local();
+			r.tid = b->tid;
+			b->add(r);
+		}
+
+		uint64_t nextChirpId()
+		{
+			return chirpCounter.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// frame timestamp -> chirp ID, single writer (radar reader)
+		void link(double time, uint64_t id)
+		{
+			size_t h = linkHead.load(std::memory_order_relaxed);
+			Link& l = links[h % numLinks];
+			l.id.store(UINT64_MAX, std::memory_order_relaxed);
+			l.time.store(time, std::memory_order_relaxed);
+			l.id.store(id, std::memory_order_release);
+			linkHead.store(h + 1, std::memory_order_release);
+		}
+
+		// ID linked to exactly this timestamp, newest first, otherwise new ID
+		uint64_t linkedId(double time)
+		{
+			size_t h = linkHead.load(std::memory_order_acquire);
+			for (size_t k = 0; k < std::min(h, numLinks); k++) {
+				const Link& l = links[(h - 1 - k) % numLinks];
+				uint64_t id = l.id.load(std::memory_order_acquire);
+				if (id != UINT64_MAX && l.time.load(std::memory_order_relaxed) == time)
+					return id;
+			}
+			return nextChirpId();
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (std::unique_ptr<TraceBuffer>& b : buffers)
+				b->clear();
+		}
+
+		// writes Chrome Trace Event JSON, returns number of events or -1 on error
+		long exportJson(const std::string& path)
+		{
+			std::vector<TraceRecord> all;
+			std::vector<std::string> eventNames;
+			std::vector<std::string> tidNames;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (const std::unique_ptr<TraceBuffer>& b : buffers)
+					b->snapshot(all);
+				eventNames = names;
+				tidNames = threadNames;
+			}
+			std::stable_sort(all.begin(), all.end(),
+					[](const TraceRecord& a, const TraceRecord& b) { return a.ns < b.ns; });
+
+			FILE* fp = std::fopen(path.c_str(), "w");
+			if (!fp)
+				return -1;
+			std::fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+			bool first = true;
+			for (size_t t = 0; t < tidNames.size(); t++) {
+				if (tidNames[t].empty())
+					continue;
+				std::fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+						first ? "" : ",\n", t, tidNames[t].c_str());
+				first = false;
+			}
+			uint64_t origin = all.empty() ? 0 : all.front().ns;
+			for (const TraceRecord& r : all) {
+				const char* text = r.name < eventNames.size() ? eventNames[r.name].c_str() : "?";
+				std::fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+						first ? "" : ",\n", text, r.phase, (double)(r.ns - origin) * 1e-3, r.tid);
+				if (r.phase == 'b' || r.phase == 'e')
+					std::fprintf(fp, ",\"cat\":\"async\",\"id\":%llu", (unsigned long long)r.id);
+				if (r.phase == 'i')
+					std::fprintf(fp, ",\"s\":\"t\"");
+				std::fprintf(fp, ",\"args\":{\"id\":%llu}}", (unsigned long long)r.id);
+				first = false;
+			}
+			std::fprintf(fp, "\n]}\n");
+			if (std::fclose(fp) != 0)
+				return -1;
+			return (long)all.size();
+		}
+
+	private:
+		struct Link {
+			std::atomic<double> time{0.0};
+			std::atomic<uint64_t> id{UINT64_MAX};
+		};
+		static constexpr size_t numLinks = 1024;
+
+		// releases ring of exiting thread for reuse
+		struct LocalBuffer {
+			TraceBuffer* buffer = nullptr;
+			std::string name;
+			~LocalBuffer()
+			{
+				if (buffer)
+					buffer->owned.store(false, std::memory_order_release);
+			}
+		};
+
+		std::atomic<bool> enabled{false};
+		std::atomic<size_t> ringCapacity{1 << 16};
+		std::atomic<uint64_t> chirpCounter{0};
+		std::mutex mutex;
+		std::vector<std::unique_ptr<TraceBuffer>> buffers;
+		std::vector<std::string> names;
+		std::vector<std::string> threadNames;
+		uint32_t nextTid = 1;
+		Link links[numLinks];
+		std::atomic<size_t> linkHead{0};
+
+		static LocalBuffer& mine()
+		{
+			static thread_local LocalBuffer local;
+			return local;
+		}
+
+		TraceBuffer* local()
+		{
+			LocalBuffer& m = mine();
+			if (m.buffer)
+				return m.buffer;
+			std::lock_guard<std::mutex> lock(mutex);
+			for (std::unique_ptr<TraceBuffer>& b : buffers) {
+				bool expected = false;
+				if (b->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					m.buffer = b.get();
+					break;
+				}
+			}
+			if (!m.buffer) {
+				buffers.emplace_back(new TraceBuffer(ringCapacity.load(std::memory_order_relaxed)));
+				m.buffer = buffers.back().get();
+			}
+			m.buffer->tid = nextTid++;
+			if (threadNames.size() <= m.buffer->tid)
+				threadNames.resize(m.buffer->tid + 1);
+			threadNames[m.buffer->tid] = m.name.empty() ? "thread " + std::to_string(m.buffer->tid) : m.name;
+			return m.buffer;
+		}
+};
+
+#endif /* !TRACE_RECORDER_H */
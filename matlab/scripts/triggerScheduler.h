@@ -0,0 +1,219 @@
+#ifndef TRIGGER_SCHEDULER_H
+#define TRIGGER_SCHEDULER_H
+
+#include "poseTimeline.h"
+#include "serialPort.h"
+#include "traceRecorder.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+
+// Native radar trigger
+//
+// Thread waits on periodic CLOCK_MONOTONIC timerfd and calls fire (writes
+// trigger command to the radar). Difference between actual wake up and
+// scheduled expiration is accumulated as jitter, expirations that passed
+// while thread didn't run are counted as missed.
+//
+// Angle locked mode: timer only samples pose timeline every pollPeriod,
+// trigger fires whenever yaw moves to another angleStep wide cell, so chirps
+// are evenly spaced in angle and nothing is fired while platform stands.
+// Triggers are never closer than minInterval (chirp period of the radar),
+// cells crossed meanwhile are counted as skipped. Pose at current time is
+// clamped to the last report, so crossing is seen with delay of one platform
+// report at most.
+
+struct TriggerConfig {
+	double period = 0.02;      // s, periodic mode
+	double angleStep = 0;      // deg, > 0 selects angle locked mode
+	double pollPeriod = 0.001; // s, pose sampling in angle locked mode
+	double minInterval = 0.02; // s, angle locked mode
+	double startDelay = 0;     // s, first expiration
+	int poseMode = POSE_LINEAR;
+};
+
+struct TriggerStats {
+	std::atomic<uint64_t> triggers{0};
+	std::atomic<uint64_t> failed{0};       // fire returned false
+	std::atomic<uint64_t> missed{0};       // timer expirations not served in time
+	std::atomic<uint64_t> skippedCells{0}; // angle cells crossed without trigger
+	std::atomic<uint64_t> wakeups{0};
+	std::atomic<uint64_t> jitterSumNs{0};
+	std::atomic<uint64_t> jitterSumSqUs{0}; // us^2, ns^2 would overflow within hours
+	std::atomic<uint64_t> jitterMaxNs{0};
+
+	void reset()
+	{
+		for (std::atomic<uint64_t>* c : {&triggers, &failed, &missed, &skippedCells, &wakeups,
+				&jitterSumNs, &jitterSumSqUs, &jitterMaxNs})
+			c->store(0, std::memory_order_relaxed);
+	}
+};
+
+class TriggerScheduler {
+	public:
+		TriggerStats stats;
+
+		~TriggerScheduler() { stop(); }
+
+		bool isRunning() const
+		{
+			return running.load(std::memory_order_acquire);
+		}
+
+		// timeNow is current time in MATLAB time base, needed by angle locked mode
+		void start(const TriggerConfig& config, std::function<bool()> fireFn,
+				const PoseTimeline* timeline, double timeNow)
+		{
+			stop();
+			cfg = config;
+			fire = std::move(fireFn);
+			poses = timeline;
+			timeBase = timeNow - monotonicSeconds();
+			stats.reset();
+
+			fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+			if (fd < 0)
+				throw std::runtime_error("timerfd_create failed");
+			interval = cfg.angleStep > 0 ? cfg.pollPeriod : cfg.period;
+			if (interval <= 0) {
+				::close(fd);
+				fd = -1;
+				throw std::runtime_error("trigger period must be positive");
+			}
+			double first = cfg.startDelay > 0 ? cfg.startDelay : interval;
+			struct itimerspec spec;
+			spec.it_interval = toTimespec(interval);
+			spec.it_value = toTimespec(first);
+			nextExpiration = monotonicSeconds() + first;
+			if (timerfd_settime(fd, 0, &spec, nullptr) != 0) {
+				::close(fd);
+				fd = -1;
+				throw std::runtime_error("timerfd_settime failed");
+			}
+			running.store(true, std::memory_order_release);
+			thread = std::thread(&TriggerScheduler::run, this);
+		}
+
+		void stop()
+		{
+			running.store(false, std::memory_order_release);
+			if (thread.joinable())
+				thread.join();
+			if (fd >= 0)
+				::close(fd);
+			fd = -1;
+		}
+
+	private:
+		int fd = -1;
+		std::thread thread;
+		std::atomic<bool> running{false};
+		TriggerConfig cfg;
+		std::function<bool()> fire;
+		const PoseTimeline* poses = nullptr;
+		double timeBase = 0;
+		double interval = 0;
+		double nextExpiration = 0; // monotonic s
+
+		static struct timespec toTimespec(double seconds)
+		{
+			struct timespec ts;
+			ts.tv_sec = (time_t)seconds;
+			ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+			return ts;
+		}
+
+		void run()
+		{
+			TraceRecorder::instance().threadName("trigger");
+			struct pollfd pfd = {fd, POLLIN, 0};
+			long lastCell = 0;
+			bool haveCell = false;
+			bool pending = false;
+			double lastTrigger = -1e9;
+			while (running.load(std::memory_order_acquire)) {
+				if (::poll(&pfd, 1, 100) <= 0)
+					continue;
+				uint64_t expirations = 0;
+				if (::read(fd, &expirations, sizeof(expirations)) != sizeof(expirations) || expirations == 0)
+					continue;
+				double now = monotonicSeconds();
+				recordJitter(now - nextExpiration);
+				if (expirations > 1)
+					stats.missed.fetch_add(expirations - 1, std::memory_order_relaxed);
+				nextExpiration += (double)expirations * interval;
+
+				if (cfg.angleStep <= 0) {
+					trigger();
+					continue;
+				}
+
+				double yaw, pitch;
+				if (!poses || !poses->at(now + timeBase, yaw, pitch, cfg.poseMode))
+					continue;
+				long cell = (long)std::floor(yaw / cfg.angleStep);
+				if (!haveCell) {
+					lastCell = cell;
+					haveCell = true;
+					continue;
+				}
+				if (cell != lastCell) {
+					// every crossed cell wants a trigger, one pending is fired
+					uint64_t crossed = cellDelta(cell, lastCell);
+					uint64_t skipped = pending ? crossed : crossed - 1;
+					if (skipped > 0)
+						stats.skippedCells.fetch_add(skipped, std::memory_order_relaxed);
+					lastCell = cell;
+					pending = true;
+				}
+				if (pending && now - lastTrigger >= cfg.minInterval) {
+					trigger();
+					lastTrigger = now;
+					pending = false;
+				}
+			}
+		}
+
+		// cells between two poses, shorter way around when yaw wraps
+		uint64_t cellDelta(long cell, long lastCell) const
+		{
+			uint64_t delta = (uint64_t)std::labs(cell - lastCell);
+			const uint64_t turn = (uint64_t)std::lround(360.0 / cfg.angleStep);
+			if (turn > 0 && delta < turn && delta > turn / 2)
+				delta = turn - delta;
+			return delta;
+		}
+
+		void trigger()
+		{
+			TraceRecorder& trace = TraceRecorder::instance();
+			static const uint16_t event = trace.name("trigger");
+			trace.instant(event, stats.triggers.load(std::memory_order_relaxed));
+			if (fire && fire())
+				stats.triggers.fetch_add(1, std::memory_order_relaxed);
+			else
+				stats.failed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void recordJitter(double late)
+		{
+			uint64_t ns = late > 0 ? (uint64_t)(late * 1e9) : 0;
+			uint64_t us = ns / 1000;
+			stats.wakeups.fetch_add(1, std::memory_order_relaxed);
+			stats.jitterSumNs.fetch_add(ns, std::memory_order_relaxed);
+			stats.jitterSumSqUs.fetch_add(us * us, std::memory_order_relaxed);
+			if (ns > stats.jitterMaxNs.load(std::memory_order_relaxed))
+				stats.jitterMaxNs.store(ns, std::memory_order_relaxed);
+		}
+};
+
+#endif /* !TRIGGER_SCHEDULER_H */